@@ -0,0 +1,39 @@
+#include "../lib/board.h"
+#include "../lib/arbiter.h"
+#include "../lib/led_bcm.h"
+#include <avr/interrupt.h>
+
+int main(void) {
+    BoardInit();
+    ArbInit();
+    LedBcmInit();
+    LcdInit(LCD_MODE_8BIT);
+    sei();
+    LcdStart(2, 16);
+    LcdPrint("LEDs+7seg+LCD");
+
+    uint8_t levels[LED_BCM_LEDS] = { 0 };
+    uint8_t pos = 0;
+    int32_t count = 0;
+
+    while (1) {
+        // 7-segment counter and a rotating LED scanner with a fading tail
+        ArbSegPrintInt(count);
+        for (uint8_t i = 0; i < LED_BCM_LEDS; i++) levels[i] >>= 1;
+        levels[pos] = 255;
+        pos = (pos + 1) & (LED_BCM_LEDS - 1);
+        LedBcmSetAll(levels);
+
+        // The LCD shares PORTA with both latches; the arbiter keeps them apart
+        LcdSetCursor(1, 0);
+        LcdPrintInt(ArbMaxIsrTicks());
+        LcdPrint("us ");
+        LcdPrintInt(ArbLateEvents());
+        LcdPrint(" late  ");
+
+        count++;
+        _delay_ms(100);
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "../lib/lcd.h"
+#include "../lib/keypad.h"
+#include "../lib/leds.h"
+#include "../lib/startup.h"
+
+// The decorative LED blink takes 500 ms; as a start-up task it no longer delays the LCD
+#ifndef FAST_BOOT_LED_FLASH
+#define FAST_BOOT_LED_FLASH 0
+#endif
+
+static uint16_t pot;    // VR1
+
+// LCD task: greet as soon as the display is ready
+static uint32_t lcd_task(uint8_t step) {
+    uint32_t wait = LcdStartStep(step);
+    if (wait == STARTUP_DONE) LcdPrint("BK-AVR128 ready");
+    return wait;
+}
+
+// VR1 on ADC0: the first conversion takes 25 ADC clocks (200 us at 125 kHz)
+static uint32_t adc_task(uint8_t step) {
+    if (step == 0) {
+        ADMUX = (1 << REFS0);                                                   // AVCC, ADC0
+        ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADPS2) | (1 << ADPS1);       // F_CPU / 64
+        return 200;
+    }
+    if (ADCSRA & (1 << ADSC)) return STARTUP_REPEAT | 20;
+    pot = ADC;
+    return STARTUP_DONE;
+}
+
+static uint32_t keypad_task(uint8_t step) {
+    (void)step;
+    KeypadInit();
+    return STARTUP_DONE;
+}
+
+int main(void) {
+    StartupTask_t tasks[] = {
+        STARTUP_TASK(lcd_task),
+        STARTUP_TASK(adc_task),
+        STARTUP_TASK(keypad_task),
+#if FAST_BOOT_LED_FLASH
+        STARTUP_TASK(LedsFlashStep),
+#endif
+    };
+
+    LcdBegin(LCD_MODE_8BIT, 2, 16);
+    StartupRun(tasks, sizeof(tasks) / sizeof(tasks[0]));
+
+    // Time to the first output, counted from the start of the sequencer
+    LcdSetCursor(1, 0);
+    LcdPrint("LCD ");
+    LcdPrintInt(tasks[0].done_us / 1000);
+    LcdPrint(" ms");
+    _delay_ms(2000);
+
+    while (1) {
+        uint8_t key = KeypadRead();
+
+        ADCSRA |= (1 << ADSC);
+        while (ADCSRA & (1 << ADSC));
+        pot = ADC;
+
+        LcdSetCursor(1, 0);
+        LcdPrint("VR1 ");
+        LcdPrintInt(pot);
+        LcdPrint(" key ");
+        LcdPrintInt(key);
+        LcdPrint("    ");
+        _delay_ms(100);
+    }
+
+    return 0;
+}
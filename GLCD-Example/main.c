@@ -0,0 +1,60 @@
+#include "../lib/glcd.h"
+
+#define GRAPH_TOP     12    // First row of the graph area
+#define GRAPH_HEIGHT  52    // Rows 12-63
+
+// Read VR1 (ADC0 on PF0), 8-bit result
+static uint8_t read_pot(void) {
+    ADCSRA |= (1 << ADSC);
+    while (ADCSRA & (1 << ADSC));
+    return ADCH;
+}
+
+int main(void) {
+    // Initialize LCD12864 (J15 jumper on the parallel side)
+    GlcdInit(GLCD_MODE_PARALLEL);
+
+    // ADC: AVCC reference, left-adjusted result, F_CPU / 64
+    ADMUX = (1 << REFS0) | (1 << ADLAR);
+    ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1);
+
+    // Static part of the dashboard, drawn once
+    GlcdPrint_P(0, 0, PSTR("VR1"), GLCD_BLACK);
+    GlcdPrint_P(66, 0, PSTR("words"), GLCD_BLACK);
+    GlcdHLine(0, GRAPH_TOP - 2, GLCD_WIDTH, GLCD_BLACK);
+    GlcdFlush();
+
+    uint8_t x = 0;
+    uint8_t prev_y = GLCD_HEIGHT - 1;
+    uint16_t words = 0;
+
+    while (1) {
+        uint8_t y = GLCD_HEIGHT - 1 - (uint16_t)read_pot() * (GRAPH_HEIGHT - 1) / 255;
+
+        // Sweep like a scope: erase a narrow band ahead of the trace, then draw the new segment
+        GlcdFillRect(x, GRAPH_TOP, 4, GRAPH_HEIGHT, GLCD_WHITE);
+        if (x > 0) GlcdLine(x - 1, prev_y, x, y, GLCD_BLACK);
+        prev_y = y;
+        x = (x + 1) & (GLCD_WIDTH - 1);
+
+        // Numeric readouts only touch their own words
+        char text[6];
+        uint8_t value = read_pot();
+        text[0] = '0' + value / 100;
+        text[1] = '0' + (value / 10) % 10;
+        text[2] = '0' + value % 10;
+        text[3] = '\0';
+        GlcdFillRect(24, 0, 18, 7, GLCD_WHITE);
+        GlcdPrint(24, 0, text, GLCD_BLACK);
+
+        text[0] = '0' + (words / 100) % 10;
+        text[1] = '0' + (words / 10) % 10;
+        text[2] = '0' + words % 10;
+        GlcdFillRect(102, 0, 18, 7, GLCD_WHITE);
+        GlcdPrint(102, 0, text, GLCD_BLACK);
+
+        words = GlcdFlush();
+    }
+
+    return 0;
+}
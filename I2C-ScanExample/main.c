@@ -0,0 +1,34 @@
+#include "../lib/i2c_lcd.h"
+
+// Print a 7-bit address as two hex digits
+static void print_hex(uint8_t value) {
+    static const char digits[] = "0123456789ABCDEF";
+    char text[3] = { digits[value >> 4], digits[value & 0x0F], '\0' };
+    I2C_LcdPrint(text);
+}
+
+int main(void) {
+    uint8_t found[8];
+
+    // The I2C LCD (0x27) shows what else answers on the bus, e.g. the AT24C02 at 0x50
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+
+    while (1) {
+        uint8_t count = TwiScan(found, sizeof(found));
+
+        I2C_LcdClear();
+        I2C_LcdPrint("I2C devices: ");
+        I2C_LcdPrintInt(count);
+        I2C_LcdSetCursor(1, 0);
+        for (uint8_t i = 0; i < count && i < 5; i++) {
+            print_hex(found[i]);
+            I2C_LcdPrint(" ");
+        }
+
+        // Unplugging a device or shorting the bus never freezes the loop
+        _delay_ms(2000);
+    }
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "../lib/board.h"
+#include "../lib/arbiter.h"
+#include "../lib/led_bcm.h"
+#include "../lib/pwm.h"
+#include "../lib/irq.h"
+#include "../lib/timebase.h"
+#include <avr/interrupt.h>
+
+// PS/2 keyboard on INT3 and an NEC remote on the IR receiver (INT5) as IRQ_HIGH handlers,
+// while the display refresh and a PWM fade keep the other interrupts busy. LCD row 0 shows
+// the last scancode and IR code, row 1 the worst latency of INT3 and INT5 and, after "A",
+// the longest display refresh interrupt (a plain ISR, not deferred) in us; the 7-segment
+// display shows the longest bottom-half run in timebase ticks.
+
+#define PS2_DATA        PD2
+#define IR_EDGES        34      // NEC: leader, 32 bits and the stop bit, falling edges
+#define IR_ONE_TICKS    (1690 * TIMEBASE_TICKS_PER_MS / 1000)   // 2.25 ms = 1, 1.12 ms = 0
+#define PROBE_MS        100
+
+// PS/2 frame: start bit, 8 data bits LSB first, parity, stop bit, sampled on falling CLK
+static volatile uint16_t ps2_frame;
+static volatile uint8_t ps2_bits;
+static volatile uint8_t ps2_code;
+static uint16_t ps2_last;                                   // Time of the last clock edge
+
+static uint16_t ir_edges[IR_EDGES];
+static volatile uint8_t ir_count;
+static volatile uint32_t ir_code;
+
+// Bottom half: check the frame and keep the scancode
+static void ps2_decode(void) {
+    uint16_t frame = ps2_frame;
+    uint8_t code = frame >> 1;
+    uint8_t ones = __builtin_popcount(frame & 0x3FE);       // Data and parity: odd
+    if (!(frame & 1) && (frame & 0x400) && (ones & 1)) ps2_code = code;
+}
+
+// Bottom half: the intervals between falling edges are the bits
+static void ir_decode(void) {
+    uint32_t code = 0;
+    for (uint8_t i = 1; i < IR_EDGES - 1; i++) {
+        code >>= 1;
+        if ((uint16_t)(ir_edges[i + 1] - ir_edges[i]) > IR_ONE_TICKS) code |= 0x80000000UL;
+    }
+    ir_code = code;
+    ir_count = 0;
+}
+
+IRQ_HIGH(INT3_vect, IRQ_INT3) {
+    // The clock runs at 10-16.7 kHz: a pause of 1 ms means a new frame
+    if ((uint16_t)(stamp - ps2_last) > TIMEBASE_TICKS_PER_MS) ps2_bits = 0;
+    ps2_last = stamp;
+    uint16_t frame = ps2_frame >> 1;
+    if (PIND & (1 << PS2_DATA)) frame |= 0x400;
+    ps2_frame = frame;
+    if (++ps2_bits == 11) {
+        ps2_bits = 0;
+        IrqDefer(ps2_decode);
+    }
+}
+
+IRQ_HIGH(INT5_vect, IRQ_INT5) {
+    uint8_t n = ir_count;
+    if (n >= IR_EDGES) return;                              // Frame waiting for the decoder
+    // A gap longer than the leader starts a new frame
+    if (n && (uint16_t)(stamp - ir_edges[n - 1]) > 20 * TIMEBASE_TICKS_PER_MS) n = 0;
+    ir_edges[n++] = stamp;
+    ir_count = n;
+    if (n == IR_EDGES) IrqDefer(ir_decode);
+}
+
+static void print_hex(uint32_t value, uint8_t digits) {
+    char text[9];
+    for (uint8_t i = 0; i < digits; i++) {
+        text[i] = "0123456789ABCDEF"[(value >> (4 * (digits - 1 - i))) & 0x0F];
+    }
+    text[digits] = '\0';
+    LcdPrint(text);
+}
+
+static void print_latency(IrqSource_t source) {
+    IrqStats_t stats;
+    IrqGetStats(source, &stats);
+    LcdPrintInt(TimebaseMicros(stats.max_latency));
+    LcdPrint(" ");
+}
+
+int main(void) {
+    BoardInit();
+    ArbInit();
+    LedBcmInit();
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+    PwmInit(PWM_LED, 1000);
+
+    IrqHighInit(IRQ_INT3, IRQ_FALLING);
+    IrqHighInit(IRQ_INT5, IRQ_FALLING);
+    sei();
+
+    uint8_t levels[LED_BCM_LEDS] = { 0 };
+    uint8_t pos = 0;
+    bool bright = false;
+    uint16_t last = TimebaseNow();
+    uint8_t ms = 0;
+    while (1) {
+        // Work the IRQ_HIGH handlers deferred while no other interrupt came
+        IrqBottomHalf();
+
+        if (!PwmIsFading(PWM_LED)) {
+            bright = !bright;
+            PwmFade(PWM_LED, bright ? 255 : 0, 500);
+        }
+
+        if ((uint16_t)(TimebaseNow() - last) < TIMEBASE_TICKS_PER_MS) continue;
+        last += TIMEBASE_TICKS_PER_MS;
+        if (++ms < PROBE_MS) continue;
+        ms = 0;
+
+        // Between frames, pull each line once to see how long its handler waits
+        if (!ps2_bits) IrqProbe(IRQ_INT3);
+        if (!ir_count) IrqProbe(IRQ_INT5);
+
+        for (uint8_t i = 0; i < LED_BCM_LEDS; i++) levels[i] >>= 1;
+        levels[pos] = 255;
+        pos = (pos + 1) & (LED_BCM_LEDS - 1);
+        LedBcmSetAll(levels);
+        ArbSegPrintInt(IrqBottomHalfMax());
+
+        LcdSetCursor(0, 0);
+        LcdPrint("K:");
+        print_hex(ps2_code, 2);
+        LcdPrint(" IR:");
+        print_hex(ir_code, 8);
+        LcdSetCursor(1, 0);
+        print_latency(IRQ_INT3);
+        print_latency(IRQ_INT5);
+        LcdPrint("A");
+        LcdPrintInt(TimebaseMicros(ArbMaxIsrTicks()));
+        LcdPrint("us    ");
+    }
+
+    return 0;
+}
@@ -12,11 +12,7 @@ static inline void beep(uint8_t minTime, uint8_t maxTime) {
     uint8_t range = maxTime - minTime;
     uint8_t randomTime = minTime + (seed % range);  // Pseudo-random value in range
     
-    BuzzerOn();  // Activate the buzzer
-    for (uint8_t i = 0; i < randomTime; i++) {
-        _delay_ms(1);  // Delay 1ms per iteration
-    }
-    BuzzerOff();  // Deactivate the buzzer
+    BuzzerBeep(randomTime);  // Run-time duration: DelayMs() counts it without floats
 }
 
 /**
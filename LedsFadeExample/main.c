@@ -0,0 +1,28 @@
+#include "../lib/board.h"
+#include "../lib/led_bcm.h"
+#include <avr/interrupt.h>
+
+int main(void) {
+    BoardInit();
+    LedBcmInit();
+    sei();
+
+    uint8_t levels[LED_BCM_LEDS] = { 0 };
+    uint8_t pos = 0;
+    int8_t dir = 1;
+
+    while (1) {
+        // Scanner with a fading tail: every LED loses half its brightness per step
+        for (uint8_t i = 0; i < LED_BCM_LEDS; i++) levels[i] >>= 1;
+        levels[pos] = 255;
+        LedBcmSetAll(levels);
+
+        if (pos == LED_BCM_LEDS - 1) dir = -1;
+        else if (pos == 0) dir = 1;
+        pos += dir;
+
+        _delay_ms(80);
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "../lib/lcd.h"
+#include "../lib/marquee.h"
+#include "../lib/timebase.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#define TICK_US     10000   // Marquee tick: 10 ms on the timebase compare B
+
+static const char news[] PROGMEM = "BK-AVR128: one row scrolls while the other keeps counting";
+
+static Marquee_t ticker;
+
+ISR(TIMER3_COMPB_vect) {
+    OCR3B += TICK_US;
+    MarqueeTick();
+}
+
+int main(void) {
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+    LcdPrint("Count:");
+
+    // Row 1 scrolls one cell every 250 ms
+    MarqueeInit(&ticker, LcdSetCursor, LcdWrite, 1, 0, 16);
+    MarqueeSetText_P(&ticker, news, 25);
+
+    TimebaseInit();
+    OCR3B = TimebaseNow() + TICK_US;
+    ETIFR = (1 << OCF3B);
+    ETIMSK |= (1 << OCIE3B);
+    sei();
+
+    uint16_t count = 0;
+    while (1) {
+        // Row 0 changes on its own, the ticker only touches row 1
+        LcdSetCursor(0, 7);
+        LcdPrintInt(count++);
+        MarqueeUpdate();
+        _delay_ms(50);
+    }
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "../lib/board.h"
+#include "../lib/arbiter.h"
+#include "../lib/led_bcm.h"
+#include "../lib/menu.h"
+#include "../lib/timebase.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+// An operator panel on the LCD1602 and the keypad: which LED, its brightness and blinking,
+// the key beep, and a setup page with the display refresh rate. Each keypress rewrites
+// only the cells that change.
+
+#define KEY_UP          2       // Top row, second key
+#define KEY_BACK        5       // Second row: back, OK, down
+#define KEY_OK          6
+#define KEY_DOWN        7
+#define BLINK_MS        250
+
+static int16_t led = 1;
+static int16_t level = 255;
+static bool blink;
+static bool beep = true;
+static int16_t refresh = 120;
+static bool lit = true;
+static Menu_t menu;
+
+static void apply_leds(void) {
+    uint8_t levels[LED_BCM_LEDS] = { 0 };
+    if (lit || !blink) levels[led - 1] = level;
+    LedBcmSetAll(levels);
+}
+
+// The frame takes the nearest of 163, 122, 98, 81 or 70 Hz
+static void apply_refresh(void) {
+    ArbSetRefresh(refresh);
+}
+
+static void defaults(void) {
+    led = 1;
+    level = 255;
+    blink = false;
+    refresh = 120;
+    apply_refresh();
+    apply_leds();
+}
+
+static const MenuItem_t setup[] PROGMEM = {
+    { "Refresh Hz", MENU_NUMBER, .value = &refresh, .action = apply_refresh,
+      .min = 70, .max = 160, .step = 10 },
+    { "Defaults", MENU_ACTION, .action = defaults },
+    { "Back", MENU_BACK },
+    { "" }
+};
+
+static const MenuItem_t top[] PROGMEM = {
+    { "LED", MENU_NUMBER, .value = &led, .action = apply_leds, .min = 1, .max = 8, .step = 1 },
+    { "Level", MENU_NUMBER, .value = &level, .action = apply_leds, .min = 0, .max = 255, .step = 15 },
+    { "Blink", MENU_TOGGLE, .value = &blink, .action = apply_leds },
+    { "Beep", MENU_TOGGLE, .value = &beep },
+    { "Setup", MENU_SUBMENU, .page = setup },
+    { "" }
+};
+
+static MenuKey_t menu_key(uint8_t key) {
+    switch (key) {
+        case KEY_UP: return MENU_KEY_UP;
+        case KEY_DOWN: return MENU_KEY_DOWN;
+        case KEY_OK: return MENU_KEY_OK;
+        case KEY_BACK: return MENU_KEY_BACK;
+        default: return MENU_KEY_NONE;
+    }
+}
+
+int main(void) {
+    BoardInit();
+    KeypadInit();
+    ArbInit();
+    LedBcmInit();
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+    sei();
+
+    MenuInit(&menu, LcdSetCursor, LcdWrite, 2, 16, top);
+    apply_leds();
+
+    uint8_t last_key = 0;
+    uint16_t last = TimebaseNow();
+    uint16_t ms = 0;
+    while (1) {
+        // Act on the press, not while the key is held
+        uint8_t key = KeypadRead();
+        if (key != last_key) {
+            last_key = key;
+            if (MenuKey(&menu, menu_key(key)) && beep) BuzzerBeep(5);
+        }
+        MenuUpdate(&menu);
+
+        if ((uint16_t)(TimebaseNow() - last) < TIMEBASE_TICKS_PER_MS) continue;
+        last += TIMEBASE_TICKS_PER_MS;
+        if (++ms < BLINK_MS) continue;
+        ms = 0;
+        lit = !lit;
+        if (blink) apply_leds();
+    }
+
+    return 0;
+}
@@ -0,0 +1,32 @@
+#include "../lib/board.h"
+#include "../lib/pwm.h"
+#include <avr/interrupt.h>
+
+int main(void) {
+    BoardInit();
+    sei();
+
+    while (1) {
+        // Breathe the PWM LED a few times (gamma curve: the fade looks even to the eye)
+        PwmInit(PWM_LED, 500);
+        for (uint8_t i = 0; i < 3; i++) {
+            PwmFade(PWM_LED, 255, 1000);
+            while (PwmIsFading(PWM_LED));
+            PwmFade(PWM_LED, 0, 1000);
+            while (PwmIsFading(PWM_LED));
+        }
+
+        // Soft-start the J6 motor, run, then soft-stop (the LED on PB4 follows inverted)
+        PwmInit(PWM_MOTOR, 4000);
+        PwmFade(PWM_MOTOR, 200, 1500);
+        while (PwmIsFading(PWM_MOTOR));
+        _delay_ms(2000);
+        PwmFade(PWM_MOTOR, 0, 1500);
+        while (PwmIsFading(PWM_MOTOR));
+        PwmStop(PWM_MOTOR);
+
+        _delay_ms(1000);
+    }
+
+    return 0;
+}
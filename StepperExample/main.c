@@ -0,0 +1,34 @@
+#include "../lib/board.h"
+#include "../lib/stepper.h"
+#include <avr/interrupt.h>
+
+int main(void) {
+    BoardInit();
+    LatchInit();
+    LEDS_DDR = 0xFF;
+    StepperInit(STEPPER_HALF_STEP);
+    sei();
+
+    while (1) {
+        // One turn of a 28BYJ-48 (4096 half steps) each way, then a short fast shuttle
+        StepperMove(4096, 800, 1000);
+        StepperMove(-4096, 800, 1000);
+        for (uint8_t i = 0; i < 4; i++) {
+            StepperMove(200, 1000, 4000);
+            StepperMove(-200, 1000, 4000);
+        }
+        while (StepperIsBusy());
+        StepperRelease();
+
+        // Show the longest step interrupt (in us at 8 MHz) on the LED bar, active LOW
+        uint16_t ticks = StepperMaxIsrTicks();
+        LedSetMask(~(uint8_t)(ticks > 255 ? 255 : ticks));
+        LatchLeds_On();
+        _delay_us(10);
+        LatchLeds_Off();
+
+        _delay_ms(1000);
+    }
+
+    return 0;
+}
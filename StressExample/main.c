@@ -0,0 +1,166 @@
+#include "../lib/board.h"
+#include "../lib/arbiter.h"
+#include "../lib/led_bcm.h"
+#include "../lib/cpuload.h"
+#include "../lib/portd.h"
+#include "../lib/stepper.h"
+#include "../lib/pwm.h"
+#include "../lib/marquee.h"
+#include "../lib/eestore.h"
+#include "../lib/telemetry.h"
+#include "../lib/shell.h"
+#include "../lib/stackmon.h"
+#include "../lib/timebase.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+// Every driver at once, with the CPU load on the 7-segment display (load, peak) and on
+// the LED bar. The GLCD is left out: it sits on the same PORTA/PB5-PB7 lines as the J14
+// LCD. So are the OC1x PWM channels (PB5-PB7 again). The clock stays undivided: the
+// stepper, the PWM and the arbiter run from timers that ClockSetDivider() doesn't rescale.
+
+#define TICK_TICKS      (TIMEBASE_TICKS_PER_MS * 10)    // Marquee tick: 10 ms on the timebase compare B
+#define TELEM_LOAD      1       // Telemetry channel: now, peak, average (permille)
+#define KEY_SAVE        15      // Keep the peak in EEPROM
+#define KEY_RESET       14      // Start peak and average again
+
+static const char news[] PROGMEM = "Stepper, PWM, keypad, TWI, UART, EEPROM, 7-seg, LEDs, LCD";
+
+static Marquee_t ticker;
+
+ISR(TIMER3_COMPB_vect) {
+    OCR3B += TICK_TICKS;
+    MarqueeTick();
+}
+
+// load: the figures; load reset starts peak and average again
+static bool cmd_load(uint8_t argc, char *argv[], uint8_t step) {
+    CpuLoad_t load;
+    (void)argv;
+    (void)step;
+    if (argc > 1) CpuLoadReset();
+    CpuLoadGet(&load);
+    UartPuts("now ");
+    ShellPrintUint(load.now);
+    UartPuts(" peak ");
+    ShellPrintUint(load.peak);
+    UartPuts(" avg ");
+    ShellPrintUint(load.average);
+    UartPuts("\r\n");
+    return false;
+}
+
+static const ShellCommand_t commands[] PROGMEM = {
+    { "load", cmd_load, "[reset]  CPU load in permille" },
+    { "" }
+};
+
+// Half a turn each way, then a fast shuttle, over and over
+static void stepper_next(void) {
+    static uint8_t move;
+    static const int16_t steps[4] = { 2048, -2048, 200, -200 };
+    static const uint16_t speed[4] = { 800, 800, 1000, 1000 };
+    StepperMove(steps[move], speed[move], 2000);
+    move = (move + 1) & 3;
+}
+
+// One pass of the main loop; it is also the calibration pass of the load meter, so the
+// polls that find nothing due are part of the idle baseline
+static void loop_pass(void) {
+    static uint8_t last_key;
+    static bool bright;
+
+    bool busy = PortdPoll();
+    busy |= ShellPoll();
+    busy |= MarqueeUpdate() != 0;
+
+    uint8_t key = PortdKey();
+    if (key != last_key) {
+        last_key = key;
+        LcdSetCursor(0, 4);
+        LcdPrint("  ");
+        LcdSetCursor(0, 4);
+        if (key) LcdPrintInt(key);
+        if (key == KEY_RESET) CpuLoadReset();
+        if (key == KEY_SAVE) {
+            CpuLoad_t load;
+            CpuLoadGet(&load);
+            EeStorePut("peak", &load.peak, sizeof(load.peak));
+        }
+        if (key) BuzzerBeep(20);
+        busy = true;
+    }
+
+    if (StepperQueueFree()) {
+        stepper_next();
+        busy = true;
+    }
+    if (!PwmIsFading(PWM_LED)) {
+        bright = !bright;
+        PwmFade(PWM_LED, bright ? 255 : 0, 1000);
+        busy = true;
+    }
+
+    // Nothing else to do: an idle pass, and once per window the slower displays
+    if (!busy && CpuLoadIdle()) {
+        CpuLoad_t load;
+        CpuLoadGet(&load);
+        uint16_t *v = TelemReserve(TELEM_LOAD, TELEM_U16, 3 * sizeof(uint16_t));
+        if (v) {
+            v[0] = load.now;
+            v[1] = load.peak;
+            v[2] = load.average;
+            TelemCommit();
+        }
+        LcdSetCursor(0, 10);
+        LcdPrintInt(StackUnused());
+        LcdPrint(" ");
+        I2C_LcdSetCursor(1, 0);
+        I2C_LcdPrintInt(load.average);
+        I2C_LcdPrint("  ");
+    }
+}
+
+int main(void) {
+    StackMonInit();
+    BoardInit();
+    ArbInit();
+    LedBcmInit();
+
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+    LcdPrint("Key   Stk");
+    MarqueeInit(&ticker, LcdSetCursor, LcdWrite, 1, 0, 16);
+    MarqueeSetText_P(&ticker, news, 25);
+
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+    I2C_LcdPrint("Avg    Last");
+    PortdInit(0);
+
+    StepperInit(STEPPER_HALF_STEP);
+    PwmInit(PWM_LED, 1000);
+    EeStoreInit();
+    TelemInit(0);
+    ShellInit(commands, ShellFixedClockParams);     // No "set clockdiv": see above
+
+    uint16_t last_peak = 0;
+    EeStoreGet("peak", &last_peak, sizeof(last_peak), NULL);
+    I2C_LcdSetCursor(1, 7);
+    I2C_LcdPrintInt(last_peak);
+
+    OCR3B = TimebaseNow() + TICK_TICKS;
+    ETIFR = (1 << OCF3B);
+    ETIMSK |= (1 << OCIE3B);
+
+    // Baseline through the loop itself with interrupts still off, then the figures live
+    // on both displays
+    CpuLoadInit();
+    CpuLoadCalibrate(loop_pass);
+    CpuLoadSetView(CPULOAD_VIEW_BOTH);
+    sei();
+
+    while (1) loop_pass();
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+/**
+ * @file main.c
+ * @brief Serial bootloader for the boot section, driven by tools/bkboot (make upload).
+ * @details Runs from the 4 KB boot section at BOOT_START (fuses: BOOTSZ = 01, BOOTRST
+ *          programmed, see the README) and talks to the host over USART0, the RS232 port
+ *          behind the MAX232, with the protocol in protocol.h.
+ *
+ *          - Power-on and brown-out resets jump to the application at once, without touching
+ *            any peripheral. The RESET button and watchdog resets wait BOOT_WAIT_MS for the
+ *            host; without an application the bootloader waits forever.
+ *          - A page is acknowledged as soon as it is in RAM. Its erase, fill and write run in
+ *            short steps from the receive loop while the next page arrives, using two page
+ *            buffers, so the 2 x 4.5 ms of SPM time per page is hidden behind the transfer.
+ *          - The host compares page CRCs first and only sends the pages that changed; the
+ *            CRC of the whole image is checked before the application is started.
+ *          - The first page written in a session erases page 0 first (the host writes page 0
+ *            last), so an interrupted upload leaves no half-written application to start.
+ *
+ *          BOOT_BAUD defaults to 125000 (U2X, UBRR = 7, exact at 8 MHz). 115200 can't be
+ *          made within 2 % from an 8 MHz crystal; 250000 and 500000 are exact too, if the
+ *          RS232 cable and level shifter cope.
+ */
+
+#include <avr/io.h>
+#include <avr/boot.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include <stdbool.h>
+#include "protocol.h"
+
+#ifndef BOOT_BAUD
+#define BOOT_BAUD       125000UL
+#endif
+#ifndef BOOT_WAIT_MS
+#define BOOT_WAIT_MS    250     ///< Time for the host to answer after a RESET button press
+#endif
+#define BOOT_BYTE_MS    100     ///< Longest gap inside a frame
+#define BOOT_DRAIN_MS   20      ///< Silence that ends a bad frame
+#define BOOT_FILL_WORDS 8       ///< Page buffer words filled per receive loop pass
+
+// USART0 in double speed mode
+#define BOOT_UBRR       ((F_CPU + 4UL * BOOT_BAUD) / (8UL * BOOT_BAUD) - 1)
+#define BOOT_BAUD_REAL  (F_CPU / (8UL * (BOOT_UBRR + 1)))
+#if BOOT_BAUD_REAL * 100 > BOOT_BAUD * 102 || BOOT_BAUD_REAL * 100 < BOOT_BAUD * 98
+#error "BOOT_BAUD is more than 2 % off at this F_CPU (exact at 8 MHz: 125000, 250000, 500000)"
+#endif
+
+// Start of the application (overridden by the host test)
+#ifndef BOOT_JUMP_APP
+#define BOOT_JUMP_APP() __asm__ __volatile__ ("jmp 0")
+#endif
+
+// Steps of the page job
+typedef enum {
+    FLASH_IDLE,
+    FLASH_ERASE,
+    FLASH_FILL,
+    FLASH_WRITE,
+    FLASH_ENABLE
+} FlashState_t;
+
+// Global variables
+static uint8_t page_buf[2][BOOT_PAGE_SIZE];
+static uint8_t rx_buf;                  // Buffer the next page is received into
+static FlashState_t flash_state;
+static uint32_t flash_addr;
+static const uint8_t *flash_data;       // NULL: erase only
+static uint16_t flash_fill;
+static bool app_erased;
+static uint16_t reply_crc;
+
+// Run the next step of the page job if the SPM unit is free
+static void flash_poll(void) {
+    if (flash_state == FLASH_IDLE || boot_spm_busy()) return;
+
+    switch (flash_state) {
+    case FLASH_ERASE:
+        boot_page_erase(flash_addr);
+        flash_state = flash_data ? FLASH_FILL : FLASH_ENABLE;
+        break;
+    case FLASH_FILL:
+        for (uint8_t i = 0; i < BOOT_FILL_WORDS; i++, flash_fill += 2) {
+            boot_page_fill(flash_addr + flash_fill, flash_data[flash_fill] | (flash_data[flash_fill + 1] << 8));
+        }
+        if (flash_fill >= BOOT_PAGE_SIZE) flash_state = FLASH_WRITE;
+        break;
+    case FLASH_WRITE:
+        boot_page_write(flash_addr);
+        flash_state = FLASH_ENABLE;
+        break;
+    default:
+        boot_rww_enable();              // The application section can be read again
+        flash_state = FLASH_IDLE;
+        break;
+    }
+}
+
+static void flash_wait(void) {
+    while (flash_state != FLASH_IDLE) flash_poll();
+}
+
+// Program a page (data == NULL: erase it) in the background
+static void flash_start(uint32_t addr, const uint8_t *data) {
+    flash_wait();
+    flash_addr = addr;
+    flash_data = data;
+    flash_fill = 0;
+    flash_state = FLASH_ERASE;
+}
+
+static uint16_t flash_crc(uint32_t addr, uint32_t length) {
+    uint16_t crc = 0;
+    flash_wait();
+    while (length--) crc = boot_crc_update(crc, pgm_read_byte_far(addr++));
+    return crc;
+}
+
+static void uart_init(void) {
+    UBRR0H = BOOT_UBRR >> 8;
+    UBRR0L = BOOT_UBRR & 0xFF;
+    UCSR0A = (1 << U2X0);
+    UCSR0B = (1 << RXEN0) | (1 << TXEN0);
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);     // 8N1
+}
+
+static void uart_putc(uint8_t c) {
+    while (!(UCSR0A & (1 << UDRE0))) flash_poll();
+    UDR0 = c;
+}
+
+// Receive a byte, running the page job while waiting; -1 after timeout_ms (0: no timeout)
+static int16_t uart_getc(uint16_t timeout_ms) {
+    uint32_t ticks = (uint32_t)timeout_ms * 100;
+    while (!(UCSR0A & (1 << RXC0))) {
+        flash_poll();
+        if (timeout_ms && !ticks--) return -1;
+        _delay_us(10);
+    }
+    uint8_t c = UDR0;
+    return c;
+}
+
+// Receive part of a frame into dst (NULL: into crc only)
+static bool frame_read(uint8_t *dst, uint16_t length, uint16_t *crc) {
+    while (length--) {
+        int16_t c = uart_getc(BOOT_BYTE_MS);
+        if (c < 0) return false;
+        *crc = boot_crc_update(*crc, c);
+        if (dst) *dst++ = c;
+    }
+    return true;
+}
+
+static void reply_start(void) {
+    uart_putc(BOOT_ACK);
+    reply_crc = 0;
+}
+
+static void reply_put(uint8_t c) {
+    uart_putc(c);
+    reply_crc = boot_crc_update(reply_crc, c);
+}
+
+static void reply_end(void) {
+    uart_putc(reply_crc & 0xFF);
+    uart_putc(reply_crc >> 8);
+}
+
+static void boot_app(void) {
+    flash_wait();
+    while (!(UCSR0A & (1 << UDRE0)));
+    _delay_us(20000000.0 / BOOT_BAUD);  // Two characters: the last reply byte is out
+    UCSR0B = 0;
+    UCSR0A = 0;
+    UBRR0L = 0;
+    BOOT_JUMP_APP();
+}
+
+// Receive the rest of a request and carry it out; false: answer with a NAK
+static bool command(uint8_t cmd) {
+    uint8_t head[4] = { 0 };
+    uint8_t head_len;
+    uint16_t crc = boot_crc_update(0, cmd);
+    uint8_t *data = NULL;
+    uint16_t data_len = 0;
+    uint8_t end[2];
+    uint16_t end_crc = 0;
+
+    switch (cmd) {
+    case BOOT_CMD_INFO:
+    case BOOT_CMD_GO:
+        head_len = 0;
+        break;
+    case BOOT_CMD_WRITE:
+        head_len = 2;
+        data = page_buf[rx_buf];
+        data_len = BOOT_PAGE_SIZE;
+        break;
+    case BOOT_CMD_CRC:
+    case BOOT_CMD_VERIFY:
+        head_len = 4;
+        break;
+    default:
+        return false;
+    }
+
+    if (!frame_read(head, head_len, &crc) || !frame_read(data, data_len, &crc) ||
+        !frame_read(end, 2, &end_crc) || crc != (end[0] | (end[1] << 8))) return false;
+
+    uint16_t page = head[0] | (head[1] << 8);
+    uint16_t count = head[2] | (head[3] << 8);
+    uint32_t length = page | ((uint32_t)count << 16);
+
+    switch (cmd) {
+    case BOOT_CMD_INFO: {
+        BootInfo_t info = {
+            { 'B', 'K' }, BOOT_VERSION, { BOOT_PAGE_SIZE & 0xFF, BOOT_PAGE_SIZE >> 8 },
+            { BOOT_START & 0xFF, (BOOT_START >> 8) & 0xFF, (BOOT_START >> 16) & 0xFF, BOOT_START >> 24 }
+        };
+        reply_start();
+        for (uint8_t i = 0; i < sizeof(info); i++) reply_put(((const uint8_t *)&info)[i]);
+        reply_end();
+        break;
+    }
+    case BOOT_CMD_CRC:
+        if ((uint32_t)(page + count) * BOOT_PAGE_SIZE > BOOT_START) return false;
+        reply_start();
+        while (count--) {
+            uint16_t page_crc = flash_crc((uint32_t)page++ * BOOT_PAGE_SIZE, BOOT_PAGE_SIZE);
+            reply_put(page_crc & 0xFF);
+            reply_put(page_crc >> 8);
+        }
+        reply_end();
+        break;
+    case BOOT_CMD_WRITE:
+        if ((uint32_t)(page + 1) * BOOT_PAGE_SIZE > BOOT_START) return false;
+        if (!app_erased && page != 0 && pgm_read_word_far(0) != 0xFFFF) flash_start(0, NULL);
+        app_erased = true;
+        flash_start((uint32_t)page * BOOT_PAGE_SIZE, data);
+        rx_buf ^= 1;
+        uart_putc(BOOT_ACK);
+        break;
+    case BOOT_CMD_VERIFY:
+        if (length > BOOT_START) return false;
+        reply_start();
+        crc = flash_crc(0, length);
+        reply_put(crc & 0xFF);
+        reply_put(crc >> 8);
+        reply_end();
+        break;
+    default:
+        uart_putc(BOOT_ACK);
+        boot_app();
+        break;
+    }
+    return true;
+}
+
+int main(void) {
+    uint8_t reset = MCUCSR;
+    bool app = pgm_read_word_far(0) != 0xFFFF;
+
+    MCUCSR = 0;
+    WDTCR = (1 << WDCE) | (1 << WDE);  // Watchdog off, in case the application used it to get here
+    WDTCR = 0;
+
+    // Power-on: straight to the application
+    if (app && !(reset & ((1 << EXTRF) | (1 << WDRF)))) BOOT_JUMP_APP();
+
+    // Wait for the host
+    uart_init();
+    for (uint16_t ms = 0; uart_getc(1) != BOOT_SYNC; ms++) {
+        if (app && ms >= BOOT_WAIT_MS) boot_app();
+    }
+    uart_putc(BOOT_ACK);
+
+    while (1) {
+        int16_t cmd = uart_getc(0);
+        if (cmd == BOOT_SYNC) {
+            uart_putc(BOOT_ACK);        // Syncs still on the way when the host saw the first ACK
+        } else if (!command(cmd)) {
+            while (uart_getc(BOOT_DRAIN_MS) >= 0);
+            uart_putc(BOOT_NAK);
+        }
+    }
+
+    return 0;
+}
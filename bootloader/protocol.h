@@ -0,0 +1,71 @@
+/**
+ * @file protocol.h
+ * @brief Serial protocol between the bootloader and tools/bkboot (shared by both).
+ * @details After a reset the host sends BOOT_SYNC every few milliseconds until the
+ *          bootloader answers BOOT_ACK. After that every request is a frame:
+ *
+ *              command, payload, CRC16 (little endian, over command and payload)
+ *
+ *          A good request is answered by BOOT_ACK, followed by the reply payload and its
+ *          CRC16 if the command has one. A bad CRC, an unknown command or an address out of
+ *          range is answered by a single BOOT_NAK, and the request has no effect.
+ *
+ *          | Command         | Payload                       | Reply payload                  |
+ *          |-----------------|-------------------------------|--------------------------------|
+ *          | BOOT_SYNC       | - (no CRC)                    | - (no CRC)                     |
+ *          | BOOT_CMD_INFO   | -                             | BootInfo_t                     |
+ *          | BOOT_CMD_CRC    | first page (2), count (2)     | CRC16 of each page (2 * count) |
+ *          | BOOT_CMD_WRITE  | page (2), BOOT_PAGE_SIZE data | -                              |
+ *          | BOOT_CMD_VERIFY | length in bytes (4)           | CRC16 of flash 0..length-1 (2) |
+ *          | BOOT_CMD_GO     | -                             | - (then starts the application)|
+ *
+ *          All numbers are little endian. BOOT_CMD_WRITE is acknowledged as soon as the page
+ *          is in RAM: its erase and write run while the next frame is received. The page CRCs
+ *          let the host skip pages that are already programmed.
+ *
+ *          CRC16 is CRC-16/XMODEM (polynomial 0x1021, initial value 0), the same as
+ *          _crc_xmodem_update() in avr-libc.
+ */
+
+#ifndef BOOT_PROTOCOL_H
+#define BOOT_PROTOCOL_H
+
+#include <stdint.h>
+
+#define BOOT_SYNC           '?'
+#define BOOT_ACK            0x06
+#define BOOT_NAK            0x15
+
+#define BOOT_CMD_INFO       'I'
+#define BOOT_CMD_CRC        'C'
+#define BOOT_CMD_WRITE      'W'
+#define BOOT_CMD_VERIFY     'V'
+#define BOOT_CMD_GO         'G'
+
+#define BOOT_VERSION        1
+#define BOOT_PAGE_SIZE      256         ///< SPM_PAGESIZE of the ATmega128
+#define BOOT_START          0x1F000UL   ///< Boot section, 2048 words (BOOTSZ = 01)
+
+// Reply to BOOT_CMD_INFO
+typedef struct {
+    uint8_t magic[2];       ///< 'B', 'K'
+    uint8_t version;        ///< BOOT_VERSION
+    uint8_t page_size[2];   ///< BOOT_PAGE_SIZE
+    uint8_t boot_start[4];  ///< BOOT_START, the first address the application can't use
+} BootInfo_t;
+
+#ifdef __AVR__
+#include <util/crc16.h>
+#define boot_crc_update     _crc_xmodem_update
+#else
+// CRC-16/XMODEM of one more byte (same result as _crc_xmodem_update)
+static inline uint16_t boot_crc_update(uint16_t crc, uint8_t data) {
+    crc ^= (uint16_t)data << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+#endif
+
+#endif // BOOT_PROTOCOL_H
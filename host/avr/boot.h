@@ -0,0 +1,20 @@
+/**
+ * @file boot.h
+ * @brief Self-programming (SPM) macros for the host build, backed by host/flash.c.
+ */
+
+#ifndef HOST_AVR_BOOT_H
+#define HOST_AVR_BOOT_H
+
+#include <avr/io.h>
+#include "../flash.h"
+
+#define boot_page_erase(addr)       FlashPageErase(addr)
+#define boot_page_fill(addr, word)  FlashPageFill((addr), (word))
+#define boot_page_write(addr)       FlashPageWrite(addr)
+#define boot_rww_enable()           FlashRwwEnable()
+#define boot_spm_busy()             FlashSpmBusy()
+#define boot_spm_busy_wait()        do { } while (boot_spm_busy())
+#define boot_rww_busy()             (hal_flash.rww_busy)
+
+#endif // HOST_AVR_BOOT_H
@@ -0,0 +1,22 @@
+/**
+ * @file interrupt.h
+ * @brief Interrupt macros for the host build (see hal.h).
+ * @details ISR(vector) defines a plain function named after the vector, so a test calls
+ *          TIMER2_COMP_vect() to run an interrupt. sei()/cli() set and clear SREG_I.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define ISR(vector, ...)    void vector(void); void vector(void)
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define EMPTY_INTERRUPT(vector)     void vector(void) { }
+#define sei()               (SREG |= (1 << SREG_I))
+#define cli()               (SREG &= ~(1 << SREG_I))
+#define reti()              return
+
+#endif // HOST_AVR_INTERRUPT_H
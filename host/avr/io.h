@@ -0,0 +1,538 @@
+/**
+ * @file io.h
+ * @brief ATmega128 register map for the host build (see hal.h).
+ * @details Register names, addresses and bit positions match avr-libc's <avr/io.h> for the
+ *          ATmega128, so lib/ compiles unchanged; every register access goes through the HAL.
+ */
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+#include "../hal.h"
+
+#define _SFR_MEM8(addr)     (*HalIo8(addr))
+#define _SFR_MEM16(addr)    (*HalIo16(addr))
+#define _SFR_ACT8(addr)     (*HalAct8(addr))    // Register with side effects (hal.h)
+#define _BV(bit)            (1 << (bit))
+
+#define bit_is_set(sfr, bit)            ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit)          (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit)     do { } while (bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit)   do { } while (bit_is_set(sfr, bit))
+
+// Memory sizes
+#define RAMSTART        0x100
+#define RAMEND          0x10FF
+#define XRAMEND         0xFFFF
+#define E2END           0x0FFF
+#define FLASHEND        0x1FFFF
+#define SPM_PAGESIZE    256
+
+// End of .bss/heap for stackmon.h, in place of the avr-libc linker symbols (see hal.h)
+#define STACK_FLOOR     hal_heap_end
+
+// 8-bit registers
+#define PINF     _SFR_MEM8(0x20)
+#define PINE     _SFR_MEM8(0x21)
+#define DDRE     _SFR_MEM8(0x22)
+#define PORTE    _SFR_MEM8(0x23)
+#define ADCL     _SFR_MEM8(0x24)
+#define ADCH     _SFR_MEM8(0x25)
+#define ADCSRA   _SFR_MEM8(0x26)
+#define ADMUX    _SFR_MEM8(0x27)
+#define ACSR     _SFR_MEM8(0x28)
+#define UBRR0L   _SFR_MEM8(0x29)
+#define UCSR0B   _SFR_MEM8(0x2A)
+#define UCSR0A   _SFR_MEM8(0x2B)
+#define UDR0     _SFR_ACT8(0x2C)
+#define SPCR     _SFR_MEM8(0x2D)
+#define SPSR     _SFR_MEM8(0x2E)
+#define SPDR     _SFR_ACT8(0x2F)
+#define PIND     _SFR_MEM8(0x30)
+#define DDRD     _SFR_MEM8(0x31)
+#define PORTD    _SFR_MEM8(0x32)
+#define PINC     _SFR_MEM8(0x33)
+#define DDRC     _SFR_MEM8(0x34)
+#define PORTC    _SFR_MEM8(0x35)
+#define PINB     _SFR_MEM8(0x36)
+#define DDRB     _SFR_MEM8(0x37)
+#define PORTB    _SFR_MEM8(0x38)
+#define PINA     _SFR_MEM8(0x39)
+#define DDRA     _SFR_MEM8(0x3A)
+#define PORTA    _SFR_MEM8(0x3B)
+#define EECR     _SFR_ACT8(0x3C)
+#define EEDR     _SFR_MEM8(0x3D)
+#define EEARL    _SFR_MEM8(0x3E)
+#define EEARH    _SFR_MEM8(0x3F)
+#define SFIOR    _SFR_MEM8(0x40)
+#define WDTCR    _SFR_MEM8(0x41)
+#define OCDR     _SFR_MEM8(0x42)
+#define OCR2     _SFR_MEM8(0x43)
+#define TCNT2    _SFR_MEM8(0x44)
+#define TCCR2    _SFR_MEM8(0x45)
+#define ICR1L    _SFR_MEM8(0x46)
+#define ICR1H    _SFR_MEM8(0x47)
+#define OCR1BL   _SFR_MEM8(0x48)
+#define OCR1BH   _SFR_MEM8(0x49)
+#define OCR1AL   _SFR_MEM8(0x4A)
+#define OCR1AH   _SFR_MEM8(0x4B)
+#define TCNT1L   _SFR_MEM8(0x4C)
+#define TCNT1H   _SFR_MEM8(0x4D)
+#define TCCR1B   _SFR_MEM8(0x4E)
+#define TCCR1A   _SFR_MEM8(0x4F)
+#define ASSR     _SFR_MEM8(0x50)
+#define OCR0     _SFR_MEM8(0x51)
+#define TCNT0    _SFR_MEM8(0x52)
+#define TCCR0    _SFR_MEM8(0x53)
+#define MCUCSR   _SFR_MEM8(0x54)
+#define MCUCR    _SFR_MEM8(0x55)
+#define TIFR     _SFR_MEM8(0x56)
+#define TIMSK    _SFR_MEM8(0x57)
+#define EIFR     _SFR_MEM8(0x58)
+#define EIMSK    _SFR_MEM8(0x59)
+#define EICRB    _SFR_MEM8(0x5A)
+#define RAMPZ    _SFR_MEM8(0x5B)
+#define XDIV     _SFR_MEM8(0x5C)
+#define SPL      _SFR_MEM8(0x5D)
+#define SPH      _SFR_MEM8(0x5E)
+#define SREG     _SFR_MEM8(0x5F)
+#define DDRF     _SFR_MEM8(0x61)
+#define PORTF    _SFR_MEM8(0x62)
+#define PING     _SFR_MEM8(0x63)
+#define DDRG     _SFR_MEM8(0x64)
+#define PORTG    _SFR_MEM8(0x65)
+#define SPMCSR   _SFR_MEM8(0x68)
+#define EICRA    _SFR_MEM8(0x6A)
+#define XMCRB    _SFR_MEM8(0x6C)
+#define XMCRA    _SFR_MEM8(0x6D)
+#define OSCCAL   _SFR_MEM8(0x6F)
+#define TWBR     _SFR_MEM8(0x70)
+#define TWSR     _SFR_MEM8(0x71)
+#define TWAR     _SFR_MEM8(0x72)
+#define TWDR     _SFR_ACT8(0x73)
+#define TWCR     _SFR_ACT8(0x74)
+#define OCR1CL   _SFR_MEM8(0x78)
+#define OCR1CH   _SFR_MEM8(0x79)
+#define TCCR1C   _SFR_MEM8(0x7A)
+#define ETIFR    _SFR_MEM8(0x7C)
+#define ETIMSK   _SFR_MEM8(0x7D)
+#define ICR3L    _SFR_MEM8(0x80)
+#define ICR3H    _SFR_MEM8(0x81)
+#define OCR3CL   _SFR_MEM8(0x82)
+#define OCR3CH   _SFR_MEM8(0x83)
+#define OCR3BL   _SFR_MEM8(0x84)
+#define OCR3BH   _SFR_MEM8(0x85)
+#define OCR3AL   _SFR_MEM8(0x86)
+#define OCR3AH   _SFR_MEM8(0x87)
+#define TCNT3L   _SFR_MEM8(0x88)
+#define TCNT3H   _SFR_MEM8(0x89)
+#define TCCR3B   _SFR_MEM8(0x8A)
+#define TCCR3A   _SFR_MEM8(0x8B)
+#define TCCR3C   _SFR_MEM8(0x8C)
+#define UBRR0H   _SFR_MEM8(0x90)
+#define UCSR0C   _SFR_MEM8(0x95)
+#define UBRR1H   _SFR_MEM8(0x98)
+#define UBRR1L   _SFR_MEM8(0x99)
+#define UCSR1B   _SFR_MEM8(0x9A)
+#define UCSR1A   _SFR_MEM8(0x9B)
+#define UDR1     _SFR_ACT8(0x9C)
+#define UCSR1C   _SFR_MEM8(0x9D)
+
+// 16-bit registers
+#define ADC      _SFR_MEM16(0x24)
+#define ADCW     _SFR_MEM16(0x24)
+#define EEAR     _SFR_MEM16(0x3E)
+#define ICR1     _SFR_MEM16(0x46)
+#define OCR1B    _SFR_MEM16(0x48)
+#define OCR1A    _SFR_MEM16(0x4A)
+#define TCNT1    _SFR_MEM16(0x4C)
+#define SP       _SFR_MEM16(0x5D)
+#define OCR1C    _SFR_MEM16(0x78)
+#define ICR3     _SFR_MEM16(0x80)
+#define OCR3C    _SFR_MEM16(0x82)
+#define OCR3B    _SFR_MEM16(0x84)
+#define OCR3A    _SFR_MEM16(0x86)
+#define TCNT3    _SFR_MEM16(0x88)
+
+// Port pins
+#define PA0 0
+#define PA1 1
+#define PA2 2
+#define PA3 3
+#define PA4 4
+#define PA5 5
+#define PA6 6
+#define PA7 7
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PC7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+#define PE0 0
+#define PE1 1
+#define PE2 2
+#define PE3 3
+#define PE4 4
+#define PE5 5
+#define PE6 6
+#define PE7 7
+#define PF0 0
+#define PF1 1
+#define PF2 2
+#define PF3 3
+#define PF4 4
+#define PF5 5
+#define PF6 6
+#define PF7 7
+#define PG0 0
+#define PG1 1
+#define PG2 2
+#define PG3 3
+#define PG4 4
+
+// ADC
+// ADCSRA
+#define ADEN     7
+#define ADSC     6
+#define ADFR     5
+#define ADIF     4
+#define ADIE     3
+#define ADPS2    2
+#define ADPS1    1
+#define ADPS0    0
+// ADMUX
+#define REFS1    7
+#define REFS0    6
+#define ADLAR    5
+#define MUX4     4
+#define MUX3     3
+#define MUX2     2
+#define MUX1     1
+#define MUX0     0
+// ACSR
+#define ACD      7
+#define ACBG     6
+#define ACO      5
+#define ACI      4
+#define ACIE     3
+#define ACIC     2
+#define ACIS1    1
+#define ACIS0    0
+
+// USART0/1
+// UCSR0A
+#define RXC0     7
+#define TXC0     6
+#define UDRE0    5
+#define FE0      4
+#define DOR0     3
+#define UPE0     2
+#define U2X0     1
+#define MPCM0    0
+// UCSR0B
+#define RXCIE0   7
+#define TXCIE0   6
+#define UDRIE0   5
+#define RXEN0    4
+#define TXEN0    3
+#define UCSZ02   2
+#define RXB80    1
+#define TXB80    0
+// UCSR0C
+#define UMSEL0   6
+#define UPM01    5
+#define UPM00    4
+#define USBS0    3
+#define UCSZ01   2
+#define UCSZ00   1
+#define UCPOL0   0
+// UCSR1A
+#define RXC1     7
+#define TXC1     6
+#define UDRE1    5
+#define FE1      4
+#define DOR1     3
+#define UPE1     2
+#define U2X1     1
+#define MPCM1    0
+// UCSR1B
+#define RXCIE1   7
+#define TXCIE1   6
+#define UDRIE1   5
+#define RXEN1    4
+#define TXEN1    3
+#define UCSZ12   2
+#define RXB81    1
+#define TXB81    0
+// UCSR1C
+#define UMSEL1   6
+#define UPM11    5
+#define UPM10    4
+#define USBS1    3
+#define UCSZ11   2
+#define UCSZ10   1
+#define UCPOL1   0
+
+// SPI
+// SPCR
+#define SPIE     7
+#define SPE      6
+#define DORD     5
+#define MSTR     4
+#define CPOL     3
+#define CPHA     2
+#define SPR1     1
+#define SPR0     0
+// SPSR
+#define SPIF     7
+#define WCOL     6
+#define SPI2X    0
+
+// EEPROM
+// EECR
+#define EERIE    3
+#define EEMWE    2
+#define EEWE     1
+#define EERE     0
+
+// Special function / sleep / reset
+// SFIOR
+#define TSM      7
+#define ACME     3
+#define PUD      2
+#define PSR0     1
+#define PSR321   0
+// WDTCR
+#define WDCE     4
+#define WDE      3
+#define WDP2     2
+#define WDP1     1
+#define WDP0     0
+// MCUCR
+#define SRE      7
+#define SRW10    6
+#define SE       5
+#define SM1      4
+#define SM0      3
+#define SM2      2
+#define IVSEL    1
+#define IVCE     0
+// MCUCSR
+#define JTD      7
+#define JTRF     4
+#define WDRF     3
+#define BORF     2
+#define EXTRF    1
+#define PORF     0
+// XDIV
+#define XDIVEN   7
+// SPMCSR
+#define SPMIE    7
+#define RWWSB    6
+#define RWWSRE   4
+#define BLBSET   3
+#define PGWRT    2
+#define PGERS    1
+#define SPMEN    0
+// XMCRA
+#define SRL2     6
+#define SRL1     5
+#define SRL0     4
+#define SRW01    3
+#define SRW00    2
+#define SRW11    1
+// XMCRB
+#define XMBK     7
+#define XMM2     2
+#define XMM1     1
+#define XMM0     0
+
+// External interrupts
+// EIMSK
+#define INT7     7
+#define INT6     6
+#define INT5     5
+#define INT4     4
+#define INT3     3
+#define INT2     2
+#define INT1     1
+#define INT0     0
+// EIFR
+#define INTF7    7
+#define INTF6    6
+#define INTF5    5
+#define INTF4    4
+#define INTF3    3
+#define INTF2    2
+#define INTF1    1
+#define INTF0    0
+// EICRA
+#define ISC31    7
+#define ISC30    6
+#define ISC21    5
+#define ISC20    4
+#define ISC11    3
+#define ISC10    2
+#define ISC01    1
+#define ISC00    0
+// EICRB
+#define ISC71    7
+#define ISC70    6
+#define ISC61    5
+#define ISC60    4
+#define ISC51    3
+#define ISC50    2
+#define ISC41    1
+#define ISC40    0
+
+// Timers
+// TCCR0
+#define FOC0     7
+#define WGM00    6
+#define COM01    5
+#define COM00    4
+#define WGM01    3
+#define CS02     2
+#define CS01     1
+#define CS00     0
+// ASSR
+#define AS0      3
+#define TCN0UB   2
+#define OCR0UB   1
+#define TCR0UB   0
+// TCCR1A
+#define COM1A1   7
+#define COM1A0   6
+#define COM1B1   5
+#define COM1B0   4
+#define COM1C1   3
+#define COM1C0   2
+#define WGM11    1
+#define WGM10    0
+// TCCR1B
+#define ICNC1    7
+#define ICES1    6
+#define WGM13    4
+#define WGM12    3
+#define CS12     2
+#define CS11     1
+#define CS10     0
+// TCCR1C
+#define FOC1A    7
+#define FOC1B    6
+#define FOC1C    5
+// TCCR2
+#define FOC2     7
+#define WGM20    6
+#define COM21    5
+#define COM20    4
+#define WGM21    3
+#define CS22     2
+#define CS21     1
+#define CS20     0
+// TCCR3A
+#define COM3A1   7
+#define COM3A0   6
+#define COM3B1   5
+#define COM3B0   4
+#define COM3C1   3
+#define COM3C0   2
+#define WGM31    1
+#define WGM30    0
+// TCCR3B
+#define ICNC3    7
+#define ICES3    6
+#define WGM33    4
+#define WGM32    3
+#define CS32     2
+#define CS31     1
+#define CS30     0
+// TCCR3C
+#define FOC3A    7
+#define FOC3B    6
+#define FOC3C    5
+// TIMSK
+#define OCIE2    7
+#define TOIE2    6
+#define TICIE1   5
+#define OCIE1A   4
+#define OCIE1B   3
+#define TOIE1    2
+#define OCIE0    1
+#define TOIE0    0
+// TIFR
+#define OCF2     7
+#define TOV2     6
+#define ICF1     5
+#define OCF1A    4
+#define OCF1B    3
+#define TOV1     2
+#define OCF0     1
+#define TOV0     0
+// ETIMSK
+#define TICIE3   5
+#define OCIE3A   4
+#define OCIE3B   3
+#define TOIE3    2
+#define OCIE3C   1
+#define OCIE1C   0
+// ETIFR
+#define ICF3     5
+#define OCF3A    4
+#define OCF3B    3
+#define TOV3     2
+#define OCF3C    1
+#define OCF1C    0
+
+// TWI
+// TWCR
+#define TWINT    7
+#define TWEA     6
+#define TWSTA    5
+#define TWSTO    4
+#define TWWC     3
+#define TWEN     2
+#define TWIE     0
+// TWSR
+#define TWS7     7
+#define TWS6     6
+#define TWS5     5
+#define TWS4     4
+#define TWS3     3
+#define TWPS1    1
+#define TWPS0    0
+// TWAR
+#define TWGCE    0
+
+// Status register
+// SREG
+#define SREG_I   7
+#define SREG_T   6
+#define SREG_H   5
+#define SREG_S   4
+#define SREG_V   3
+#define SREG_N   2
+#define SREG_Z   1
+#define SREG_C   0
+
+#endif // HOST_AVR_IO_H
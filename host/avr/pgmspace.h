@@ -0,0 +1,32 @@
+/**
+ * @file pgmspace.h
+ * @brief Program memory access for the host build: flash data is ordinary const data.
+ * @details The _far variants take a flash byte address and read the flash model
+ *          (host/flash.h), for code that reads its own program memory like a bootloader.
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "../flash.h"
+
+#define PROGMEM
+#define PGM_P                   const char *
+#define PSTR(s)                 (s)
+#define pgm_read_byte(addr)     (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)    (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)      (*(void * const *)(addr))
+#define pgm_read_byte_far(addr) FlashRead(addr)
+#define pgm_read_word_far(addr) FlashReadWord(addr)
+#define memcpy_P                memcpy
+#define memcmp_P                memcmp
+#define strlen_P                strlen
+#define strcpy_P                strcpy
+#define strncpy_P               strncpy
+#define strcmp_P                strcmp
+#define strncmp_P               strncmp
+
+#endif // HOST_AVR_PGMSPACE_H
@@ -0,0 +1,93 @@
+#include "eeprom.h"
+#include "hal.h"
+#include <avr/io.h>
+#include <stddef.h>
+
+#define EEPROM_WRITE_CYCLES ((uint64_t)EEPROM_WRITE_US * (F_CPU / 1000000UL))
+
+Eeprom_t hal_eeprom;
+
+static uint16_t eeprom_eecr, eeprom_eedr, eeprom_eear;
+
+static bool eeprom_busy(void) {
+    return HalCycles() < hal_eeprom.busy_until;
+}
+
+static uint16_t eeprom_address(void) {
+    return (HalGet(eeprom_eear) | (HalGet(eeprom_eear + 1) << 8)) % EEPROM_SIZE;
+}
+
+static void eeprom_control(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    Eeprom_t *ee = &hal_eeprom;
+    (void)addr;
+    (void)old_value;
+    (void)ctx;
+
+    if (value & (1 << EERE)) {
+        if (eeprom_busy()) ee->violations++;
+        else HalSet(eeprom_eedr, ee->mem[eeprom_address()]);
+        value &= ~(1 << EERE);
+    }
+    if ((value & (1 << EEWE)) && !eeprom_busy()) {
+        if (!ee->armed || HalCycles() - ee->armed_at > 4) {
+            ee->violations++;
+        } else if (ee->cut_after != 0) {
+            uint16_t a = eeprom_address();
+            ee->mem[a] = HalGet(eeprom_eedr);
+            ee->wear[a]++;
+            ee->writes++;
+            ee->busy_until = HalCycles() + EEPROM_WRITE_CYCLES;
+            if (ee->cut_after > 0) ee->cut_after--;
+        }
+        ee->armed = false;
+        value &= ~(1 << EEMWE);
+    } else if (value & (1 << EEMWE)) {
+        ee->armed = true;
+        ee->armed_at = HalCycles();
+    }
+    if (!eeprom_busy()) value &= ~(1 << EEWE);
+    HalSet(eeprom_eecr, value);
+}
+
+// EEWE reads set while a write is in progress, EEMWE clears after four cycles
+static uint8_t eeprom_status(uint16_t addr, uint8_t value, void *ctx) {
+    Eeprom_t *ee = &hal_eeprom;
+    (void)addr;
+    (void)ctx;
+    if (ee->armed && HalCycles() - ee->armed_at > 4) {
+        ee->armed = false;
+        value &= ~(1 << EEMWE);
+    }
+    return eeprom_busy() ? value | (1 << EEWE) : value & ~(1 << EEWE);
+}
+
+/**
+ * @brief Erase the EEPROM (all 0xFF) and clear the counters.
+ */
+void EepromErase(void) {
+    hal_eeprom = (Eeprom_t){ .cut_after = -1 };
+    for (uint16_t a = 0; a < EEPROM_SIZE; a++) hal_eeprom.mem[a] = 0xFF;
+}
+
+/**
+ * @brief Connect the model to EECR and EEDR (after HalReset()).
+ */
+void EepromAttach(void) {
+    hal_eeprom.busy_until = 0;
+    hal_eeprom.armed = false;
+    eeprom_eecr = HAL_ADDR(EECR);
+    eeprom_eedr = HAL_ADDR(EEDR);
+    eeprom_eear = HAL_ADDR(EEARL);
+    HalOnWrite(eeprom_eecr, eeprom_control, NULL);
+    HalOnRead(eeprom_eecr, eeprom_status, NULL);
+}
+
+/**
+ * @brief Whether EE_READY_vect should run now.
+ */
+bool EepromInterrupt(void) {
+    HalSync();
+    if (!(HalGet(eeprom_eecr) & (1 << EERIE))) return false;
+    if (eeprom_busy()) HalAdvance(hal_eeprom.busy_until - HalCycles());
+    return true;
+}
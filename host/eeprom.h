@@ -0,0 +1,53 @@
+/**
+ * @file eeprom.h
+ * @brief ATmega128 internal EEPROM model for host tests.
+ * @details Driven through EEAR/EEDR/EECR like the real part: setting EERE reads the byte
+ *          at EEAR into EEDR, setting EEWE within four cycles of EEMWE programs EEDR at
+ *          EEAR. A write keeps EEWE set for EEPROM_WRITE_US of virtual time. The contents
+ *          survive HalReset(), like the real EEPROM across a reset.
+ *
+ *          EE_READY_vect is not raised by the model; a test calls it while EERIE is set
+ *          (EepromInterrupt()). Misuse is counted: an access while a write is in progress,
+ *          or EEWE set without EEMWE.
+ */
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EEPROM_SIZE         4096
+#define EEPROM_WRITE_US     8500    ///< Byte write time (erase and write)
+
+typedef struct {
+    uint8_t mem[EEPROM_SIZE];
+    uint32_t wear[EEPROM_SIZE];     // Writes per cell
+    uint64_t busy_until;            // Virtual cycles
+    uint64_t armed_at;              // EEMWE set at this cycle
+    bool armed;
+    uint32_t writes;
+    uint32_t violations;
+    int32_t cut_after;              // Writes left before a power cut, later ones are lost (-1 = none)
+} Eeprom_t;
+
+extern Eeprom_t hal_eeprom;
+
+/**
+ * @brief Erase the EEPROM (all 0xFF) and clear the counters.
+ */
+void EepromErase(void);
+
+/**
+ * @brief Connect the model to EECR and EEDR (after HalReset()).
+ */
+void EepromAttach(void);
+
+/**
+ * @brief Whether EE_READY_vect should run now.
+ * @return True when EERIE is set and no write is in progress; waits (advances the virtual
+ *         clock) for a write in progress first.
+ */
+bool EepromInterrupt(void);
+
+#endif // EEPROM_H
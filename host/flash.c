@@ -0,0 +1,94 @@
+#include "flash.h"
+#include "hal.h"
+#include <string.h>
+
+#define FLASH_READ_CYCLES   3       // ELPM
+
+// Global variables
+Flash_t hal_flash;
+
+// Start an SPM instruction
+static bool flash_spm(void) {
+    HalSync();
+    HalAdvance(1);
+    if (FlashSpmBusy()) {
+        hal_flash.spm_violations++;
+        return false;
+    }
+    return true;
+}
+
+static void flash_busy(void) {
+    hal_flash.busy_until = HalCycles() + (uint64_t)FLASH_SPM_US * (F_CPU / 1000000UL);
+    hal_flash.rww_busy = true;
+}
+
+static void flash_buffer_clear(void) {
+    memset(hal_flash.buffer, 0xFF, sizeof(hal_flash.buffer));
+}
+
+/**
+ * @brief Erase the whole flash and clear the SPM state and counters.
+ */
+void FlashReset(void) {
+    memset(&hal_flash, 0, sizeof(hal_flash));
+    memset(hal_flash.mem, 0xFF, sizeof(hal_flash.mem));
+    flash_buffer_clear();
+}
+
+/**
+ * @brief Read a byte the way LPM/ELPM would (pgm_read_byte_far()).
+ */
+uint8_t FlashRead(uint32_t addr) {
+    HalSync();
+    HalAdvance(FLASH_READ_CYCLES);
+    addr %= FLASH_SIZE;
+    if (addr < FLASH_NRWW_START && hal_flash.rww_busy) {
+        hal_flash.rww_violations++;
+        return 0xFF;
+    }
+    return hal_flash.mem[addr];
+}
+
+/**
+ * @brief Read a little-endian word (pgm_read_word_far()).
+ */
+uint16_t FlashReadWord(uint32_t addr) {
+    return FlashRead(addr) | (FlashRead(addr + 1) << 8);
+}
+
+void FlashPageErase(uint32_t addr) {
+    if (!flash_spm()) return;
+    memset(&hal_flash.mem[(addr % FLASH_SIZE) & ~(FLASH_PAGE_SIZE - 1UL)], 0xFF, FLASH_PAGE_SIZE);
+    hal_flash.erases++;
+    flash_busy();
+}
+
+void FlashPageFill(uint32_t addr, uint16_t word) {
+    if (!flash_spm()) return;
+    hal_flash.buffer[(addr % FLASH_PAGE_SIZE) / 2] = word;
+}
+
+void FlashPageWrite(uint32_t addr) {
+    if (!flash_spm()) return;
+    uint8_t *page = &hal_flash.mem[(addr % FLASH_SIZE) & ~(FLASH_PAGE_SIZE - 1UL)];
+    for (uint16_t i = 0; i < FLASH_PAGE_SIZE / 2; i++) {
+        page[2 * i] &= hal_flash.buffer[i] & 0xFF;
+        page[2 * i + 1] &= hal_flash.buffer[i] >> 8;
+    }
+    flash_buffer_clear();
+    hal_flash.writes++;
+    flash_busy();
+}
+
+void FlashRwwEnable(void) {
+    if (!flash_spm()) return;
+    hal_flash.rww_busy = false;
+    flash_buffer_clear();
+}
+
+bool FlashSpmBusy(void) {
+    HalSync();
+    HalAdvance(1);
+    return HalCycles() < hal_flash.busy_until;
+}
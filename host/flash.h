@@ -0,0 +1,65 @@
+/**
+ * @file flash.h
+ * @brief ATmega128 program memory and SPM model for host tests (host/avr/boot.h).
+ * @details Page erase and page write keep the SPM unit busy for FLASH_SPM_US of virtual
+ *          time, like the real part, and make the read-while-write section unreadable until
+ *          boot_rww_enable(). A page write only clears bits, so writing a page that was not
+ *          erased first corrupts it the way real flash would.
+ *
+ *          Misuse is counted instead of stopping the test: an SPM instruction issued while
+ *          the unit is busy, and a read of the RWW section while it is busy (the hardware
+ *          returns garbage, the model returns 0xFF).
+ */
+
+#ifndef FLASH_H
+#define FLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FLASH_SIZE          0x20000UL   ///< 128 KB
+#define FLASH_PAGE_SIZE     256
+#define FLASH_NRWW_START    0x1E000UL   ///< No-read-while-write section (last 8 KB)
+#define FLASH_SPM_US        4500        ///< Page erase or page write time
+
+typedef struct {
+    uint8_t mem[FLASH_SIZE];
+    uint16_t buffer[FLASH_PAGE_SIZE / 2];   // Temporary page buffer
+    uint64_t busy_until;                    // Virtual cycles
+    bool rww_busy;                          // RWW section locked until boot_rww_enable()
+    uint32_t erases;
+    uint32_t writes;
+    uint32_t spm_violations;                // SPM while the unit was busy
+    uint32_t rww_violations;                // RWW section read while locked
+} Flash_t;
+
+extern Flash_t hal_flash;
+
+/**
+ * @brief Erase the whole flash and clear the SPM state and counters.
+ * @note HalReset() leaves the flash alone, like a reset of the real part.
+ */
+void FlashReset(void);
+
+/**
+ * @brief Read a byte the way LPM/ELPM would (pgm_read_byte_far()).
+ * @param addr Byte address.
+ * @return Flash byte, 0xFF for a locked RWW section.
+ */
+uint8_t FlashRead(uint32_t addr);
+
+/**
+ * @brief Read a little-endian word (pgm_read_word_far()).
+ * @param addr Byte address.
+ * @return Flash word.
+ */
+uint16_t FlashReadWord(uint32_t addr);
+
+// SPM operations used by host/avr/boot.h
+void FlashPageErase(uint32_t addr);
+void FlashPageFill(uint32_t addr, uint16_t word);
+void FlashPageWrite(uint32_t addr);
+void FlashRwwEnable(void);
+bool FlashSpmBusy(void);
+
+#endif // FLASH_H
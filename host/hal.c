@@ -0,0 +1,290 @@
+#include "hal.h"
+#include <stddef.h>
+
+#define HAL_NONE        0xFFFF
+#define HAL_XDIV        0x5C        // System clock divider
+
+// Registers with side effects on write or read (see hal.h)
+static const uint16_t hal_action_regs[] = {
+    0x2C,   // UDR0
+    0x2F,   // SPDR
+    0x3C,   // EECR
+    0x73,   // TWDR
+    0x74,   // TWCR
+    0x9C    // UDR1
+};
+
+typedef enum {
+    HOOK_WRITE,
+    HOOK_READ,
+    HOOK_CONSUME
+} HalHookKind_t;
+
+typedef struct {
+    uint16_t addr;
+    uint8_t kind;
+    union {
+        HalWriteHook_t write;
+        HalReadHook_t read;
+        HalConsumeHook_t consume;
+    } fn;
+    void *ctx;
+} HalHook_t;
+
+// Global variables
+bool hal_peek;
+uint16_t hal_heap_end = HAL_IO_SIZE;
+static uint8_t hal_mem[HAL_MEM_SIZE] __attribute__((aligned(2)));
+static uint16_t hal_act[HAL_IO_SIZE];           // Action cells, low byte = value
+static bool hal_is_act[HAL_IO_SIZE];
+static uint8_t hal_shadow[HAL_IO_SIZE];         // Value at the last sync
+static bool hal_watched[HAL_IO_SIZE];           // Has write hooks
+static bool hal_has_read[HAL_IO_SIZE];          // Has read hooks
+static HalHook_t hal_hooks[HAL_MAX_HOOKS];
+static uint8_t hal_hook_count;
+static uint16_t hal_last_act = HAL_NONE;        // Action register accessed last
+static uint64_t hal_cycles;
+static uint64_t hal_accesses;
+static bool hal_in_sync;
+
+static void hal_fire_write(uint16_t addr, uint8_t old_value, uint8_t value) {
+    for (uint8_t i = 0; i < hal_hook_count; i++) {
+        HalHook_t *h = &hal_hooks[i];
+        if (h->addr == addr && h->kind == HOOK_WRITE) h->fn.write(addr, old_value, value, h->ctx);
+    }
+}
+
+static void hal_fire_consume(uint16_t addr, uint8_t value) {
+    for (uint8_t i = 0; i < hal_hook_count; i++) {
+        HalHook_t *h = &hal_hooks[i];
+        if (h->addr == addr && h->kind == HOOK_CONSUME) h->fn.consume(addr, value, h->ctx);
+    }
+}
+
+static void hal_refresh(uint16_t addr) {
+    for (uint8_t i = 0; i < hal_hook_count; i++) {
+        HalHook_t *h = &hal_hooks[i];
+        if (h->addr == addr && h->kind == HOOK_READ) {
+            uint8_t value = h->fn.read(addr, HalGet(addr), h->ctx);
+            HalSet(addr, value);
+            hal_shadow[addr] = value;
+        }
+    }
+}
+
+static void hal_add(uint16_t addr, uint8_t kind, void *fn, void *ctx) {
+    if (addr >= HAL_IO_SIZE || hal_hook_count >= HAL_MAX_HOOKS) return;
+    HalHook_t *h = &hal_hooks[hal_hook_count++];
+    h->addr = addr;
+    h->kind = kind;
+    h->ctx = ctx;
+    if (kind == HOOK_WRITE) {
+        h->fn.write = (HalWriteHook_t)fn;
+        hal_watched[addr] = true;
+        hal_shadow[addr] = HalGet(addr);
+    } else if (kind == HOOK_READ) {
+        h->fn.read = (HalReadHook_t)fn;
+        hal_has_read[addr] = true;
+    } else {
+        h->fn.consume = (HalConsumeHook_t)fn;
+    }
+}
+
+/**
+ * @brief Clear all registers, hooks and the virtual clock.
+ */
+void HalReset(void) {
+    for (uint16_t a = 0; a < HAL_IO_SIZE; a++) {
+        hal_mem[a] = 0;
+        hal_act[a] = HAL_MARK;
+        hal_is_act[a] = false;
+        hal_shadow[a] = 0;
+        hal_watched[a] = false;
+        hal_has_read[a] = false;
+    }
+    for (uint16_t a = HAL_IO_SIZE; a < HAL_MEM_SIZE; a++) hal_mem[a] = 0;
+    hal_heap_end = HAL_IO_SIZE;
+    for (uint8_t i = 0; i < sizeof(hal_action_regs) / sizeof(hal_action_regs[0]); i++) {
+        hal_is_act[hal_action_regs[i]] = true;
+    }
+    hal_hook_count = 0;
+    hal_last_act = HAL_NONE;
+    hal_cycles = 0;
+    hal_accesses = 0;
+    hal_in_sync = false;
+    hal_peek = false;
+}
+
+/**
+ * @brief Register a write hook.
+ */
+void HalOnWrite(uint16_t addr, HalWriteHook_t hook, void *ctx) {
+    hal_add(addr, HOOK_WRITE, (void *)hook, ctx);
+}
+
+/**
+ * @brief Register a read hook that supplies the value of an input register.
+ */
+void HalOnRead(uint16_t addr, HalReadHook_t hook, void *ctx) {
+    hal_add(addr, HOOK_READ, (void *)hook, ctx);
+}
+
+/**
+ * @brief Register a hook for reads of an action register.
+ */
+void HalOnConsume(uint16_t addr, HalConsumeHook_t hook, void *ctx) {
+    hal_add(addr, HOOK_CONSUME, (void *)hook, ctx);
+}
+
+/**
+ * @brief Dispatch the effect of the last register access to the hooks.
+ */
+void HalSync(void) {
+    if (hal_in_sync) return;        // A hook touched a register through the macros
+    hal_in_sync = true;
+
+    // Action register: a cleared mark or a changed value means it was written
+    if (hal_last_act != HAL_NONE) {
+        uint16_t addr = hal_last_act;
+        uint16_t cell = hal_act[addr];
+        uint8_t old_value = hal_shadow[addr];
+        hal_last_act = HAL_NONE;
+        hal_act[addr] = (cell & 0xFF) | HAL_MARK;
+        hal_shadow[addr] = cell & 0xFF;
+        if (!(cell & HAL_MARK) || (uint8_t)cell != old_value) hal_fire_write(addr, old_value, cell);
+        else hal_fire_consume(addr, cell);
+    }
+
+    // Plain registers: report changes
+    for (uint8_t i = 0; i < hal_hook_count; i++) {
+        uint16_t addr = hal_hooks[i].addr;
+        if (!hal_watched[addr] || hal_is_act[addr]) continue;
+        uint8_t value = hal_mem[addr];
+        if (value != hal_shadow[addr]) {
+            uint8_t old_value = hal_shadow[addr];
+            hal_shadow[addr] = value;
+            hal_fire_write(addr, old_value, value);
+        }
+    }
+
+    hal_in_sync = false;
+}
+
+/**
+ * @brief Read a register without side effects (for hooks and tests).
+ */
+uint8_t HalGet(uint16_t addr) {
+    if (addr >= HAL_MEM_SIZE) return 0;
+    if (addr >= HAL_IO_SIZE) return hal_mem[addr];
+    return hal_is_act[addr] ? (uint8_t)hal_act[addr] : hal_mem[addr];
+}
+
+/**
+ * @brief Write a register without triggering hooks (for models and tests).
+ */
+void HalSet(uint16_t addr, uint8_t value) {
+    if (addr >= HAL_MEM_SIZE) return;
+    if (addr >= HAL_IO_SIZE) {
+        hal_mem[addr] = value;
+        return;
+    }
+    if (hal_is_act[addr]) hal_act[addr] = value | HAL_MARK;
+    else hal_mem[addr] = value;
+    hal_shadow[addr] = value;
+}
+
+/**
+ * @brief XDIV division factor of the system clock.
+ */
+uint8_t HalClockDivider(void) {
+    uint8_t xdiv = hal_mem[HAL_XDIV];
+    return (xdiv & 0x80) ? 129 - (xdiv & 0x7F) : 1;      // XDIVEN, XDIV6..0
+}
+
+/**
+ * @brief Virtual time since HalReset().
+ */
+uint64_t HalCycles(void) {
+    return hal_cycles;
+}
+
+/**
+ * @brief Virtual time since HalReset().
+ */
+uint64_t HalMicros(void) {
+    return hal_cycles * 1000000ULL / F_CPU;
+}
+
+/**
+ * @brief Advance the virtual clock.
+ */
+void HalAdvance(uint64_t cycles) {
+    hal_cycles += cycles;
+}
+
+/**
+ * @brief Number of register accesses since HalReset().
+ */
+uint64_t HalAccesses(void) {
+    return hal_accesses;
+}
+
+/**
+ * @brief Map a register cell back to its address.
+ */
+uint16_t HalAddr(const volatile void *cell) {
+    const volatile uint8_t *p = cell;
+    if (p >= hal_mem && p < hal_mem + HAL_MEM_SIZE) return p - hal_mem;
+    return (const volatile uint16_t *)cell - hal_act;
+}
+
+// Common part of every register access
+static void hal_access(uint16_t addr) {
+    HalSync();
+    hal_cycles += HalClockDivider();
+    hal_accesses++;
+    if (hal_has_read[addr]) hal_refresh(addr);
+}
+
+volatile uint8_t *HalIo8(uint16_t addr) {
+    if (hal_peek) {
+        hal_peek = false;
+        if (addr < HAL_IO_SIZE && hal_is_act[addr]) return (volatile uint8_t *)&hal_act[addr];
+        return &hal_mem[addr];
+    }
+    if (addr >= HAL_IO_SIZE) {
+        // SRAM: no hooks, one cycle like a register access
+        HalSync();
+        hal_cycles += HalClockDivider();
+        return &hal_mem[addr];
+    }
+    hal_access(addr);
+    return &hal_mem[addr];
+}
+
+volatile uint16_t *HalIo16(uint16_t addr) {
+    if (!hal_peek) hal_access(addr);
+    hal_peek = false;
+    return (volatile uint16_t *)&hal_mem[addr];
+}
+
+volatile uint16_t *HalAct8(uint16_t addr) {
+    if (!hal_peek) {
+        hal_access(addr);
+        hal_last_act = addr;
+    }
+    hal_peek = false;
+    return &hal_act[addr];
+}
+
+// Delays from host/util/delay.h
+void hal_delay_us(double us) {
+    HalSync();
+    if (us > 0) hal_cycles += (uint64_t)(us * (F_CPU / 1000000.0) + 0.5) * HalClockDivider();
+}
+
+// Counted loops from host/util/delay_basic.h, in CPU cycles at the current clock
+void hal_delay_cycles(uint32_t cycles) {
+    HalSync();
+    hal_cycles += (uint64_t)cycles * HalClockDivider();
+}
@@ -0,0 +1,148 @@
+/**
+ * @file hal.h
+ * @brief Register-simulation HAL for building lib/ on the host (x86 Linux).
+ * @details host/avr/io.h maps every ATmega128 register to a cell in hal_mem[], reached
+ *          through HalIo8()/HalIo16(). Each access first runs HalSync(), which finds out
+ *          what the previous access did and calls the hooks registered for that address:
+ *          - plain registers (PORTx, DDRx, ...) report a write when their value changed;
+ *          - action registers (TWCR, TWDR, UDR0/1, SPDR, EECR) live in 16-bit cells that
+ *            carry HAL_MARK after every sync. A driver assignment stores a plain 8-bit value
+ *            and clears the mark, so even writing the same value twice is seen as two writes;
+ *            an access that leaves the mark set was a read and goes to the consume hooks
+ *            (e.g. popping the next received byte after UDR0 was read);
+ *          - read hooks refresh a register (PINx, status bits) just before it is accessed.
+ *
+ *          The internal SRAM (0x100-0x10FF) is plain memory behind the same accessors, so
+ *          code that walks the data space by address (stackmon.c) runs on the host too.
+ *
+ *          Time is a virtual CPU cycle counter: every register access costs one cycle and
+ *          _delay_us()/_delay_ms() advance it by the requested time, so busy-wait loops and
+ *          protocol timing can be checked without real hardware. Models advance it too
+ *          (e.g. the TWI bus for each transferred bit).
+ *
+ * @note Hooks must use HalGet()/HalSet(), never the register macros.
+ * @note An action register read straight into a wider type (e.g. int16_t c = UDR0) carries
+ *       HAL_MARK in bit 8; store it in a uint8_t first, as the drivers do.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HAL_IO_SIZE     0x100   ///< Data-space addresses 0x00-0xFF (all ATmega128 registers)
+#define HAL_MEM_SIZE    0x1100  ///< Registers and internal SRAM, up to RAMEND
+#define HAL_MARK        0x100   ///< Set in action cells at every sync, cleared by a write
+#define HAL_MAX_HOOKS   32      ///< Hooks of all kinds together
+
+// Called when a register was written (value may equal old_value for action registers)
+typedef void (*HalWriteHook_t)(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx);
+
+// Called before a register is accessed; returns the value the access should see
+typedef uint8_t (*HalReadHook_t)(uint16_t addr, uint8_t value, void *ctx);
+
+// Called after an action register was read
+typedef void (*HalConsumeHook_t)(uint16_t addr, uint8_t value, void *ctx);
+
+/**
+ * @brief Clear all registers, hooks and the virtual clock.
+ * @note Registers start at 0 except SREG (interrupts disabled) and the action marks.
+ */
+void HalReset(void);
+
+/**
+ * @brief Register a write hook.
+ * @param addr Register address (e.g. HAL_ADDR(PORTB)).
+ * @param hook Function to call.
+ * @param ctx Passed to the hook.
+ */
+void HalOnWrite(uint16_t addr, HalWriteHook_t hook, void *ctx);
+
+/**
+ * @brief Register a read hook that supplies the value of an input register.
+ * @param addr Register address.
+ * @param hook Function to call.
+ * @param ctx Passed to the hook.
+ */
+void HalOnRead(uint16_t addr, HalReadHook_t hook, void *ctx);
+
+/**
+ * @brief Register a hook for reads of an action register.
+ * @param addr Action register address.
+ * @param hook Function to call.
+ * @param ctx Passed to the hook.
+ */
+void HalOnConsume(uint16_t addr, HalConsumeHook_t hook, void *ctx);
+
+/**
+ * @brief Dispatch the effect of the last register access to the hooks.
+ * @note Called by every register access and delay; call it before checking a model.
+ */
+void HalSync(void);
+
+/**
+ * @brief Read a register without side effects (for hooks and tests).
+ * @param addr Register or SRAM address.
+ * @return Register value.
+ */
+uint8_t HalGet(uint16_t addr);
+
+/**
+ * @brief Write a register without triggering hooks (for models and tests).
+ * @param addr Register or SRAM address.
+ * @param value New value.
+ */
+void HalSet(uint16_t addr, uint8_t value);
+
+/**
+ * @brief Virtual time since HalReset().
+ * @return Cycles of the undivided clock (F_CPU): while XDIV divides the system clock,
+ *         every CPU cycle counts its division factor.
+ */
+uint64_t HalCycles(void);
+
+/**
+ * @brief XDIV division factor of the system clock.
+ * @return 1 when XDIV is off.
+ */
+uint8_t HalClockDivider(void);
+
+/**
+ * @brief Virtual time since HalReset().
+ * @return Microseconds at F_CPU.
+ */
+uint64_t HalMicros(void);
+
+/**
+ * @brief Advance the virtual clock.
+ * @param cycles Cycles of the undivided clock.
+ */
+void HalAdvance(uint64_t cycles);
+
+/**
+ * @brief Number of register accesses since HalReset().
+ * @return Access count.
+ */
+uint64_t HalAccesses(void);
+
+/**
+ * @brief Map a register cell back to its address.
+ * @param cell Pointer returned by one of the accessors.
+ * @return Register address.
+ */
+uint16_t HalAddr(const volatile void *cell);
+
+// End of .data/.bss (and of the heap) in the simulated SRAM, RAMSTART after HalReset()
+extern uint16_t hal_heap_end;
+
+// Accessors used by host/avr/io.h
+volatile uint8_t *HalIo8(uint16_t addr);
+volatile uint16_t *HalIo16(uint16_t addr);
+volatile uint16_t *HalAct8(uint16_t addr);
+extern bool hal_peek;
+
+// Register address for hooks, e.g. HalOnWrite(HAL_ADDR(PORTB), ...); not counted as an access
+#define HAL_ADDR(reg)   ({ hal_peek = true; HalAddr(&(reg)); })
+
+#endif // HAL_H
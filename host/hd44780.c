@@ -0,0 +1,161 @@
+#include "hd44780.h"
+#include "hal.h"
+#include <string.h>
+
+#define HD44780_EXEC_US     37      // Most instructions and data writes
+#define HD44780_SLOW_US     1520    // Clear display, return home
+
+// Row start addresses (rows 2 and 3 continue rows 0 and 1 on 20x4 modules)
+static const uint8_t hd44780_rows[4] = { 0x00, 0x40, 0x14, 0x54 };
+
+// Move the address counter, wrapping inside the DDRAM lines
+static void hd44780_step(Hd44780_t *lcd, int8_t dir) {
+    uint8_t ac = lcd->ac;
+    if (lcd->two_lines) {
+        uint8_t base = ac & 0x40;
+        uint8_t col = ac & 0x3F;
+        if (dir > 0) col = (col >= 0x27) ? 0 : col + 1;
+        else col = (col == 0) ? 0x27 : col - 1;
+        if (dir > 0 && col == 0) base ^= 0x40;
+        if (dir < 0 && col == 0x27) base ^= 0x40;
+        lcd->ac = base | col;
+    } else {
+        if (dir > 0) lcd->ac = (ac >= 0x4F) ? 0 : ac + 1;
+        else lcd->ac = (ac == 0) ? 0x4F : ac - 1;
+    }
+}
+
+static void hd44780_command(Hd44780_t *lcd, uint8_t cmd) {
+    uint32_t exec = HD44780_EXEC_US;
+
+    if (cmd == 0x00) return;        // No instruction (e.g. the high nibble of 0x03 at init)
+    if (cmd & 0x80) {
+        lcd->ac = cmd & 0x7F;
+        lcd->cgram = false;
+    } else if (cmd & 0x40) {
+        lcd->cgram = true;
+    } else if (cmd & 0x20) {
+        lcd->eight_bit = cmd & 0x10;
+        lcd->two_lines = cmd & 0x08;
+        lcd->nibble_pending = false;
+    } else if (cmd & 0x10) {
+        bool right = cmd & 0x04;
+        if (cmd & 0x08) lcd->shift += right ? -1 : 1;      // Display shift
+        else hd44780_step(lcd, right ? 1 : -1);             // Cursor move
+    } else if (cmd & 0x08) {
+        lcd->display_on = cmd & 0x04;
+        lcd->cursor_on = cmd & 0x02;
+        lcd->blink_on = cmd & 0x01;
+    } else if (cmd & 0x04) {
+        lcd->increment = cmd & 0x02;
+    } else if (cmd & 0x02) {
+        lcd->ac = 0;
+        lcd->shift = 0;
+        exec = HD44780_SLOW_US;
+    } else if (cmd & 0x01) {
+        memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+        lcd->ac = 0;
+        lcd->shift = 0;
+        lcd->increment = true;
+        exec = HD44780_SLOW_US;
+    }
+    lcd->busy_until = HalCycles() + (uint64_t)exec * (F_CPU / 1000000UL);
+}
+
+static void hd44780_byte(Hd44780_t *lcd, bool rs, uint8_t value) {
+    if (lcd->byte_count < HD44780_LOG) {
+        Hd44780Byte_t *b = &lcd->bytes[lcd->byte_count++];
+        b->value = value;
+        b->rs = rs;
+        b->cycles = HalCycles();
+    }
+
+    if (!rs) {
+        hd44780_command(lcd, value);
+        return;
+    }
+    if (!lcd->cgram) {
+        lcd->ddram[lcd->ac & 0x7F] = value;
+        hd44780_step(lcd, lcd->increment ? 1 : -1);
+    }
+    lcd->busy_until = HalCycles() + (uint64_t)HD44780_EXEC_US * (F_CPU / 1000000UL);
+}
+
+/**
+ * @brief Power-on state: 8-bit interface, one line, display off, DDRAM filled with spaces.
+ */
+void Hd44780Init(Hd44780_t *lcd) {
+    memset(lcd, 0, sizeof(*lcd));
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+    lcd->eight_bit = true;
+    lcd->increment = true;
+}
+
+/**
+ * @brief Feed one falling EN edge.
+ */
+void Hd44780Strobe(Hd44780_t *lcd, bool rs, bool rw, uint8_t data) {
+    if (lcd->strobe_count < HD44780_LOG) lcd->strobes[lcd->strobe_count++] = data;
+    if (rw) {
+        lcd->reads++;
+        return;
+    }
+
+    // The busy time is checked at the first strobe of a transfer
+    if (!lcd->nibble_pending && HalCycles() < lcd->busy_until) lcd->busy_violations++;
+
+    if (lcd->eight_bit) {
+        hd44780_byte(lcd, rs, data);
+    } else if (!lcd->nibble_pending) {
+        lcd->nibble = data & 0xF0;
+        lcd->nibble_pending = true;
+    } else {
+        lcd->nibble_pending = false;
+        hd44780_byte(lcd, rs, lcd->nibble | (data >> 4));
+    }
+}
+
+// Falling EN edge on the control port
+static void hd44780_ctrl_hook(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    Hd44780_t *lcd = ctx;
+    (void)addr;
+    if ((old_value & (1 << lcd->en_bit)) && !(value & (1 << lcd->en_bit))) {
+        Hd44780Strobe(lcd, value & (1 << lcd->rs_bit), value & (1 << lcd->rw_bit), HalGet(lcd->data_addr));
+    }
+}
+
+/**
+ * @brief Connect the model to a port-driven bus (e.g. lcd.c).
+ */
+void Hd44780AttachParallel(Hd44780_t *lcd, uint16_t ctrl_addr, uint8_t rs_bit, uint8_t rw_bit,
+                           uint8_t en_bit, uint16_t data_addr) {
+    lcd->data_addr = data_addr;
+    lcd->rs_bit = rs_bit;
+    lcd->rw_bit = rw_bit;
+    lcd->en_bit = en_bit;
+    HalOnWrite(ctrl_addr, hd44780_ctrl_hook, lcd);
+}
+
+/**
+ * @brief Copy the visible text of a row.
+ */
+void Hd44780Row(Hd44780_t *lcd, uint8_t row, char *buf, uint8_t width) {
+    HalSync();
+    for (uint8_t col = 0; col < width; col++) {
+        int16_t offset = ((int16_t)col + lcd->shift) % 40;
+        if (offset < 0) offset += 40;
+        buf[col] = lcd->ddram[(hd44780_rows[row & 3] + offset) & 0x7F];
+    }
+    buf[width] = '\0';
+}
+
+/**
+ * @brief Find the last complete byte of a kind.
+ */
+int Hd44780Last(Hd44780_t *lcd, bool rs) {
+    HalSync();
+    for (int i = lcd->byte_count - 1; i >= 0; i--) {
+        if (lcd->bytes[i].rs == rs) return lcd->bytes[i].value;
+    }
+    return -1;
+}
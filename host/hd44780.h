@@ -0,0 +1,97 @@
+/**
+ * @file hd44780.h
+ * @brief HD44780 character LCD model for host tests.
+ * @details Decodes the bus at every falling EN edge: 8-bit or 4-bit transfers, DDRAM
+ *          writes with the address counter, entry mode, display shift and the other
+ *          instructions. Each strobe, each complete byte and the instruction timing
+ *          (37 us, 1.52 ms for clear/home) are recorded so tests can check the nibble
+ *          sequences, cursor addresses and busy-time violations.
+ */
+
+#ifndef HD44780_H
+#define HD44780_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HD44780_LOG     256     ///< Bytes and strobes kept in the logs
+
+// One complete transfer (command or data)
+typedef struct {
+    uint8_t value;
+    bool rs;
+    uint64_t cycles;    // Virtual time of the last strobe
+} Hd44780Byte_t;
+
+typedef struct {
+    uint8_t ddram[0x80];
+    uint8_t ac;                 // Address counter
+    int8_t shift;               // Display shift, positive = content moved left
+    bool eight_bit;             // DL
+    bool two_lines;             // N
+    bool display_on;
+    bool cursor_on;
+    bool blink_on;
+    bool increment;             // I/D
+    bool cgram;                 // Data goes to CGRAM (ignored)
+    bool nibble_pending;        // 4-bit mode: high nibble received
+    uint8_t nibble;
+    uint64_t busy_until;        // Virtual time the current instruction ends
+
+    Hd44780Byte_t bytes[HD44780_LOG];
+    uint16_t byte_count;
+    uint8_t strobes[HD44780_LOG];   // DB7-DB0 at each falling EN edge
+    uint16_t strobe_count;
+    uint16_t busy_violations;   // Transfers that started during an instruction
+    uint16_t reads;             // Strobes with RW high (not modelled)
+
+    // Parallel bus wiring (Hd44780AttachParallel)
+    uint16_t data_addr;
+    uint8_t rs_bit, rw_bit, en_bit;
+} Hd44780_t;
+
+/**
+ * @brief Power-on state: 8-bit interface, one line, display off, DDRAM filled with spaces.
+ * @param lcd Model.
+ */
+void Hd44780Init(Hd44780_t *lcd);
+
+/**
+ * @brief Feed one falling EN edge.
+ * @param lcd Model.
+ * @param rs Register select.
+ * @param rw Read (true) or write.
+ * @param data DB7-DB0; only DB7-DB4 are used in 4-bit mode.
+ */
+void Hd44780Strobe(Hd44780_t *lcd, bool rs, bool rw, uint8_t data);
+
+/**
+ * @brief Connect the model to a port-driven bus (e.g. lcd.c).
+ * @param lcd Model, initialized.
+ * @param ctrl_addr Control port address (RS, RW, EN).
+ * @param rs_bit RS bit.
+ * @param rw_bit RW bit.
+ * @param en_bit EN bit.
+ * @param data_addr Data port address (DB0-DB7).
+ */
+void Hd44780AttachParallel(Hd44780_t *lcd, uint16_t ctrl_addr, uint8_t rs_bit, uint8_t rw_bit,
+                           uint8_t en_bit, uint16_t data_addr);
+
+/**
+ * @brief Copy the visible text of a row.
+ * @param lcd Model.
+ * @param row Row 0-3 (rows 2 and 3 follow the 20x4 layout at 0x14 / 0x54).
+ * @param buf Destination, width + 1 bytes.
+ * @param width Visible columns.
+ */
+void Hd44780Row(Hd44780_t *lcd, uint8_t row, char *buf, uint8_t width);
+
+/**
+ * @brief Find the last complete byte of a kind.
+ * @param lcd Model.
+ * @param rs false for commands, true for data.
+ * @return Byte value, or -1 if none was sent.
+ */
+int Hd44780Last(Hd44780_t *lcd, bool rs);
+
+#endif // HD44780_H
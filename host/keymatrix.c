@@ -0,0 +1,63 @@
+#include "keymatrix.h"
+#include "hal.h"
+#include <avr/io.h>
+
+// Global variables
+static uint16_t km_ddrd, km_portd;
+
+static uint8_t km_pind(uint16_t addr, uint8_t value, void *ctx) {
+    KeyMatrix_t *km = ctx;
+    uint8_t ddr = HalGet(km_ddrd);
+    uint8_t port = HalGet(km_portd);
+    (void)addr;
+    (void)value;
+
+    if (km->reads < KEYMATRIX_LOG) km->scan_log[km->reads] = ddr & ~port & 0x0F;
+    km->reads++;
+    return KeyMatrixLevels(km, ddr, port);
+}
+
+/**
+ * @brief Levels on PD0-PD7 for the pressed keys and buttons.
+ */
+uint8_t KeyMatrixLevels(const KeyMatrix_t *km, uint8_t ddr, uint8_t port) {
+    // Driven pins keep their output, inputs read the pull-up (or float high)
+    uint8_t level = (ddr & port) | (uint8_t)~ddr;
+    uint8_t low = ddr & ~port;      // Pins driven low
+
+    level &= ~(km->buttons & 0x0F & ~ddr);
+    low |= km->buttons & 0x0F & ~ddr;
+
+    // A pressed key joins its row and column; two passes settle paths through one pin
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint8_t key = 0; key < 16; key++) {
+            if (!(km->keys & (1 << key))) continue;
+            uint8_t row = 1 << (key / 4);
+            uint8_t col = 1 << (4 + key % 4);
+            if (low & (row | col)) {
+                low |= (row | col) & ~ddr;
+                level &= ~((row | col) & ~ddr);
+            }
+        }
+    }
+    return level;
+}
+
+/**
+ * @brief Supply PIND from the model.
+ */
+void KeyMatrixAttach(KeyMatrix_t *km) {
+    *km = (KeyMatrix_t){ 0 };
+    km_ddrd = HAL_ADDR(DDRD);
+    km_portd = HAL_ADDR(PORTD);
+    HalOnRead(HAL_ADDR(PIND), km_pind, km);
+}
+
+/**
+ * @brief Press or release a key.
+ */
+void KeyMatrixSet(KeyMatrix_t *km, uint8_t key, uint8_t pressed) {
+    if (key < 1 || key > 16) return;
+    if (pressed) km->keys |= 1 << (key - 1);
+    else km->keys &= ~(1 << (key - 1));
+}
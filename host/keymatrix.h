@@ -0,0 +1,47 @@
+/**
+ * @file keymatrix.h
+ * @brief 4x4 keypad (rows PD0-PD3, columns PD4-PD7) and push buttons (PD0-PD3) model.
+ * @details PIND is computed at every read from DDRD/PORTD and the pressed keys: a pressed
+ *          key connects its row and column pin, so an input pin follows a driven-low pin
+ *          on the other side; otherwise inputs read their pull-up (or 1 when floating).
+ *          Pressed buttons pull PD0-PD3 to ground.
+ */
+
+#ifndef KEYMATRIX_H
+#define KEYMATRIX_H
+
+#include <stdint.h>
+
+#define KEYMATRIX_LOG   64      ///< PIND reads kept in the scan log
+
+typedef struct {
+    uint16_t keys;                      ///< Bit (row * 4 + col) set = key pressed
+    uint8_t buttons;                    ///< Bit n set = button n + 1 pressed
+    uint8_t scan_log[KEYMATRIX_LOG];    ///< PD0-PD3 driven low at each PIND read
+    uint16_t reads;
+} KeyMatrix_t;
+
+/**
+ * @brief Supply PIND from the model.
+ * @param km Model, cleared here (nothing pressed).
+ */
+void KeyMatrixAttach(KeyMatrix_t *km);
+
+/**
+ * @brief Press or release a key.
+ * @param km Model.
+ * @param key Key number 1-16 as returned by KeypadRead().
+ * @param pressed New state.
+ */
+void KeyMatrixSet(KeyMatrix_t *km, uint8_t key, uint8_t pressed);
+
+/**
+ * @brief Levels on PD0-PD7 for the pressed keys and buttons (also used by sim/board.c).
+ * @param km Model.
+ * @param ddr DDRD.
+ * @param port PORTD.
+ * @return PIND.
+ */
+uint8_t KeyMatrixLevels(const KeyMatrix_t *km, uint8_t ddr, uint8_t port);
+
+#endif // KEYMATRIX_H
@@ -0,0 +1,46 @@
+#include "pcf8574.h"
+
+static bool pcf_write(TwiDevice_t *dev, uint8_t data) {
+    Pcf8574_t *pcf = dev->ctx;
+    uint8_t old_port = pcf->port;
+    pcf->port = data;
+    pcf->writes++;
+    if (pcf->on_change) pcf->on_change(pcf, old_port, data);
+    return true;
+}
+
+// Quasi-bidirectional pins: a low latch pulls the pin low
+static uint8_t pcf_read(TwiDevice_t *dev, bool ack) {
+    Pcf8574_t *pcf = dev->ctx;
+    (void)ack;
+    return pcf->port & pcf->inputs;
+}
+
+// Falling P2 clocks the LCD
+static void pcf_lcd_change(Pcf8574_t *pcf, uint8_t old_port, uint8_t port) {
+    if ((old_port & 0x04) && !(port & 0x04)) {
+        Hd44780Strobe(pcf->lcd, port & 0x01, port & 0x02, (port & 0xF0) | 0x0F);
+    }
+}
+
+/**
+ * @brief Put the expander on the bus.
+ */
+void Pcf8574Init(Pcf8574_t *pcf, TwiBus_t *bus, uint8_t address) {
+    *pcf = (Pcf8574_t){ 0 };
+    pcf->port = 0xFF;           // Power-on: all pins high
+    pcf->inputs = 0xFF;
+    pcf->dev.address = address;
+    pcf->dev.write = pcf_write;
+    pcf->dev.read = pcf_read;
+    pcf->dev.ctx = pcf;
+    TwiBusAdd(bus, &pcf->dev);
+}
+
+/**
+ * @brief Wire an HD44780 to the port.
+ */
+void Pcf8574AttachLcd(Pcf8574_t *pcf, Hd44780_t *lcd) {
+    pcf->lcd = lcd;
+    pcf->on_change = pcf_lcd_change;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file pcf8574.h
+ * @brief PCF8574 I/O expander model, with the usual HD44780 backpack wiring.
+ */
+
+#ifndef PCF8574_H
+#define PCF8574_H
+
+#include <stdint.h>
+#include "twi_bus.h"
+#include "hd44780.h"
+
+typedef struct Pcf8574 {
+    TwiDevice_t dev;
+    uint8_t port;           // Output latch
+    uint8_t inputs;         // Levels seen on pins whose latch is high
+    uint32_t writes;
+    void (*on_change)(struct Pcf8574 *pcf, uint8_t old_port, uint8_t port);
+    Hd44780_t *lcd;         // Pcf8574AttachLcd()
+} Pcf8574_t;
+
+/**
+ * @brief Put the expander on the bus.
+ * @param pcf Model, cleared here.
+ * @param bus Bus.
+ * @param address 7-bit address (0x20-0x27, 0x38-0x3F for the A version).
+ */
+void Pcf8574Init(Pcf8574_t *pcf, TwiBus_t *bus, uint8_t address);
+
+/**
+ * @brief Wire an HD44780 to the port: P0 = RS, P1 = RW, P2 = EN, P3 = backlight, P4-P7 = D4-D7.
+ * @param pcf Model.
+ * @param lcd LCD model, initialized. D0-D3 are left open and read as 1.
+ */
+void Pcf8574AttachLcd(Pcf8574_t *pcf, Hd44780_t *lcd);
+
+#endif // PCF8574_H
@@ -0,0 +1,61 @@
+#include "timer3.h"
+#include "hal.h"
+#include <avr/io.h>
+
+// Clock select CS32-CS30 to prescaler (external clock inputs count as stopped)
+static const uint16_t timer3_prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+static uint16_t timer3_tcnt3l, timer3_tcnt3h;
+
+static uint16_t timer3_now(Timer3_t *t) {
+    if (!t->prescaler) return t->base;
+    return t->base + (HalCycles() - t->start) / ((uint64_t)t->prescaler * t->divider);
+}
+
+// A new prescaler or system clock divider: the count goes on from where it is
+static void timer3_rebase(Timer3_t *t, uint16_t prescaler) {
+    t->base = timer3_now(t);
+    t->prescaler = prescaler;
+    t->divider = HalClockDivider();
+    t->start = HalCycles();
+}
+
+static void timer3_control(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    Timer3_t *t = ctx;
+    (void)addr;
+    (void)old_value;
+    uint16_t prescaler = timer3_prescalers[value & 0x07];
+    if (prescaler != t->prescaler) timer3_rebase(t, prescaler);
+}
+
+static void timer3_xdiv(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    Timer3_t *t = ctx;
+    (void)addr;
+    (void)old_value;
+    (void)value;
+    timer3_rebase(t, t->prescaler);
+}
+
+// Reads of TCNT3 (low byte first, as the 16-bit access does) see the current count
+static uint8_t timer3_count(uint16_t addr, uint8_t value, void *ctx) {
+    Timer3_t *t = ctx;
+    (void)addr;
+    (void)value;
+    if (!t->prescaler) return HalGet(timer3_tcnt3l);
+    uint16_t count = timer3_now(t);
+    HalSet(timer3_tcnt3h, count >> 8);
+    return count & 0xFF;
+}
+
+/**
+ * @brief Supply TCNT3 from the model.
+ */
+void Timer3Attach(Timer3_t *t) {
+    *t = (Timer3_t){ 0 };
+    timer3_tcnt3l = HAL_ADDR(TCNT3L);
+    timer3_tcnt3h = HAL_ADDR(TCNT3H);
+    t->divider = 1;
+    HalOnWrite(HAL_ADDR(TCCR3B), timer3_control, t);
+    HalOnWrite(HAL_ADDR(XDIV), timer3_xdiv, t);
+    HalOnRead(timer3_tcnt3l, timer3_count, t);
+}
@@ -0,0 +1,29 @@
+/**
+ * @file timer3.h
+ * @brief Timer3 counter model: TCNT3 follows the virtual clock.
+ * @details TCNT3 counts system clock cycles (F_CPU, divided by XDIV) divided by the
+ *          prescaler selected in TCCR3B (CS32-CS30). A new prescaler or XDIV value changes
+ *          the rate, not the count, so the timebase (timebase.h) and code that
+ *          measures time with it run on the host. Compare matches and interrupts are not
+ *          modelled.
+ */
+
+#ifndef TIMER3_H
+#define TIMER3_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint16_t prescaler;         ///< 0 while stopped
+    uint8_t divider;            ///< XDIV factor since start
+    uint16_t base;              ///< Count at start
+    uint64_t start;             ///< HalCycles() when the rate last changed
+} Timer3_t;
+
+/**
+ * @brief Supply TCNT3 from the model.
+ * @param t Model, cleared here (timer stopped).
+ */
+void Timer3Attach(Timer3_t *t);
+
+#endif // TIMER3_H
@@ -0,0 +1,147 @@
+#include "twi_bus.h"
+#include "hal.h"
+#include <avr/io.h>
+#include <stddef.h>
+
+// Global variables
+static uint16_t twi_twcr, twi_twdr, twi_twsr, twi_twbr, twi_ddrd, twi_portd;
+
+static void twi_status(uint8_t status) {
+    HalSet(twi_twsr, status | (HalGet(twi_twsr) & 0x03));
+}
+
+static void twi_end_transfer(TwiBus_t *bus) {
+    if (bus->active && bus->active->stop) bus->active->stop(bus->active);
+    bus->active = NULL;
+}
+
+// TWCR write: perform the requested bus action at once
+static void twi_twcr_hook(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    TwiBus_t *bus = ctx;
+    (void)addr;
+    (void)old_value;
+
+    if (!(value & (1 << TWEN)) && bus->state != TWI_BUS_IDLE) bus->glitches++;
+    if (!(value & (1 << TWEN)) || !(value & (1 << TWINT))) return;     // Nothing started
+
+    // A held bus never completes the operation
+    if (bus->hold_scl || bus->sda_stuck) {
+        HalSet(twi_twcr, value & ~(1 << TWINT));
+        return;
+    }
+
+    if (value & (1 << TWSTO)) {
+        twi_end_transfer(bus);
+        bus->state = TWI_BUS_IDLE;
+        bus->stops++;
+        HalAdvance(TwiBusBitCycles());
+        HalSet(twi_twcr, value & ~((1 << TWSTO) | (1 << TWINT)));
+        return;
+    }
+
+    if (value & (1 << TWSTA)) {
+        twi_status(bus->state == TWI_BUS_IDLE ? 0x08 : 0x10);
+        twi_end_transfer(bus);
+        bus->state = TWI_BUS_START;
+        bus->starts++;
+        HalAdvance(TwiBusBitCycles());
+        HalSet(twi_twcr, value);
+        return;
+    }
+
+    HalAdvance(9 * TwiBusBitCycles());
+    bus->bytes++;
+
+    if (bus->state == TWI_BUS_START) {
+        uint8_t sla = HalGet(twi_twdr);
+        bool read = sla & 0x01;
+        bool ack = false;
+        for (TwiDevice_t *dev = bus->devices; dev; dev = dev->next) {
+            if (dev->address == (sla >> 1)) {
+                ack = dev->start ? dev->start(dev, read) : true;
+                if (ack) bus->active = dev;
+                break;
+            }
+        }
+        if (!ack) bus->nacks++;
+        bus->state = !ack ? TWI_BUS_NACKED : (read ? TWI_BUS_READ : TWI_BUS_WRITE);
+        twi_status(read ? (ack ? 0x40 : 0x48) : (ack ? 0x18 : 0x20));
+    } else if (bus->state == TWI_BUS_WRITE) {
+        TwiDevice_t *dev = bus->active;
+        bool ack = dev->write ? dev->write(dev, HalGet(twi_twdr)) : true;
+        if (!ack) bus->nacks++;
+        twi_status(ack ? 0x28 : 0x30);
+    } else if (bus->state == TWI_BUS_READ) {
+        TwiDevice_t *dev = bus->active;
+        bool ack = value & (1 << TWEA);
+        HalSet(twi_twdr, dev->read ? dev->read(dev, ack) : 0xFF);
+        twi_status(ack ? 0x50 : 0x58);
+    } else {
+        bus->nacks++;
+        twi_status(0x30);       // Nobody listens: every byte is NACKed
+    }
+    HalSet(twi_twcr, value);
+}
+
+// PD0/PD1 driven by software while a transfer is open
+static void twi_port_hook(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    TwiBus_t *bus = ctx;
+    (void)addr;
+    if (((old_value ^ value) & ((1 << PD0) | (1 << PD1))) && bus->state != TWI_BUS_IDLE) bus->glitches++;
+}
+
+// SCL released by software (DDRD bit goes to input): one clock for a stuck slave
+static void twi_ddrd_hook(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    TwiBus_t *bus = ctx;
+    twi_port_hook(addr, old_value, value, ctx);
+    if ((old_value & (1 << PD0)) && !(value & (1 << PD0)) && !bus->hold_scl) {
+        bus->scl_pulses++;
+        if (bus->sda_stuck && bus->sda_stuck != 0xFF) bus->sda_stuck--;
+    }
+}
+
+// SCL = PD0, SDA = PD1: low when driven low or held by a slave
+static uint8_t twi_pind_hook(uint16_t addr, uint8_t value, void *ctx) {
+    TwiBus_t *bus = ctx;
+    uint8_t driven_low = HalGet(twi_ddrd) & ~HalGet(twi_portd);
+    (void)addr;
+    value |= (1 << PD0) | (1 << PD1);
+    if (bus->hold_scl || (driven_low & (1 << PD0))) value &= ~(1 << PD0);
+    if (bus->sda_stuck || (driven_low & (1 << PD1))) value &= ~(1 << PD1);
+    return value;
+}
+
+/**
+ * @brief Start emulating the TWI hardware.
+ */
+void TwiBusAttach(TwiBus_t *bus) {
+    *bus = (TwiBus_t){ 0 };
+    twi_twcr = HAL_ADDR(TWCR);
+    twi_twdr = HAL_ADDR(TWDR);
+    twi_twsr = HAL_ADDR(TWSR);
+    twi_twbr = HAL_ADDR(TWBR);
+    twi_ddrd = HAL_ADDR(DDRD);
+    twi_portd = HAL_ADDR(PORTD);
+    HalSet(twi_twsr, 0xF8);     // No relevant state
+    HalSet(twi_twdr, 0xFF);
+    HalOnWrite(twi_twcr, twi_twcr_hook, bus);
+    HalOnWrite(twi_ddrd, twi_ddrd_hook, bus);
+    HalOnWrite(twi_portd, twi_port_hook, bus);
+    HalOnRead(HAL_ADDR(PIND), twi_pind_hook, bus);
+}
+
+/**
+ * @brief Add a slave device to the bus.
+ */
+void TwiBusAdd(TwiBus_t *bus, TwiDevice_t *dev) {
+    dev->next = bus->devices;
+    bus->devices = dev;
+}
+
+/**
+ * @brief Time one bit takes on the bus.
+ */
+uint32_t TwiBusBitCycles(void) {
+    uint8_t twps = HalGet(twi_twsr) & 0x03;
+    return 16 + 2UL * HalGet(twi_twbr) * (1UL << (2 * twps));
+}
@@ -0,0 +1,77 @@
+/**
+ * @file twi_bus.h
+ * @brief TWI (I2C) master emulation with slave device models for host tests.
+ * @details Watches TWCR writes and plays the role of the TWI hardware: START/repeated
+ *          START, SLA+R/W, data bytes and STOP complete immediately, TWSR gets the matching
+ *          status code and TWINT is set again. The virtual clock advances by the time the
+ *          transfer takes on the wire at the configured TWBR/TWPS (9 bit times per byte),
+ *          so bus speed shows up in test timing.
+ *
+ *          Faults for recovery tests: hold_scl keeps SCL low (TWINT never comes back),
+ *          sda_stuck keeps SDA low until that many SCL clocks were driven on PD0 by
+ *          software (0xFF = forever). PIND reads the SCL/SDA levels of the model.
+ *
+ *          Anything that takes PD0/PD1 away from an open transfer (TWEN cleared, or the
+ *          pins driven through DDRD/PORTD between START and STOP) counts as a glitch: it
+ *          would corrupt the transfer on a real bus.
+ */
+
+#ifndef TWI_BUS_H
+#define TWI_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Slave device; callbacks may be NULL
+typedef struct TwiDevice {
+    uint8_t address;                                        ///< 7-bit address
+    bool (*start)(struct TwiDevice *dev, bool read);        ///< Addressed; return ACK
+    bool (*write)(struct TwiDevice *dev, uint8_t data);     ///< Byte received; return ACK
+    uint8_t (*read)(struct TwiDevice *dev, bool ack);       ///< Byte to send; ack = master's TWEA
+    void (*stop)(struct TwiDevice *dev);                    ///< STOP or repeated START
+    void *ctx;
+    struct TwiDevice *next;
+} TwiDevice_t;
+
+typedef enum {
+    TWI_BUS_IDLE,
+    TWI_BUS_START,      // START sent, waiting for SLA+R/W
+    TWI_BUS_WRITE,      // Master transmitter
+    TWI_BUS_READ,       // Master receiver
+    TWI_BUS_NACKED      // Address not acknowledged
+} TwiBusState_t;
+
+typedef struct {
+    TwiDevice_t *devices;
+    TwiDevice_t *active;
+    TwiBusState_t state;
+    uint32_t starts;
+    uint32_t stops;
+    uint32_t bytes;         // Address and data bytes
+    uint32_t nacks;
+    bool hold_scl;          // A slave stretches SCL forever
+    uint8_t sda_stuck;      // SCL clocks until SDA is released
+    uint16_t scl_pulses;    // SCL clocks driven by software (bus clear)
+    uint32_t glitches;      // PD0/PD1 disturbed during a transfer
+} TwiBus_t;
+
+/**
+ * @brief Start emulating the TWI hardware.
+ * @param bus Bus state, cleared here.
+ */
+void TwiBusAttach(TwiBus_t *bus);
+
+/**
+ * @brief Add a slave device to the bus.
+ * @param bus Bus.
+ * @param dev Device with address and callbacks set.
+ */
+void TwiBusAdd(TwiBus_t *bus, TwiDevice_t *dev);
+
+/**
+ * @brief Time one bit takes on the bus.
+ * @return CPU cycles (16 + 2 * TWBR * 4^TWPS).
+ */
+uint32_t TwiBusBitCycles(void);
+
+#endif // TWI_BUS_H
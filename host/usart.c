@@ -0,0 +1,111 @@
+#define _GNU_SOURCE
+#include "usart.h"
+#include "hal.h"
+#include <avr/io.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+static int64_t usart_wall_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// Read what the bridge has; an idle driver waits until the wall clock caught up
+static void usart_pump(Usart_t *u) {
+    if (u->fd < 0) return;
+
+    if (u->rx_count == 0) {
+        int64_t ahead = (int64_t)HalMicros() - (usart_wall_us() - u->epoch_us);
+        if (ahead > 0) {
+            struct pollfd p = { .fd = u->fd, .events = POLLIN };
+            struct timespec ts = { ahead / 1000000, (ahead % 1000000) * 1000 };
+            ppoll(&p, 1, &ts, NULL);
+        }
+    }
+
+    while (u->rx_count < USART_RX_SIZE) {
+        uint16_t tail = (u->rx_head + u->rx_count) % USART_RX_SIZE;
+        uint16_t room = (tail >= u->rx_head) ? USART_RX_SIZE - tail : u->rx_head - tail;
+        ssize_t n = read(u->fd, &u->rx[tail], room);
+        if (n <= 0) break;
+        u->rx_count += n;
+    }
+}
+
+static uint8_t usart_status(uint16_t addr, uint8_t value, void *ctx) {
+    Usart_t *u = ctx;
+    (void)addr;
+    usart_pump(u);
+    value = (value & ~(1 << RXC0)) | (1 << UDRE0) | (1 << TXC0);
+    return u->rx_count ? value | (1 << RXC0) : value;
+}
+
+static uint8_t usart_data(uint16_t addr, uint8_t value, void *ctx) {
+    Usart_t *u = ctx;
+    (void)addr;
+    return u->rx_count ? u->rx[u->rx_head] : value;
+}
+
+// UDR0 was read: the byte leaves the queue
+static void usart_received(uint16_t addr, uint8_t value, void *ctx) {
+    Usart_t *u = ctx;
+    (void)addr;
+    (void)value;
+    if (!u->rx_count) return;
+    u->rx_head = (u->rx_head + 1) % USART_RX_SIZE;
+    u->rx_count--;
+    u->rx_bytes++;
+}
+
+static void usart_transmit(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    Usart_t *u = ctx;
+    (void)addr;
+    (void)old_value;
+    if (u->tx_count < USART_TX_LOG) u->tx[u->tx_count] = value;
+    u->tx_count++;
+    if (u->fd < 0) return;
+
+    // The bridge is non-blocking: wait for room, drop it if the other end is gone
+    struct pollfd p = { .fd = u->fd, .events = POLLOUT };
+    while (write(u->fd, &value, 1) != 1) {
+        if (errno != EAGAIN || poll(&p, 1, 1000) <= 0) {
+            u->fd = -1;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Emulate USART0.
+ */
+void UsartAttach(Usart_t *u) {
+    *u = (Usart_t){ .fd = -1 };
+    HalOnRead(HAL_ADDR(UCSR0A), usart_status, u);
+    HalOnRead(HAL_ADDR(UDR0), usart_data, u);
+    HalOnConsume(HAL_ADDR(UDR0), usart_received, u);
+    HalOnWrite(HAL_ADDR(UDR0), usart_transmit, u);
+}
+
+/**
+ * @brief Connect USART0 to a file descriptor.
+ */
+void UsartBridge(Usart_t *u, int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    u->fd = fd;
+    u->epoch_us = usart_wall_us() - (int64_t)HalMicros();
+}
+
+/**
+ * @brief Queue bytes for the driver to receive.
+ */
+void UsartFeed(Usart_t *u, const void *data, uint16_t length) {
+    const uint8_t *p = data;
+    while (length-- && u->rx_count < USART_RX_SIZE) {
+        u->rx[(u->rx_head + u->rx_count) % USART_RX_SIZE] = *p++;
+        u->rx_count++;
+    }
+}
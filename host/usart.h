@@ -0,0 +1,54 @@
+/**
+ * @file usart.h
+ * @brief USART0 model for host tests: receive queue, transmit log and a socket bridge.
+ * @details UCSR0A reads report RXC0 while received bytes are queued and UDRE0/TXC0 always
+ *          (a byte written to UDR0 goes out at once). Reading UDR0 takes the next byte.
+ *
+ *          With UsartBridge() the USART talks to a file descriptor (a socketpair or pty),
+ *          so a driver can run against a real host program. While the receive queue is
+ *          empty the virtual clock is not allowed to run ahead of the wall clock, so the
+ *          driver's timeouts take real time while it waits for the other end.
+ */
+
+#ifndef USART_H
+#define USART_H
+
+#include <stdint.h>
+
+#define USART_RX_SIZE   1024    ///< Receive queue
+#define USART_TX_LOG    1024    ///< Transmitted bytes kept in tx
+
+typedef struct {
+    uint8_t rx[USART_RX_SIZE];
+    uint16_t rx_head;
+    uint16_t rx_count;
+    uint8_t tx[USART_TX_LOG];
+    uint32_t tx_count;          ///< Bytes transmitted (tx keeps the first USART_TX_LOG)
+    uint32_t rx_bytes;          ///< Bytes read from UDR0
+    int fd;                     ///< Bridge, -1 if none
+    int64_t epoch_us;           ///< Wall clock at virtual time 0
+} Usart_t;
+
+/**
+ * @brief Emulate USART0.
+ * @param u Model, cleared here (empty queues, no bridge).
+ */
+void UsartAttach(Usart_t *u);
+
+/**
+ * @brief Connect USART0 to a file descriptor: received data is read from it, transmitted
+ *        data is written to it.
+ * @param u Model.
+ * @param fd Descriptor, made non-blocking here.
+ */
+void UsartBridge(Usart_t *u, int fd);
+
+/**
+ * @brief Queue bytes for the driver to receive.
+ * @param u Model.
+ * @param data Bytes.
+ * @param length Number of bytes (the rest is dropped when the queue is full).
+ */
+void UsartFeed(Usart_t *u, const void *data, uint16_t length);
+
+#endif // USART_H
@@ -0,0 +1,44 @@
+/**
+ * @file atomic.h
+ * @brief ATOMIC_BLOCK for the host build, same construction as avr-libc (SREG_I in the HAL).
+ */
+
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static inline uint8_t hal_irq_off(void) {
+    cli();
+    return 1;
+}
+
+static inline uint8_t hal_irq_on(void) {
+    sei();
+    return 1;
+}
+
+static inline void hal_irq_restore(const uint8_t *sreg) {
+    SREG = *sreg;
+}
+
+static inline void hal_irq_force_on(const uint8_t *sreg) {
+    (void)sreg;
+    sei();
+}
+
+static inline void hal_irq_force_off(const uint8_t *sreg) {
+    (void)sreg;
+    cli();
+}
+
+#define ATOMIC_BLOCK(type)      for (type, hal_todo = hal_irq_off(); hal_todo; hal_todo = 0)
+#define NONATOMIC_BLOCK(type)   for (type, hal_todo = hal_irq_on(); hal_todo; hal_todo = 0)
+
+#define ATOMIC_RESTORESTATE     uint8_t hal_sreg __attribute__((__cleanup__(hal_irq_restore))) = SREG
+#define ATOMIC_FORCEON          uint8_t hal_sreg __attribute__((__cleanup__(hal_irq_force_on))) = 0
+#define NONATOMIC_RESTORESTATE  uint8_t hal_sreg __attribute__((__cleanup__(hal_irq_restore))) = SREG
+#define NONATOMIC_FORCEOFF      uint8_t hal_sreg __attribute__((__cleanup__(hal_irq_force_off))) = 0
+
+#endif // HOST_UTIL_ATOMIC_H
@@ -0,0 +1,19 @@
+/**
+ * @file delay.h
+ * @brief Busy-wait delays for the host build: they advance the HAL's virtual clock.
+ */
+
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+void hal_delay_us(double us);
+
+static inline void _delay_us(double us) {
+    hal_delay_us(us);
+}
+
+static inline void _delay_ms(double ms) {
+    hal_delay_us(ms * 1000.0);
+}
+
+#endif // HOST_UTIL_DELAY_H
@@ -0,0 +1,22 @@
+/**
+ * @file delay_basic.h
+ * @brief Counted busy loops for the host build: they advance the HAL's virtual clock by the
+ *        cycles the AVR loops take (3 per _delay_loop_1() pass, 4 per _delay_loop_2() pass).
+ */
+
+#ifndef HOST_UTIL_DELAY_BASIC_H
+#define HOST_UTIL_DELAY_BASIC_H
+
+#include <stdint.h>
+
+void hal_delay_cycles(uint32_t cycles);
+
+static inline void _delay_loop_1(uint8_t count) {
+    hal_delay_cycles(3UL * (count ? count : 256));
+}
+
+static inline void _delay_loop_2(uint16_t count) {
+    hal_delay_cycles(4UL * (count ? count : 65536));
+}
+
+#endif // HOST_UTIL_DELAY_BASIC_H
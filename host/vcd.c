@@ -0,0 +1,110 @@
+#include "vcd.h"
+#include "hal.h"
+#include <stdio.h>
+
+typedef struct {
+    const char *name;
+    uint16_t addr;
+    uint8_t mask;
+    uint8_t width;
+    char id;
+    bool known;         // Written at least once
+} VcdSignal_t;
+
+// Global variables
+static FILE *vcd_file;
+static VcdSignal_t vcd_signals[VCD_MAX_SIGNALS];
+static uint8_t vcd_count;
+static bool vcd_header_done;
+static uint64_t vcd_time = UINT64_MAX;
+
+static uint8_t vcd_bits(const VcdSignal_t *s, uint8_t value) {
+    uint8_t bits = 0;
+    uint8_t n = 0;
+    for (uint8_t b = 0; b < 8; b++) {
+        if (s->mask & (1 << b)) bits |= ((value >> b) & 1) << n++;
+    }
+    return bits;
+}
+
+static void vcd_value(const VcdSignal_t *s, uint8_t value) {
+    uint8_t bits = vcd_bits(s, value);
+    if (s->width == 1) {
+        fprintf(vcd_file, "%u%c\n", bits, s->id);
+        return;
+    }
+    fputc('b', vcd_file);
+    for (int8_t b = s->width - 1; b >= 0; b--) fputc('0' + ((bits >> b) & 1), vcd_file);
+    fprintf(vcd_file, " %c\n", s->id);
+}
+
+static void vcd_header(void) {
+    fprintf(vcd_file, "$timescale 1ns $end\n$scope module host $end\n");
+    for (uint8_t i = 0; i < vcd_count; i++) {
+        fprintf(vcd_file, "$var wire %u %c %s $end\n", vcd_signals[i].width, vcd_signals[i].id,
+                vcd_signals[i].name);
+    }
+    // Values before the first traced write are unknown
+    fprintf(vcd_file, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+    for (uint8_t i = 0; i < vcd_count; i++) {
+        if (vcd_signals[i].width == 1) fprintf(vcd_file, "x%c\n", vcd_signals[i].id);
+        else fprintf(vcd_file, "bx %c\n", vcd_signals[i].id);
+    }
+    fprintf(vcd_file, "$end\n");
+    vcd_header_done = true;
+    vcd_time = 0;
+}
+
+static void vcd_hook(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    VcdSignal_t *s = ctx;
+    (void)addr;
+    if (!vcd_file) return;
+    if (!vcd_header_done) vcd_header();
+    if (s->known && (old_value & s->mask) == (value & s->mask)) return;
+    s->known = true;
+
+    uint64_t ns = HalCycles() * 1000000000ULL / F_CPU;
+    if (ns != vcd_time) {
+        fprintf(vcd_file, "#%llu\n", (unsigned long long)ns);
+        vcd_time = ns;
+    }
+    vcd_value(s, value);
+}
+
+/**
+ * @brief Start a trace file.
+ */
+bool VcdOpen(const char *path) {
+    vcd_file = fopen(path, "w");
+    vcd_count = 0;
+    vcd_header_done = false;
+    vcd_time = UINT64_MAX;
+    return vcd_file != NULL;
+}
+
+/**
+ * @brief Trace bits of a register.
+ */
+void VcdTrace(const char *name, uint16_t addr, uint8_t mask) {
+    if (vcd_count >= VCD_MAX_SIGNALS || !mask) return;
+    VcdSignal_t *s = &vcd_signals[vcd_count];
+    s->name = name;
+    s->addr = addr;
+    s->mask = mask;
+    s->width = __builtin_popcount(mask);
+    s->id = '!' + vcd_count;
+    s->known = false;
+    vcd_count++;
+    HalOnWrite(addr, vcd_hook, s);
+}
+
+/**
+ * @brief Write the pending changes and close the file.
+ */
+void VcdClose(void) {
+    if (!vcd_file) return;
+    HalSync();
+    if (!vcd_header_done) vcd_header();
+    fclose(vcd_file);
+    vcd_file = NULL;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file vcd.h
+ * @brief VCD trace of register bits on the virtual clock, in the layout simavr writes.
+ * @details Each traced signal is a bit mask of one register, recorded at every write seen
+ *          by HalSync(). The files can be checked with tools/vcdcheck just like the traces
+ *          `make sim-timing` captures from simavr (sim/trace.c uses the same signal names).
+ */
+
+#ifndef VCD_H
+#define VCD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define VCD_MAX_SIGNALS 8
+
+/**
+ * @brief Start a trace file.
+ * @param path Output file.
+ * @return true if the file could be created.
+ * @note Add all signals with VcdTrace() before the first register access to trace.
+ */
+bool VcdOpen(const char *path);
+
+/**
+ * @brief Trace bits of a register.
+ * @param name Signal name (RS, RW, EN, DATA, TWBR, TWPS, TWCR, TWDR for vcdcheck).
+ * @param addr Register address (HAL_ADDR()).
+ * @param mask Bits to trace; the signal is as wide as the mask.
+ */
+void VcdTrace(const char *name, uint16_t addr, uint8_t mask);
+
+/**
+ * @brief Write the pending changes and close the file.
+ */
+void VcdClose(void);
+
+#endif // VCD_H
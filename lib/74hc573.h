@@ -3,6 +3,9 @@
  * @author Florin (enhanced by Grok)
  * @brief Library for controlling the 74HC573 latch on the BK-AVR128 board.
  * @details Manages three latch outputs (PF1, PF2, PF3) for segments, digits, and LEDs.
+ * @note These strobes are not synchronized with anything else on PORTA/PORTC. When the LEDs,
+ *       the 7-segment display and an LCD are used together, use the output arbiter
+ *       (arbiter.h) instead.
  */
 
  #ifndef HC573_H
@@ -0,0 +1,329 @@
+#include "arbiter.h"
+#include "74hc573.h"
+#include "timebase.h"
+#include "trace.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#define ARB_CS          ((1 << CS21) | (1 << CS20))     // Timer2 at F_CPU / 64
+#define ARB_FRAME_HZ(unit)  (F_CPU / 64 / 256 / (unit))   // Frames per second
+#define ARB_MIN_LEAD    2       // Ticks needed to enter the interrupt in time
+#define ARB_RETRY_TICKS 2       // Event delay while the bus is locked
+#define ARB_EVENTS      16
+
+// Event actions: LED plane in the high nibble (8 = dark), digit in the low nibble
+#define ARB_NONE        0x0F
+#define ARB_DARK        8
+#define EV(led, digit)  (((led) << 4) | (digit))
+
+// One frame event: what to show and how long until the next event
+typedef struct {
+    uint8_t action;
+    uint8_t units;
+} ArbEvent_t;
+
+// 256-unit frame; plane k lasts 2^k units, digit slots start every 32 units
+static const ArbEvent_t arb_schedule[ARB_EVENTS] PROGMEM = {
+    { EV(0, 0),               1 },   //   0
+    { EV(1, ARB_NONE),        2 },   //   1
+    { EV(2, ARB_NONE),        4 },   //   3
+    { EV(3, ARB_NONE),        8 },   //   7
+    { EV(4, ARB_NONE),       16 },   //  15
+    { EV(5, ARB_NONE),        1 },   //  31
+    { EV(ARB_NONE, 1),       31 },   //  32
+    { EV(6, ARB_NONE),        1 },   //  63
+    { EV(ARB_NONE, 2),       32 },   //  64
+    { EV(ARB_NONE, 3),       31 },   //  96
+    { EV(7, ARB_NONE),        1 },   // 127
+    { EV(ARB_NONE, 4),       32 },   // 128
+    { EV(ARB_NONE, 5),       32 },   // 160
+    { EV(ARB_NONE, 6),       32 },   // 192
+    { EV(ARB_NONE, 7),       31 },   // 224
+    { EV(ARB_DARK, ARB_NONE), 1 }    // 255
+};
+
+// Hexadecimal digits, bit 0 = a ... bit 6 = g
+static const uint8_t arb_font[16] PROGMEM = {
+    0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,
+    0x7F, 0x6F, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71
+};
+
+#define ARB_SEG_MINUS   0x40
+
+// Bus lock counter (arbiter_lock.c)
+extern volatile uint8_t arb_bus_busy;
+
+// Global variables
+static volatile uint8_t arb_seg_out[ARB_DIGITS];        // PORTC byte per digit (active LOW)
+static volatile uint8_t arb_led_planes[ARB_LED_PLANES]; // PORTA byte per plane (active LOW)
+static uint8_t arb_latched[ARB_LATCHES];                // Content of each latch
+static uint8_t arb_event;                               // Next schedule entry
+static uint8_t arb_unit = ARB_UNIT_TICKS;               // Timer2 ticks per frame unit
+static uint16_t arb_isr_max;
+static uint16_t arb_late;
+
+// Strobe a latch: data is already on the port, LE high then low (both 2-cycle sbi/cbi, so
+// the pulse is 250 ns at 8 MHz against a 74HC573 minimum of about 20 ns)
+#define ARB_STROBE(pin) do { LATCH_PORT |= (1 << (pin)); LATCH_PORT &= ~(1 << (pin)); } while (0)
+
+// Write + strobe without saving the ports (interrupts off, caller restores PORTA/PORTC)
+static inline void arb_latch(ArbLatch_t latch, uint8_t value) {
+    if (arb_latched[latch] == value) return;
+    arb_latched[latch] = value;
+    switch (latch) {
+        case ARB_LATCH_SEGMENTS:
+            PORTC = value;
+            ARB_STROBE(LATCH_OUT1);
+            break;
+        case ARB_LATCH_DIGITS:
+            PORTA = value;
+            ARB_STROBE(LATCH_OUT2);
+            break;
+        default:
+            PORTA = value;
+            ARB_STROBE(LATCH_OUT3);
+            break;
+    }
+}
+
+// A plain ISR, not IRQ_LOW (irq.h): the latch writes are the BCM timing itself, and the
+// shortest planes last one unit (32 us). Run as a bottom half with interrupts on, a nested
+// handler would stretch them. What it adds to an IRQ_HIGH latency is its own length,
+// measured into arb_isr_max (ArbMaxIsrTicks()).
+ISR(TIMER2_COMP_vect) {
+    uint16_t start = TCNT3;
+    uint8_t due = OCR2;
+
+    // An LCD transfer owns the bus: try again shortly, the current slot gets longer
+    if (arb_bus_busy) {
+        TRACE(TRACE_ARBITER_RETRY, arb_event);
+        OCR2 = TCNT2 + ARB_RETRY_TICKS;
+        if (arb_late != 0xFFFF) arb_late++;
+        return;
+    }
+
+    uint8_t ev = arb_event;
+    TRACE_BEGIN(TRACE_ARBITER, ev);
+    uint8_t action = pgm_read_byte(&arb_schedule[ev].action);
+    uint8_t ticks = pgm_read_byte(&arb_schedule[ev].units) * arb_unit;
+    arb_event = (ev + 1) & (ARB_EVENTS - 1);
+
+    uint8_t saved_a = PORTA;
+    uint8_t saved_c = PORTC;
+
+    uint8_t digit = action & 0x0F;
+    if (digit < ARB_DIGITS) {
+        uint8_t segs = arb_seg_out[digit];
+        uint8_t select = 1 << digit;
+        if (select != arb_latched[ARB_LATCH_DIGITS] && segs != arb_latched[ARB_LATCH_SEGMENTS]) {
+            arb_latch(ARB_LATCH_SEGMENTS, 0xFF);     // Blank before switching digits
+        }
+        arb_latch(ARB_LATCH_DIGITS, select);
+        arb_latch(ARB_LATCH_SEGMENTS, segs);
+    }
+
+    uint8_t plane = action >> 4;
+    if (plane < ARB_LED_PLANES) arb_latch(ARB_LATCH_LEDS, arb_led_planes[plane]);
+    else if (plane == ARB_DARK) arb_latch(ARB_LATCH_LEDS, 0xFF);
+
+    PORTA = saved_a;
+    PORTC = saved_c;
+
+    // Schedule relative to the previous event; if this one ran past the next, go ASAP
+    uint8_t now = TCNT2;
+    if (ticks < (uint8_t)(now - due) + ARB_MIN_LEAD) {
+        OCR2 = now + ARB_MIN_LEAD;
+        if (arb_late != 0xFFFF) arb_late++;
+    } else {
+        OCR2 = due + ticks;
+    }
+
+    uint16_t spent = TCNT3 - start;
+    if (spent > arb_isr_max) arb_isr_max = spent;
+    TRACE_END(TRACE_ARBITER, ev);
+}
+
+// Put all latches into a known state (interrupts off)
+static void arb_blank(void) {
+    uint8_t saved_a = PORTA;
+    uint8_t saved_c = PORTC;
+
+    // Force the strobes: the shadows don't know what the latches hold yet
+    arb_latched[ARB_LATCH_SEGMENTS] = 0x00;
+    arb_latched[ARB_LATCH_DIGITS] = 0xFF;
+    arb_latched[ARB_LATCH_LEDS] = 0x00;
+    arb_latch(ARB_LATCH_SEGMENTS, 0xFF);
+    arb_latch(ARB_LATCH_DIGITS, 0x00);
+    arb_latch(ARB_LATCH_LEDS, 0xFF);
+
+    PORTA = saved_a;
+    PORTC = saved_c;
+}
+
+/**
+ * @brief Take over PORTA, PORTC and the latches and start the refresh frame.
+ */
+void ArbInit(void) {
+    if (TIMSK & (1 << OCIE2)) return;
+
+    for (uint8_t i = 0; i < ARB_DIGITS; i++) arb_seg_out[i] = 0xFF;
+    for (uint8_t k = 0; k < ARB_LED_PLANES; k++) arb_led_planes[k] = 0xFF;
+    arb_event = 0;
+    arb_unit = ARB_UNIT_TICKS;
+    arb_isr_max = 0;
+    arb_late = 0;
+
+    LatchInit();
+    DDRA = 0xFF;
+    DDRC = 0xFF;
+    TimebaseInit();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        arb_blank();
+        TCCR2 = ARB_CS;                     // Normal mode, free-running
+        OCR2 = TCNT2 + ARB_MIN_LEAD;
+        TIFR = (1 << OCF2);                 // Drop a stale match
+        TIMSK |= (1 << OCIE2);
+    }
+}
+
+/**
+ * @brief Stop the refresh frame and blank the display and the LEDs.
+ */
+void ArbStop(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TIMSK &= ~(1 << OCIE2);
+        TCCR2 = 0;
+        arb_blank();
+    }
+}
+
+/**
+ * @brief Write a byte into one latch (atomic write + strobe).
+ * @param latch Target latch.
+ * @param value Byte to latch, in the port's own polarity.
+ */
+void ArbLatchWrite(ArbLatch_t latch, uint8_t value) {
+    if (latch >= ARB_LATCHES) return;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t saved_a = PORTA;
+        uint8_t saved_c = PORTC;
+        arb_latch(latch, value);
+        PORTA = saved_a;
+        PORTC = saved_c;
+    }
+}
+
+/**
+ * @brief Set the segments of one digit.
+ * @param digit Digit 0-7.
+ * @param segments Bit 0 = a ... bit 6 = g, bit 7 = dp; 1 = lit.
+ */
+void ArbSegSet(uint8_t digit, uint8_t segments) {
+    if (digit >= ARB_DIGITS) return;
+    arb_seg_out[digit] = ~segments;
+}
+
+/**
+ * @brief Show a hexadecimal value on one digit.
+ * @param digit Digit 0-7.
+ * @param value 0-15; larger values blank the digit.
+ * @param dp true to light the decimal point.
+ */
+void ArbSegPutDigit(uint8_t digit, uint8_t value, bool dp) {
+    uint8_t segments = (value < 16) ? pgm_read_byte(&arb_font[value]) : 0;
+    if (dp) segments |= 0x80;
+    ArbSegSet(digit, segments);
+}
+
+/**
+ * @brief Show a signed decimal number right-aligned on the 8 digits.
+ * @param value Number to show (-9999999 to 99999999; others show "--------").
+ */
+void ArbSegPrintInt(int32_t value) {
+    uint8_t segments[ARB_DIGITS];
+    bool negative = value < 0;
+    uint32_t magnitude = negative ? -(uint32_t)value : (uint32_t)value;
+    int8_t i = ARB_DIGITS - 1;
+
+    if (value > 99999999L || value < -9999999L) {
+        for (i = 0; i < ARB_DIGITS; i++) ArbSegSet(i, ARB_SEG_MINUS);
+        return;
+    }
+
+    for (uint8_t d = 0; d < ARB_DIGITS; d++) segments[d] = 0;
+    do {
+        segments[i--] = pgm_read_byte(&arb_font[magnitude % 10]);
+        magnitude /= 10;
+    } while (magnitude);
+    if (negative) segments[i] = ARB_SEG_MINUS;
+
+    for (uint8_t d = 0; d < ARB_DIGITS; d++) ArbSegSet(d, segments[d]);
+}
+
+/**
+ * @brief Blank all digits.
+ */
+void ArbSegClear(void) {
+    for (uint8_t d = 0; d < ARB_DIGITS; d++) ArbSegSet(d, 0);
+}
+
+/**
+ * @brief Replace LED bits in the bit plane bytes shown by the refresh frame.
+ * @param mask LEDs to update (bit 0 = LED1).
+ * @param planes Eight PORTA bytes, plane 0 (1 unit) first, active LOW.
+ */
+void ArbLedWritePlanes(uint8_t mask, const uint8_t planes[ARB_LED_PLANES]) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t k = 0; k < ARB_LED_PLANES; k++) {
+            arb_led_planes[k] = (arb_led_planes[k] & ~mask) | (planes[k] & mask);
+        }
+    }
+}
+
+/**
+ * @brief Change the frame rate while the frame runs.
+ * @param hz Wanted frames per second.
+ * @return Frame rate now in use.
+ */
+uint8_t ArbSetRefresh(uint8_t hz) {
+    uint16_t unit = hz ? (ARB_FRAME_HZ(1) + hz / 2) / hz : ARB_UNIT_MAX;
+    if (unit < ARB_UNIT_MIN) unit = ARB_UNIT_MIN;
+    if (unit > ARB_UNIT_MAX) unit = ARB_UNIT_MAX;
+    arb_unit = unit;
+    return ArbRefresh();
+}
+
+/**
+ * @brief Frame rate in use.
+ * @return Frames per second at F_CPU.
+ */
+uint8_t ArbRefresh(void) {
+    return (ARB_FRAME_HZ(1) + arb_unit / 2) / arb_unit;
+}
+
+/**
+ * @brief Longest refresh interrupt measured so far.
+ * @return Duration in timebase ticks (1 us at 8 MHz).
+ */
+uint16_t ArbMaxIsrTicks(void) {
+    uint16_t ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticks = arb_isr_max;
+    }
+    return ticks;
+}
+
+/**
+ * @brief Number of events that ran late (previous interrupt overran or bus locked).
+ * @return Count (saturates at 65535).
+ */
+uint16_t ArbLateEvents(void) {
+    uint16_t count;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = arb_late;
+    }
+    return count;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file arbiter.h
+ * @brief Output arbiter for the shared PORTA/PORTC latches and the LCD data bus.
+ * @details PORTA feeds the LED latch (U6, LE = PF3), the digit latch (U5, LE = PF2) and the
+ *          LCD data lines; PORTC feeds the segment latch (U4, LE = PF1). The arbiter owns these
+ *          ports: every latch update is an atomic "save port, write data, strobe LE, restore
+ *          port" sequence, a latch is only strobed when its content changes, and the LCD driver
+ *          locks the bus around each transfer so no strobe can land in the middle of one.
+ *
+ *          A fixed refresh frame on Timer2 services all latches. The frame is 256 units of
+ *          4 timer ticks (32 us at 8 MHz, 8.19 ms per frame, 122 Hz; ArbSetRefresh() changes
+ *          the unit at run time) and holds 16 events:
+ *          - the 8 bit planes of the LED brightness (binary code modulation, planes of
+ *            1, 2, 4 ... 128 units, plus 1 dark unit);
+ *          - the 8 digit slots of the 7-segment display, 32 units each. On a digit change the
+ *            segments are blanked first, so no digit shows its neighbour's pattern.
+ *          Events are scheduled on the compare match of the free-running counter (like the
+ *          stepper on the timebase), so a late interrupt stretches one slot instead of
+ *          losing a frame.
+ *
+ *          CPU budget: 16 interrupts per frame of roughly 100-200 cycles each, about 4% of
+ *          the CPU at 8 MHz. ArbMaxIsrTicks() reports the measured worst case. The refresh
+ *          stays a plain interrupt rather than an IRQ_LOW bottom half (irq.h), since the
+ *          latch writes are the timing of the 1-unit planes; that worst case (plus the ISR
+ *          prologue) is what it adds to an IRQ_HIGH latency, and IrqExample shows it next
+ *          to the INT3/INT5 figures.
+ *
+ * @note Uses Timer2 and its compare interrupt, and the timebase (Timer3) for measurements.
+ *       Don't call the LatchXxx_On/Off() functions while the arbiter runs.
+ */
+
+#ifndef ARBITER_H
+#define ARBITER_H
+
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ARB_DIGITS      8       ///< 7-segment digits (digit 0 is the leftmost, PA0)
+#define ARB_LED_PLANES  8       ///< LED brightness bit planes
+#define ARB_UNIT_TICKS  4       ///< Timer2 ticks per frame unit after ArbInit() (122 Hz frame)
+#define ARB_UNIT_MIN    3       ///< Shortest unit: a 1-unit event still fits one interrupt
+#define ARB_UNIT_MAX    7       ///< Longest unit: a 32-unit slot still fits the 8-bit compare
+
+// Latches on the board
+typedef enum {
+    ARB_LATCH_SEGMENTS = 0,     ///< U4: segments a-g, dp on PORTC (active LOW)
+    ARB_LATCH_DIGITS,           ///< U5: digit enables on PORTA (active HIGH)
+    ARB_LATCH_LEDS,             ///< U6: LED1-LED8 on PORTA (active LOW)
+    ARB_LATCHES
+} ArbLatch_t;
+
+/**
+ * @brief Take over PORTA, PORTC and the latches and start the refresh frame.
+ * @note Blanks the display and switches all LEDs off. Safe to call more than once.
+ *       Enable interrupts with sei().
+ */
+void ArbInit(void);
+
+/**
+ * @brief Stop the refresh frame and blank the display and the LEDs.
+ */
+void ArbStop(void);
+
+/**
+ * @brief Write a byte into one latch (atomic write + strobe).
+ * @param latch Target latch.
+ * @param value Byte to latch, in the port's own polarity.
+ * @note Skips the strobe if the latch already holds the value. While the refresh frame
+ *       runs, the digit and LED latches are overwritten at the next event.
+ */
+void ArbLatchWrite(ArbLatch_t latch, uint8_t value);
+
+/**
+ * @brief Lock the PORTA/PORTC bus for a transfer (LCD data + EN pulse).
+ * @note Nests. The refresh interrupt postpones its event by a few ticks while the bus is
+ *       locked, so keep the locked section short (no long delays inside).
+ */
+void ArbBusLock(void);
+
+/**
+ * @brief Release the bus locked by ArbBusLock().
+ */
+void ArbBusUnlock(void);
+
+/**
+ * @brief Set the segments of one digit.
+ * @param digit Digit 0-7.
+ * @param segments Bit 0 = a ... bit 6 = g, bit 7 = dp; 1 = lit.
+ */
+void ArbSegSet(uint8_t digit, uint8_t segments);
+
+/**
+ * @brief Show a hexadecimal value on one digit.
+ * @param digit Digit 0-7.
+ * @param value 0-15; larger values blank the digit.
+ * @param dp true to light the decimal point.
+ */
+void ArbSegPutDigit(uint8_t digit, uint8_t value, bool dp);
+
+/**
+ * @brief Show a signed decimal number right-aligned on the 8 digits.
+ * @param value Number to show (-9999999 to 99999999; others show "--------").
+ */
+void ArbSegPrintInt(int32_t value);
+
+/**
+ * @brief Blank all digits.
+ */
+void ArbSegClear(void);
+
+/**
+ * @brief Replace LED bits in the bit plane bytes shown by the refresh frame.
+ * @param mask LEDs to update (bit 0 = LED1).
+ * @param planes Eight PORTA bytes, plane 0 (1 unit) first, active LOW.
+ * @note Used by led_bcm.h; all planes change together.
+ */
+void ArbLedWritePlanes(uint8_t mask, const uint8_t planes[ARB_LED_PLANES]);
+
+/**
+ * @brief Change the frame rate while the frame runs.
+ * @param hz Wanted frames per second; the unit length is rounded to the nearest of
+ *           ARB_UNIT_MIN to ARB_UNIT_MAX ticks (163, 122, 98, 81 or 70 Hz at 8 MHz).
+ * @return Frame rate now in use, as ArbRefresh().
+ * @note Takes effect from the next event. Lower rates flicker less at the eye's edge of
+ *       vision but leave more CPU to the rest; the interrupt count per frame stays 16.
+ */
+uint8_t ArbSetRefresh(uint8_t hz);
+
+/**
+ * @brief Frame rate in use.
+ * @return Frames per second at F_CPU (a divided system clock slows the frame with it).
+ */
+uint8_t ArbRefresh(void);
+
+/**
+ * @brief Longest refresh interrupt measured so far.
+ * @return Duration in timebase ticks (1 us at 8 MHz).
+ */
+uint16_t ArbMaxIsrTicks(void);
+
+/**
+ * @brief Number of events that ran late (previous interrupt overran or bus locked).
+ * @return Count (saturates at 65535).
+ */
+uint16_t ArbLateEvents(void);
+
+#endif // ARBITER_H
@@ -0,0 +1,24 @@
+#include "arbiter.h"
+#include <util/atomic.h>
+
+// Kept apart from arbiter.c so drivers that only lock the bus (lcd.c) don't pull in the
+// refresh interrupt. The interrupt reads the counter directly.
+volatile uint8_t arb_bus_busy;
+
+/**
+ * @brief Lock the PORTA/PORTC bus for a transfer (LCD data + EN pulse).
+ */
+void ArbBusLock(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        arb_bus_busy++;
+    }
+}
+
+/**
+ * @brief Release the bus locked by ArbBusLock().
+ */
+void ArbBusUnlock(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (arb_bus_busy) arb_bus_busy--;
+    }
+}
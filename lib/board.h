@@ -9,12 +9,13 @@
  #define BOARD_H
  
  #include <avr/io.h>
+ #include "clock_config.h"
  #include <util/delay.h>
  #include <stdint.h>
  #include <stdbool.h>
  
  // Conditional Library Includes
- #define USE_CLOCK_CONFIG  ///< Enable clock_config.h
+ #define USE_CLOCK_CONFIG  ///< Enable clock.h (run-time XDIV scaling)
  #define USE_PORT          ///< Enable port.h
  #define USE_LEDS          ///< Enable leds.h
  #define USE_KEYPAD        ///< Enable keypad.h
@@ -25,7 +26,7 @@
  #define USE_LCD           ///< Enable lcd.h
  
  #ifdef USE_CLOCK_CONFIG
-     #include "clock_config.h"
+     #include "clock.h"
  #endif
  #ifdef USE_PORT
      #include "port.h"
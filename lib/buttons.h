@@ -3,6 +3,8 @@
  * @author Florin (enhanced by Grok)
  * @brief Library for reading buttons on the BK-AVR128 board.
  * @details Uses PD0-PD3 as inputs with pull-ups; returns button number (1-4) or 0 if none pressed.
+ * @note PD0/PD1 are also the TWI pins: with an I2C device on the bus, read the buttons
+ *       through the PORTD owner (portd.h, PortdButtons()) instead.
  */
 
  #ifndef BUTTONS_H
@@ -10,6 +12,7 @@
  
  #include <avr/io.h>
  #include <stdint.h>
+ #include "clock_config.h"
  #include <util/delay.h>
  
  /**
@@ -9,7 +9,9 @@
  #define BUZZER_H
  
  #include <avr/io.h>
+ #include "clock_config.h"
  #include <util/delay.h>
+ #include "delay.h"
  
  // Buzzer Pin Definitions
  #define BUZZER_DIR  DDRE    ///< Data Direction Register for buzzer
@@ -44,11 +46,12 @@
  /**
   * @brief Generate a short beep.
   * @param duration_ms Duration of the beep in milliseconds
-  * @note Turns on the buzzer for the specified duration, then turns it off.
+  * @note Turns on the buzzer for the specified duration, then turns it off. The duration
+  *       may be a variable (DelayMs(), delay.h).
   */
  static inline void BuzzerBeep(uint16_t duration_ms) {
      BuzzerOn();
-     _delay_ms(duration_ms);
+     DelayMs(duration_ms);
      BuzzerOff();
  }
  
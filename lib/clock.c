@@ -0,0 +1,91 @@
+/**
+ * @file clock.c
+ * @brief Run-time system clock scaling with the XDIV divider, and notifiers for the
+ *        drivers whose timing depends on it.
+ */
+
+#include "clock.h"
+#include "timebase.h"
+#include "trace.h"
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#define TIMEBASE_CS_SLOW    (1 << CS31)     // F_CPU / 8: one tick per microsecond at 8 MHz
+#define TIMEBASE_CS_FAST    (1 << CS30)     // Divided clock / 1, from a divider of 8 up
+
+// Global variables
+uint8_t timebase_shift;
+uint8_t timebase_cs = TIMEBASE_CS_SLOW;
+static uint8_t clock_divider = 1;
+static ClockNotifier_t clock_notifiers[CLOCK_MAX_NOTIFIERS];
+static uint8_t clock_notifier_count;
+
+static void clock_notify(ClockEvent_t event, uint32_t hz) {
+    for (uint8_t i = 0; i < clock_notifier_count; i++) clock_notifiers[i](event, hz);
+}
+
+/**
+ * @brief Divide the system clock.
+ */
+ClockStatus_t ClockSetDivider(uint8_t divider) {
+    uint8_t log2 = 0;
+    if (!divider || (divider & (divider - 1))) return CLOCK_BAD_DIVIDER;
+    if (divider == clock_divider) return CLOCK_OK;
+    while ((1 << log2) < divider) log2++;
+
+    // Timer3 from the divided clock: prescaler 8 below a divider of 8, 1 from there on, so
+    // the tick is 1, 2 or 4 full-clock ticks, then 1, 2 ... 16 again
+    uint8_t cs = (divider >= 8) ? TIMEBASE_CS_FAST : TIMEBASE_CS_SLOW;
+    uint8_t shift = (divider >= 8) ? log2 - 3 : log2;
+    bool running = (TCCR3B & TIMEBASE_CS_MASK) == timebase_cs;
+
+    uint32_t hz = F_CPU / divider;
+    TRACE(TRACE_CLOCK, divider);
+    clock_notify(CLOCK_PRE_CHANGE, hz);
+
+    // A deadline taken with the longer tick would end early with the shorter one
+    if (running && shift < timebase_shift) {
+        uint16_t start = TimebaseNow();
+        uint16_t ticks = TimebaseTicks(CLOCK_SETTLE_US);
+        while ((uint16_t)(TimebaseNow() - start) < ticks);
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        // XDIV6..0 only take a new value together with XDIVEN = 1, after XDIVEN = 0
+        XDIV = 0;
+        if (divider > 1) XDIV = (1 << XDIVEN) | (129 - divider);
+        if (running) TCCR3B = (TCCR3B & ~TIMEBASE_CS_MASK) | cs;    // Keeps ICNC3/ICES3
+        timebase_cs = cs;
+        timebase_shift = shift;
+        clock_divider = divider;
+    }
+
+    clock_notify(CLOCK_POST_CHANGE, hz);
+    return CLOCK_OK;
+}
+
+/**
+ * @brief Current XDIV division factor.
+ */
+uint8_t ClockDivider(void) {
+    return clock_divider;
+}
+
+/**
+ * @brief Current system clock.
+ */
+uint32_t ClockHz(void) {
+    return F_CPU / clock_divider;
+}
+
+/**
+ * @brief Call a function around every clock change.
+ */
+ClockStatus_t ClockNotify(ClockNotifier_t fn) {
+    for (uint8_t i = 0; i < clock_notifier_count; i++) {
+        if (clock_notifiers[i] == fn) return CLOCK_OK;
+    }
+    if (clock_notifier_count >= CLOCK_MAX_NOTIFIERS) return CLOCK_FULL;
+    clock_notifiers[clock_notifier_count++] = fn;
+    return CLOCK_OK;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file clock.h
+ * @brief Run-time system clock scaling with the XDIV divider, and notifiers for the
+ *        drivers whose timing depends on it.
+ * @details F_CPU (clock_config.h, or -DF_CPU from the Makefile) is the crystal frequency
+ *          and the only clock constant; everything below is derived from it. XDIV divides
+ *          the clock of the CPU and of all peripherals, so a main loop that only waits can
+ *          run at a fraction of the power and switch back to the full clock when the
+ *          display or the bus has work:
+ *
+ *              ClockSetDivider(64);            // 125 kHz while idle
+ *              ...
+ *              ClockSetDivider(1);             // 8 MHz for the LCD update
+ *
+ *          What follows the clock:
+ *          - the timebase (timebase.h): Timer3 switches between F_CPU / 8 and F_CPU / 1 so
+ *            its tick stays as short as possible, and TimebaseTicks() converts microseconds
+ *            with the current tick length. The LCD deadlines and the start-up sequencer use
+ *            it, so their waits keep their real length;
+ *          - the TWI bit rate (twi.c): TWBR/TWPS are worked out again for TWI_SPEED, within
+ *            what the slower clock allows;
+ *          - the USART0 baud rate (uart.c): UBRR is worked out again once the byte being
+ *            sent is out;
+ *          - any other driver through ClockNotify(): its callback runs before the switch
+ *            (finish a transfer) and after it (reprogram a baud rate or a timer).
+ *
+ *          What doesn't: _delay_us()/_delay_ms() are counted in cycles at F_CPU, so they
+ *          take `factor` times longer while the clock is divided. They are minimum waits
+ *          in the drivers, so that is slow but safe (DelayUs()/DelayMs() from delay.h
+ *          do follow the divider). The stepper profile, PWM frequencies
+ *          and the arbiter refresh (Timer2) scale with the clock; don't divide it while
+ *          they run.
+ *
+ * @note When the tick gets shorter (the clock goes up), a deadline taken before the switch
+ *       would end early, so ClockSetDivider() first waits CLOCK_SETTLE_US, the longest
+ *       deadline a driver keeps between calls (an HD44780 clear).
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "clock_config.h"
+
+#ifndef CLOCK_MAX_NOTIFIERS
+#define CLOCK_MAX_NOTIFIERS 4       ///< Callbacks ClockNotify() can hold
+#endif
+#ifndef CLOCK_SETTLE_US
+#define CLOCK_SETTLE_US     2000    ///< Wait before a switch that shortens the timebase tick
+#endif
+
+#define CLOCK_MAX_DIVIDER   128     ///< Largest power-of-two XDIV division factor
+
+// Result of a clock change
+typedef enum {
+    CLOCK_OK = 0,       ///< Switched (or already at that divider)
+    CLOCK_BAD_DIVIDER,  ///< Not 1, 2, 4 ... 128
+    CLOCK_FULL          ///< ClockNotify(): no free slot
+} ClockStatus_t;
+
+// Moment a notifier is called at
+typedef enum {
+    CLOCK_PRE_CHANGE,   ///< Still at the old clock
+    CLOCK_POST_CHANGE   ///< Running at the new clock
+} ClockEvent_t;
+
+/**
+ * @brief Clock change callback.
+ * @param event CLOCK_PRE_CHANGE or CLOCK_POST_CHANGE.
+ * @param hz The new system clock in Hz.
+ */
+typedef void (*ClockNotifier_t)(ClockEvent_t event, uint32_t hz);
+
+/**
+ * @brief Divide the system clock.
+ * @param divider 1 (XDIV off, F_CPU), 2, 4, 8, 16, 32, 64 or 128.
+ * @return CLOCK_OK or CLOCK_BAD_DIVIDER.
+ * @note Calls the notifiers in the order they were added; interrupts are off only while
+ *       XDIV and Timer3 are switched. Call it from the main loop, not from an interrupt.
+ */
+ClockStatus_t ClockSetDivider(uint8_t divider);
+
+/**
+ * @brief Current XDIV division factor.
+ * @return 1 when the clock is not divided.
+ */
+uint8_t ClockDivider(void);
+
+/**
+ * @brief Current system clock.
+ * @return F_CPU / ClockDivider() in Hz.
+ */
+uint32_t ClockHz(void);
+
+/**
+ * @brief Call a function around every clock change.
+ * @param fn Callback; adding one that is already there does nothing.
+ * @return CLOCK_OK or CLOCK_FULL.
+ */
+ClockStatus_t ClockNotify(ClockNotifier_t fn);
+
+#endif // CLOCK_H
@@ -2,6 +2,9 @@
  * @file clock_config.h
  * @author Florin (enhanced by Grok)
  * @brief Clock frequency configuration for the ATmega128.
+ * @details The one place F_CPU is set (the Makefile passes the same value with -DF_CPU).
+ *          Every library header that uses F_CPU or <util/delay.h> includes this file first.
+ *          Run-time clock division is in clock.h.
  */
 
  #ifndef CLOCK_CONFIG_H
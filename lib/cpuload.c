@@ -0,0 +1,169 @@
+/**
+ * @file cpuload.c
+ * @brief CPU load meter: counts idle-loop passes against a calibrated baseline and shows the
+ *        load live on the 7-segment display or the LED bar.
+ */
+
+#include "cpuload.h"
+#include "timebase.h"
+#include "clock.h"
+#include "arbiter.h"
+#include "led_bcm.h"
+#include <util/atomic.h>
+
+#define CPULOAD_RATE_US     4096UL      // Baseline unit: passes per 4096 us
+#define CPULOAD_MAX_US      1000000UL   // Longest window the arithmetic takes (no overflow)
+#define CPULOAD_BLANK       0xFF        // ArbSegPutDigit() value that blanks the digit
+
+// Global variables
+static uint16_t cpuload_start;          // Timebase at the start of the window
+static uint16_t cpuload_ticks;          // Window length at the current clock
+static uint16_t cpuload_passes;         // Idle passes in the window
+static uint16_t cpuload_rate;           // Idle passes per CPULOAD_RATE_US at full clock
+static bool cpuload_calibrating;
+static CpuLoadView_t cpuload_view;
+static uint16_t cpuload_now;
+static uint16_t cpuload_peak;
+static uint32_t cpuload_sum;
+static uint32_t cpuload_windows;
+
+static void cpuload_start_window(void) {
+    uint32_t ticks = TimebaseTicks(CPULOAD_WINDOW_MS * 1000UL);
+    cpuload_ticks = (ticks > UINT16_MAX) ? UINT16_MAX : ticks;
+    cpuload_passes = 0;
+    cpuload_start = TimebaseNow();
+}
+
+// Four digits from `first`: permille as percent with one decimal, leading zeros blanked
+static void cpuload_digits(uint8_t first, uint16_t permille) {
+    uint8_t d[4] = { permille / 1000, permille / 100 % 10, permille / 10 % 10, permille % 10 };
+    bool leading = true;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        if (d[i] || i == 2) leading = false;
+        ArbSegPutDigit(first + i, leading ? CPULOAD_BLANK : d[i], i == 2);
+    }
+}
+
+// Bar up to the load, the LED of the peak dimmed above it
+static void cpuload_bar(void) {
+    uint8_t levels[LED_BCM_LEDS] = { 0 };
+    uint8_t bar = (cpuload_now * LED_BCM_LEDS + 500) / 1000;
+    uint8_t peak = (cpuload_peak * LED_BCM_LEDS + 999) / 1000;
+
+    for (uint8_t i = 0; i < bar; i++) levels[i] = 255;
+    if (peak > bar) levels[peak - 1] = CPULOAD_PEAK_LEVEL;
+    LedBcmSetAll(levels);
+}
+
+// End of a window `elapsed` ticks long: the baseline, or the load of the window
+static void cpuload_close(uint16_t elapsed) {
+    uint32_t us = TimebaseMicros(elapsed);
+    if (us > CPULOAD_MAX_US) us = CPULOAD_MAX_US;
+    if (!us) us = 1;
+
+    if (cpuload_calibrating) {
+        cpuload_rate = ((uint32_t)cpuload_passes * CPULOAD_RATE_US + us / 2) / us * ClockDivider();
+        cpuload_calibrating = false;
+        return;
+    }
+
+    // Passes an idle CPU would have made at the current clock
+    uint32_t expected = (uint32_t)cpuload_rate * us / CPULOAD_RATE_US / ClockDivider();
+    uint16_t load = 0;
+    if (cpuload_passes < expected) load = 1000 - (uint32_t)cpuload_passes * 1000 / expected;
+
+    cpuload_now = load;
+    if (load > cpuload_peak) cpuload_peak = load;
+    cpuload_sum += load;
+    cpuload_windows++;
+
+    if (cpuload_view & CPULOAD_VIEW_SEGMENTS) {
+        cpuload_digits(0, cpuload_now);
+        cpuload_digits(4, cpuload_peak);
+    }
+    if (cpuload_view & CPULOAD_VIEW_LEDS) cpuload_bar();
+}
+
+/**
+ * @brief Start the timebase and the first window.
+ */
+void CpuLoadInit(void) {
+    TimebaseInit();
+    cpuload_view = CPULOAD_VIEW_NONE;
+    cpuload_calibrating = false;
+    cpuload_rate = 0;
+    cpuload_now = 0;
+    CpuLoadReset();
+    cpuload_start_window();
+}
+
+/**
+ * @brief Measure the idle baseline through the application's own loop pass.
+ */
+void CpuLoadCalibrate(CpuLoadPass_t pass) {
+    cpuload_calibrating = true;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        cpuload_start_window();
+        while (cpuload_calibrating) {
+            uint16_t passes = cpuload_passes;
+            pass();
+            // A pass that found work didn't reach CpuLoadIdle(): end the window here
+            if (cpuload_passes == passes) {
+                uint16_t elapsed = TimebaseNow() - cpuload_start;
+                if (elapsed >= cpuload_ticks) cpuload_close(elapsed);
+            }
+        }
+    }
+    cpuload_now = 0;
+    CpuLoadReset();
+    cpuload_start_window();
+}
+
+/**
+ * @brief Count one idle pass; closes the window when it is over.
+ */
+bool CpuLoadIdle(void) {
+    cpuload_passes++;
+    uint16_t elapsed = TimebaseNow() - cpuload_start;
+    if (elapsed < cpuload_ticks) return false;
+
+    // The figures and the drawing fall between two windows; the baseline isn't a figure
+    bool figures = !cpuload_calibrating;
+    cpuload_close(elapsed);
+    cpuload_start_window();
+    return figures;
+}
+
+/**
+ * @brief Choose where the figures are shown.
+ */
+void CpuLoadSetView(CpuLoadView_t view) {
+    cpuload_view = view;
+}
+
+/**
+ * @brief Read the figures.
+ */
+void CpuLoadGet(CpuLoad_t *load) {
+    load->now = cpuload_now;
+    load->peak = cpuload_peak;
+    load->average = cpuload_windows ? cpuload_sum / cpuload_windows : 0;
+    load->windows = cpuload_windows;
+}
+
+/**
+ * @brief Start the peak and the average again.
+ */
+void CpuLoadReset(void) {
+    cpuload_peak = 0;
+    cpuload_sum = 0;
+    cpuload_windows = 0;
+}
+
+/**
+ * @brief Idle passes per 4096 us at full clock, measured by CpuLoadCalibrate().
+ */
+uint16_t CpuLoadBaseline(void) {
+    return cpuload_rate;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file cpuload.h
+ * @brief CPU load meter: counts idle-loop passes against a calibrated baseline and shows the
+ *        load live on the 7-segment display or the LED bar.
+ * @details The main loop calls CpuLoadIdle() whenever it finds nothing to do. Each call is
+ *          one idle pass; every CPULOAD_WINDOW_MS the passes counted are compared with the
+ *          passes an idle CPU makes in the same time, and the shortfall is the load:
+ *
+ *              static void loop_pass(void) {
+ *                  bool busy = PortdPoll();
+ *                  busy |= ShellPoll();
+ *                  if (!busy) CpuLoadIdle();
+ *              }
+ *              ...
+ *              CpuLoadInit();
+ *              CpuLoadCalibrate(loop_pass);        // Before sei(): measures the baseline
+ *              CpuLoadSetView(CPULOAD_VIEW_SEGMENTS);
+ *              sei();
+ *              while (1) loop_pass();
+ *
+ *          CpuLoadCalibrate() runs the application's own loop pass for one window with
+ *          interrupts disabled, so the baseline holds the same polls that find nothing due,
+ *          the same call and the same timestamp read (the Timer3 timebase, timebase.h), and
+ *          an idle loop reads close to 0 %. Calibrated against a bare CpuLoadIdle() loop
+ *          instead, the polls alone would show as load. Passes that find work during the
+ *          window (a keypad scan coming due) don't count as idle, as later on. While the
+ *          clock is divided (clock.h) the baseline is divided with it. A window that closes
+ *          late (a long busy stretch) is measured by its real length, so the figure stays
+ *          right.
+ *
+ *          The load of each window is kept in permille, with its peak and the average over
+ *          the windows since CpuLoadCalibrate() or CpuLoadReset(). Interrupts and the work
+ *          the loop finds count as load; its checks on an idle pass are in the baseline.
+ *          The view is drawn when a window closes, from CpuLoadIdle(), and the drawing is
+ *          left out of both windows:
+ *          - CPULOAD_VIEW_SEGMENTS: the load on digits 0-3 and the peak on digits 4-7,
+ *            as percent with one decimal ("12.5    99.0");
+ *          - CPULOAD_VIEW_LEDS: a bar of LED1-LED8 at full brightness (one LED per 12.5 %)
+ *            and the LED of the peak dimmed, through led_bcm.h.
+ *          Both go through the output arbiter (arbiter.h); start it (ArbInit() or
+ *          LedBcmInit()) before choosing a view.
+ *
+ * @note The timebase wraps after 65.5 ms at 8 MHz: a busy stretch longer than that between
+ *       two idle passes is measured modulo the wrap, which still reads close to 100 %.
+ */
+
+#ifndef CPULOAD_H
+#define CPULOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef CPULOAD_WINDOW_MS
+#define CPULOAD_WINDOW_MS   50      ///< Measuring window (below the 65 ms timebase wrap)
+#endif
+#define CPULOAD_PEAK_LEVEL  24      ///< Brightness of the peak LED in CPULOAD_VIEW_LEDS
+
+// Where the figures are shown
+typedef enum {
+    CPULOAD_VIEW_NONE = 0,
+    CPULOAD_VIEW_SEGMENTS = 1,      ///< Load and peak on the 7-segment digits
+    CPULOAD_VIEW_LEDS = 2,          ///< Bar on the LEDs
+    CPULOAD_VIEW_BOTH = 3
+} CpuLoadView_t;
+
+// Figures in permille of the CPU (1000 = no idle pass at all)
+typedef struct {
+    uint16_t now;           ///< Last window
+    uint16_t peak;          ///< Highest window since CpuLoadCalibrate() or CpuLoadReset()
+    uint16_t average;       ///< Mean of the windows since then
+    uint32_t windows;       ///< Windows since then
+} CpuLoad_t;
+
+// One pass of the application's main loop, calling CpuLoadIdle() when it finds nothing to do
+typedef void (*CpuLoadPass_t)(void);
+
+/**
+ * @brief Start the timebase and the first window.
+ * @note The load reads 0 until CpuLoadCalibrate() has measured the baseline.
+ */
+void CpuLoadInit(void);
+
+/**
+ * @brief Measure the idle baseline through the application's own loop pass.
+ * @param pass Main loop pass; it runs for one window (CPULOAD_WINDOW_MS) and its
+ *        CpuLoadIdle() returns false meanwhile.
+ * @note Runs with interrupts disabled; call it before sei() or at a point where a pause of
+ *       that length is harmless. The pass must not wait for an interrupt.
+ */
+void CpuLoadCalibrate(CpuLoadPass_t pass);
+
+/**
+ * @brief Count one idle pass; closes the window when it is over.
+ * @return true when a window closed and the figures are new.
+ */
+bool CpuLoadIdle(void);
+
+/**
+ * @brief Choose where the figures are shown.
+ * @param view CPULOAD_VIEW_NONE, _SEGMENTS, _LEDS or _BOTH.
+ */
+void CpuLoadSetView(CpuLoadView_t view);
+
+/**
+ * @brief Read the figures.
+ * @param load Destination.
+ */
+void CpuLoadGet(CpuLoad_t *load);
+
+/**
+ * @brief Start the peak and the average again.
+ */
+void CpuLoadReset(void);
+
+/**
+ * @brief Idle passes per 4096 us at full clock, measured by CpuLoadCalibrate().
+ * @return Baseline rate.
+ */
+uint16_t CpuLoadBaseline(void);
+
+#endif // CPULOAD_H
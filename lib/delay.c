@@ -0,0 +1,37 @@
+/**
+ * @file delay.c
+ * @brief Busy waits for a run-time number of microseconds or milliseconds, in integer
+ *        arithmetic.
+ */
+
+#include "delay.h"
+#include "clock.h"
+#include <util/delay_basic.h>
+
+// Passes at the current system clock (the divider is a power of two), rounded up
+static uint32_t delay_scale(uint32_t loops) {
+    for (uint8_t divider = ClockDivider(); divider > 1; divider >>= 1) loops = (loops + 1) >> 1;
+    return loops;
+}
+
+/**
+ * @brief Busy-wait for a run-time number of microseconds.
+ */
+void DelayUs(uint16_t us) {
+    uint32_t loops = delay_scale(((uint32_t)us * DELAY_LOOPS_PER_US_Q8(F_CPU) + 255) >> 8);
+
+    if (loops <= DELAY_US_OVERHEAD) return;
+    loops -= DELAY_US_OVERHEAD;
+    for (; loops > 0xFFFF; loops -= 0x10000) _delay_loop_2(0);     // 0 = 65536 passes
+    if (loops) _delay_loop_2(loops);
+}
+
+/**
+ * @brief Busy-wait for a run-time number of milliseconds.
+ */
+void DelayMs(uint16_t ms) {
+    uint16_t loops = delay_scale(DELAY_LOOPS_PER_MS(F_CPU));
+
+    if (loops > DELAY_MS_OVERHEAD) loops -= DELAY_MS_OVERHEAD;
+    while (ms--) _delay_loop_2(loops);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file delay.h
+ * @brief Busy waits for a run-time number of microseconds or milliseconds, in integer
+ *        arithmetic.
+ * @details _delay_us()/_delay_ms() from <util/delay.h> are made for compile-time constants.
+ *          Given a variable they work the cycle count out in float at run time, which links
+ *          the soft-float routines and leaves the time spent on that math uncounted.
+ *          DelayUs() and DelayMs() count passes of avr-libc's 4-cycle _delay_loop_2()
+ *          instead:
+ *
+ *              DelayMs(duration);                  // 0-65535 ms
+ *              DelayUs(PulseWidth());              // 0-65535 us
+ *
+ *          DelayMs() runs one pass block of F_CPU / 4000 per millisecond, less one pass
+ *          for the outer loop. DelayUs() multiplies by the passes per microsecond in 1/256
+ *          steps (DELAY_LOOPS_PER_US_Q8, rounded up), so the count is never short: it is
+ *          exact at whole-MHz clocks, at most 0.03 % long at the UART crystals (3.6864,
+ *          7.3728, 11.0592 MHz ...), plus at most one pass of rounding (tests/test_delay.c
+ *          checks 1-20 MHz). DELAY_US_OVERHEAD
+ *          passes are taken off for the call and the arithmetic (about 40 cycles at -Os,
+ *          estimated from the instruction sequence, not measured on the board): a call
+ *          takes about 5 us at 8 MHz at the least, and longer waits end within a few
+ *          cycles of the request. Both follow a divided system clock (clock.h): the count
+ *          is divided by ClockDivider(), rounded up.
+ *
+ * @note Interrupts that run during the wait make it longer. For a constant, _delay_us()
+ *       is still the better choice: it is exact to the cycle and costs no call.
+ */
+
+#ifndef DELAY_H
+#define DELAY_H
+
+#include <stdint.h>
+#include "clock_config.h"
+
+#define DELAY_LOOP_CYCLES       4   ///< Cycles per _delay_loop_2() pass
+
+// Passes taken off for the code around the loops. The host build (make host-test) sets
+// both to 0: its virtual clock counts the passes, not the instructions around them.
+#ifndef DELAY_US_OVERHEAD
+#define DELAY_US_OVERHEAD       8   ///< Passes the DelayUs() call and arithmetic take
+#endif
+#ifndef DELAY_MS_OVERHEAD
+#define DELAY_MS_OVERHEAD       1   ///< Passes one DelayMs() outer loop takes
+#endif
+
+/// _delay_loop_2() passes per millisecond at f_cpu, rounded up (at most 65535)
+#define DELAY_LOOPS_PER_MS(f_cpu)       (((f_cpu) + 3999) / 4000)
+/// _delay_loop_2() passes per microsecond at f_cpu in 1/256, rounded up (f_cpu * 256 / 4e6)
+#define DELAY_LOOPS_PER_US_Q8(f_cpu)    (((f_cpu) + 15624) / 15625)
+
+#if DELAY_LOOPS_PER_MS(F_CPU) > 65535
+#error "F_CPU too high for DelayMs()"
+#endif
+
+/**
+ * @brief Busy-wait for a run-time number of microseconds.
+ * @param us Microseconds; waits shorter than the call itself (about 5 us at 8 MHz) end
+ *           as soon as it returns.
+ */
+void DelayUs(uint16_t us);
+
+/**
+ * @brief Busy-wait for a run-time number of milliseconds.
+ * @param ms Milliseconds.
+ */
+void DelayMs(uint16_t ms);
+
+#endif // DELAY_H
@@ -0,0 +1,394 @@
+#include "eestore.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#include <stddef.h>
+
+#define EE_HEADER_SIZE      4
+#define EE_DELETED          0x40    // Length byte flag: the key was removed
+#define EE_LENGTH_MASK      0x3F
+#define EE_BODY_SIZE(len)   (1 + EESTORE_KEY_SIZE + (len))      // Length byte, key, value
+#define EE_RECORD_SIZE(len) (EE_BODY_SIZE(len) + 2)             // ... and the CRC
+#define EE_CRC_SEED(gen)    (0xFFFF ^ (gen))
+#define EE_SKIP_MAX         16      // Unchanged bytes skipped per interrupt
+
+typedef enum {
+    EE_COMPACT_NONE = 0,
+    EE_COMPACT_REQUESTED,   // Starts when the queue is empty
+    EE_COMPACT_RUNNING
+} EeCompact_t;
+
+// Index entry of a live record
+typedef struct {
+    uint8_t key[EESTORE_KEY_SIZE];
+    uint16_t addr;          // Record address, 0 = free entry
+    uint8_t length;         // Value length
+} EeIndex_t;
+
+// Global variables
+static EeIndex_t ee_index[EESTORE_KEYS];
+static uint16_t ee_bank;                    // Start of the active bank
+static uint8_t ee_gen;                      // Its generation
+static uint16_t ee_append;                  // End of the log, queued bytes included
+static uint16_t ee_live;                    // Header and live records, bytes
+
+// Writer (EE_READY_vect): queued bytes go to ee_write_addr and up
+static uint8_t ee_queue[EESTORE_QUEUE];
+static volatile uint8_t ee_head;
+static volatile uint8_t ee_count;
+static volatile uint16_t ee_write_addr;
+static volatile uint8_t ee_compact;
+
+// Compaction state: copying the record of ee_index[ee_copy_slot], then the header
+static uint16_t ee_moved[EESTORE_KEYS];     // New record addresses
+static uint8_t ee_copy_slot;
+static uint8_t ee_copy_pos;
+static uint16_t ee_copy_dst;
+static uint16_t ee_copy_crc;
+
+// EEPROM read; no write may be in progress
+static uint8_t ee_read(uint16_t addr) {
+    EEAR = addr;
+    EECR |= (1 << EERE);
+    return EEDR;
+}
+
+static uint16_t ee_other_bank(void) {
+    return (ee_bank == EESTORE_START) ? EESTORE_START + EESTORE_BANK_SIZE : EESTORE_START;
+}
+
+// Byte of the log: from the EEPROM, or from the queue if not written yet
+static uint8_t ee_byte(uint16_t addr) {
+    if (addr < ee_write_addr) return ee_read(addr);
+    return ee_queue[(ee_head + (addr - ee_write_addr)) % EESTORE_QUEUE];
+}
+
+// Pad the key to EESTORE_KEY_SIZE; false if it is longer (cut, it would alias another)
+static bool ee_key(uint8_t *k, const char *key) {
+    for (uint8_t i = 0; i < EESTORE_KEY_SIZE; i++) {
+        k[i] = *key;
+        if (*key) key++;
+    }
+    return !*key;
+}
+
+static int8_t ee_find(const uint8_t *k) {
+    for (uint8_t slot = 0; slot < EESTORE_KEYS; slot++) {
+        EeIndex_t *e = &ee_index[slot];
+        if (!e->addr) continue;
+        uint8_t i = 0;
+        while (i < EESTORE_KEY_SIZE && e->key[i] == k[i]) i++;
+        if (i == EESTORE_KEY_SIZE) return slot;
+    }
+    return -1;
+}
+
+static int8_t ee_free_slot(void) {
+    for (uint8_t slot = 0; slot < EESTORE_KEYS; slot++) {
+        if (!ee_index[slot].addr) return slot;
+    }
+    return -1;
+}
+
+// Call with interrupts off
+static void ee_push(uint8_t data) {
+    ee_queue[(ee_head + ee_count) % EESTORE_QUEUE] = data;
+    ee_count++;
+}
+
+// Queue a record at the end of the log; returns its address
+static uint16_t ee_append_record(const uint8_t *k, uint8_t head, const uint8_t *value, uint8_t length) {
+    uint16_t crc = EE_CRC_SEED(ee_gen);
+    uint16_t addr = ee_append;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ee_push(head);
+        crc = _crc_xmodem_update(crc, head);
+        for (uint8_t i = 0; i < EESTORE_KEY_SIZE; i++) {
+            ee_push(k[i]);
+            crc = _crc_xmodem_update(crc, k[i]);
+        }
+        for (uint8_t i = 0; i < length; i++) {
+            ee_push(value[i]);
+            crc = _crc_xmodem_update(crc, value[i]);
+        }
+        ee_push(crc & 0xFF);
+        ee_push(crc >> 8);
+        EECR |= (1 << EERIE);
+    }
+    ee_append += EE_RECORD_SIZE(length);
+    return addr;
+}
+
+// Compaction done: the copy becomes the active bank
+static void ee_copy_finish(void) {
+    for (uint8_t slot = 0; slot < EESTORE_KEYS; slot++) {
+        if (ee_index[slot].addr) ee_index[slot].addr = ee_moved[slot];
+    }
+    ee_bank = ee_other_bank();
+    ee_gen++;
+    ee_append = ee_copy_dst;
+    ee_write_addr = ee_copy_dst;
+    ee_live = ee_copy_dst - ee_bank;
+    ee_compact = EE_COMPACT_NONE;
+}
+
+// Next byte of the compaction: live records with a new CRC, then the header
+static bool ee_copy_next(uint16_t *addr, uint8_t *data) {
+    uint16_t bank = ee_other_bank();
+    uint8_t gen = ee_gen + 1;
+
+    while (ee_copy_slot < EESTORE_KEYS && !ee_index[ee_copy_slot].addr) ee_copy_slot++;
+    if (ee_copy_slot < EESTORE_KEYS) {
+        EeIndex_t *e = &ee_index[ee_copy_slot];
+        uint8_t body = EE_BODY_SIZE(e->length);
+        uint8_t pos = ee_copy_pos++;
+
+        *addr = ee_copy_dst + pos;
+        if (pos == 0) ee_copy_crc = EE_CRC_SEED(gen);
+        if (pos < body) {
+            *data = ee_read(e->addr + pos);
+            ee_copy_crc = _crc_xmodem_update(ee_copy_crc, *data);
+        } else if (pos == body) {
+            *data = ee_copy_crc & 0xFF;
+        } else {
+            *data = ee_copy_crc >> 8;
+            ee_moved[ee_copy_slot++] = ee_copy_dst;
+            ee_copy_dst += EE_RECORD_SIZE(e->length);
+            ee_copy_pos = 0;
+        }
+        return true;
+    }
+
+    // Generation last, after its complement: a header cut short does not check
+    static const uint8_t order[EE_HEADER_SIZE] = { 0, 1, 3, 2 };
+    if (ee_copy_pos < EE_HEADER_SIZE) {
+        uint8_t pos = order[ee_copy_pos++];
+        const uint8_t header[EE_HEADER_SIZE] = { 'K', 'V', gen, (uint8_t)~gen };
+        *addr = bank + pos;
+        *data = header[pos];
+        return true;
+    }
+    ee_copy_finish();
+    return false;
+}
+
+// Next byte to program: queued bytes first, then the compaction
+static bool ee_next(uint16_t *addr, uint8_t *data) {
+    if (ee_count) {
+        *addr = ee_write_addr++;
+        *data = ee_queue[ee_head];
+        ee_head = (ee_head + 1) % EESTORE_QUEUE;
+        ee_count--;
+        return true;
+    }
+    if (ee_compact == EE_COMPACT_REQUESTED) {
+        ee_copy_slot = 0;
+        ee_copy_pos = 0;
+        ee_copy_dst = ee_other_bank() + EE_HEADER_SIZE;
+        ee_compact = EE_COMPACT_RUNNING;
+    }
+    if (ee_compact == EE_COMPACT_RUNNING) return ee_copy_next(addr, data);
+    return false;
+}
+
+// EEPROM ready: program the next byte that differs, or stop when there is nothing left
+ISR(EE_READY_vect) {
+    uint16_t addr;
+    uint8_t data;
+
+    for (uint8_t skipped = 0; skipped < EE_SKIP_MAX; skipped++) {
+        if (!ee_next(&addr, &data)) {
+            EECR &= ~(1 << EERIE);
+            return;
+        }
+        if (ee_read(addr) == data) continue;
+        EEAR = addr;
+        EEDR = data;
+        EECR |= (1 << EEMWE);
+        EECR |= (1 << EEWE);
+        return;
+    }
+}
+
+static bool ee_header(uint16_t bank, uint8_t *gen) {
+    *gen = ee_read(bank + 2);
+    return ee_read(bank) == 'K' && ee_read(bank + 1) == 'V' && (uint8_t)~ee_read(bank + 3) == *gen;
+}
+
+// Build the index from the log of the active bank
+static void ee_scan(void) {
+    uint16_t addr = ee_bank + EE_HEADER_SIZE;
+    uint16_t end = ee_bank + EESTORE_BANK_SIZE;
+    uint8_t k[EESTORE_KEY_SIZE];
+
+    while (addr + EE_RECORD_SIZE(0) <= end) {
+        uint8_t head = ee_read(addr);
+        uint8_t length = head & EE_LENGTH_MASK;
+        if ((head & 0x80) || length > EESTORE_VALUE_MAX || addr + EE_RECORD_SIZE(length) > end) break;
+
+        uint16_t crc = EE_CRC_SEED(ee_gen);
+        for (uint8_t i = 0; i < EE_BODY_SIZE(length); i++) {
+            uint8_t data = ee_read(addr + i);
+            crc = _crc_xmodem_update(crc, data);
+            if (i >= 1 && i <= EESTORE_KEY_SIZE) k[i - 1] = data;
+        }
+        uint16_t stored = ee_read(addr + EE_BODY_SIZE(length)) | (ee_read(addr + EE_BODY_SIZE(length) + 1) << 8);
+        if (stored != crc) break;   // End of the log, or a write cut short
+
+        int8_t slot = ee_find(k);
+        if (head & EE_DELETED) {
+            if (slot >= 0) ee_index[slot].addr = 0;
+        } else if (slot >= 0 || (slot = ee_free_slot()) >= 0) {
+            for (uint8_t i = 0; i < EESTORE_KEY_SIZE; i++) ee_index[slot].key[i] = k[i];
+            ee_index[slot].addr = addr;
+            ee_index[slot].length = length;
+        }
+        addr += EE_RECORD_SIZE(length);
+    }
+    ee_append = addr;
+    ee_write_addr = addr;
+
+    ee_live = EE_HEADER_SIZE;
+    for (uint8_t slot = 0; slot < EESTORE_KEYS; slot++) {
+        if (ee_index[slot].addr) ee_live += EE_RECORD_SIZE(ee_index[slot].length);
+    }
+}
+
+/**
+ * @brief Find the active bank and index its records.
+ */
+void EeStoreInit(void) {
+    uint8_t gen0, gen1;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        EECR &= ~(1 << EERIE);
+        ee_head = 0;
+        ee_count = 0;
+        ee_compact = EE_COMPACT_NONE;
+    }
+    while (EECR & (1 << EEWE));
+    for (uint8_t slot = 0; slot < EESTORE_KEYS; slot++) ee_index[slot].addr = 0;
+
+    bool valid0 = ee_header(EESTORE_START, &gen0);
+    bool valid1 = ee_header(EESTORE_START + EESTORE_BANK_SIZE, &gen1);
+    if (valid0 || valid1) {
+        bool first = valid0 && (!valid1 || (int8_t)(gen0 - gen1) >= 0);
+        ee_bank = first ? EESTORE_START : EESTORE_START + EESTORE_BANK_SIZE;
+        ee_gen = first ? gen0 : gen1;
+        ee_scan();
+        return;
+    }
+
+    // Nothing valid: format the first bank
+    ee_bank = EESTORE_START;
+    ee_gen = 0;
+    ee_write_addr = EESTORE_START;
+    ee_append = EESTORE_START + EE_HEADER_SIZE;
+    ee_live = EE_HEADER_SIZE;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ee_push('K');
+        ee_push('V');
+        ee_push(0);
+        ee_push(0xFF);
+        EECR |= (1 << EERIE);
+    }
+}
+
+/**
+ * @brief Save a value.
+ */
+EeStoreStatus_t EeStorePut(const char *key, const void *value, uint8_t length) {
+    uint8_t k[EESTORE_KEY_SIZE];
+    uint8_t size = EE_RECORD_SIZE(length);
+    int8_t slot;
+
+    if (length > EESTORE_VALUE_MAX || !ee_key(k, key)) return EESTORE_TOO_LONG;
+    slot = ee_find(k);
+    uint16_t replaced = (slot >= 0) ? EE_RECORD_SIZE(ee_index[slot].length) : 0;
+    if (slot < 0 && (slot = ee_free_slot()) < 0) return EESTORE_FULL;
+    if (ee_compact != EE_COMPACT_NONE) return EESTORE_BUSY;
+    if (ee_live + size > EESTORE_BANK_SIZE) return EESTORE_FULL;
+    if (ee_append + size > ee_bank + EESTORE_BANK_SIZE) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            ee_compact = EE_COMPACT_REQUESTED;
+            EECR |= (1 << EERIE);
+        }
+        return EESTORE_BUSY;
+    }
+    if (EESTORE_QUEUE - ee_count < size) return EESTORE_BUSY;
+
+    EeIndex_t *e = &ee_index[slot];
+    e->addr = ee_append_record(k, length, value, length);
+    for (uint8_t i = 0; i < EESTORE_KEY_SIZE; i++) e->key[i] = k[i];
+    e->length = length;
+    ee_live += size - replaced;
+    return EESTORE_OK;
+}
+
+/**
+ * @brief Read a value.
+ */
+EeStoreStatus_t EeStoreGet(const char *key, void *value, uint8_t size, uint8_t *length) {
+    uint8_t k[EESTORE_KEY_SIZE];
+    uint8_t *out = value;
+    uint8_t writing;
+
+    if (!ee_key(k, key)) return EESTORE_TOO_LONG;
+    int8_t slot = ee_find(k);
+    if (slot < 0) return EESTORE_NOT_FOUND;
+
+    // Hold the writer and let the byte in progress finish, then read
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        writing = EECR & (1 << EERIE);
+        EECR &= ~(1 << EERIE);
+    }
+    while (EECR & (1 << EEWE));
+
+    EeIndex_t *e = &ee_index[slot];
+    uint16_t addr = e->addr + EE_BODY_SIZE(0);
+    for (uint8_t i = 0; i < e->length && i < size; i++) out[i] = ee_byte(addr + i);
+    if (length) *length = e->length;
+
+    if (writing) EECR |= (1 << EERIE);
+    return EESTORE_OK;
+}
+
+/**
+ * @brief Remove a key.
+ */
+EeStoreStatus_t EeStoreDelete(const char *key) {
+    uint8_t k[EESTORE_KEY_SIZE];
+
+    if (!ee_key(k, key)) return EESTORE_TOO_LONG;
+    int8_t slot = ee_find(k);
+    if (slot < 0) return EESTORE_NOT_FOUND;
+    if (ee_compact != EE_COMPACT_NONE) return EESTORE_BUSY;
+    if (ee_append + EE_RECORD_SIZE(0) > ee_bank + EESTORE_BANK_SIZE) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            ee_compact = EE_COMPACT_REQUESTED;
+            EECR |= (1 << EERIE);
+        }
+        return EESTORE_BUSY;
+    }
+    if (EESTORE_QUEUE - ee_count < EE_RECORD_SIZE(0)) return EESTORE_BUSY;
+
+    ee_append_record(k, EE_DELETED, NULL, 0);
+    ee_live -= EE_RECORD_SIZE(ee_index[slot].length);
+    ee_index[slot].addr = 0;
+    return EESTORE_OK;
+}
+
+/**
+ * @brief Whether writes are still going out.
+ */
+bool EeStoreBusy(void) {
+    return ee_count || ee_compact != EE_COMPACT_NONE;
+}
+
+/**
+ * @brief Room left for records before the next compaction.
+ */
+uint16_t EeStoreFree(void) {
+    return ee_bank + EESTORE_BANK_SIZE - ee_append;
+}
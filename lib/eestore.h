@@ -0,0 +1,119 @@
+/**
+ * @file eestore.h
+ * @brief Key/value store for settings in the internal EEPROM, with wear leveling, a CRC per
+ *        record and interrupt-driven writes.
+ * @details The store region is split into two banks. The active bank holds a header and
+ *          an append-only log of records; saving a value appends a new record, so writes
+ *          move across the bank instead of wearing the same cells. When the bank is full,
+ *          the live records are copied to the other bank (compaction) and the header of
+ *          that bank, written last, makes it the active one.
+ *
+ *          Bank header: 'K', 'V', generation, ~generation. The valid bank with the newer
+ *          generation is active.
+ *          Record: length (bit 6 = deleted), key (EESTORE_KEY_SIZE bytes), value,
+ *          CRC-16/XMODEM (little-endian) over the rest, seeded with the generation so
+ *          records left from an older use of the bank are not taken as valid. A record
+ *          that is erased (0xFF) or fails its CRC ends the log, so a write cut by a reset
+ *          loses only that record.
+ *
+ *          EeStoreInit() scans the log once and keeps an index of the live records in RAM
+ *          (address and length per key), so EeStoreGet() reads the value directly.
+ *          EeStorePut() and EeStoreDelete() only queue the bytes: EE_READY_vect writes them
+ *          one per 8.5 ms EEPROM write time in the background. Bytes that already hold the
+ *          right value are skipped.
+ *
+ * @note Interrupts must be enabled for the writes to go out. Use the store from the main
+ *       loop only (not from interrupts).
+ */
+
+#ifndef EESTORE_H
+#define EESTORE_H
+
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef EESTORE_START
+#define EESTORE_START       0               ///< First EEPROM address of the store
+#endif
+#ifndef EESTORE_END
+#define EESTORE_END         (E2END + 1)     ///< End of the store (exclusive)
+#endif
+#ifndef EESTORE_KEYS
+#define EESTORE_KEYS        16              ///< Live keys (index entries in RAM)
+#endif
+#ifndef EESTORE_QUEUE
+#define EESTORE_QUEUE       64              ///< Bytes waiting to be written
+#endif
+
+#define EESTORE_KEY_SIZE    4               ///< Key length; shorter keys are padded with 0
+#define EESTORE_VALUE_MAX   32              ///< Longest value in bytes
+#define EESTORE_BANK_SIZE   ((EESTORE_END - EESTORE_START) / 2)
+
+#if EESTORE_BANK_SIZE < 64
+#error "EESTORE_START..EESTORE_END is too small for two banks"
+#endif
+#if EESTORE_QUEUE < EESTORE_VALUE_MAX + EESTORE_KEY_SIZE + 3
+#error "EESTORE_QUEUE must hold a whole record"
+#endif
+
+typedef enum {
+    EESTORE_OK = 0,         ///< Done (for writes: queued)
+    EESTORE_NOT_FOUND,      ///< No such key
+    EESTORE_BUSY,           ///< Queue full or compaction running; try again later
+    EESTORE_FULL,           ///< No room for the record or for another key
+    EESTORE_TOO_LONG        ///< Value longer than EESTORE_VALUE_MAX, or key than EESTORE_KEY_SIZE
+} EeStoreStatus_t;
+
+/**
+ * @brief Find the active bank and index its records.
+ * @note Formats the store (in the background) when no bank is valid, e.g. on a new chip.
+ *       Call before enabling interrupts or with them enabled; the scan reads the EEPROM
+ *       directly and takes about 1 us per byte of the log.
+ */
+void EeStoreInit(void);
+
+/**
+ * @brief Save a value.
+ * @param key Key, up to EESTORE_KEY_SIZE characters (e.g. "bklt"); longer keys are refused,
+ *            not cut.
+ * @param value Bytes to save.
+ * @param length Number of bytes, up to EESTORE_VALUE_MAX.
+ * @return EESTORE_OK once queued (the value can be read back at once), EESTORE_BUSY,
+ *         EESTORE_FULL or EESTORE_TOO_LONG.
+ * @note Does not wait for the EEPROM. When the bank is full it starts a compaction and
+ *       returns EESTORE_BUSY until it is finished (about 8.5 ms per live byte).
+ */
+EeStoreStatus_t EeStorePut(const char *key, const void *value, uint8_t length);
+
+/**
+ * @brief Read a value.
+ * @param key Key.
+ * @param value Buffer for the value.
+ * @param size Buffer size; a longer value is cut.
+ * @param length Set to the length of the saved value (may be NULL).
+ * @return EESTORE_OK, EESTORE_NOT_FOUND or EESTORE_TOO_LONG (key).
+ * @note Waits for the EEPROM byte being written, at most 8.5 ms.
+ */
+EeStoreStatus_t EeStoreGet(const char *key, void *value, uint8_t size, uint8_t *length);
+
+/**
+ * @brief Remove a key.
+ * @param key Key.
+ * @return EESTORE_OK once queued, EESTORE_NOT_FOUND, EESTORE_BUSY or EESTORE_TOO_LONG (key).
+ */
+EeStoreStatus_t EeStoreDelete(const char *key);
+
+/**
+ * @brief Whether writes are still going out.
+ * @return True while bytes are queued or a compaction is running.
+ */
+bool EeStoreBusy(void);
+
+/**
+ * @brief Room left for records before the next compaction.
+ * @return Bytes free in the active bank.
+ */
+uint16_t EeStoreFree(void);
+
+#endif // EESTORE_H
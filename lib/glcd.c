@@ -0,0 +1,522 @@
+#include "glcd.h"
+#include "arbiter.h"
+
+// ST7920 instruction set
+#define GLCD_CMD_BASIC        0x30  // 8-bit interface, basic instructions
+#define GLCD_CMD_EXTENDED     0x34  // 8-bit interface, extended instructions, graphics off
+#define GLCD_CMD_GRAPHICS_ON  0x36  // Extended instructions, graphics on
+#define GLCD_CMD_DISPLAY_ON   0x0C
+#define GLCD_CMD_CLEAR        0x01
+#define GLCD_CMD_ENTRY_MODE   0x06
+#define GLCD_CMD_GDRAM_ADDR   0x80  // Followed by vertical, then horizontal address
+
+// Serial mode synchronizing byte (RW = 0)
+#define GLCD_SYNC_CMD         0xF8
+#define GLCD_SYNC_DATA        0xFA
+
+#define GLCD_ROW_BYTES        (GLCD_WIDTH / 8)
+#define GLCD_BUSY_TIMEOUT     200   // Busy-flag polls before giving up (~ 0.5 ms)
+
+// 5x7 font, ASCII 0x20-0x7E, one byte per column, LSB = top row
+static const uint8_t glcd_font[] PROGMEM = {
+    0x00, 0x00, 0x00, 0x00, 0x00,  // ' '
+    0x00, 0x00, 0x5F, 0x00, 0x00,  // '!'
+    0x00, 0x07, 0x00, 0x07, 0x00,  // '"'
+    0x14, 0x7F, 0x14, 0x7F, 0x14,  // '#'
+    0x24, 0x2A, 0x7F, 0x2A, 0x12,  // '$'
+    0x23, 0x13, 0x08, 0x64, 0x62,  // '%'
+    0x36, 0x49, 0x55, 0x22, 0x50,  // '&'
+    0x00, 0x05, 0x03, 0x00, 0x00,  // '''
+    0x00, 0x1C, 0x22, 0x41, 0x00,  // '('
+    0x00, 0x41, 0x22, 0x1C, 0x00,  // ')'
+    0x08, 0x2A, 0x1C, 0x2A, 0x08,  // '*'
+    0x08, 0x08, 0x3E, 0x08, 0x08,  // '+'
+    0x00, 0x50, 0x30, 0x00, 0x00,  // ','
+    0x08, 0x08, 0x08, 0x08, 0x08,  // '-'
+    0x00, 0x60, 0x60, 0x00, 0x00,  // '.'
+    0x20, 0x10, 0x08, 0x04, 0x02,  // '/'
+    0x3E, 0x51, 0x49, 0x45, 0x3E,  // '0'
+    0x00, 0x42, 0x7F, 0x40, 0x00,  // '1'
+    0x42, 0x61, 0x51, 0x49, 0x46,  // '2'
+    0x21, 0x41, 0x45, 0x4B, 0x31,  // '3'
+    0x18, 0x14, 0x12, 0x7F, 0x10,  // '4'
+    0x27, 0x45, 0x45, 0x45, 0x39,  // '5'
+    0x3C, 0x4A, 0x49, 0x49, 0x30,  // '6'
+    0x01, 0x71, 0x09, 0x05, 0x03,  // '7'
+    0x36, 0x49, 0x49, 0x49, 0x36,  // '8'
+    0x06, 0x49, 0x49, 0x29, 0x1E,  // '9'
+    0x00, 0x36, 0x36, 0x00, 0x00,  // ':'
+    0x00, 0x56, 0x36, 0x00, 0x00,  // ';'
+    0x08, 0x14, 0x22, 0x41, 0x00,  // '<'
+    0x14, 0x14, 0x14, 0x14, 0x14,  // '='
+    0x00, 0x41, 0x22, 0x14, 0x08,  // '>'
+    0x02, 0x01, 0x51, 0x09, 0x06,  // '?'
+    0x32, 0x49, 0x79, 0x41, 0x3E,  // '@'
+    0x7E, 0x11, 0x11, 0x11, 0x7E,  // 'A'
+    0x7F, 0x49, 0x49, 0x49, 0x36,  // 'B'
+    0x3E, 0x41, 0x41, 0x41, 0x22,  // 'C'
+    0x7F, 0x41, 0x41, 0x22, 0x1C,  // 'D'
+    0x7F, 0x49, 0x49, 0x49, 0x41,  // 'E'
+    0x7F, 0x09, 0x09, 0x09, 0x01,  // 'F'
+    0x3E, 0x41, 0x49, 0x49, 0x7A,  // 'G'
+    0x7F, 0x08, 0x08, 0x08, 0x7F,  // 'H'
+    0x00, 0x41, 0x7F, 0x41, 0x00,  // 'I'
+    0x20, 0x40, 0x41, 0x3F, 0x01,  // 'J'
+    0x7F, 0x08, 0x14, 0x22, 0x41,  // 'K'
+    0x7F, 0x40, 0x40, 0x40, 0x40,  // 'L'
+    0x7F, 0x02, 0x0C, 0x02, 0x7F,  // 'M'
+    0x7F, 0x04, 0x08, 0x10, 0x7F,  // 'N'
+    0x3E, 0x41, 0x41, 0x41, 0x3E,  // 'O'
+    0x7F, 0x09, 0x09, 0x09, 0x06,  // 'P'
+    0x3E, 0x41, 0x51, 0x21, 0x5E,  // 'Q'
+    0x7F, 0x09, 0x19, 0x29, 0x46,  // 'R'
+    0x46, 0x49, 0x49, 0x49, 0x31,  // 'S'
+    0x01, 0x01, 0x7F, 0x01, 0x01,  // 'T'
+    0x3F, 0x40, 0x40, 0x40, 0x3F,  // 'U'
+    0x1F, 0x20, 0x40, 0x20, 0x1F,  // 'V'
+    0x3F, 0x40, 0x38, 0x40, 0x3F,  // 'W'
+    0x63, 0x14, 0x08, 0x14, 0x63,  // 'X'
+    0x07, 0x08, 0x70, 0x08, 0x07,  // 'Y'
+    0x61, 0x51, 0x49, 0x45, 0x43,  // 'Z'
+    0x00, 0x7F, 0x41, 0x41, 0x00,  // '['
+    0x02, 0x04, 0x08, 0x10, 0x20,  // '\'
+    0x00, 0x41, 0x41, 0x7F, 0x00,  // ']'
+    0x04, 0x02, 0x01, 0x02, 0x04,  // '^'
+    0x40, 0x40, 0x40, 0x40, 0x40,  // '_'
+    0x00, 0x01, 0x02, 0x04, 0x00,  // '`'
+    0x20, 0x54, 0x54, 0x54, 0x78,  // 'a'
+    0x7F, 0x48, 0x44, 0x44, 0x38,  // 'b'
+    0x38, 0x44, 0x44, 0x44, 0x20,  // 'c'
+    0x38, 0x44, 0x44, 0x48, 0x7F,  // 'd'
+    0x38, 0x54, 0x54, 0x54, 0x18,  // 'e'
+    0x08, 0x7E, 0x09, 0x01, 0x02,  // 'f'
+    0x0C, 0x52, 0x52, 0x52, 0x3E,  // 'g'
+    0x7F, 0x08, 0x04, 0x04, 0x78,  // 'h'
+    0x00, 0x44, 0x7D, 0x40, 0x00,  // 'i'
+    0x20, 0x40, 0x44, 0x3D, 0x00,  // 'j'
+    0x7F, 0x10, 0x28, 0x44, 0x00,  // 'k'
+    0x00, 0x41, 0x7F, 0x40, 0x00,  // 'l'
+    0x7C, 0x04, 0x18, 0x04, 0x78,  // 'm'
+    0x7C, 0x08, 0x04, 0x04, 0x78,  // 'n'
+    0x38, 0x44, 0x44, 0x44, 0x38,  // 'o'
+    0x7C, 0x14, 0x14, 0x14, 0x08,  // 'p'
+    0x08, 0x14, 0x14, 0x18, 0x7C,  // 'q'
+    0x7C, 0x08, 0x04, 0x04, 0x08,  // 'r'
+    0x48, 0x54, 0x54, 0x54, 0x20,  // 's'
+    0x04, 0x3F, 0x44, 0x40, 0x20,  // 't'
+    0x3C, 0x40, 0x40, 0x20, 0x7C,  // 'u'
+    0x1C, 0x20, 0x40, 0x20, 0x1C,  // 'v'
+    0x3C, 0x40, 0x30, 0x40, 0x3C,  // 'w'
+    0x44, 0x28, 0x10, 0x28, 0x44,  // 'x'
+    0x0C, 0x50, 0x50, 0x50, 0x3C,  // 'y'
+    0x44, 0x64, 0x54, 0x4C, 0x44,  // 'z'
+    0x00, 0x08, 0x36, 0x41, 0x00,  // '{'
+    0x00, 0x00, 0x7F, 0x00, 0x00,  // '|'
+    0x00, 0x41, 0x36, 0x08, 0x00,  // '}'
+    0x10, 0x08, 0x08, 0x10, 0x08   // '~'
+};
+
+// Global variables
+static GlcdMode_t glcd_mode;                              // Bus mode (J15)
+static uint8_t glcd_fb[GLCD_HEIGHT][GLCD_ROW_BYTES];      // Framebuffer, MSB = leftmost pixel
+static uint16_t glcd_dirty[GLCD_HEIGHT / 2];              // Dirty words per GDRAM row
+
+// Low-level bus functions
+#ifdef GLCD_SERIAL_HW_SPI
+static void glcd_serial_byte(uint8_t data) {
+    SPDR = data;
+    while (!(SPSR & (1 << SPIF)));
+}
+#else
+static void glcd_serial_byte(uint8_t data) {
+    // SID is sampled on the rising edge of CLK, MSB first
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if (data & 0x80) GLCD_CTRL_PORT |= (1 << GLCD_RW);
+        else GLCD_CTRL_PORT &= ~(1 << GLCD_RW);
+        GLCD_CTRL_PORT |= (1 << GLCD_EN);
+        data <<= 1;
+        GLCD_CTRL_PORT &= ~(1 << GLCD_EN);
+    }
+}
+#endif
+
+// Wait for the busy flag (parallel mode only); each poll locks the shared PORTA bus
+static void glcd_wait_ready(void) {
+    uint8_t timeout = GLCD_BUSY_TIMEOUT;
+    uint8_t status;
+
+    GLCD_CTRL_PORT &= ~(1 << GLCD_RS);
+    GLCD_CTRL_PORT |= (1 << GLCD_RW);
+    do {
+        ArbBusLock();
+        GLCD_DATA_DDR = 0x00;
+        GLCD_CTRL_PORT |= (1 << GLCD_EN);
+        _delay_us(1);
+        status = GLCD_DATA_PIN;
+        GLCD_CTRL_PORT &= ~(1 << GLCD_EN);
+        GLCD_DATA_DDR = 0xFF;
+        ArbBusUnlock();
+        if (!(status & 0x80)) break;
+        _delay_us(1);
+    } while (--timeout);
+    GLCD_CTRL_PORT &= ~(1 << GLCD_RW);
+}
+
+static void glcd_write(uint8_t data, uint8_t rs) {
+    if (glcd_mode == GLCD_MODE_SERIAL) {
+        GLCD_CTRL_PORT |= (1 << GLCD_RS);          // CS high
+        glcd_serial_byte(rs ? GLCD_SYNC_DATA : GLCD_SYNC_CMD);
+        glcd_serial_byte(data & 0xF0);
+        glcd_serial_byte(data << 4);
+        GLCD_CTRL_PORT &= ~(1 << GLCD_RS);         // CS low
+        _delay_us(GLCD_EXEC_US);
+    } else {
+        glcd_wait_ready();
+        if (rs) GLCD_CTRL_PORT |= (1 << GLCD_RS);
+        else GLCD_CTRL_PORT &= ~(1 << GLCD_RS);
+        ArbBusLock();
+        GLCD_DATA_PORT = data;
+        GLCD_CTRL_PORT |= (1 << GLCD_EN);
+        _delay_us(1);
+        GLCD_CTRL_PORT &= ~(1 << GLCD_EN);
+        ArbBusUnlock();
+    }
+}
+
+// Send command to LCD
+static void glcd_command(uint8_t cmd) {
+    glcd_write(cmd, 0);
+}
+
+// Mark framebuffer bytes [first, last] of a row as changed
+static void glcd_mark(uint8_t y, uint8_t first, uint8_t last) {
+    uint8_t word = first >> 1;
+    uint8_t end = last >> 1;
+    uint16_t mask = 0;
+
+    while (word <= end) mask |= (1 << word++);
+    if (y & 0x20) mask <<= 8;   // Lower half lives in GDRAM columns 8-15
+    glcd_dirty[y & 0x1F] |= mask;
+}
+
+// Apply a color to the masked bits of one framebuffer byte
+static void glcd_apply(uint8_t *dst, uint8_t mask, GlcdColor_t color) {
+    if (color == GLCD_BLACK) *dst |= mask;
+    else if (color == GLCD_WHITE) *dst &= ~mask;
+    else *dst ^= mask;
+}
+
+/**
+ * @brief Initializes the LCD12864 and switches it to graphics mode.
+ * @param mode Bus mode matching the J15 jumper (GLCD_MODE_PARALLEL or GLCD_MODE_SERIAL).
+ */
+void GlcdInit(GlcdMode_t mode) {
+    glcd_mode = mode;
+
+    GLCD_CTRL_DDR |= (1 << GLCD_RS) | (1 << GLCD_RW) | (1 << GLCD_EN);
+    GLCD_CTRL_PORT &= ~((1 << GLCD_RS) | (1 << GLCD_RW) | (1 << GLCD_EN));
+    if (mode == GLCD_MODE_PARALLEL) {
+        GLCD_DATA_DDR = 0xFF;
+    }
+#ifdef GLCD_SERIAL_HW_SPI
+    else {
+        // SS must be an output for master mode; SPI mode 3, F_CPU / 8
+        DDRB |= (1 << PB0) | (1 << PB1) | (1 << PB2);
+        SPCR = (1 << SPE) | (1 << MSTR) | (1 << CPOL) | (1 << CPHA) | (1 << SPR0);
+        SPSR = (1 << SPI2X);
+    }
+#endif
+
+    _delay_ms(50);  // Wait for LCD to power up
+
+    // Initialization sequence for ST7920 (busy flag is not valid yet)
+    glcd_command(GLCD_CMD_BASIC);
+    _delay_us(100);
+    glcd_command(GLCD_CMD_BASIC);
+    _delay_us(100);
+    glcd_command(GLCD_CMD_DISPLAY_ON);
+    _delay_us(100);
+    glcd_command(GLCD_CMD_CLEAR);
+    _delay_ms(10);  // Clear command takes longer
+    glcd_command(GLCD_CMD_ENTRY_MODE);
+    glcd_command(GLCD_CMD_EXTENDED);
+    glcd_command(GLCD_CMD_GRAPHICS_ON);
+
+    GlcdClear();
+    GlcdFlush();
+}
+
+/**
+ * @brief Clears the framebuffer and marks the whole screen for the next flush.
+ */
+void GlcdClear(void) {
+    uint8_t *p = &glcd_fb[0][0];
+
+    for (uint16_t i = 0; i < sizeof(glcd_fb); i++) *p++ = 0;
+    for (uint8_t i = 0; i < GLCD_HEIGHT / 2; i++) glcd_dirty[i] = 0xFFFF;
+}
+
+/**
+ * @brief Sends every modified GDRAM word to the display.
+ * @return Number of 16-pixel words written (0 if nothing changed).
+ * @note GDRAM row gy holds screen row gy in columns 0-7 and row gy + 32 in columns 8-15,
+ *       and the horizontal address auto-increments, so each run of adjacent dirty words
+ *       costs two address commands plus two data bytes per word.
+ */
+uint16_t GlcdFlush(void) {
+    uint16_t words = 0;
+
+    for (uint8_t gy = 0; gy < GLCD_HEIGHT / 2; gy++) {
+        uint16_t mask = glcd_dirty[gy];
+        uint8_t gx = 0;
+
+        glcd_dirty[gy] = 0;
+        while (mask) {
+            // Skip clean words, then stream the following run of dirty ones
+            while (!(mask & 1)) {
+                mask >>= 1;
+                gx++;
+            }
+            glcd_command(GLCD_CMD_GDRAM_ADDR | gy);
+            glcd_command(GLCD_CMD_GDRAM_ADDR | gx);
+            while (mask & 1) {
+                const uint8_t *src = (gx < 8) ? &glcd_fb[gy][gx << 1] : &glcd_fb[gy + 32][(gx - 8) << 1];
+                glcd_write(src[0], 1);
+                glcd_write(src[1], 1);
+                mask >>= 1;
+                gx++;
+                words++;
+            }
+        }
+    }
+    return words;
+}
+
+/**
+ * @brief Sets, clears or toggles a single pixel.
+ * @param x Column (0-127).
+ * @param y Row (0-63).
+ * @param color GLCD_BLACK, GLCD_WHITE or GLCD_INVERT.
+ */
+void GlcdSetPixel(uint8_t x, uint8_t y, GlcdColor_t color) {
+    if (x >= GLCD_WIDTH || y >= GLCD_HEIGHT) return;
+    glcd_apply(&glcd_fb[y][x >> 3], 0x80 >> (x & 7), color);
+    glcd_mark(y, x >> 3, x >> 3);
+}
+
+/**
+ * @brief Reads a pixel from the framebuffer.
+ * @param x Column (0-127).
+ * @param y Row (0-63).
+ * @return true if the pixel is on, false if off or off-screen.
+ */
+bool GlcdGetPixel(uint8_t x, uint8_t y) {
+    if (x >= GLCD_WIDTH || y >= GLCD_HEIGHT) return false;
+    return (glcd_fb[y][x >> 3] & (0x80 >> (x & 7))) != 0;
+}
+
+/**
+ * @brief Draws a horizontal line, a byte at a time.
+ * @param x Start column.
+ * @param y Row.
+ * @param width Length in pixels (clipped to the screen).
+ * @param color Pixel color.
+ */
+void GlcdHLine(uint8_t x, uint8_t y, uint8_t width, GlcdColor_t color) {
+    if (x >= GLCD_WIDTH || y >= GLCD_HEIGHT || width == 0) return;
+    if (width > GLCD_WIDTH - x) width = GLCD_WIDTH - x;
+
+    uint8_t last = x + width - 1;
+    uint8_t first_byte = x >> 3;
+    uint8_t last_byte = last >> 3;
+    uint8_t first_mask = 0xFF >> (x & 7);
+    uint8_t last_mask = 0xFF << (7 - (last & 7));
+    uint8_t *row = glcd_fb[y];
+
+    if (first_byte == last_byte) {
+        glcd_apply(&row[first_byte], first_mask & last_mask, color);
+    } else {
+        glcd_apply(&row[first_byte], first_mask, color);
+        for (uint8_t b = first_byte + 1; b < last_byte; b++) glcd_apply(&row[b], 0xFF, color);
+        glcd_apply(&row[last_byte], last_mask, color);
+    }
+    glcd_mark(y, first_byte, last_byte);
+}
+
+/**
+ * @brief Draws a vertical line.
+ * @param x Column.
+ * @param y Start row.
+ * @param height Length in pixels (clipped to the screen).
+ * @param color Pixel color.
+ */
+void GlcdVLine(uint8_t x, uint8_t y, uint8_t height, GlcdColor_t color) {
+    if (x >= GLCD_WIDTH || y >= GLCD_HEIGHT) return;
+    if (height > GLCD_HEIGHT - y) height = GLCD_HEIGHT - y;
+
+    uint8_t mask = 0x80 >> (x & 7);
+    uint8_t col = x >> 3;
+
+    while (height--) {
+        glcd_apply(&glcd_fb[y][col], mask, color);
+        glcd_mark(y, col, col);
+        y++;
+    }
+}
+
+/**
+ * @brief Draws a line between two points (Bresenham).
+ * @param x0 Start column.
+ * @param y0 Start row.
+ * @param x1 End column.
+ * @param y1 End row.
+ * @param color Pixel color.
+ */
+void GlcdLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, GlcdColor_t color) {
+    if (y0 == y1) {
+        if (x0 > x1) { uint8_t t = x0; x0 = x1; x1 = t; }
+        GlcdHLine(x0, y0, x1 - x0 + 1, color);
+        return;
+    }
+    if (x0 == x1) {
+        if (y0 > y1) { uint8_t t = y0; y0 = y1; y1 = t; }
+        GlcdVLine(x0, y0, y1 - y0 + 1, color);
+        return;
+    }
+
+    int16_t dx = (x1 > x0) ? (x1 - x0) : (x0 - x1);
+    int16_t dy = (y1 > y0) ? (y0 - y1) : (y1 - y0);
+    int8_t sx = (x0 < x1) ? 1 : -1;
+    int8_t sy = (y0 < y1) ? 1 : -1;
+    int16_t err = dx + dy;
+
+    while (1) {
+        GlcdSetPixel(x0, y0, color);
+        if (x0 == x1 && y0 == y1) break;
+        int16_t e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+}
+
+/**
+ * @brief Draws a rectangle outline.
+ * @param x Left column.
+ * @param y Top row.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param color Pixel color.
+ */
+void GlcdRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, GlcdColor_t color) {
+    if (width == 0 || height == 0) return;
+    GlcdHLine(x, y, width, color);
+    if (height > 1) GlcdHLine(x, y + height - 1, width, color);
+    if (height > 2) {
+        GlcdVLine(x, y + 1, height - 2, color);
+        if (width > 1) GlcdVLine(x + width - 1, y + 1, height - 2, color);
+    }
+}
+
+/**
+ * @brief Fills a rectangle, a byte at a time.
+ * @param x Left column.
+ * @param y Top row.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param color Pixel color (GLCD_WHITE erases the area).
+ */
+void GlcdFillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, GlcdColor_t color) {
+    if (y >= GLCD_HEIGHT) return;
+    if (height > GLCD_HEIGHT - y) height = GLCD_HEIGHT - y;
+    while (height--) GlcdHLine(x, y++, width, color);
+}
+
+/**
+ * @brief Draws a 1-bpp bitmap stored in program memory.
+ * @param x Left column (any alignment).
+ * @param y Top row.
+ * @param bitmap PROGMEM bitmap, row-major, (width + 7) / 8 bytes per row, MSB = leftmost pixel.
+ * @param width Bitmap width in pixels.
+ * @param height Bitmap height in pixels.
+ * @param color Color applied to the set bits.
+ */
+void GlcdBlit(uint8_t x, uint8_t y, const uint8_t *bitmap, uint8_t width, uint8_t height, GlcdColor_t color) {
+    if (x >= GLCD_WIDTH || y >= GLCD_HEIGHT || width == 0) return;
+
+    uint8_t src_bytes = (width + 7) >> 3;
+    uint8_t shift = x & 7;
+    uint8_t first_col = x >> 3;
+    uint8_t visible = (width > GLCD_WIDTH - x) ? (GLCD_WIDTH - x) : width;
+    uint8_t last_col = (x + visible - 1) >> 3;
+    uint8_t tail_bits = visible & 7;
+
+    for (uint8_t row = 0; row < height && (uint8_t)(y + row) < GLCD_HEIGHT; row++) {
+        uint8_t *dst = glcd_fb[y + row];
+        const uint8_t *src = bitmap + (uint16_t)row * src_bytes;
+
+        for (uint8_t i = 0; i < src_bytes; i++) {
+            uint8_t bits = pgm_read_byte(src + i);
+            uint8_t col = first_col + i;
+
+            if ((uint8_t)(i * 8) >= visible) break;
+            if (i == (uint8_t)((visible - 1) >> 3) && tail_bits) bits &= 0xFF << (8 - tail_bits);
+
+            glcd_apply(&dst[col], bits >> shift, color);
+            if (shift && col + 1 <= last_col) glcd_apply(&dst[col + 1], bits << (8 - shift), color);
+        }
+        glcd_mark(y + row, first_col, last_col);
+    }
+}
+
+/**
+ * @brief Draws one character from the built-in 5x7 font.
+ * @param x Left column.
+ * @param y Top row.
+ * @param c Printable ASCII character (0x20-0x7E); others draw as '?'.
+ * @param color Pixel color of the glyph.
+ * @return Column just after the character cell (6 pixels wide).
+ */
+uint8_t GlcdPutChar(uint8_t x, uint8_t y, char c, GlcdColor_t color) {
+    if (c < 0x20 || c > 0x7E) c = '?';
+    const uint8_t *glyph = &glcd_font[(uint16_t)(c - 0x20) * 5];
+
+    for (uint8_t col = 0; col < 5; col++) {
+        uint8_t bits = pgm_read_byte(glyph + col);
+        for (uint8_t row = 0; bits; row++, bits >>= 1) {
+            if (bits & 1) GlcdSetPixel(x + col, y + row, color);
+        }
+    }
+    return x + 6;
+}
+
+/**
+ * @brief Draws a string with the built-in 5x7 font.
+ * @param x Left column.
+ * @param y Top row.
+ * @param text Pointer to a null-terminated string in RAM.
+ * @param color Pixel color of the glyphs.
+ * @return Column just after the last character.
+ */
+uint8_t GlcdPrint(uint8_t x, uint8_t y, const char *text, GlcdColor_t color) {
+    while (*text && x < GLCD_WIDTH) {
+        x = GlcdPutChar(x, y, *text++, color);
+    }
+    return x;
+}
+
+/**
+ * @brief Draws a string stored in program memory.
+ * @param x Left column.
+ * @param y Top row.
+ * @param text PROGMEM string (e.g., PSTR("Temp")).
+ * @param color Pixel color of the glyphs.
+ * @return Column just after the last character.
+ */
+uint8_t GlcdPrint_P(uint8_t x, uint8_t y, const char *text, GlcdColor_t color) {
+    char c;
+
+    while ((c = pgm_read_byte(text++)) && x < GLCD_WIDTH) {
+        x = GlcdPutChar(x, y, c, color);
+    }
+    return x;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file glcd.h
+ * @brief Graphics driver for the ST7920-based LCD12864 on the BK-AVR128 board (J16).
+ * @details Drawing goes to a 1 KB framebuffer in SRAM. GlcdFlush() sends only the
+ *          16-pixel GDRAM words touched since the previous flush, so a dashboard that
+ *          redraws a few values and a sweeping graph costs a few dozen bus writes per
+ *          frame instead of 1024.
+ *
+ *          Wiring (J16): RS/CS = PB5, RW/SID = PB6, E/CLK = PB7, DB0-DB7 = PA0-PA7.
+ *          The J15 jumper drives PSB: HIGH selects the 8-bit parallel bus, LOW the
+ *          serial bus. PORTA is shared with the LED and digit latches, which keep their
+ *          outputs while PF1-PF3 are LOW; each parallel bus cycle locks the output
+ *          arbiter (arbiter.h) so its refresh can run alongside.
+ *
+ *          Serial mode is bit-banged on PB6/PB7 by default. Define GLCD_SERIAL_HW_SPI
+ *          when SID/CLK are wired to MOSI (PB2) / SCK (PB1) to use the SPI module.
+ */
+
+#ifndef GLCD_H
+#define GLCD_H
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "clock_config.h"
+#include <util/delay.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// LCD12864 pin configuration for BK-AVR128 (J16)
+#define GLCD_DATA_PORT  PORTA   // DB0-DB7 (parallel mode)
+#define GLCD_DATA_DDR   DDRA
+#define GLCD_DATA_PIN   PINA
+#define GLCD_CTRL_PORT  PORTB   // Control lines
+#define GLCD_CTRL_DDR   DDRB
+#define GLCD_RS         PB5     // Register Select (CS in serial mode)
+#define GLCD_RW         PB6     // Read/Write (SID in serial mode)
+#define GLCD_EN         PB7     // Enable (CLK in serial mode)
+
+// Display geometry
+#define GLCD_WIDTH      128
+#define GLCD_HEIGHT     64
+
+// Controller execution time for a write when the busy flag can't be read (serial mode)
+#ifndef GLCD_EXEC_US
+#define GLCD_EXEC_US    72
+#endif
+
+// LCD12864 bus options (selected by the J15 PSB jumper)
+typedef enum {
+    GLCD_MODE_PARALLEL = 0,  ///< 8-bit parallel bus, busy flag polled
+    GLCD_MODE_SERIAL = 1     ///< 3-wire serial bus, fixed execution delay
+} GlcdMode_t;
+
+// Pixel colors
+typedef enum {
+    GLCD_WHITE = 0,   ///< Pixel off
+    GLCD_BLACK = 1,   ///< Pixel on
+    GLCD_INVERT = 2   ///< Toggle pixel
+} GlcdColor_t;
+
+/**
+ * @brief Initializes the LCD12864 and switches it to graphics mode.
+ * @param mode Bus mode matching the J15 jumper (GLCD_MODE_PARALLEL or GLCD_MODE_SERIAL).
+ * @note Blocks for about 50 ms (controller power-up) and clears the screen.
+ */
+void GlcdInit(GlcdMode_t mode);
+
+/**
+ * @brief Clears the framebuffer and marks the whole screen for the next flush.
+ */
+void GlcdClear(void);
+
+/**
+ * @brief Sends every modified GDRAM word to the display.
+ * @return Number of 16-pixel words written (0 if nothing changed).
+ */
+uint16_t GlcdFlush(void);
+
+/**
+ * @brief Sets, clears or toggles a single pixel.
+ * @param x Column (0-127).
+ * @param y Row (0-63).
+ * @param color GLCD_BLACK, GLCD_WHITE or GLCD_INVERT.
+ * @note Does nothing if the pixel is off-screen.
+ */
+void GlcdSetPixel(uint8_t x, uint8_t y, GlcdColor_t color);
+
+/**
+ * @brief Reads a pixel from the framebuffer.
+ * @param x Column (0-127).
+ * @param y Row (0-63).
+ * @return true if the pixel is on, false if off or off-screen.
+ */
+bool GlcdGetPixel(uint8_t x, uint8_t y);
+
+/**
+ * @brief Draws a horizontal line, a byte at a time.
+ * @param x Start column.
+ * @param y Row.
+ * @param width Length in pixels (clipped to the screen).
+ * @param color Pixel color.
+ */
+void GlcdHLine(uint8_t x, uint8_t y, uint8_t width, GlcdColor_t color);
+
+/**
+ * @brief Draws a vertical line.
+ * @param x Column.
+ * @param y Start row.
+ * @param height Length in pixels (clipped to the screen).
+ * @param color Pixel color.
+ */
+void GlcdVLine(uint8_t x, uint8_t y, uint8_t height, GlcdColor_t color);
+
+/**
+ * @brief Draws a line between two points (Bresenham).
+ * @param x0 Start column.
+ * @param y0 Start row.
+ * @param x1 End column.
+ * @param y1 End row.
+ * @param color Pixel color.
+ */
+void GlcdLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, GlcdColor_t color);
+
+/**
+ * @brief Draws a rectangle outline.
+ * @param x Left column.
+ * @param y Top row.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param color Pixel color.
+ */
+void GlcdRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, GlcdColor_t color);
+
+/**
+ * @brief Fills a rectangle, a byte at a time.
+ * @param x Left column.
+ * @param y Top row.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param color Pixel color (GLCD_WHITE erases the area).
+ */
+void GlcdFillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, GlcdColor_t color);
+
+/**
+ * @brief Draws a 1-bpp bitmap stored in program memory.
+ * @param x Left column (any alignment).
+ * @param y Top row.
+ * @param bitmap PROGMEM bitmap, row-major, (width + 7) / 8 bytes per row, MSB = leftmost pixel.
+ * @param width Bitmap width in pixels.
+ * @param height Bitmap height in pixels.
+ * @param color Color applied to the set bits; clear bits leave the background untouched.
+ */
+void GlcdBlit(uint8_t x, uint8_t y, const uint8_t *bitmap, uint8_t width, uint8_t height, GlcdColor_t color);
+
+/**
+ * @brief Draws one character from the built-in 5x7 font.
+ * @param x Left column.
+ * @param y Top row.
+ * @param c Printable ASCII character (0x20-0x7E); others draw as '?'.
+ * @param color Pixel color of the glyph.
+ * @return Column just after the character cell (6 pixels wide).
+ */
+uint8_t GlcdPutChar(uint8_t x, uint8_t y, char c, GlcdColor_t color);
+
+/**
+ * @brief Draws a string with the built-in 5x7 font.
+ * @param x Left column.
+ * @param y Top row.
+ * @param text Pointer to a null-terminated string in RAM.
+ * @param color Pixel color of the glyphs.
+ * @return Column just after the last character.
+ */
+uint8_t GlcdPrint(uint8_t x, uint8_t y, const char *text, GlcdColor_t color);
+
+/**
+ * @brief Draws a string stored in program memory.
+ * @param x Left column.
+ * @param y Top row.
+ * @param text PROGMEM string (e.g., PSTR("Temp")).
+ * @param color Pixel color of the glyphs.
+ * @return Column just after the last character.
+ */
+uint8_t GlcdPrint_P(uint8_t x, uint8_t y, const char *text, GlcdColor_t color);
+
+#endif // GLCD_H
@@ -1,4 +1,5 @@
 #include "i2c_lcd.h"
+#include "timebase.h"
 
 // LCD command constants (for HD44780 via PCF8574)
 #define LCD_CMD_CLEAR       0x01
@@ -10,63 +11,205 @@
 #define LCD_BACKLIGHT_OFF   0x00
 #define LCD_EN              0x04
 #define LCD_RS              0x01
+#define LCD_POWER_UP_US     40000   // From VCC at 2.7 V to the first command (datasheet)
 
-// Global variables
-static uint8_t lcd_address;    // I2C address of the LCD
-static uint8_t lcd_backlight;  // Backlight state
-static uint8_t lcd_rows;       // Number of rows
-static uint8_t lcd_cols;       // Number of columns
+#define LCD_CLEAR_US        2000    // Clear and home (1.52 ms)
 
-// Low-level I2C functions
-static void i2c_init(void) {
-    // Set SCL and SDA as outputs
-    DDRD |= (1 << I2C_SCL_PIN) | (1 << I2C_SDA_PIN);
-    // Set I2C frequency: TWBR = ((F_CPU / I2C_SPEED) - 16) / 2
-    TWBR = ((F_CPU / I2C_SPEED) - 16) / 2;
-    TWSR = 0;  // Prescaler = 1
+// Display used by the functions without a handle (I2C_LcdInit(), I2C_LcdPrint()...)
+static I2cLcd_t lcd_default;
+
+// Wait until this display finished a clear or home; other displays don't matter
+static void lcd_wait(I2cLcd_t *lcd) {
+    if (!lcd->busy_ticks) return;
+    TimebaseInit();     // Restarts Timer3 if something stopped it meanwhile
+    while ((uint16_t)(TimebaseNow() - lcd->busy_since) < lcd->busy_ticks);
+    lcd->busy_ticks = 0;
 }
 
-static void i2c_start(void) {
-    TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
-    while (!(TWCR & (1 << TWINT)));
+// Port writes for one byte (4-bit mode via PCF8574): EN high then low for each nibble
+static TwiStatus_t lcd_put(I2cLcd_t *lcd, uint8_t data, uint8_t rs) {
+    uint8_t data_high = (data & 0xF0) | (rs ? LCD_RS : 0) | lcd->backlight;
+    uint8_t data_low = ((data << 4) & 0xF0) | (rs ? LCD_RS : 0) | lcd->backlight;
+    TwiStatus_t status;
+
+    // Each write takes 9 SCL periods, which covers the EN pulse width
+    if ((status = TwiWrite(data_high | LCD_EN)) != TWI_OK) return status;
+    if ((status = TwiWrite(data_high)) != TWI_OK) return status;
+    if ((status = TwiWrite(data_low | LCD_EN)) != TWI_OK) return status;
+    return TwiWrite(data_low);
 }
 
-static void i2c_stop(void) {
-    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
-    while (TWCR & (1 << TWSTO));
+// Send bytes to the LCD in one transfer. The two port writes between the last EN fall of
+// a byte and the first EN fall of the next one take >= 37 us up to ~480 kHz, so no delay
+// is needed for the LCD to finish an instruction (except clear/home).
+static void lcd_send(I2cLcd_t *lcd, const uint8_t *data, uint8_t length, uint8_t rs) {
+    lcd_wait(lcd);
+    TwiStatus_t status = TwiStart(lcd->address, false);
+    while (status == TWI_OK && length--) {
+        status = lcd_put(lcd, *data++, rs);
+    }
+    if (status == TWI_OK) status = TwiStop();
+    lcd->status = status;
 }
 
-static void i2c_write(uint8_t data) {
-    TWDR = data;
-    TWCR = (1 << TWINT) | (1 << TWEN);
-    while (!(TWCR & (1 << TWINT)));
+// Send command to LCD
+static void lcd_command(I2cLcd_t *lcd, uint8_t cmd) {
+    lcd_send(lcd, &cmd, 1, 0);
+    if (cmd == LCD_CMD_CLEAR || cmd == LCD_CMD_HOME) {
+        lcd->busy_since = TimebaseNow();
+        lcd->busy_ticks = TimebaseTicks(LCD_CLEAR_US);
+    }
 }
 
-// Send a byte to the LCD (4-bit mode via PCF8574)
-static void lcd_write_byte(uint8_t data, uint8_t rs) {
-    uint8_t data_high = (data & 0xF0) | (rs ? LCD_RS : 0) | lcd_backlight;
-    uint8_t data_low = ((data << 4) & 0xF0) | (rs ? LCD_RS : 0) | lcd_backlight;
+static void lcd_setup(I2cLcd_t *lcd, uint8_t address, uint32_t power_us) {
+    lcd->address = address;
+    lcd->backlight = LCD_BACKLIGHT_ON;
+    lcd->power_us = power_us;
+    lcd->busy_ticks = 0;
+    lcd->status = TWI_OK;
+    TwiInit();
+    TimebaseInit();
+}
 
-    i2c_start();
-    i2c_write(lcd_address << 1);
-    i2c_write(data_high | LCD_EN);  // Enable high
-    _delay_us(1);
-    i2c_write(data_high);           // Enable low
-    i2c_write(data_low | LCD_EN);   // Enable high
-    _delay_us(1);
-    i2c_write(data_low);            // Enable low
-    i2c_stop();
-    _delay_us(50);  // Wait for LCD to process
+// DDRAM address of each row: rows 2 and 3 continue rows 0 and 1 after `columns` cells
+static void lcd_geometry(I2cLcd_t *lcd, uint8_t rows, uint8_t columns) {
+    lcd->rows = (rows > 4) ? 4 : rows;
+    lcd->cols = columns;
+    lcd->row_offset[0] = 0x00;
+    lcd->row_offset[1] = 0x40;
+    lcd->row_offset[2] = columns;
+    lcd->row_offset[3] = 0x40 + columns;
 }
 
-// Send command to LCD
-static void lcd_command(uint8_t cmd) {
-    lcd_write_byte(cmd, 0);
+/**
+ * @brief Sets up a display on the TWI bus and waits 50 ms for it to power up.
+ */
+void I2C_LcdDevInit(I2cLcd_t *lcd, uint8_t address) {
+    lcd_setup(lcd, address, 15000);
+    _delay_ms(50);  // Wait for LCD to power up
 }
 
-// Send data to LCD
-static void lcd_data(uint8_t data) {
-    lcd_write_byte(data, 1);
+/**
+ * @brief Runs the initialization sequence of a display.
+ */
+void I2C_LcdDevStart(I2cLcd_t *lcd, uint8_t rows, uint8_t columns) {
+    uint32_t wait;
+    lcd_geometry(lcd, rows, columns);
+    for (uint8_t step = 0; (wait = I2C_LcdDevStartStep(lcd, step)) != STARTUP_DONE; step++) {
+        StartupDelay(wait);
+    }
+}
+
+/**
+ * @brief Sets up a display without waiting, for the start-up sequencer.
+ */
+void I2C_LcdDevBegin(I2cLcd_t *lcd, uint8_t address, uint8_t rows, uint8_t columns) {
+    lcd_setup(lcd, address, LCD_POWER_UP_US);
+    lcd_geometry(lcd, rows, columns);
+}
+
+/**
+ * @brief One step of the HD44780 initialization sequence of a display.
+ */
+uint32_t I2C_LcdDevStartStep(I2cLcd_t *lcd, uint8_t step) {
+    // Initialization sequence for HD44780 in 4-bit mode
+    static const uint8_t commands[] = {
+        0x03, 0x03, 0x03, 0x02, LCD_CMD_FUNCTION_SET, LCD_CMD_DISPLAY_ON, LCD_CMD_ENTRY_MODE, LCD_CMD_CLEAR
+    };
+
+    if (step == 0) return lcd->power_us;
+    if (step > sizeof(commands)) return STARTUP_DONE;
+    lcd_command(lcd, commands[step - 1]);
+    switch (step) {
+    case 1: return 5000;
+    case 2: return 100;
+    case 8: return LCD_CLEAR_US;    // Clear command takes longer
+    default: return 0;
+    }
+}
+
+/**
+ * @brief Clears a display.
+ */
+void I2C_LcdDevClear(I2cLcd_t *lcd) {
+    lcd_command(lcd, LCD_CMD_CLEAR);
+}
+
+/**
+ * @brief Sets the cursor position on a display.
+ */
+void I2C_LcdDevSetCursor(I2cLcd_t *lcd, uint8_t row, uint8_t column) {
+    if (row >= lcd->rows || column >= lcd->cols) return;
+    lcd_command(lcd, 0x80 | (lcd->row_offset[row] + column));
+}
+
+/**
+ * @brief Moves the cursor of a display to (0,0).
+ */
+void I2C_LcdDevHome(I2cLcd_t *lcd) {
+    lcd_command(lcd, LCD_CMD_HOME);
+}
+
+/**
+ * @brief Prints a string on a display, in one transfer.
+ */
+void I2C_LcdDevPrint(I2cLcd_t *lcd, const char *text) {
+    uint8_t length = 0;
+    while (text[length] && length < 255) length++;
+    lcd_send(lcd, (const uint8_t *)text, length, 1);
+}
+
+/**
+ * @brief Writes characters to a display, in one transfer.
+ */
+void I2C_LcdDevWrite(I2cLcd_t *lcd, const char *text, uint8_t length) {
+    lcd_send(lcd, (const uint8_t *)text, length, 1);
+}
+
+/**
+ * @brief Shifts a whole display one position to the left.
+ */
+void I2C_LcdDevMoveLeft(I2cLcd_t *lcd) {
+    lcd_command(lcd, 0x18);
+}
+
+/**
+ * @brief Shifts a whole display one position to the right.
+ */
+void I2C_LcdDevMoveRight(I2cLcd_t *lcd) {
+    lcd_command(lcd, 0x1C);
+}
+
+/**
+ * @brief Switches the backlight of a display.
+ */
+void I2C_LcdDevBacklight(I2cLcd_t *lcd, bool on) {
+    lcd->backlight = on ? LCD_BACKLIGHT_ON : LCD_BACKLIGHT_OFF;
+    lcd_command(lcd, 0x00);  // Dummy command to update backlight
+}
+
+/**
+ * @brief Prints an integer on a display, in one transfer.
+ */
+void I2C_LcdDevPrintInt(I2cLcd_t *lcd, int32_t value) {
+    char buffer[11];  // Enough for -2147483648
+    uint8_t i = sizeof(buffer);
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+
+    // Digits from the right, then the whole number as one transfer
+    do {
+        buffer[--i] = (magnitude % 10) + '0';
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) buffer[--i] = '-';
+    lcd_send(lcd, (const uint8_t *)buffer + i, sizeof(buffer) - i, 1);
+}
+
+/**
+ * @brief Result of the last transfer to a display.
+ */
+TwiStatus_t I2C_LcdDevGetStatus(const I2cLcd_t *lcd) {
+    return lcd->status;
 }
 
 /**
@@ -74,10 +217,7 @@ static void lcd_data(uint8_t data) {
  * @param address The 7-bit I2C address of the LCD (e.g., 0x27 for PCF8574).
  */
 void I2C_LcdInit(uint8_t address) {
-    lcd_address = address;
-    lcd_backlight = LCD_BACKLIGHT_ON;
-    i2c_init();
-    _delay_ms(50);  // Wait for LCD to power up
+    I2C_LcdDevInit(&lcd_default, address);
 }
 
 /**
@@ -86,29 +226,33 @@ void I2C_LcdInit(uint8_t address) {
  * @param columns Number of columns (e.g., 16 for a 16x2 LCD).
  */
 void I2C_LcdStart(uint8_t rows, uint8_t columns) {
-    lcd_rows = rows;
-    lcd_cols = columns;
+    I2C_LcdDevStart(&lcd_default, rows, columns);
+}
 
-    // Initialization sequence for HD44780 in 4-bit mode
-    _delay_ms(15);
-    lcd_command(0x03);
-    _delay_ms(5);
-    lcd_command(0x03);
-    _delay_us(100);
-    lcd_command(0x03);
-    lcd_command(0x02);  // Set 4-bit mode
-    lcd_command(LCD_CMD_FUNCTION_SET);
-    lcd_command(LCD_CMD_DISPLAY_ON);
-    lcd_command(LCD_CMD_ENTRY_MODE);
-    I2C_LcdClear();
+/**
+ * @brief Sets up the I2C module and LCD size without waiting, for the start-up sequencer.
+ * @param address The 7-bit I2C address of the LCD.
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ */
+void I2C_LcdBegin(uint8_t address, uint8_t rows, uint8_t columns) {
+    I2C_LcdDevBegin(&lcd_default, address, rows, columns);
+}
+
+/**
+ * @brief One step of the HD44780 initialization sequence (start-up task).
+ * @param step Step number, from 0.
+ * @return Microseconds to wait before the next step, or STARTUP_DONE.
+ */
+uint32_t I2C_LcdStartStep(uint8_t step) {
+    return I2C_LcdDevStartStep(&lcd_default, step);
 }
 
 /**
  * @brief Clears the LCD screen.
  */
 void I2C_LcdClear(void) {
-    lcd_command(LCD_CMD_CLEAR);
-    _delay_ms(2);  // Clear command takes longer
+    I2C_LcdDevClear(&lcd_default);
 }
 
 /**
@@ -117,19 +261,14 @@ void I2C_LcdClear(void) {
  * @param column Column number (0-based).
  */
 void I2C_LcdSetCursor(uint8_t row, uint8_t column) {
-    if (row >= lcd_rows || column >= lcd_cols) return;
-    uint8_t address = (row == 0) ? 0x00 : 0x40;
-    if (row == 1 && lcd_rows > 2) address = 0x14;
-    if (row == 2 && lcd_rows > 3) address = 0x54;
-    lcd_command(0x80 | (address + column));
+    I2C_LcdDevSetCursor(&lcd_default, row, column);
 }
 
 /**
  * @brief Moves the cursor to the home position (0,0).
  */
 void I2C_LcdHome(void) {
-    lcd_command(LCD_CMD_HOME);
-    _delay_ms(2);  // Home command takes longer
+    I2C_LcdDevHome(&lcd_default);
 }
 
 /**
@@ -137,39 +276,44 @@ void I2C_LcdHome(void) {
  * @param text Pointer to a null-terminated string to display.
  */
 void I2C_LcdPrint(const char *text) {
-    while (*text) {
-        lcd_data(*text++);
-    }
+    I2C_LcdDevPrint(&lcd_default, text);
+}
+
+/**
+ * @brief Writes characters to the LCD at the current cursor position, in one transfer.
+ * @param text Characters to display (not null-terminated).
+ * @param length Number of characters.
+ */
+void I2C_LcdWrite(const char *text, uint8_t length) {
+    I2C_LcdDevWrite(&lcd_default, text, length);
 }
 
 /**
  * @brief Shifts the entire display one position to the left.
  */
 void I2C_LcdMoveLeft(void) {
-    lcd_command(0x18);
+    I2C_LcdDevMoveLeft(&lcd_default);
 }
 
 /**
  * @brief Shifts the entire display one position to the right.
  */
 void I2C_LcdMoveRight(void) {
-    lcd_command(0x1C);
+    I2C_LcdDevMoveRight(&lcd_default);
 }
 
 /**
  * @brief Enables the LCD backlight.
  */
 void I2C_LcdEnableBacklight(void) {
-    lcd_backlight = LCD_BACKLIGHT_ON;
-    lcd_command(0x00);  // Dummy command to update backlight
+    I2C_LcdDevBacklight(&lcd_default, true);
 }
 
 /**
  * @brief Disables the LCD backlight.
  */
 void I2C_LcdDisableBacklight(void) {
-    lcd_backlight = LCD_BACKLIGHT_OFF;
-    lcd_command(0x00);  // Dummy command to update backlight
+    I2C_LcdDevBacklight(&lcd_default, false);
 }
 
 /**
@@ -177,25 +321,14 @@ void I2C_LcdDisableBacklight(void) {
  * @param value The integer value to convert and display.
  */
 void I2C_LcdPrintInt(int32_t value) {
-    char buffer[12];  // Enough for -2147483648 + null
-    int8_t i = 0;
-
-    if (value == 0) {
-        lcd_data('0');
-        return;
-    }
-
-    if (value < 0) {
-        lcd_data('-');
-        value = -value;
-    }
-
-    while (value > 0) {
-        buffer[i++] = (value % 10) + '0';
-        value /= 10;
-    }
+    I2C_LcdDevPrintInt(&lcd_default, value);
+}
 
-    while (i > 0) {
-        lcd_data(buffer[--i]);
-    }
+/**
+ * @brief Result of the last transfer to the LCD.
+ * @return TWI_OK, or the error of the failed transfer (e.g. TWI_NACK_ADDR when the LCD
+ *         is not connected).
+ */
+TwiStatus_t I2C_LcdGetStatus(void) {
+    return lcd_default.status;
 }
\ No newline at end of file
@@ -1,18 +1,140 @@
+/**
+ * @file i2c_lcd.h
+ * @brief HD44780 character LCD behind a PCF8574 I2C expander.
+ * @details Several such displays can share the TWI bus at different addresses: the
+ *          I2C_LcdDevXxx() functions take an I2cLcd_t handle, the functions without a
+ *          handle drive one default display. Each byte goes out as four port writes whose
+ *          TWI time covers the instruction time, and a clear or home (1.52 ms) sets a
+ *          deadline on the timebase (Timer3) instead of a delay: only the next transfer to
+ *          the same display waits for it.
+ */
+
 #ifndef I2C_LCD_H
 #define I2C_LCD_H
 
 #include <avr/io.h>
+#include "clock_config.h"
 #include <util/delay.h>
 #include <stdint.h>
 #include <stdbool.h>
 
-// I2C configuration for BK-AVR128 (ATmega128)
-#define I2C_SCL_PORT PORTD
-#define I2C_SDA_PORT PORTD
-#define I2C_SCL_PIN PD0
-#define I2C_SDA_PIN PD1
-#define I2C_SPEED 100000UL  // 100 kHz I2C speed
-#define F_CPU 8000000UL     // 8 MHz clock from BK-AVR128
+// I2C configuration for BK-AVR128 (ATmega128): SCL = PD0, SDA = PD1, speed set by
+// TWI_SPEED (twi.h)
+#include "twi.h"
+#include "startup.h"
+
+// One display on the TWI bus
+typedef struct {
+    uint8_t address;            // 7-bit address of the PCF8574
+    uint8_t backlight;          // Backlight bit for the expander port
+    uint8_t rows;
+    uint8_t cols;
+    uint8_t row_offset[4];      // DDRAM address of each row
+    TwiStatus_t status;         // Result of the last transfer
+    uint32_t power_us;          // Wait before the first command of the start sequence
+    uint16_t busy_since;        // Timebase tick of the last clear or home
+    uint16_t busy_ticks;        // Its execution time, 0 = ready
+} I2cLcd_t;
+
+/**
+ * @brief Sets up a display on the TWI bus and waits 50 ms for it to power up.
+ * @param lcd Display.
+ * @param address The 7-bit I2C address of the display.
+ */
+void I2C_LcdDevInit(I2cLcd_t *lcd, uint8_t address);
+
+/**
+ * @brief Runs the initialization sequence of a display.
+ * @param lcd Display.
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ */
+void I2C_LcdDevStart(I2cLcd_t *lcd, uint8_t rows, uint8_t columns);
+
+/**
+ * @brief Sets up a display without waiting, for the start-up sequencer (see I2C_LcdBegin()).
+ * @param lcd Display.
+ * @param address The 7-bit I2C address of the display.
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ */
+void I2C_LcdDevBegin(I2cLcd_t *lcd, uint8_t address, uint8_t rows, uint8_t columns);
+
+/**
+ * @brief One step of the HD44780 initialization sequence of a display.
+ * @param lcd Display.
+ * @param step Step number, from 0.
+ * @return Microseconds to wait before the next step, or STARTUP_DONE.
+ */
+uint32_t I2C_LcdDevStartStep(I2cLcd_t *lcd, uint8_t step);
+
+/**
+ * @brief Clears a display.
+ * @param lcd Display.
+ */
+void I2C_LcdDevClear(I2cLcd_t *lcd);
+
+/**
+ * @brief Sets the cursor position on a display.
+ * @param lcd Display.
+ * @param row Row number (0-based).
+ * @param column Column number (0-based).
+ */
+void I2C_LcdDevSetCursor(I2cLcd_t *lcd, uint8_t row, uint8_t column);
+
+/**
+ * @brief Moves the cursor of a display to (0,0).
+ * @param lcd Display.
+ */
+void I2C_LcdDevHome(I2cLcd_t *lcd);
+
+/**
+ * @brief Prints a string on a display, in one transfer.
+ * @param lcd Display.
+ * @param text Null-terminated string.
+ */
+void I2C_LcdDevPrint(I2cLcd_t *lcd, const char *text);
+
+/**
+ * @brief Writes characters to a display, in one transfer.
+ * @param lcd Display.
+ * @param text Characters (not null-terminated).
+ * @param length Number of characters.
+ */
+void I2C_LcdDevWrite(I2cLcd_t *lcd, const char *text, uint8_t length);
+
+/**
+ * @brief Shifts a whole display one position to the left.
+ * @param lcd Display.
+ */
+void I2C_LcdDevMoveLeft(I2cLcd_t *lcd);
+
+/**
+ * @brief Shifts a whole display one position to the right.
+ * @param lcd Display.
+ */
+void I2C_LcdDevMoveRight(I2cLcd_t *lcd);
+
+/**
+ * @brief Switches the backlight of a display.
+ * @param lcd Display.
+ * @param on True to switch it on.
+ */
+void I2C_LcdDevBacklight(I2cLcd_t *lcd, bool on);
+
+/**
+ * @brief Prints an integer on a display, in one transfer.
+ * @param lcd Display.
+ * @param value The integer value to display.
+ */
+void I2C_LcdDevPrintInt(I2cLcd_t *lcd, int32_t value);
+
+/**
+ * @brief Result of the last transfer to a display.
+ * @param lcd Display.
+ * @return TWI_OK, or the error of the failed transfer.
+ */
+TwiStatus_t I2C_LcdDevGetStatus(const I2cLcd_t *lcd);
 
 /**
  * @brief Initializes the I2C module for LCD communication.
@@ -27,6 +149,24 @@ void I2C_LcdInit(uint8_t address);
  */
 void I2C_LcdStart(uint8_t rows, uint8_t columns);
 
+/**
+ * @brief Sets up the I2C module and LCD size without waiting, for a fast boot with the
+ *        start-up sequencer (startup.h).
+ * @details Replaces I2C_LcdInit() and I2C_LcdStart(): run I2C_LcdStartStep() as a start-up
+ *          task next.
+ * @param address The 7-bit I2C address of the LCD.
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ */
+void I2C_LcdBegin(uint8_t address, uint8_t rows, uint8_t columns);
+
+/**
+ * @brief One step of the HD44780 initialization sequence (start-up task).
+ * @param step Step number, from 0.
+ * @return Microseconds to wait before the next step, or STARTUP_DONE.
+ */
+uint32_t I2C_LcdStartStep(uint8_t step);
+
 /**
  * @brief Clears the LCD screen.
  */
@@ -50,6 +190,13 @@ void I2C_LcdHome(void);
  */
 void I2C_LcdPrint(const char *text);
 
+/**
+ * @brief Writes characters to the LCD at the current cursor position, in one transfer.
+ * @param text Characters to display (not null-terminated).
+ * @param length Number of characters.
+ */
+void I2C_LcdWrite(const char *text, uint8_t length);
+
 /**
  * @brief Shifts the entire display one position to the left.
  */
@@ -76,4 +223,11 @@ void I2C_LcdDisableBacklight(void);
  */
 void I2C_LcdPrintInt(int32_t value);
 
+/**
+ * @brief Result of the last transfer to the LCD.
+ * @return TWI_OK, or the error of the failed transfer (e.g. TWI_NACK_ADDR when the LCD
+ *         is not connected).
+ */
+TwiStatus_t I2C_LcdGetStatus(void);
+
 #endif // I2C_LCD_H
\ No newline at end of file
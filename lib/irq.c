@@ -0,0 +1,163 @@
+/**
+ * @file irq.c
+ * @brief Two interrupt levels in software: short latency-critical handlers for INT3 (PS/2
+ *        clock, PD3), INT5 (IR receiver, PE5) and the Timer3 input capture, and a deferred
+ *        "bottom half" level for bulk work, with the worst-case latency of each source.
+ */
+
+#include "irq.h"
+#include "timebase.h"
+
+// Global variables
+IrqStats_t irq_stats[IRQ_SOURCES];
+volatile uint16_t irq_probe_time[IRQ_SOURCES];
+volatile uint8_t irq_probing;
+IrqWork_t irq_queue[IRQ_DEFER_SIZE];
+volatile uint8_t irq_head;
+volatile uint8_t irq_tail;
+uint16_t irq_dropped;
+static bool irq_running;                // Bottom half in progress further out
+static uint16_t irq_bh_max;
+
+/**
+ * @brief Set up the pin or the capture of a source and enable its interrupt.
+ * @param source IRQ_INT3, IRQ_INT5 or IRQ_CAPTURE.
+ * @param edge Edge that triggers it (IRQ_ANY: INT5 only; the capture takes one edge).
+ * @return false for an unknown source, or for the capture while PE7 is the buzzer output.
+ */
+bool IrqHighInit(IrqSource_t source, IrqEdge_t edge) {
+    if (source >= IRQ_SOURCES) return false;
+    // ICP3 is the buzzer pin: an output there would feed the capture its own beeps
+    if (source == IRQ_CAPTURE && (DDRE & (1 << PE7))) return false;
+    TimebaseInit();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        irq_stats[source] = (IrqStats_t){ 0 };
+        irq_probing &= ~(1 << source);
+        switch (source) {
+            case IRQ_INT3:
+                // INT3:0 have no "any edge" mode (ISCn = 01 is reserved)
+                if (edge == IRQ_ANY) edge = IRQ_FALLING;
+                DDRD &= ~(1 << PD3);
+                EICRA = (EICRA & ~((1 << ISC31) | (1 << ISC30))) | (edge << ISC30);
+                EIFR = (1 << INTF3);
+                EIMSK |= (1 << INT3);
+                break;
+            case IRQ_INT5:
+                DDRE &= ~(1 << PE5);
+                EICRB = (EICRB & ~((1 << ISC51) | (1 << ISC50))) | (edge << ISC50);
+                EIFR = (1 << INTF5);
+                EIMSK |= (1 << INT5);
+                break;
+            default:
+                if (edge == IRQ_RISING) TCCR3B |= (1 << ICES3);
+                else TCCR3B &= ~(1 << ICES3);
+                ETIFR = (1 << ICF3);
+                ETIMSK |= (1 << TICIE3);
+                break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Disable the interrupt of a source.
+ * @param source IRQ_INT3, IRQ_INT5 or IRQ_CAPTURE.
+ */
+void IrqHighStop(IrqSource_t source) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (source == IRQ_INT3) EIMSK &= ~(1 << INT3);
+        else if (source == IRQ_INT5) EIMSK &= ~(1 << INT5);
+        else if (source == IRQ_CAPTURE) ETIMSK &= ~(1 << TICIE3);
+    }
+}
+
+/**
+ * @brief Run the queued work with interrupts enabled.
+ */
+void IrqBottomHalf(void) {
+    uint8_t sreg = SREG;
+    cli();
+    if (irq_running || irq_head == irq_tail) {
+        SREG = sreg;
+        return;
+    }
+
+    irq_running = true;
+    uint16_t start = TCNT3;
+    while (irq_tail != irq_head) {
+        uint8_t tail = irq_tail;
+        IrqWork_t work = irq_queue[tail];
+        irq_tail = (tail + 1) & (IRQ_DEFER_SIZE - 1);
+        sei();
+        work();
+        cli();
+    }
+    uint16_t spent = TCNT3 - start;
+    if (spent > irq_bh_max) irq_bh_max = spent;
+    irq_running = false;
+    SREG = sreg;
+}
+
+/**
+ * @brief Pull the line of INT3 or INT5 low to measure the latency of the next handler.
+ * @param source IRQ_INT3 or IRQ_INT5.
+ * @return false if a probe of that source is still out.
+ */
+bool IrqProbe(IrqSource_t source) {
+    bool sent = false;
+    if (source != IRQ_INT3 && source != IRQ_INT5) return false;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!(irq_probing & (1 << source))) {
+            irq_probing |= (1 << source);
+            // Low level first, then the pin as output: the edge comes with the DDR write
+            if (source == IRQ_INT3) {
+                PORTD &= ~(1 << PD3);
+                irq_probe_time[source] = TCNT3;
+                DDRD |= (1 << PD3);
+            } else {
+                PORTE &= ~(1 << PE5);
+                irq_probe_time[source] = TCNT3;
+                DDRE |= (1 << PE5);
+            }
+            sent = true;
+        }
+    }
+    return sent;
+}
+
+/**
+ * @brief Copy the figures of a source.
+ */
+void IrqGetStats(IrqSource_t source, IrqStats_t *stats) {
+    if (source >= IRQ_SOURCES) return;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = irq_stats[source];
+    }
+}
+
+/**
+ * @brief Clear the figures of every source and the dropped count.
+ */
+void IrqResetStats(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t i = 0; i < IRQ_SOURCES; i++) irq_stats[i] = (IrqStats_t){ 0 };
+        irq_dropped = 0;
+        irq_bh_max = 0;
+    }
+}
+
+/**
+ * @brief Bottom-half calls dropped on a full queue.
+ */
+uint16_t IrqDeferDropped(void) {
+    return irq_dropped;
+}
+
+/**
+ * @brief Longest bottom-half run.
+ */
+uint16_t IrqBottomHalfMax(void) {
+    return irq_bh_max;
+}
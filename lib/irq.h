@@ -0,0 +1,246 @@
+/**
+ * @file irq.h
+ * @brief Two interrupt levels in software: short latency-critical handlers for INT3 (PS/2
+ *        clock, PD3), INT5 (IR receiver, PE5) and the Timer3 input capture, and a deferred
+ *        "bottom half" level for bulk work, with the worst-case latency of each source.
+ * @details The AVR has no interrupt priorities: while one handler runs, every other one
+ *          waits, so 200 cycles of display refresh or fade arithmetic delay the sample of a
+ *          PS/2 clock edge by 25 us. Here the latency-critical sources run as IRQ_HIGH
+ *          handlers: they take the timebase count first, do a few instructions and leave.
+ *          Other interrupts keep their top half short and hand the rest to IrqDefer(); the
+ *          queued work runs at the end of the interrupt, in IrqBottomHalf(), with interrupts
+ *          enabled, so any hardware interrupt, high or low, can cut in:
+ *
+ *              IRQ_HIGH(INT3_vect, IRQ_INT3) {             // stamp: edge time (ticks)
+ *                  ps2_bit(PIND & (1 << PD2));             // A few instructions only
+ *                  if (ps2_frame_done) IrqDefer(ps2_decode);
+ *              }
+ *
+ *              IRQ_LOW(TIMER0_OVF_vect) {                  // Top half: interrupts off
+ *                  OCR0 = next;
+ *                  IrqDefer(ramp_step);                    // Bulk work: interrupts on
+ *              }
+ *              ...
+ *              IrqHighInit(IRQ_INT3, IRQ_FALLING);
+ *              sei();
+ *
+ *          IRQ_HIGH handlers run with interrupts disabled: nothing cuts into them, and the
+ *          hardware order (INT3, INT5, capture) decides between two pending at once. Work
+ *          they defer waits for the next IRQ_LOW interrupt, or for IrqBottomHalf() in the
+ *          main loop, so the handler makes no call (IrqDefer() is inline). IRQ_LOW handlers
+ *          run their body, then IrqBottomHalf(). The bottom half is one level: it runs the
+ *          queue in order and is never entered twice, so deferred work doesn't need to be
+ *          reentrant; an interrupt that cuts in and defers more leaves it to the run in
+ *          progress. Deferred work must not wait for another interrupt's work.
+ *
+ *          Latency is the time from the edge to the first instruction of the handler body,
+ *          in timebase ticks (1 us at 8 MHz):
+ *          - IRQ_CAPTURE: the edge time is in ICR3, so every event is measured;
+ *          - IRQ_INT3, IRQ_INT5: IrqProbe() pulls the line low the way the device does
+ *            (open collector, like a PS/2 host inhibiting the keyboard) and takes the time;
+ *            the handler lets go of it without running its body. Probe from the main loop
+ *            and at the top of the interrupts you suspect, many times, for the worst case.
+ *          The ISR prologue (registers pushed before the body) is part of every figure.
+ *
+ * @note The arbiter refresh (TIMER2_COMP, arbiter.h) is left a plain interrupt: its latch
+ *       writes are the display timing and can't wait in the bottom half. Its measured worst
+ *       case, ArbMaxIsrTicks(), bounds what it adds to IRQ_HIGH latencies.
+ * @note ICP3 is PE7, the buzzer pin: IrqHighInit(IRQ_CAPTURE, ...) refuses while PE7 is an
+ *       output, as BuzzerInit() (and so BoardInit()) leaves it. Give up the buzzer first
+ *       (DDRE &= ~(1 << PE7)) and don't call the Buzzer functions afterwards. IRQ_HIGH and
+ *       IRQ_LOW handlers are static inline bodies of the vector: return ends the body, not
+ *       the accounting.
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef IRQ_DEFER_SIZE
+#define IRQ_DEFER_SIZE  8       ///< Queue of bottom-half calls (power of two, one kept free)
+#endif
+
+// Latency-critical sources
+typedef enum {
+    IRQ_INT3 = 0,               ///< INT3_vect, PD3 (PS/2 clock)
+    IRQ_INT5,                   ///< INT5_vect, PE5 (TL1838 IR receiver)
+    IRQ_CAPTURE,                ///< TIMER3_CAPT_vect, ICP3 on PE7, stamp = ICR3
+    IRQ_SOURCES
+} IrqSource_t;
+
+// Edge that triggers a source
+typedef enum {
+    IRQ_ANY = 1,                ///< Both edges (INT5 only; INT3 is falling or rising)
+    IRQ_FALLING = 2,
+    IRQ_RISING = 3
+} IrqEdge_t;
+
+// Figures of a source since IrqHighInit() or IrqResetStats(), in timebase ticks
+typedef struct {
+    uint32_t count;             ///< Handler runs
+    uint16_t samples;           ///< Runs with a measured latency
+    uint16_t max_latency;       ///< Longest edge-to-handler time
+    uint16_t max_handler;       ///< Longest handler body
+} IrqStats_t;
+
+/// Bottom-half work
+typedef void (*IrqWork_t)(void);
+
+// Shared with the handlers (irq.c)
+extern IrqStats_t irq_stats[IRQ_SOURCES];
+extern volatile uint16_t irq_probe_time[IRQ_SOURCES];
+extern volatile uint8_t irq_probing;                    // Bit per source
+extern IrqWork_t irq_queue[IRQ_DEFER_SIZE];
+extern volatile uint8_t irq_head;                       // Next free entry
+extern volatile uint8_t irq_tail;                       // Next entry to run
+extern uint16_t irq_dropped;
+
+// A probe edge: let go of the line and keep the latency; the body doesn't see it
+static inline void irq_probed(IrqSource_t source, uint16_t entry) {
+    IrqStats_t *s = &irq_stats[source];
+    uint16_t latency = entry - irq_probe_time[source];
+    if (source == IRQ_INT3) {
+        DDRD &= ~(1 << PD3);
+        PORTD |= (1 << PD3);                            // Input with the pull-up again
+    } else {
+        DDRE &= ~(1 << PE5);
+        PORTE |= (1 << PE5);
+    }
+    irq_probing &= ~(1 << source);
+    if (s->samples != UINT16_MAX) s->samples++;
+    if (latency > s->max_latency) s->max_latency = latency;
+}
+
+static inline void irq_account(IrqSource_t source, uint16_t entry, uint16_t stamp) {
+    IrqStats_t *s = &irq_stats[source];
+    uint16_t spent = TCNT3 - entry;
+    if (s->count != UINT32_MAX) s->count++;
+    if (spent > s->max_handler) s->max_handler = spent;
+    if (source == IRQ_CAPTURE) {
+        uint16_t latency = entry - stamp;
+        if (s->samples != UINT16_MAX) s->samples++;
+        if (latency > s->max_latency) s->max_latency = latency;
+    }
+}
+
+/**
+ * @brief Define the handler of a latency-critical source.
+ * @param vector INT3_vect, INT5_vect or TIMER3_CAPT_vect.
+ * @param source The matching IrqSource_t.
+ * @details The body that follows gets `uint16_t stamp`, the timebase count of the edge
+ *          (ICR3 for the capture, the handler entry otherwise). Keep it to a few
+ *          instructions and no calls: a call makes the prologue save every register.
+ */
+#define IRQ_HIGH(vector, source) \
+    static inline void irq_high_##vector(uint16_t stamp); \
+    ISR(vector) { \
+        uint16_t irq_entry = TCNT3; \
+        if ((source) != IRQ_CAPTURE && (irq_probing & (1 << (source)))) { \
+            irq_probed(source, irq_entry); \
+            return; \
+        } \
+        uint16_t irq_stamp = ((source) == IRQ_CAPTURE) ? ICR3 : irq_entry; \
+        irq_high_##vector(irq_stamp); \
+        irq_account(source, irq_entry, irq_stamp); \
+    } \
+    static inline void irq_high_##vector(uint16_t stamp)
+
+/**
+ * @brief Define an ordinary interrupt whose deferred work runs when its body is done.
+ * @param vector Any vector but the IRQ_HIGH ones.
+ */
+#define IRQ_LOW(vector) \
+    static inline void irq_low_##vector(void); \
+    ISR(vector) { \
+        irq_low_##vector(); \
+        IrqBottomHalf(); \
+    } \
+    static inline void irq_low_##vector(void)
+
+/**
+ * @brief Set up the pin or the capture of a source and enable its interrupt.
+ * @param source IRQ_INT3, IRQ_INT5 or IRQ_CAPTURE.
+ * @param edge Edge that triggers it (IRQ_ANY: INT5 only; the capture takes one edge).
+ * @return false if the source is unknown, or for IRQ_CAPTURE while the buzzer drives PE7
+ *         (ICP3); nothing is changed then.
+ * @note Starts the timebase. Define the handler with IRQ_HIGH.
+ */
+bool IrqHighInit(IrqSource_t source, IrqEdge_t edge);
+
+/**
+ * @brief Disable the interrupt of a source.
+ * @param source IRQ_INT3, IRQ_INT5 or IRQ_CAPTURE.
+ */
+void IrqHighStop(IrqSource_t source);
+
+/**
+ * @brief Queue bottom-half work.
+ * @param work Function to call with interrupts enabled.
+ * @return false if the queue is full (the call is dropped and counted).
+ * @note From interrupts (IRQ_LOW and IRQ_HIGH bodies), the bottom half, or the main loop.
+ */
+static inline bool IrqDefer(IrqWork_t work) {
+    bool queued = false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t head = irq_head;
+        uint8_t next = (head + 1) & (IRQ_DEFER_SIZE - 1);
+        if (next != irq_tail) {
+            irq_queue[head] = work;
+            irq_head = next;
+            queued = true;
+        } else if (irq_dropped != UINT16_MAX) {
+            irq_dropped++;
+        }
+    }
+    return queued;
+}
+
+/**
+ * @brief Run the queued work with interrupts enabled.
+ * @note Called by IRQ_LOW handlers before they return; an ISR written with ISR() calls it
+ *       last, the main loop whenever it likes (for work of the IRQ_HIGH handlers). Returns
+ *       at once when the queue is empty or the bottom half already runs further out, and
+ *       with the interrupt flag as it found it.
+ */
+void IrqBottomHalf(void);
+
+/**
+ * @brief Pull the line of INT3 or INT5 low to measure the latency of the next handler.
+ * @param source IRQ_INT3 or IRQ_INT5.
+ * @return false if a probe of that source is still out.
+ * @note Set the source to IRQ_FALLING or IRQ_ANY. The probe edge doesn't reach the
+ *       handler body, and a device edge that comes while the probe holds the line is lost:
+ *       probe between PS/2 frames or IR bursts.
+ */
+bool IrqProbe(IrqSource_t source);
+
+/**
+ * @brief Copy the figures of a source.
+ * @param source Source.
+ * @param stats Destination.
+ */
+void IrqGetStats(IrqSource_t source, IrqStats_t *stats);
+
+/**
+ * @brief Clear the figures of every source and the dropped count.
+ */
+void IrqResetStats(void);
+
+/**
+ * @brief Bottom-half calls dropped on a full queue.
+ * @return Count (saturates at 65535).
+ */
+uint16_t IrqDeferDropped(void);
+
+/**
+ * @brief Longest bottom-half run.
+ * @return Duration in timebase ticks, interrupts that cut in included.
+ */
+uint16_t IrqBottomHalfMax(void);
+
+#endif // IRQ_H
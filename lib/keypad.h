@@ -4,6 +4,8 @@
  * @brief Library for reading a 4x4 keypad on the BK-AVR128 board.
  * @details Uses PD0-PD3 as outputs (rows) and PD4-PD7 as inputs with pull-ups (columns).
  *          Returns key number (1-16) or 0 if no key is pressed.
+ * @note PD0/PD1 are also the TWI pins: with an I2C device on the bus, scan through the
+ *       PORTD owner (portd.h, PortdKey()) instead.
  */
 
  #ifndef KEYPAD_H
@@ -11,6 +13,7 @@
  
  #include <avr/io.h>
  #include <stdint.h>
+ #include "clock_config.h"
  #include <util/delay.h>
  
  /**
@@ -1,4 +1,18 @@
 #include "lcd.h"
+#include "arbiter.h"
+#include "timebase.h"
+#include "trace.h"
+#include <util/atomic.h>
+
+#ifdef LCD_BACKLIGHT_PIN
+#include "stepper.h"
+#if (1 << LCD_BACKLIGHT_PIN) & STEPPER_MASK
+#error "LCD_BACKLIGHT_PIN is a stepper coil (PB0-PB3)"
+#endif
+#if LCD_BACKLIGHT_PIN == LCD_RS || LCD_BACKLIGHT_PIN == LCD_RW || LCD_BACKLIGHT_PIN == LCD_EN
+#error "LCD_BACKLIGHT_PIN is an LCD control line"
+#endif
+#endif
 
 // LCD command constants (for HD44780)
 #define LCD_CMD_CLEAR       0x01
@@ -7,22 +21,48 @@
 #define LCD_CMD_DISPLAY_ON  0x0C
 #define LCD_CMD_FUNCTION_4BIT 0x28  // 4-bit, 2 lines, 5x8 font
 #define LCD_CMD_FUNCTION_8BIT 0x38  // 8-bit, 2 lines, 5x8 font
+#define LCD_CMD_SET_DDRAM   0x80
+
+#define LCD_EXEC_US         50      // Instruction time (37 us in the datasheet)
+#define LCD_CLEAR_US        2000    // Clear and home (1.52 ms)
+#define LCD_POWER_UP_US     40000   // From VCC at 2.7 V to the first command (datasheet)
 
-// Global variables
-static LcdMode_t lcd_mode;     // Current operating mode
-static uint8_t lcd_rows;       // Number of rows
-static uint8_t lcd_cols;       // Number of columns
-static bool lcd_backlight;     // Backlight state (assuming PB3 as example)
+// Display used by the functions without a handle (LcdInit(), LcdPrint()...)
+static Lcd_t lcd_default;
+
+// Wait until this display finished its last instruction; other displays don't matter
+static void lcd_wait(Lcd_t *lcd) {
+    if (!lcd->busy_ticks) return;
+    TimebaseInit();     // Restarts Timer3 if something stopped it meanwhile
+    TRACE_BEGIN(TRACE_LCD_WAIT, lcd->en);
+    while ((uint16_t)(TimebaseNow() - lcd->busy_since) < lcd->busy_ticks);
+    TRACE_END(TRACE_LCD_WAIT, lcd->en);
+    lcd->busy_ticks = 0;
+}
+
+static void lcd_busy(Lcd_t *lcd, uint16_t us) {
+    lcd->busy_since = TimebaseNow();
+    lcd->busy_ticks = TimebaseTicks(us);
+}
 
 // Low-level LCD functions
-static void lcd_pulse_enable(void) {
-    LCD_CTRL_PORT |= (1 << LCD_EN);
+// EN is a run-time bit, so each edge is an in/or/out on PORTB, not one sbi/cbi: with
+// interrupts on, a stepper phase written in between would be undone by the write-back
+static void lcd_pulse_enable(uint8_t en) {
+    uint8_t mask = 1 << en;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        LCD_CTRL_PORT |= mask;
+    }
     _delay_us(1);
-    LCD_CTRL_PORT &= ~(1 << LCD_EN);
-    _delay_us(50);  // Wait for LCD to process
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        LCD_CTRL_PORT &= ~mask;
+    }
 }
 
-static void lcd_write(uint8_t data, uint8_t rs) {
+static void lcd_write(Lcd_t *lcd, uint8_t data, uint8_t rs) {
+    lcd_wait(lcd);
+    TRACE(TRACE_LCD, data);
+
     // Set RS (0 for command, 1 for data)
     if (rs) LCD_CTRL_PORT |= (1 << LCD_RS);
     else LCD_CTRL_PORT &= ~(1 << LCD_RS);
@@ -30,84 +70,242 @@ static void lcd_write(uint8_t data, uint8_t rs) {
     // Set RW to write (0)
     LCD_CTRL_PORT &= ~(1 << LCD_RW);
 
-    if (lcd_mode == LCD_MODE_8BIT) {
+    // Data and EN pulse as one bus cycle, so no latch strobe lands in between
+    ArbBusLock();
+    if (lcd->mode == LCD_MODE_8BIT) {
         LCD_DATA_PORT = data;
-        lcd_pulse_enable();
+        lcd_pulse_enable(lcd->en);
     } else {  // 4-bit mode
         LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | (data & 0xF0);
-        lcd_pulse_enable();
+        lcd_pulse_enable(lcd->en);
         LCD_DATA_PORT = (LCD_DATA_PORT & 0x0F) | ((data << 4) & 0xF0);
-        lcd_pulse_enable();
+        lcd_pulse_enable(lcd->en);
     }
+    ArbBusUnlock();
+    lcd_busy(lcd, LCD_EXEC_US);  // The next write to this LCD waits for it
 }
 
 // Send command to LCD
-static void lcd_command(uint8_t cmd) {
-    lcd_write(cmd, 0);
-    if (cmd == LCD_CMD_CLEAR || cmd == LCD_CMD_HOME) _delay_ms(2);  // Longer delay
+static void lcd_command(Lcd_t *lcd, uint8_t cmd) {
+    lcd_write(lcd, cmd, 0);
+    if (cmd == LCD_CMD_CLEAR || cmd == LCD_CMD_HOME) lcd_busy(lcd, LCD_CLEAR_US);  // Longer delay
 }
 
 // Send data to LCD
-static void lcd_data(uint8_t data) {
-    lcd_write(data, 1);
+static void lcd_data(Lcd_t *lcd, uint8_t data) {
+    lcd_write(lcd, data, 1);
 }
 
-/**
- * @brief Initializes the LCD with the specified mode.
- * @param mode LCD operating mode (LCD_MODE_4BIT or LCD_MODE_8BIT).
- */
-void LcdInit(LcdMode_t mode) {
-    lcd_mode = mode;
-    lcd_backlight = true;  // Assume backlight on by default
+// Set up the pins; the LCD needs power_us more before the first command
+static void lcd_setup(Lcd_t *lcd, LcdMode_t mode, uint8_t en, uint32_t power_us) {
+    lcd->mode = mode;
+    lcd->en = en;
+    lcd->power_us = power_us;
+    lcd->busy_ticks = 0;
+    lcd->backlight = true;  // Assume backlight on by default
 
-    // Set control pins as outputs
-    LCD_CTRL_DDR |= (1 << LCD_RS) | (1 << LCD_RW) | (1 << LCD_EN);
+    // Set control pins as outputs (PORTB is shared with the stepper interrupt)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        LCD_CTRL_DDR |= (1 << LCD_RS) | (1 << LCD_RW) | (1 << en);
+        LCD_CTRL_PORT &= ~(1 << en);
+    }
     // Set data pins as outputs (PB0-PB7 for 8-bit, PB4-PB7 for 4-bit)
     LCD_DATA_DDR |= (mode == LCD_MODE_8BIT) ? 0xFF : 0xF0;
 
-    // Backlight pin (example: PB3)
-    DDRB |= (1 << PB3);
-    PORTB |= (1 << PB3);  // Backlight on
+#ifdef LCD_BACKLIGHT_PIN
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        LCD_CTRL_DDR |= (1 << LCD_BACKLIGHT_PIN);
+        LCD_CTRL_PORT |= (1 << LCD_BACKLIGHT_PIN);  // Backlight on
+    }
+#endif
+    TimebaseInit();
+}
 
+// DDRAM address of each row: rows 2 and 3 continue rows 0 and 1 after `columns` cells
+static void lcd_geometry(Lcd_t *lcd, uint8_t rows, uint8_t columns) {
+    lcd->rows = (rows > 4) ? 4 : rows;
+    lcd->cols = columns;
+    lcd->row_offset[0] = 0x00;
+    lcd->row_offset[1] = 0x40;
+    lcd->row_offset[2] = columns;
+    lcd->row_offset[3] = 0x40 + columns;
+}
+
+/**
+ * @brief Sets up a display on the shared bus and waits for it to power up.
+ */
+void LcdDevInit(Lcd_t *lcd, LcdMode_t mode, uint8_t en) {
+    lcd_setup(lcd, mode, en, 15000);
     _delay_ms(50);  // Wait for LCD to power up
 }
 
+/**
+ * @brief Runs the initialization sequence of a display.
+ */
+void LcdDevStart(Lcd_t *lcd, uint8_t rows, uint8_t columns) {
+    uint32_t wait;
+    lcd_geometry(lcd, rows, columns);
+    for (uint8_t step = 0; (wait = LcdDevStartStep(lcd, step)) != STARTUP_DONE; step++) {
+        StartupDelay(wait);
+    }
+}
+
+/**
+ * @brief Sets up a display without waiting, for the start-up sequencer.
+ */
+void LcdDevBegin(Lcd_t *lcd, LcdMode_t mode, uint8_t en, uint8_t rows, uint8_t columns) {
+    lcd_setup(lcd, mode, en, LCD_POWER_UP_US);
+    lcd_geometry(lcd, rows, columns);
+}
+
+/**
+ * @brief One step of the HD44780 initialization sequence of a display.
+ */
+uint32_t LcdDevStartStep(Lcd_t *lcd, uint8_t step) {
+    bool eight_bit = (lcd->mode == LCD_MODE_8BIT);
+
+    // Initialization sequence for HD44780: 0x30 three times (0x03, 0x03, 0x02 in 4-bit
+    // mode, which switches to 4 bits), then the real settings
+    switch (step) {
+    case 0:
+        return lcd->power_us;
+    case 1:
+        lcd_command(lcd, eight_bit ? 0x30 : 0x03);
+        return 5000;
+    case 2:
+        lcd_command(lcd, eight_bit ? 0x30 : 0x03);
+        return 100;
+    case 3:
+        lcd_command(lcd, eight_bit ? 0x30 : 0x02);
+        return 0;
+    case 4:
+        lcd_command(lcd, eight_bit ? LCD_CMD_FUNCTION_8BIT : LCD_CMD_FUNCTION_4BIT);
+        return 0;
+    case 5:
+        lcd_command(lcd, LCD_CMD_DISPLAY_ON);
+        return 0;
+    case 6:
+        lcd_command(lcd, LCD_CMD_ENTRY_MODE);
+        return 0;
+    case 7:
+        lcd_command(lcd, LCD_CMD_CLEAR);
+        return LCD_CLEAR_US;    // Not needed before the next write, but done when done
+    default:
+        return STARTUP_DONE;
+    }
+}
+
+/**
+ * @brief Clears a display.
+ */
+void LcdDevClear(Lcd_t *lcd) {
+    lcd_command(lcd, LCD_CMD_CLEAR);
+}
+
+/**
+ * @brief Sets the cursor position on a display.
+ */
+void LcdDevSetCursor(Lcd_t *lcd, uint8_t row, uint8_t column) {
+    if (row >= lcd->rows || column >= lcd->cols) return;
+    lcd_command(lcd, LCD_CMD_SET_DDRAM | (lcd->row_offset[row] + column));
+}
+
+/**
+ * @brief Moves the cursor of a display to (0,0).
+ */
+void LcdDevHome(Lcd_t *lcd) {
+    lcd_command(lcd, LCD_CMD_HOME);
+}
+
+/**
+ * @brief Prints a string on a display.
+ */
+void LcdDevPrint(Lcd_t *lcd, const char *text) {
+    while (*text) {
+        lcd_data(lcd, *text++);
+    }
+}
+
+/**
+ * @brief Writes characters to a display.
+ */
+void LcdDevWrite(Lcd_t *lcd, const char *text, uint8_t length) {
+    while (length--) {
+        lcd_data(lcd, *text++);
+    }
+}
+
+/**
+ * @brief Shifts a whole display one position to the left.
+ */
+void LcdDevMoveLeft(Lcd_t *lcd) {
+    lcd_command(lcd, 0x18);
+}
+
+/**
+ * @brief Shifts a whole display one position to the right.
+ */
+void LcdDevMoveRight(Lcd_t *lcd) {
+    lcd_command(lcd, 0x1C);
+}
+
+/**
+ * @brief Prints an integer on a display.
+ */
+void LcdDevPrintInt(Lcd_t *lcd, int32_t value) {
+    char buffer[11];  // Enough for -2147483648
+    uint8_t i = sizeof(buffer);
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+
+    do {
+        buffer[--i] = (magnitude % 10) + '0';
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) buffer[--i] = '-';
+    LcdDevWrite(lcd, buffer + i, sizeof(buffer) - i);
+}
+
+/**
+ * @brief Initializes the LCD with the specified mode.
+ * @param mode LCD operating mode (LCD_MODE_4BIT or LCD_MODE_8BIT).
+ */
+void LcdInit(LcdMode_t mode) {
+    LcdDevInit(&lcd_default, mode, LCD_EN);
+}
+
 /**
  * @brief Starts the LCD with the specified dimensions.
  * @param rows Number of rows (e.g., 2 for a 16x2 LCD).
  * @param columns Number of columns (e.g., 16 for a 16x2 LCD).
  */
 void LcdStart(uint8_t rows, uint8_t columns) {
-    lcd_rows = rows;
-    lcd_cols = columns;
-
-    // Initialization sequence for HD44780
-    _delay_ms(15);
-    if (lcd_mode == LCD_MODE_8BIT) {
-        lcd_command(0x30);  // 8-bit mode init
-        _delay_ms(5);
-        lcd_command(0x30);
-        _delay_us(100);
-        lcd_command(0x30);
-        lcd_command(LCD_CMD_FUNCTION_8BIT);
-    } else {  // 4-bit mode
-        lcd_command(0x03);
-        _delay_ms(5);
-        lcd_command(0x03);
-        _delay_us(100);
-        lcd_command(0x02);  // Set 4-bit mode
-        lcd_command(LCD_CMD_FUNCTION_4BIT);
-    }
-    lcd_command(LCD_CMD_DISPLAY_ON);
-    lcd_command(LCD_CMD_ENTRY_MODE);
-    LcdClear();
+    LcdDevStart(&lcd_default, rows, columns);
+}
+
+/**
+ * @brief Sets up the LCD pins and size without waiting, for the start-up sequencer.
+ * @param mode LCD operating mode (LCD_MODE_4BIT or LCD_MODE_8BIT).
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ */
+void LcdBegin(LcdMode_t mode, uint8_t rows, uint8_t columns) {
+    LcdDevBegin(&lcd_default, mode, LCD_EN, rows, columns);
+}
+
+/**
+ * @brief One step of the HD44780 initialization sequence (start-up task).
+ * @param step Step number, from 0.
+ * @return Microseconds to wait before the next step, or STARTUP_DONE.
+ */
+uint32_t LcdStartStep(uint8_t step) {
+    return LcdDevStartStep(&lcd_default, step);
 }
 
 /**
  * @brief Clears the LCD screen.
  */
 void LcdClear(void) {
-    lcd_command(LCD_CMD_CLEAR);
+    LcdDevClear(&lcd_default);
 }
 
 /**
@@ -116,18 +314,14 @@ void LcdClear(void) {
  * @param column Column number (0-based).
  */
 void LcdSetCursor(uint8_t row, uint8_t column) {
-    if (row >= lcd_rows || column >= lcd_cols) return;
-    uint8_t address = (row == 0) ? 0x00 : 0x40;
-    if (row == 1 && lcd_rows > 2) address = 0x14;
-    if (row == 2 && lcd_rows > 3) address = 0x54;
-    lcd_command(0x80 | (address + column));
+    LcdDevSetCursor(&lcd_default, row, column);
 }
 
 /**
  * @brief Moves the cursor to the home position (0,0).
  */
 void LcdHome(void) {
-    lcd_command(LCD_CMD_HOME);
+    LcdDevHome(&lcd_default);
 }
 
 /**
@@ -135,39 +329,50 @@ void LcdHome(void) {
  * @param text Pointer to a null-terminated string to display.
  */
 void LcdPrint(const char *text) {
-    while (*text) {
-        lcd_data(*text++);
-    }
+    LcdDevPrint(&lcd_default, text);
+}
+
+/**
+ * @brief Writes characters to the LCD at the current cursor position.
+ * @param text Characters to display (not null-terminated).
+ * @param length Number of characters.
+ */
+void LcdWrite(const char *text, uint8_t length) {
+    LcdDevWrite(&lcd_default, text, length);
 }
 
 /**
  * @brief Shifts the entire display one position to the left.
  */
 void LcdMoveLeft(void) {
-    lcd_command(0x18);
+    LcdDevMoveLeft(&lcd_default);
 }
 
 /**
  * @brief Shifts the entire display one position to the right.
  */
 void LcdMoveRight(void) {
-    lcd_command(0x1C);
+    LcdDevMoveRight(&lcd_default);
 }
 
 /**
- * @brief Enables the LCD backlight (if connected to PB3).
+ * @brief Enables the LCD backlight (if connected to LCD_BACKLIGHT_PIN).
  */
 void LcdEnableBacklight(void) {
-    lcd_backlight = true;
-    PORTB |= (1 << PB3);
+    lcd_default.backlight = true;
+#ifdef LCD_BACKLIGHT_PIN
+    LCD_CTRL_PORT |= (1 << LCD_BACKLIGHT_PIN);
+#endif
 }
 
 /**
- * @brief Disables the LCD backlight (if connected to PB3).
+ * @brief Disables the LCD backlight (if connected to LCD_BACKLIGHT_PIN).
  */
 void LcdDisableBacklight(void) {
-    lcd_backlight = false;
-    PORTB &= ~(1 << PB3);
+    lcd_default.backlight = false;
+#ifdef LCD_BACKLIGHT_PIN
+    LCD_CTRL_PORT &= ~(1 << LCD_BACKLIGHT_PIN);
+#endif
 }
 
 /**
@@ -175,25 +380,5 @@ void LcdDisableBacklight(void) {
  * @param value The integer value to convert and display.
  */
 void LcdPrintInt(int32_t value) {
-    char buffer[12];  // Enough for -2147483648 + null
-    int8_t i = 0;
-
-    if (value == 0) {
-        lcd_data('0');
-        return;
-    }
-
-    if (value < 0) {
-        lcd_data('-');
-        value = -value;
-    }
-
-    while (value > 0) {
-        buffer[i++] = (value % 10) + '0';
-        value /= 10;
-    }
-
-    while (i > 0) {
-        lcd_data(buffer[--i]);
-    }
-}
\ No newline at end of file
+    LcdDevPrintInt(&lcd_default, value);
+}
@@ -1,20 +1,45 @@
+/**
+ * @file lcd.h
+ * @brief HD44780 character LCD driver (LCD1602 on J14).
+ * @details PORTA is shared with the LED and digit latches. Each transfer (data setup and
+ *          EN pulse) locks the output arbiter bus (arbiter.h), so the LCD can be used
+ *          together with the LEDs and the 7-segment display.
+ *
+ *          Several displays can share the bus (data, RS, RW) with one EN line each on
+ *          LCD_CTRL_PORT: the LcdDevXxx() functions take an Lcd_t handle, the functions
+ *          without a handle drive the J14 display (EN = LCD_EN). Instead of sleeping after
+ *          each instruction, a handle remembers when its controller is busy until (on the
+ *          timebase, Timer3) and the next write to that display waits for it. Writes to
+ *          another display go ahead at once, so updates of several panels interleave and
+ *          a clear (1.52 ms) on one doesn't hold up the others.
+ */
+
 #ifndef LCD_H
 #define LCD_H
 
 #include <avr/io.h>
+#include "clock_config.h"
 #include <util/delay.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "startup.h"
 
-// LCD pin configuration for BK-AVR128 (example pins, adjustable)
-#define LCD_DATA_PORT PORTB    // Data lines (4 or 8 bits)
-#define LCD_DATA_DDR  DDRB
-#define LCD_DATA_PIN  PINB
-#define LCD_CTRL_PORT PORTC    // Control lines (RS, RW, EN)
-#define LCD_CTRL_DDR  DDRC
-#define LCD_RS        PC0      // Register Select
-#define LCD_RW        PC1      // Read/Write
-#define LCD_EN        PC2      // Enable
+// LCD1602 pin configuration for BK-AVR128 (J14); override before including to rewire
+#ifndef LCD_DATA_PORT
+#define LCD_DATA_PORT PORTA    // Data lines DB0-DB7 (DB4-DB7 = PA4-PA7 in 4-bit mode)
+#define LCD_DATA_DDR  DDRA
+#define LCD_DATA_PIN  PINA
+#endif
+#ifndef LCD_CTRL_PORT
+#define LCD_CTRL_PORT PORTB    // Control lines (RS, RW, EN)
+#define LCD_CTRL_DDR  DDRB
+#define LCD_RS        PB5      // Register Select
+#define LCD_RW        PB6      // Read/Write
+#define LCD_EN        PB7      // Enable
+#endif
+// Backlight switch: none by default. PB3 used to be driven here, but PB0-PB3 are the
+// stepper coils (STEPPER_MASK); define a free LCD_CTRL_PORT bit to switch a transistor.
+// #define LCD_BACKLIGHT_PIN  PBx
 
 // LCD mode options
 typedef enum {
@@ -22,6 +47,108 @@ typedef enum {
     LCD_MODE_8BIT = 1   ///< 8-bit mode
 } LcdMode_t;
 
+// One display on the bus
+typedef struct {
+    LcdMode_t mode;
+    uint8_t en;                 // EN bit on LCD_CTRL_PORT
+    uint8_t rows;
+    uint8_t cols;
+    uint8_t row_offset[4];      // DDRAM address of each row
+    bool backlight;
+    uint32_t power_us;          // Wait before the first command of the start sequence
+    uint16_t busy_since;        // Timebase tick of the last instruction
+    uint16_t busy_ticks;        // Its execution time, 0 = ready
+} Lcd_t;
+
+/**
+ * @brief Sets up a display on the shared bus and waits 50 ms for it to power up.
+ * @param lcd Handle.
+ * @param mode LCD operating mode (LCD_MODE_4BIT or LCD_MODE_8BIT).
+ * @param en EN bit of this display on LCD_CTRL_PORT (LCD_EN for J14).
+ */
+void LcdDevInit(Lcd_t *lcd, LcdMode_t mode, uint8_t en);
+
+/**
+ * @brief Runs the initialization sequence of a display.
+ * @param lcd Handle.
+ * @param rows Number of rows (1-4).
+ * @param columns Number of columns; rows 2 and 3 start at this DDRAM offset (16x4: 0x10,
+ *        0x50; 20x4: 0x14, 0x54).
+ */
+void LcdDevStart(Lcd_t *lcd, uint8_t rows, uint8_t columns);
+
+/**
+ * @brief Sets up a display without waiting, for the start-up sequencer (see LcdBegin()).
+ * @param lcd Handle.
+ * @param mode LCD operating mode.
+ * @param en EN bit of this display on LCD_CTRL_PORT.
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ */
+void LcdDevBegin(Lcd_t *lcd, LcdMode_t mode, uint8_t en, uint8_t rows, uint8_t columns);
+
+/**
+ * @brief One step of the HD44780 initialization sequence of a display.
+ * @param lcd Handle.
+ * @param step Step number, from 0.
+ * @return Microseconds to wait before the next step, or STARTUP_DONE.
+ */
+uint32_t LcdDevStartStep(Lcd_t *lcd, uint8_t step);
+
+/**
+ * @brief Clears a display.
+ * @param lcd Handle.
+ */
+void LcdDevClear(Lcd_t *lcd);
+
+/**
+ * @brief Sets the cursor position on a display.
+ * @param lcd Handle.
+ * @param row Row number (0-based).
+ * @param column Column number (0-based).
+ */
+void LcdDevSetCursor(Lcd_t *lcd, uint8_t row, uint8_t column);
+
+/**
+ * @brief Moves the cursor of a display to (0,0).
+ * @param lcd Handle.
+ */
+void LcdDevHome(Lcd_t *lcd);
+
+/**
+ * @brief Prints a string on a display.
+ * @param lcd Handle.
+ * @param text Null-terminated string.
+ */
+void LcdDevPrint(Lcd_t *lcd, const char *text);
+
+/**
+ * @brief Writes characters to a display.
+ * @param lcd Handle.
+ * @param text Characters (not null-terminated).
+ * @param length Number of characters.
+ */
+void LcdDevWrite(Lcd_t *lcd, const char *text, uint8_t length);
+
+/**
+ * @brief Shifts a whole display one position to the left.
+ * @param lcd Handle.
+ */
+void LcdDevMoveLeft(Lcd_t *lcd);
+
+/**
+ * @brief Shifts a whole display one position to the right.
+ * @param lcd Handle.
+ */
+void LcdDevMoveRight(Lcd_t *lcd);
+
+/**
+ * @brief Prints an integer on a display.
+ * @param lcd Handle.
+ * @param value Value.
+ */
+void LcdDevPrintInt(Lcd_t *lcd, int32_t value);
+
 /**
  * @brief Initializes the LCD with the specified mode.
  * @param mode LCD operating mode (LCD_MODE_4BIT or LCD_MODE_8BIT).
@@ -35,6 +162,25 @@ void LcdInit(LcdMode_t mode);
  */
 void LcdStart(uint8_t rows, uint8_t columns);
 
+/**
+ * @brief Sets up the LCD pins and size without waiting, for a fast boot with the start-up
+ *        sequencer (startup.h).
+ * @details Replaces LcdInit() and LcdStart(): run LcdStartStep() as a start-up task next.
+ *          Its first step waits out the 40 ms power-up time, so the other tasks get done
+ *          meanwhile.
+ * @param mode LCD operating mode (LCD_MODE_4BIT or LCD_MODE_8BIT).
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ */
+void LcdBegin(LcdMode_t mode, uint8_t rows, uint8_t columns);
+
+/**
+ * @brief One step of the HD44780 initialization sequence (start-up task).
+ * @param step Step number, from 0.
+ * @return Microseconds to wait before the next step, or STARTUP_DONE.
+ */
+uint32_t LcdStartStep(uint8_t step);
+
 /**
  * @brief Clears the LCD screen.
  */
@@ -58,6 +204,13 @@ void LcdHome(void);
  */
 void LcdPrint(const char *text);
 
+/**
+ * @brief Writes characters to the LCD at the current cursor position.
+ * @param text Characters to display (not null-terminated).
+ * @param length Number of characters.
+ */
+void LcdWrite(const char *text, uint8_t length);
+
 /**
  * @brief Shifts the entire display one position to the left.
  */
@@ -70,11 +223,13 @@ void LcdMoveRight(void);
 
 /**
  * @brief Enables the LCD backlight (if connected to a pin).
+ * @note Only records the state unless LCD_BACKLIGHT_PIN is defined.
  */
 void LcdEnableBacklight(void);
 
 /**
  * @brief Disables the LCD backlight (if connected to a pin).
+ * @note Only records the state unless LCD_BACKLIGHT_PIN is defined.
  */
 void LcdDisableBacklight(void);
 
@@ -0,0 +1,68 @@
+#include "led_bcm.h"
+#include "arbiter.h"
+
+// Global variables
+static uint8_t ledbcm_levels[LED_BCM_LEDS];
+
+// Transpose levels into plane bytes (bit k of a level lights its LED in plane k, active LOW)
+static void ledbcm_planes(const uint8_t *levels, uint8_t count, uint8_t first, uint8_t planes[LED_BCM_PLANES]) {
+    for (uint8_t k = 0; k < LED_BCM_PLANES; k++) {
+        uint8_t out = 0xFF;
+        for (uint8_t i = 0; i < count; i++) {
+            if (levels[i] & (1 << k)) out &= ~(1 << (first + i));
+        }
+        planes[k] = out;
+    }
+}
+
+/**
+ * @brief Start the output arbiter (if needed) with all LEDs off.
+ */
+void LedBcmInit(void) {
+    ArbInit();
+    LedBcmStop();
+}
+
+/**
+ * @brief Switch all LEDs off.
+ */
+void LedBcmStop(void) {
+    static const uint8_t off[LED_BCM_LEDS] = { 0 };
+    LedBcmSetAll(off);
+}
+
+/**
+ * @brief Set the brightness of one LED.
+ * @param led LED index 0-7 (LED1 to LED8); larger values are ignored.
+ * @param level Brightness 0 (off) to 255 (fully on), linear in on-time.
+ */
+void LedBcmSet(uint8_t led, uint8_t level) {
+    uint8_t planes[LED_BCM_PLANES];
+
+    if (led >= LED_BCM_LEDS) return;
+    ledbcm_levels[led] = level;
+    ledbcm_planes(&level, 1, led, planes);
+    ArbLedWritePlanes(1 << led, planes);
+}
+
+/**
+ * @brief Set the brightness of all LEDs at once.
+ * @param levels Eight levels, index 0 = LED1.
+ */
+void LedBcmSetAll(const uint8_t levels[LED_BCM_LEDS]) {
+    uint8_t planes[LED_BCM_PLANES];
+
+    for (uint8_t i = 0; i < LED_BCM_LEDS; i++) ledbcm_levels[i] = levels[i];
+    ledbcm_planes(levels, LED_BCM_LEDS, 0, planes);
+    ArbLedWritePlanes(0xFF, planes);
+}
+
+/**
+ * @brief Current brightness of one LED.
+ * @param led LED index 0-7.
+ * @return Level 0-255 (0 for an invalid index).
+ */
+uint8_t LedBcmGet(uint8_t led) {
+    if (led >= LED_BCM_LEDS) return 0;
+    return ledbcm_levels[led];
+}
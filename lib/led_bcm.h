@@ -0,0 +1,60 @@
+/**
+ * @file led_bcm.h
+ * @brief 256-level brightness for the 8 LEDs on the BK-AVR128 board using binary code modulation.
+ * @details Each LED level is split into its 8 bits. The frame is 8 bit planes whose lengths
+ *          double (1, 2, 4 ... 128 units), and during plane k every LED whose level has bit k
+ *          set is on, so each LED is lit for level/256 of the frame. The planes are shown by
+ *          the output arbiter (arbiter.h), one interrupt per plane boundary regardless of the
+ *          levels, interleaved with the 7-segment digit slots on the same Timer2 frame
+ *          (8.19 ms, 122 Hz at 8 MHz).
+ *
+ *          The PORTA byte of every plane is precomputed here when a level changes, so the
+ *          interrupt only latches it into U6 (LE = PF3), and only when it differs from the
+ *          byte the latch already holds.
+ *
+ * @note Call sei() after LedBcmInit().
+ */
+
+#ifndef LED_BCM_H
+#define LED_BCM_H
+
+#include <avr/io.h>
+#include <stdint.h>
+
+#define LED_BCM_LEDS    8       ///< LEDs on PORTA
+#define LED_BCM_PLANES  8       ///< Bit planes per frame (256 levels)
+
+/**
+ * @brief Start the output arbiter (if needed) with all LEDs off.
+ */
+void LedBcmInit(void);
+
+/**
+ * @brief Switch all LEDs off.
+ * @note The arbiter keeps running for the 7-segment display; use ArbStop() to stop it.
+ */
+void LedBcmStop(void);
+
+/**
+ * @brief Set the brightness of one LED.
+ * @param led LED index 0-7 (LED1 to LED8); larger values are ignored.
+ * @param level Brightness 0 (off) to 255 (fully on), linear in on-time.
+ * @example LedBcmSet(2, 128); // LED3 at half duty
+ */
+void LedBcmSet(uint8_t led, uint8_t level);
+
+/**
+ * @brief Set the brightness of all LEDs at once.
+ * @param levels Eight levels, index 0 = LED1.
+ * @note The new levels take effect together at the next plane.
+ */
+void LedBcmSetAll(const uint8_t levels[LED_BCM_LEDS]);
+
+/**
+ * @brief Current brightness of one LED.
+ * @param led LED index 0-7.
+ * @return Level 0-255 (0 for an invalid index).
+ */
+uint8_t LedBcmGet(uint8_t led);
+
+#endif // LED_BCM_H
@@ -9,8 +9,14 @@
  #define LEDS_H
  
  #include <avr/io.h>
+ #include "clock_config.h"
  #include <util/delay.h>
  #include <stdint.h>
+ #include "startup.h"
+ 
+ #ifndef LEDS_INIT_FLASH
+ #define LEDS_INIT_FLASH 1   ///< LedsInit() blinks all LEDs five times (500 ms); 0 skips it
+ #endif
  
  // Port and Pin Definitions
  #define LEDS_DDR    DDRA    ///< Data Direction Register for LEDs
@@ -27,16 +33,37 @@
  /**
   * @brief Initialize the LED port.
   * @note Configures all PORTA pins as outputs, turns off LEDs (HIGH), and performs
-  *       five short blinks to signal initialization.
+  *       five short blinks to signal initialization unless LEDS_INIT_FLASH is 0. For a
+  *       fast boot, run LedsFlashStep() as a start-up task instead.
   */
  static inline void LedsInit(void) {
      LEDS_DDR = 0xFF;    // All PORTA pins as outputs
      LEDS_PORT = 0xFF;   // All LEDs off (HIGH = off)
  
+ #if LEDS_INIT_FLASH
      for (uint8_t counter = 0; counter < 10; counter++) {
          LEDS_PORT ^= 0xFF;  // Toggle all LEDs
          _delay_ms(50);      // 50ms delay
      }
+ #endif
+ }
+ 
+ /**
+  * @brief The LedsInit() blink as a start-up task (startup.h), so it runs while the other
+  *        peripherals start instead of before them.
+  * @param step Step number, from 0.
+  * @return Microseconds to the next toggle, or STARTUP_DONE.
+  */
+ static inline uint32_t LedsFlashStep(uint8_t step) {
+     if (step == 0) {
+         LEDS_DDR = 0xFF;
+         LEDS_PORT = 0xFF;
+     } else if (step > 10) {
+         return STARTUP_DONE;
+     } else {
+         LEDS_PORT ^= 0xFF;
+     }
+     return (step == 0) ? 0 : 50000;
  }
  
  /**
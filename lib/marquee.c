@@ -0,0 +1,119 @@
+#include "marquee.h"
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#include <string.h>
+
+// Global variables
+static Marquee_t *marquee_list[MARQUEE_MAX];
+static uint8_t marquee_count;
+
+static void marquee_set(Marquee_t *m, const char *text, bool progmem, uint8_t interval) {
+    uint16_t length = progmem ? strlen_P(text) : strlen(text);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        m->text = text;
+        m->progmem = progmem;
+        m->length = length;
+        m->offset = 0;
+        m->interval = (length > m->width) ? interval : 0;
+        m->countdown = m->interval;
+        m->steps = 0;
+        m->redraw = true;
+    }
+}
+
+// Draw the window: text from offset to the end, the gap, then the text from its start
+static void marquee_draw(Marquee_t *m) {
+    char cells[MARQUEE_WIDTH_MAX];
+    uint16_t period = m->length + MARQUEE_GAP;
+    uint16_t pos = m->offset;
+
+    if (m->length <= m->width) period = m->width + 1;   // Fits: no wrap, padded
+    for (uint8_t i = 0; i < m->width; i++) {
+        if (pos < m->length) cells[i] = m->progmem ? pgm_read_byte(m->text + pos) : m->text[pos];
+        else cells[i] = ' ';
+        if (++pos == period) pos = 0;
+    }
+    m->set_cursor(m->row, m->column);
+    m->write(cells, m->width);
+}
+
+/**
+ * @brief Set up a viewport and register it.
+ */
+bool MarqueeInit(Marquee_t *m, MarqueeCursor_t set_cursor, MarqueeWrite_t write,
+                 uint8_t row, uint8_t column, uint8_t width) {
+    bool registered = false;
+
+    m->set_cursor = set_cursor;
+    m->write = write;
+    m->row = row;
+    m->column = column;
+    m->width = (width > MARQUEE_WIDTH_MAX) ? MARQUEE_WIDTH_MAX : width;
+    marquee_set(m, "", false, 0);
+    m->redraw = false;
+
+    for (uint8_t i = 0; i < marquee_count; i++) {
+        if (marquee_list[i] == m) registered = true;
+    }
+    if (registered) return true;
+    if (marquee_count >= MARQUEE_MAX) return false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        marquee_list[marquee_count++] = m;
+    }
+    return true;
+}
+
+/**
+ * @brief Show a text in RAM.
+ */
+void MarqueeSetText(Marquee_t *m, const char *text, uint8_t interval) {
+    marquee_set(m, text, false, interval);
+}
+
+/**
+ * @brief Show a text in program memory.
+ */
+void MarqueeSetText_P(Marquee_t *m, const char *text, uint8_t interval) {
+    marquee_set(m, text, true, interval);
+}
+
+/**
+ * @brief Count one tick for all viewports.
+ */
+void MarqueeTick(void) {
+    for (uint8_t i = 0; i < marquee_count; i++) {
+        Marquee_t *m = marquee_list[i];
+        if (!m->interval || --m->countdown) continue;
+        m->countdown = m->interval;
+        if (m->steps < 255) m->steps++;
+    }
+}
+
+/**
+ * @brief Redraw the viewports that are due.
+ */
+uint8_t MarqueeUpdate(void) {
+    uint8_t drawn = 0;
+
+    for (uint8_t i = 0; i < marquee_count; i++) {
+        Marquee_t *m = marquee_list[i];
+        uint8_t steps;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            steps = m->steps;
+            m->steps = 0;
+        }
+        if (steps) {
+            // One step moves the text one cell left; the offset wraps over text and gap
+            uint16_t period = m->length + MARQUEE_GAP;
+            m->offset = (m->offset + steps) % period;
+        } else if (!m->redraw) {
+            continue;
+        }
+        m->redraw = false;
+        marquee_draw(m);
+        drawn++;
+    }
+    return drawn;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file marquee.h
+ * @brief Per-row viewports with marquee scrolling for the character LCDs.
+ * @details LcdMoveLeft()/LcdMoveRight() shift the whole display. A viewport instead owns a
+ *          window of one row (row, column, width) and shows a longer text through it, so
+ *          one row can scroll while the rest of the screen keeps static values.
+ *
+ *          The text is not copied or rotated: the viewport keeps the text length and the
+ *          current offset, and a redraw reads the visible characters straight from the text
+ *          (RAM or PROGMEM), wrapping with MARQUEE_GAP blanks between the end and the start.
+ *          Texts that fit the window are drawn once and don't scroll.
+ *
+ *          Timing is split in two so the interrupt stays short and the LCD is only driven
+ *          from the main loop:
+ *          - MarqueeTick() from a timer interrupt counts down each viewport's interval;
+ *          - MarqueeUpdate() from the main loop redraws the viewports that are due, one
+ *            cursor command and width characters each.
+ *
+ *          The LCD functions are passed in, so both drivers work:
+ *          MarqueeInit(&m, LcdSetCursor, LcdWrite, ...) or
+ *          MarqueeInit(&m, I2C_LcdSetCursor, I2C_LcdWrite, ...).
+ *
+ * @note MarqueeUpdate() moves the LCD cursor; set it again before printing elsewhere.
+ */
+
+#ifndef MARQUEE_H
+#define MARQUEE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef MARQUEE_MAX
+#define MARQUEE_MAX     4       ///< Viewports served by MarqueeTick()/MarqueeUpdate()
+#endif
+#ifndef MARQUEE_GAP
+#define MARQUEE_GAP     4       ///< Blanks between the end of the text and its start
+#endif
+#define MARQUEE_WIDTH_MAX   40  ///< Widest window (HD44780 line length)
+
+typedef void (*MarqueeCursor_t)(uint8_t row, uint8_t column);
+typedef void (*MarqueeWrite_t)(const char *text, uint8_t length);
+
+typedef struct {
+    MarqueeCursor_t set_cursor;
+    MarqueeWrite_t write;
+    uint8_t row, column, width;
+    const char *text;
+    bool progmem;               // text is in program memory
+    uint16_t length;            // Text length
+    uint16_t offset;            // Text position shown in the first cell
+    uint8_t interval;           // Ticks per step, 0 = stopped
+    volatile uint8_t countdown;
+    volatile uint8_t steps;     // Steps due, counted by MarqueeTick()
+    bool redraw;
+} Marquee_t;
+
+/**
+ * @brief Set up a viewport and register it.
+ * @param m Viewport (static or global: it stays registered).
+ * @param set_cursor LCD cursor function (LcdSetCursor or I2C_LcdSetCursor).
+ * @param write LCD write function (LcdWrite or I2C_LcdWrite).
+ * @param row Row of the window.
+ * @param column First column of the window.
+ * @param width Window width in characters (up to MARQUEE_WIDTH_MAX).
+ * @return False if MARQUEE_MAX viewports are already registered.
+ */
+bool MarqueeInit(Marquee_t *m, MarqueeCursor_t set_cursor, MarqueeWrite_t write,
+                 uint8_t row, uint8_t column, uint8_t width);
+
+/**
+ * @brief Show a text in RAM.
+ * @param m Viewport.
+ * @param text Text; must stay valid while it is shown.
+ * @param interval Ticks between one-character steps; 0 = don't scroll.
+ */
+void MarqueeSetText(Marquee_t *m, const char *text, uint8_t interval);
+
+/**
+ * @brief Show a text in program memory (PSTR() or a PROGMEM array).
+ * @param m Viewport.
+ * @param text Text in flash.
+ * @param interval Ticks between one-character steps; 0 = don't scroll.
+ */
+void MarqueeSetText_P(Marquee_t *m, const char *text, uint8_t interval);
+
+/**
+ * @brief Count one tick for all viewports; call from a timer interrupt.
+ * @note A few cycles per viewport, no LCD access.
+ */
+void MarqueeTick(void);
+
+/**
+ * @brief Redraw the viewports that are due; call from the main loop.
+ * @return Number of viewports redrawn.
+ * @note Steps missed while the main loop was busy are caught up in one redraw.
+ */
+uint8_t MarqueeUpdate(void);
+
+#endif // MARQUEE_H
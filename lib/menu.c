@@ -0,0 +1,239 @@
+/**
+ * @file menu.c
+ * @brief Menus and forms for the character LCDs, driven by keys: item tables in flash,
+ *        redraws that send only the cells that changed.
+ */
+
+#include "menu.h"
+#include <string.h>
+
+#define MENU_ARROW      0x7E    // HD44780 ROM: right arrow, marks a submenu
+#define MENU_GAP        1       // Unchanged cells a run may cover (a cursor command costs one)
+
+static void menu_open(Menu_t *m, const MenuItem_t *page, uint8_t selected, uint8_t top) {
+    uint8_t count = 0;
+    while (pgm_read_byte(&page[count].label[0])) count++;
+    m->page = page;
+    m->count = count;
+    m->selected = selected;
+    m->top = top;
+    m->editing = false;
+}
+
+// Keep the selected item on the screen
+static void menu_scroll(Menu_t *m) {
+    if (m->selected < m->top) m->top = m->selected;
+    else if (m->selected >= m->top + m->rows) m->top = m->selected - m->rows + 1;
+}
+
+static bool menu_back(Menu_t *m) {
+    if (!m->depth) return false;
+    m->depth--;
+    menu_open(m, m->stack[m->depth].page, m->stack[m->depth].selected, m->stack[m->depth].top);
+    return true;
+}
+
+// Right-aligned decimal, returns the number of characters
+static uint8_t menu_format(int16_t value, char *text) {
+    char digits[6];
+    uint8_t n = 0;
+    uint16_t magnitude = (value < 0) ? -(uint16_t)value : (uint16_t)value;
+    do {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    uint8_t length = 0;
+    if (value < 0) text[length++] = '-';
+    while (n) text[length++] = digits[--n];
+    return length;
+}
+
+// Lay out the row of one item: marker, label, value against the right edge
+static void menu_row(const Menu_t *m, uint8_t index, char *cells) {
+    MenuItem_t item;
+    char value[6];
+    uint8_t length = 0;
+
+    memset(cells, ' ', m->columns);
+    if (index >= m->count) return;
+    memcpy_P(&item, &m->page[index], sizeof(item));
+
+    if (index == m->selected) cells[0] = m->editing ? '*' : '>';
+    switch (item.kind) {
+        case MENU_NUMBER: {
+            bool editing = m->editing && index == m->selected;
+            length = menu_format(editing ? m->edit : *(int16_t *)item.value, value);
+            break;
+        }
+        case MENU_TOGGLE:
+            length = *(bool *)item.value ? 2 : 3;
+            memcpy(value, *(bool *)item.value ? "on" : "off", length);
+            break;
+        case MENU_SUBMENU:
+            value[length++] = MENU_ARROW;
+            break;
+        default:
+            break;
+    }
+
+    // The value wins over the end of a long label, with one blank between them
+    uint8_t room = m->columns - 1 - (length ? length + 1 : 0);
+    for (uint8_t i = 0; i < room && item.label[i]; i++) cells[1 + i] = item.label[i];
+    memcpy(cells + m->columns - length, value, length);
+}
+
+/**
+ * @brief Set up a menu on the first rows of an LCD.
+ */
+void MenuInit(Menu_t *m, MenuCursor_t set_cursor, MenuWrite_t write,
+              uint8_t rows, uint8_t columns, const MenuItem_t *page) {
+    m->set_cursor = set_cursor;
+    m->write = write;
+    m->rows = (rows > MENU_ROWS_MAX) ? MENU_ROWS_MAX : rows;
+    m->columns = (columns > MENU_COLUMNS_MAX) ? MENU_COLUMNS_MAX : columns;
+    m->depth = 0;
+    menu_open(m, page, 0, 0);
+    MenuInvalidate(m);
+}
+
+/**
+ * @brief Act on a key.
+ */
+bool MenuKey(Menu_t *m, MenuKey_t key) {
+    MenuItem_t item;
+
+    if (key == MENU_KEY_NONE) return false;
+    if (!m->count) {
+        if (key != MENU_KEY_BACK || !menu_back(m)) return false;
+        m->redraw = true;
+        return true;
+    }
+    memcpy_P(&item, &m->page[m->selected], sizeof(item));
+
+    if (m->editing) {
+        int32_t edit = m->edit;                     // int is 16 bits: no overflow at the ends
+        switch (key) {
+            case MENU_KEY_UP:
+                edit += item.step;
+                if (edit > item.max) edit = item.max;
+                break;
+            case MENU_KEY_DOWN:
+                edit -= item.step;
+                if (edit < item.min) edit = item.min;
+                break;
+            case MENU_KEY_OK:
+                *(int16_t *)item.value = edit;
+                m->editing = false;
+                if (item.action) item.action();
+                break;
+            default:
+                m->editing = false;
+                break;
+        }
+        m->edit = edit;
+        m->redraw = true;
+        return true;
+    }
+
+    switch (key) {
+        case MENU_KEY_UP:
+            if (!m->selected) return false;
+            m->selected--;
+            break;
+        case MENU_KEY_DOWN:
+            if (m->selected + 1 >= m->count) return false;
+            m->selected++;
+            break;
+        case MENU_KEY_OK:
+            switch (item.kind) {
+                case MENU_SUBMENU:
+                    if (!item.page || m->depth >= MENU_DEPTH) return false;
+                    m->stack[m->depth].page = m->page;
+                    m->stack[m->depth].selected = m->selected;
+                    m->stack[m->depth].top = m->top;
+                    m->depth++;
+                    menu_open(m, item.page, 0, 0);
+                    break;
+                case MENU_TOGGLE:
+                    *(bool *)item.value = !*(bool *)item.value;
+                    if (item.action) item.action();
+                    break;
+                case MENU_NUMBER:
+                    m->edit = *(int16_t *)item.value;
+                    m->editing = true;
+                    break;
+                case MENU_BACK:
+                    if (!menu_back(m)) return false;
+                    break;
+                default:
+                    if (item.action) item.action();
+                    break;
+            }
+            break;
+        default:
+            if (!menu_back(m)) return false;
+            break;
+    }
+    menu_scroll(m);
+    m->redraw = true;
+    return true;
+}
+
+/**
+ * @brief Write the cells that changed since the last update.
+ */
+uint8_t MenuUpdate(Menu_t *m) {
+    char cells[MENU_COLUMNS_MAX];
+    uint8_t written = 0;
+
+    if (!m->redraw) return 0;
+    m->redraw = false;
+
+    for (uint8_t row = 0; row < m->rows; row++) {
+        char *shadow = m->shadow[row];
+        menu_row(m, m->top + row, cells);
+
+        // Runs of changed cells; a short unchanged gap goes out with them
+        uint8_t column = 0;
+        while (column < m->columns) {
+            if (cells[column] == shadow[column]) {
+                column++;
+                continue;
+            }
+            uint8_t end = column + 1;
+            for (uint8_t c = end; c < m->columns && c - end <= MENU_GAP; c++) {
+                if (cells[c] != shadow[c]) end = c + 1;
+            }
+            m->set_cursor(row, column);
+            m->write(cells + column, end - column);
+            memcpy(shadow + column, cells + column, end - column);
+            written += end - column;
+            column = end;
+        }
+    }
+    return written;
+}
+
+/**
+ * @brief Lay the rows out again at the next update.
+ */
+void MenuRefresh(Menu_t *m) {
+    m->redraw = true;
+}
+
+/**
+ * @brief Forget what is on the screen.
+ */
+void MenuInvalidate(Menu_t *m) {
+    // No cell ever holds 0: every one differs
+    memset(m->shadow, 0, sizeof(m->shadow));
+    m->redraw = true;
+}
+
+/**
+ * @brief Item under the cursor.
+ */
+const MenuItem_t *MenuSelected(const Menu_t *m) {
+    return &m->page[m->selected];
+}
@@ -0,0 +1,162 @@
+/**
+ * @file menu.h
+ * @brief Menus and forms for the character LCDs, driven by keys: item tables in flash,
+ *        redraws that send only the cells that changed.
+ * @details A page is a table of MenuItem_t in program memory, ended by an empty label like
+ *          the shell tables. Each item is one row: a label and, right-aligned, its value.
+ *          - MENU_SUBMENU opens another page (up to MENU_DEPTH deep);
+ *          - MENU_TOGGLE flips a bool;
+ *          - MENU_NUMBER edits an int16_t between min and max, by step: OK starts the
+ *            edit, up/down change the copy shown, OK stores it, back drops it;
+ *          - MENU_ACTION calls a function;
+ *          - MENU_BACK returns to the page above.
+ *          The action of a toggle or number runs after the value is stored.
+ *
+ *              static const MenuItem_t setup[] PROGMEM = {
+ *                  { "Contrast", MENU_NUMBER, .value = &contrast, .min = 0, .max = 9, .step = 1 },
+ *                  { "Back", MENU_BACK },
+ *                  { "" }
+ *              };
+ *              static const MenuItem_t top[] PROGMEM = {
+ *                  { "Beep", MENU_TOGGLE, .value = &beep },
+ *                  { "Setup", MENU_SUBMENU, .page = setup },
+ *                  { "" }
+ *              };
+ *              ...
+ *              MenuInit(&menu, LcdSetCursor, LcdWrite, 2, 16, top);
+ *              while (1) {
+ *                  MenuKey(&menu, key_to_menu(KeypadRead()));
+ *                  MenuUpdate(&menu);
+ *              }
+ *
+ *          The menu keeps a copy of the cells it has put on the screen. MenuKey() only
+ *          changes the state; MenuUpdate() lays the rows out in RAM, compares them with the
+ *          copy and writes the runs of cells that differ, one cursor command each. Moving
+ *          the selection rewrites two cells, a new value only its digits; a whole screen
+ *          goes out only when the page changes or the list scrolls. That keeps a keypress
+ *          on screen within one display frame (8.19 ms) on both LCDs, where a full 2x16
+ *          redraw over TWI takes longer.
+ *
+ *          The LCD functions are passed in, as for the marquee: MenuInit(&m, LcdSetCursor,
+ *          LcdWrite, ...) or MenuInit(&m, I2C_LcdSetCursor, I2C_LcdWrite, ...).
+ *
+ * @note The menu owns the rows it was given. After something else wrote there (or after
+ *       LcdClear()), call MenuInvalidate(); after values change outside the menu, call
+ *       MenuRefresh(). Call both and MenuKey()/MenuUpdate() from the main loop.
+ */
+
+#ifndef MENU_H
+#define MENU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/pgmspace.h>
+
+#ifndef MENU_DEPTH
+#define MENU_DEPTH      4       ///< Submenus open at once
+#endif
+#define MENU_LABEL_SIZE     12  ///< Label and its terminator
+#define MENU_ROWS_MAX       4   ///< Tallest screen (20x4)
+#define MENU_COLUMNS_MAX    20  ///< Widest screen
+
+// What an item does on OK
+typedef enum {
+    MENU_ACTION = 0,            ///< Call action
+    MENU_SUBMENU,               ///< Open page
+    MENU_TOGGLE,                ///< Flip *(bool *)value, then call action
+    MENU_NUMBER,                ///< Edit *(int16_t *)value, then call action
+    MENU_BACK                   ///< Return to the page above
+} MenuKind_t;
+
+// Keys, mapped by the application from the keypad or the buttons
+typedef enum {
+    MENU_KEY_NONE = 0,
+    MENU_KEY_UP,
+    MENU_KEY_DOWN,
+    MENU_KEY_OK,
+    MENU_KEY_BACK
+} MenuKey_t;
+
+typedef void (*MenuCursor_t)(uint8_t row, uint8_t column);
+typedef void (*MenuWrite_t)(const char *text, uint8_t length);
+typedef void (*MenuAction_t)(void);
+
+// Entry of a page in flash; the page ends with an empty label
+typedef struct MenuItem {
+    char label[MENU_LABEL_SIZE];
+    uint8_t kind;               ///< MenuKind_t
+    void *value;                ///< MENU_TOGGLE: bool, MENU_NUMBER: int16_t (in RAM)
+    const struct MenuItem *page;    ///< MENU_SUBMENU: the page it opens
+    MenuAction_t action;        ///< MENU_ACTION, or after a toggle or number changed; or NULL
+    int16_t min, max, step;     ///< MENU_NUMBER range
+} MenuItem_t;
+
+typedef struct {
+    MenuCursor_t set_cursor;
+    MenuWrite_t write;
+    uint8_t rows, columns;
+    const MenuItem_t *page;     // Page shown
+    uint8_t count;              // Its items
+    uint8_t selected;           // Item under the cursor
+    uint8_t top;                // Item on the first row
+    uint8_t depth;
+    struct {
+        const MenuItem_t *page;
+        uint8_t selected, top;
+    } stack[MENU_DEPTH];        // Pages above, to come back to
+    bool editing;               // A number is being edited
+    int16_t edit;               // Its value until OK
+    bool redraw;
+    char shadow[MENU_ROWS_MAX][MENU_COLUMNS_MAX];   // Cells on the screen
+} Menu_t;
+
+/**
+ * @brief Set up a menu on the first rows of an LCD.
+ * @param m Menu.
+ * @param set_cursor LCD cursor function (LcdSetCursor or I2C_LcdSetCursor).
+ * @param write LCD write function (LcdWrite or I2C_LcdWrite).
+ * @param rows Rows it uses, from row 0 (up to MENU_ROWS_MAX).
+ * @param columns Columns it uses, from column 0 (up to MENU_COLUMNS_MAX).
+ * @param page Top page in program memory.
+ * @note Nothing is written until MenuUpdate(), which then draws every cell.
+ */
+void MenuInit(Menu_t *m, MenuCursor_t set_cursor, MenuWrite_t write,
+              uint8_t rows, uint8_t columns, const MenuItem_t *page);
+
+/**
+ * @brief Act on a key.
+ * @param m Menu.
+ * @param key Key; MENU_KEY_NONE does nothing.
+ * @return True if the screen is due for a redraw.
+ * @note Doesn't touch the LCD. Actions and submenus run from here.
+ */
+bool MenuKey(Menu_t *m, MenuKey_t key);
+
+/**
+ * @brief Write the cells that changed since the last update.
+ * @param m Menu.
+ * @return Cells written (0 when nothing was due).
+ * @note Moves the LCD cursor.
+ */
+uint8_t MenuUpdate(Menu_t *m);
+
+/**
+ * @brief Lay the rows out again at the next update, for values changed outside the menu.
+ * @param m Menu.
+ */
+void MenuRefresh(Menu_t *m);
+
+/**
+ * @brief Forget what is on the screen: the next update draws every cell.
+ * @param m Menu.
+ */
+void MenuInvalidate(Menu_t *m);
+
+/**
+ * @brief Item under the cursor.
+ * @param m Menu.
+ * @return Item in program memory.
+ */
+const MenuItem_t *MenuSelected(const Menu_t *m);
+
+#endif // MENU_H
@@ -0,0 +1,200 @@
+/**
+ * @file portd.c
+ * @brief PORTD owner: time-shares PD0-PD7 between the TWI bus, the buttons and the keypad.
+ */
+
+#include "portd.h"
+#include "twi.h"
+#include "clock.h"
+#include "timebase.h"
+#include "trace.h"
+#include <avr/io.h>
+#include <util/delay.h>
+
+#define PORTD_ROWS      0x0F    // PD0-PD3: keypad rows and buttons
+#define PORTD_COLUMNS   0xF0    // PD4-PD7: keypad columns
+#define PORTD_TWI       0x03    // PD0/PD1: SCL/SDA, rows 0-1
+
+// Global variables
+static uint8_t portd_reserved;
+static uint16_t portd_scan_us;          // Scan period (PortdSetScanPeriod())
+static uint16_t portd_period;           // The same in timebase ticks
+static uint8_t portd_debounce;          // Equal scans before a change counts
+static uint16_t portd_last;             // Timebase tick of the last scan
+static uint8_t portd_key, portd_buttons;            // Debounced
+static uint8_t portd_raw_key, portd_raw_buttons;    // Last scan
+static uint8_t portd_same;              // Scans the raw state has been the same
+static bool portd_scanning;
+static PortdStats_t portd_stats;
+
+// One pass over the buttons and the keypad with the TWI unit off
+static void portd_scan(void) {
+    uint8_t mine = (uint8_t)~portd_reserved;
+    uint8_t rows = PORTD_ROWS & mine;
+    uint8_t ddr = DDRD;
+    uint8_t port = PORTD;
+    uint8_t twcr = TWCR;
+    uint8_t key = 0;
+
+    // While the bus is in use, rows 0-1 stay released: SCL driven low is a clock pulse for
+    // every slave, and SDA driven low while SCL is high a START (released, a STOP). Their
+    // buttons are still read, as inputs.
+    uint8_t driven = (twcr & (1 << TWEN)) ? rows & ~PORTD_TWI : rows;
+
+    TWCR = twcr & ~((1 << TWINT) | (1 << TWEN));        // PD0/PD1 back to the port
+    DDRD &= ~mine;
+    PORTD |= mine;                                       // All inputs with pull-ups
+    _delay_us(PORTD_SETTLE_US);
+    uint8_t buttons = ~PIND & rows;
+
+    for (uint8_t row = 0; row < 4 && !key; row++) {
+        uint8_t bit = 1 << row;
+        if (!(driven & bit)) continue;
+        PORTD &= ~bit;
+        DDRD |= bit;
+        _delay_us(PORTD_SETTLE_US);
+        uint8_t columns = ~PIND & PORTD_COLUMNS & mine;
+        DDRD &= ~bit;
+        PORTD |= bit;
+        for (uint8_t col = 0; col < 4; col++) {
+            if (columns & (1 << (4 + col))) {
+                key = row * 4 + col + 1;
+                break;
+            }
+        }
+    }
+
+    // Pins back as they were; SCL/SDA were never driven, only pulled up
+    PORTD = (PORTD & portd_reserved) | (port & mine);
+    DDRD = (DDRD & portd_reserved) | (ddr & mine);
+    TWCR = twcr & ~(1 << TWINT);
+
+    if (key == portd_raw_key && buttons == portd_raw_buttons) {
+        if (portd_same < portd_debounce) portd_same++;
+    } else {
+        portd_raw_key = key;
+        portd_raw_buttons = buttons;
+        portd_same = 1;
+    }
+    if (portd_same >= portd_debounce) {
+        if (key != portd_key) TRACE(TRACE_KEY, key);
+        portd_key = key;
+        portd_buttons = buttons;
+    }
+}
+
+// The scan period in ticks follows the system clock (clock.h)
+static void portd_clock(ClockEvent_t event, uint32_t hz) {
+    (void)hz;
+    if (event == CLOCK_POST_CHANGE) portd_period = TimebaseTicks(portd_scan_us);
+}
+
+static void portd_idle(void) {
+    PortdPoll();
+}
+
+/**
+ * @brief Take over PD0-PD7 for scanning and hook into the TWI driver.
+ */
+void PortdInit(uint8_t reserved) {
+    portd_reserved = reserved;
+    portd_key = portd_buttons = 0;
+    portd_raw_key = portd_raw_buttons = 0;
+    portd_same = 0;
+    portd_scanning = false;
+    PortdResetStats();
+    TimebaseInit();
+    portd_debounce = PORTD_DEBOUNCE;
+    portd_scan_us = PORTD_SCAN_US;
+    portd_period = TimebaseTicks(PORTD_SCAN_US);
+    portd_last = TimebaseNow() - portd_period;          // First poll scans
+    ClockNotify(portd_clock);
+    TwiOnIdle(portd_idle);
+}
+
+/**
+ * @brief Scan the keypad and the buttons if a scan is due and the bus is free.
+ */
+bool PortdPoll(void) {
+    uint16_t now = TimebaseNow();
+    uint16_t since = now - portd_last;
+    if (since < portd_period || portd_scanning) return false;
+    if (TwiActive()) {
+        portd_stats.deferred++;
+        return false;
+    }
+
+    portd_scanning = true;
+    TRACE_BEGIN(TRACE_PORTD, portd_key);
+    portd_scan();
+    TRACE_END(TRACE_PORTD, portd_raw_key);
+    portd_scanning = false;
+    portd_last = now;
+
+    uint32_t late = TimebaseMicros(since - portd_period);
+    uint32_t took = TimebaseMicros((uint16_t)(TimebaseNow() - now));
+    portd_stats.scans++;
+    if (late > portd_stats.max_late_us) portd_stats.max_late_us = (late > 0xFFFF) ? 0xFFFF : late;
+    if (took > portd_stats.max_scan_us) portd_stats.max_scan_us = (took > 0xFFFF) ? 0xFFFF : took;
+    return true;
+}
+
+/**
+ * @brief Change the scan period.
+ */
+uint16_t PortdSetScanPeriod(uint16_t us) {
+    if (us < PORTD_SCAN_MIN_US) us = PORTD_SCAN_MIN_US;
+    portd_scan_us = us;
+    portd_period = TimebaseTicks(us);
+    return us;
+}
+
+/**
+ * @brief Scan period in use.
+ */
+uint16_t PortdScanPeriod(void) {
+    return portd_scan_us;
+}
+
+/**
+ * @brief Change the number of equal scans a key or button needs.
+ */
+uint8_t PortdSetDebounce(uint8_t scans) {
+    portd_debounce = scans ? scans : 1;
+    return portd_debounce;
+}
+
+/**
+ * @brief Equal scans a key or button needs.
+ */
+uint8_t PortdDebounce(void) {
+    return portd_debounce;
+}
+
+/**
+ * @brief Debounced keypad key.
+ */
+uint8_t PortdKey(void) {
+    return portd_key;
+}
+
+/**
+ * @brief Debounced buttons.
+ */
+uint8_t PortdButtons(void) {
+    return portd_buttons;
+}
+
+/**
+ * @brief Copy the scan figures.
+ */
+void PortdGetStats(PortdStats_t *stats) {
+    *stats = portd_stats;
+}
+
+/**
+ * @brief Clear the scan figures.
+ */
+void PortdResetStats(void) {
+    portd_stats = (PortdStats_t){ 0 };
+}
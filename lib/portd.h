@@ -0,0 +1,128 @@
+/**
+ * @file portd.h
+ * @brief PORTD owner: time-shares PD0-PD7 between the TWI bus, the buttons and the keypad.
+ * @details On the BK-AVR128 PD0/PD1 are SCL/SDA and also button 1-2 and keypad rows 0-1,
+ *          PD2/PD3 are the PS/2 lines and button 3-4 and keypad rows 2-3, PD4-PD7 are the
+ *          keypad columns. KeypadInit(), ButtonsInit() and TwiInit() each set DDRD/PORTD for
+ *          themselves, so they can't be used together. The owner scans the keypad and the
+ *          buttons in the gaps between TWI transfers instead:
+ *
+ *              TwiInit();                      // or I2C_LcdInit()
+ *              PortdInit(0);
+ *              while (1) {
+ *                  PortdPoll();                // Also runs after every TWI STOP
+ *                  uint8_t key = PortdKey();
+ *                  ...
+ *              }
+ *
+ *          A scan is due every PORTD_SCAN_US. It runs from PortdPoll(), which TwiStop()
+ *          also calls right after each STOP, so a stream of transfers (an LCD update) delays
+ *          a scan by one transfer at most. A scan never runs inside a transfer. It saves
+ *          DDRD, PORTD and TWCR, switches the TWI unit off (so PD0/PD1 are port pins), reads
+ *          the buttons with the pull-ups, drives each keypad row low in turn and reads the
+ *          columns, then puts everything back and switches the TWI unit on again. That
+ *          takes about 30 us at 8 MHz. A key or button counts after PORTD_DEBOUNCE equal
+ *          scans. PortdSetScanPeriod() and PortdSetDebounce() change both at run time.
+ *
+ *          Rows 0-1 are not driven while the TWI unit is on: pulling SCL low clocks every
+ *          slave on the bus, and pulling SDA low while SCL is high is a START to them. Keys
+ *          1-8 are then not seen (buttons 1-2 are, they are only read), so an application
+ *          on the bus takes its keys from rows 2-3 (9-16). Without TwiInit() all four rows
+ *          are scanned.
+ *
+ *          Pins passed to PortdInit() as reserved are never touched, e.g. PD2/PD3 while a
+ *          PS/2 device uses them; their rows and buttons are not scanned.
+ *
+ * @note Call PortdPoll() from the main loop, not from an interrupt. A button 1 or 2 held
+ *       down pulls SCL or SDA low, which no schedule can prevent: the TWI driver then
+ *       reports a timeout or a stuck bus.
+ */
+
+#ifndef PORTD_H
+#define PORTD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef PORTD_SCAN_US
+#define PORTD_SCAN_US       10000   ///< Scan period
+#endif
+#ifndef PORTD_DEBOUNCE
+#define PORTD_DEBOUNCE      3       ///< Equal scans before a key or button counts
+#endif
+#define PORTD_SCAN_MIN_US   200     ///< Shortest scan period PortdSetScanPeriod() takes
+#define PORTD_SETTLE_US     2       ///< Wait after switching a row, for the pull-ups
+
+// Scan figures since PortdInit() or PortdResetStats()
+typedef struct {
+    uint32_t scans;         ///< Scans done
+    uint32_t deferred;      ///< Polls that found a scan due inside a transfer
+    uint16_t max_late_us;   ///< Longest delay of a due scan
+    uint16_t max_scan_us;   ///< Longest scan (TWI unit off)
+} PortdStats_t;
+
+/**
+ * @brief Take over PD0-PD7 for scanning and hook into the TWI driver.
+ * @param reserved PORTD pins the scans leave alone (e.g. (1 << PD2) | (1 << PD3) for PS/2).
+ * @note Starts the timebase (Timer3). Call after TwiInit() if the bus is used.
+ */
+void PortdInit(uint8_t reserved);
+
+/**
+ * @brief Scan the keypad and the buttons if a scan is due and the bus is free.
+ * @return true if it scanned.
+ */
+bool PortdPoll(void);
+
+/**
+ * @brief Change the scan period.
+ * @param us Period in microseconds, at least PORTD_SCAN_MIN_US.
+ * @return Period now in use.
+ * @note PortdInit() goes back to PORTD_SCAN_US.
+ */
+uint16_t PortdSetScanPeriod(uint16_t us);
+
+/**
+ * @brief Scan period in use.
+ * @return Period in microseconds.
+ */
+uint16_t PortdScanPeriod(void);
+
+/**
+ * @brief Change the number of equal scans a key or button needs to count.
+ * @param scans Scans, at least 1 (1 = no debouncing).
+ * @return Value now in use.
+ * @note PortdInit() goes back to PORTD_DEBOUNCE.
+ */
+uint8_t PortdSetDebounce(uint8_t scans);
+
+/**
+ * @brief Equal scans a key or button needs to count.
+ * @return Scans.
+ */
+uint8_t PortdDebounce(void);
+
+/**
+ * @brief Debounced keypad key.
+ * @return Key number 1-16 (KeypadRead() numbering) or 0.
+ */
+uint8_t PortdKey(void);
+
+/**
+ * @brief Debounced buttons.
+ * @return Bit n set = button n + 1 pressed.
+ */
+uint8_t PortdButtons(void);
+
+/**
+ * @brief Copy the scan figures.
+ * @param stats Destination.
+ */
+void PortdGetStats(PortdStats_t *stats);
+
+/**
+ * @brief Clear the scan figures.
+ */
+void PortdResetStats(void);
+
+#endif // PORTD_H
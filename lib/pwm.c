@@ -0,0 +1,373 @@
+#include "pwm.h"
+#include "clock_config.h"
+#include "irq.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#define PWM_RAMP_HZ     1000    // Target ramp tick rate
+
+// Timers behind the channels
+#define PWM_TIMER0      0
+#define PWM_TIMER1      1
+
+// Gamma 2.2, level 0-255 to 10-bit duty (non-zero levels never map to 0; on OC0, levels
+// 1-19 are below one timer count and stay off)
+static const uint16_t pwm_gamma[256] PROGMEM = {
+       0,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    2,    2,
+       2,    3,    3,    3,    4,    4,    5,    5,    6,    6,    7,    7,    8,    9,    9,   10,
+      11,   11,   12,   13,   14,   15,   16,   16,   17,   18,   19,   20,   21,   23,   24,   25,
+      26,   27,   28,   30,   31,   32,   34,   35,   36,   38,   39,   41,   42,   44,   46,   47,
+      49,   51,   52,   54,   56,   58,   60,   61,   63,   65,   67,   69,   71,   73,   76,   78,
+      80,   82,   84,   87,   89,   91,   94,   96,   98,  101,  103,  106,  109,  111,  114,  117,
+     119,  122,  125,  128,  130,  133,  136,  139,  142,  145,  148,  151,  155,  158,  161,  164,
+     167,  171,  174,  177,  181,  184,  188,  191,  195,  198,  202,  206,  209,  213,  217,  221,
+     225,  228,  232,  236,  240,  244,  248,  252,  257,  261,  265,  269,  274,  278,  282,  287,
+     291,  295,  300,  304,  309,  314,  318,  323,  328,  333,  337,  342,  347,  352,  357,  362,
+     367,  372,  377,  382,  387,  393,  398,  403,  408,  414,  419,  425,  430,  436,  441,  447,
+     452,  458,  464,  470,  475,  481,  487,  493,  499,  505,  511,  517,  523,  529,  535,  542,
+     548,  554,  561,  567,  573,  580,  586,  593,  599,  606,  613,  619,  626,  633,  640,  647,
+     653,  660,  667,  674,  681,  689,  696,  703,  710,  717,  725,  732,  739,  747,  754,  762,
+     769,  777,  784,  792,  800,  807,  815,  823,  831,  839,  847,  855,  863,  871,  879,  887,
+     895,  903,  912,  920,  928,  937,  945,  954,  962,  971,  979,  988,  997, 1005, 1014, 1023
+};
+
+// Timer0 prescalers (CS02:0 = index + 1) and Timer1 prescalers (CS12:0 = index + 1)
+static const uint16_t pwm_prescalers0[] PROGMEM = { 1, 8, 32, 64, 128, 256, 1024 };
+static const uint16_t pwm_prescalers1[] PROGMEM = { 1, 8, 64, 256, 1024 };
+
+// Ramp state of a channel
+typedef struct {
+    uint32_t level;     // Q8.16 current level
+    int32_t step;       // Q8.16 change per ramp tick
+    uint16_t ticks;     // Ramp ticks left (0 = idle)
+    uint8_t target;     // Level the ramp ends on
+    uint8_t curve;      // PwmCurve_t
+} PwmRamp_t;
+
+// Global variables
+static PwmRamp_t pwm_ramp[PWM_CHANNELS];
+static uint16_t pwm_top1;                   // Timer1 TOP (ICR1)
+static uint16_t pwm_ramp_hz[2];             // Ramp ticks per second per timer
+static uint8_t pwm_divider[2];              // Overflows per ramp tick per timer
+static uint8_t pwm_div_count[2];
+static volatile uint8_t pwm_ramp_due[2];    // Ramp ticks waiting for the bottom half
+static uint8_t pwm_oc0_owner = PWM_CH_LED;  // Channel driving PB4
+static volatile uint8_t pwm_oc0_base;       // OC0 duty, upper 8 bits
+static volatile uint8_t pwm_oc0_frac;       // OC0 duty, lower 2 bits (dithered)
+static uint8_t pwm_oc0_acc;
+
+// Map a channel to its timer
+static uint8_t pwm_timer(PwmChannel_t channel) {
+    return (channel <= PWM_CH_MOTOR) ? PWM_TIMER0 : PWM_TIMER1;
+}
+
+// Compare output mode bits of a channel
+static uint8_t pwm_com_mask(PwmChannel_t channel) {
+    switch (channel) {
+        case PWM_CH_OC1A: return (1 << COM1A1);
+        case PWM_CH_OC1B: return (1 << COM1B1);
+        case PWM_CH_OC1C: return (1 << COM1C1);
+        case PWM_CH_LED: return (1 << COM01) | (1 << COM00);   // Inverting: D9 is active LOW
+        default: return (1 << COM01);
+    }
+}
+
+// Overflow interrupts are only needed while a ramp runs (or OC0 dithers)
+static void pwm_update_irq(void) {
+    bool t0 = pwm_ramp[pwm_oc0_owner].ticks || pwm_oc0_frac;
+    bool t1 = pwm_ramp[PWM_CH_OC1A].ticks || pwm_ramp[PWM_CH_OC1B].ticks || pwm_ramp[PWM_CH_OC1C].ticks;
+
+    if (t0) TIMSK |= (1 << TOIE0);
+    else TIMSK &= ~(1 << TOIE0);
+    if (t1) TIMSK |= (1 << TOIE1);
+    else TIMSK &= ~(1 << TOIE1);
+}
+
+// Write a 10-bit duty to the hardware; 0 disconnects the pin to avoid the 1-count glitch
+static void pwm_write(PwmChannel_t channel, uint16_t duty) {
+    uint8_t com = pwm_com_mask(channel);
+
+    if (channel <= PWM_CH_MOTOR) {
+        if (channel != pwm_oc0_owner) return;
+        // The load is on for OCR0 + 1 counts in both compare modes: duty / 4 counts is
+        // OCR0 = duty / 4 - 1, the dither adds the quarters. Below one count it is off,
+        // at 1023 OCR0 = TOP keeps it on.
+        if (duty < 4) duty = 0;
+        if (duty >= PWM_DUTY_MAX) {
+            pwm_oc0_base = 0xFF;
+            pwm_oc0_frac = 0;
+        } else if (duty) {
+            pwm_oc0_base = (duty >> 2) - 1;
+            pwm_oc0_frac = duty & 3;
+        } else {
+            pwm_oc0_base = 0;
+            pwm_oc0_frac = 0;
+        }
+        OCR0 = pwm_oc0_base;
+        if (duty) {
+            TCCR0 = (TCCR0 & ~((1 << COM01) | (1 << COM00))) | com;
+        } else {
+            TCCR0 &= ~((1 << COM01) | (1 << COM00));
+            if (channel == PWM_CH_LED) PORTB |= (1 << PB4);
+            else PORTB &= ~(1 << PB4);
+        }
+        return;
+    }
+
+    uint16_t ocr = ((uint32_t)duty * ((uint32_t)pwm_top1 + 1)) >> 10;
+    if (channel == PWM_CH_OC1A) OCR1A = ocr;
+    else if (channel == PWM_CH_OC1B) OCR1B = ocr;
+    else OCR1C = ocr;
+    if (duty) TCCR1A |= com;
+    else TCCR1A &= ~com;
+}
+
+// Level (0-255) to 10-bit duty through the channel curve
+static uint16_t pwm_curve(PwmChannel_t channel, uint8_t level) {
+    if (pwm_ramp[channel].curve == PWM_CURVE_GAMMA) return pgm_read_word(&pwm_gamma[level]);
+    return ((uint16_t)level << 2) | (level >> 6);
+}
+
+// Advance the ramps of the channels on one timer (bottom half, interrupts enabled): the
+// arithmetic runs open, the register writes are atomic against the other interrupts
+static void pwm_ramp_tick(uint8_t first, uint8_t last) {
+    for (uint8_t ch = first; ch <= last; ch++) {
+        PwmRamp_t *r = &pwm_ramp[ch];
+        if (!r->ticks) continue;
+        r->level += r->step;
+        if (--r->ticks == 0) r->level = (uint32_t)r->target << 16;     // Land exactly
+        uint16_t duty = pwm_curve(ch, r->level >> 16);
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            pwm_write(ch, duty);
+        }
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pwm_update_irq();
+    }
+}
+
+// The ramp ticks that came due on a timer, one after the other
+static void pwm_ramp_run(uint8_t timer, uint8_t first, uint8_t last) {
+    while (pwm_ramp_due[timer]) {
+        pwm_ramp_tick(first, last);
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            pwm_ramp_due[timer]--;
+        }
+    }
+}
+
+static void pwm_ramp_timer0(void) {
+    pwm_ramp_run(PWM_TIMER0, pwm_oc0_owner, pwm_oc0_owner);
+}
+
+static void pwm_ramp_timer1(void) {
+    pwm_ramp_run(PWM_TIMER1, PWM_CH_OC1A, PWM_CH_OC1C);
+}
+
+// Count a ramp tick and queue the bottom half if none is waiting (a full queue drops it)
+static void pwm_ramp_due_tick(uint8_t timer, IrqWork_t work) {
+    if (pwm_ramp_due[timer]++ == 0 && !IrqDefer(work)) pwm_ramp_due[timer] = 0;
+}
+
+IRQ_LOW(TIMER0_OVF_vect) {
+    // Dither the two low duty bits over four periods (OCR0 is double-buffered)
+    uint8_t ocr = pwm_oc0_base;
+    pwm_oc0_acc += pwm_oc0_frac;
+    if (pwm_oc0_acc >= 4) {
+        pwm_oc0_acc -= 4;
+        if (ocr != 0xFF) ocr++;
+    }
+    OCR0 = ocr;
+
+    if (++pwm_div_count[PWM_TIMER0] >= pwm_divider[PWM_TIMER0]) {
+        pwm_div_count[PWM_TIMER0] = 0;
+        pwm_ramp_due_tick(PWM_TIMER0, pwm_ramp_timer0);
+    }
+}
+
+IRQ_LOW(TIMER1_OVF_vect) {
+    if (++pwm_div_count[PWM_TIMER1] >= pwm_divider[PWM_TIMER1]) {
+        pwm_div_count[PWM_TIMER1] = 0;
+        pwm_ramp_due_tick(PWM_TIMER1, pwm_ramp_timer1);
+    }
+}
+
+// Pick the overflow divider that brings the ramp tick closest to PWM_RAMP_HZ
+static void pwm_set_ramp_rate(uint8_t timer, uint32_t pwm_hz) {
+    uint32_t divider = (pwm_hz + PWM_RAMP_HZ / 2) / PWM_RAMP_HZ;
+
+    if (divider == 0) divider = 1;
+    if (divider > 255) divider = 255;
+    pwm_divider[timer] = divider;
+    pwm_ramp_hz[timer] = pwm_hz / divider;
+    if (pwm_ramp_hz[timer] == 0) pwm_ramp_hz[timer] = 1;
+}
+
+/**
+ * @brief Configure a channel's timer and enable its output.
+ * @param channel PWM channel.
+ * @param freq_hz Requested PWM frequency in Hz.
+ * @return Actual PWM frequency in Hz.
+ */
+uint32_t PwmInit(PwmChannel_t channel, uint32_t freq_hz) {
+    uint32_t actual;
+    uint8_t cs;
+
+    if (channel >= PWM_CHANNELS || freq_hz == 0) return 0;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pwm_ramp[channel].ticks = 0;
+        pwm_ramp[channel].level = 0;
+        pwm_ramp[channel].target = 0;
+        pwm_ramp[channel].curve = (channel == PWM_CH_LED) ? PWM_CURVE_GAMMA : PWM_CURVE_LINEAR;
+
+        if (channel <= PWM_CH_MOTOR) {
+            // Fixed 256-count period: first prescaler that doesn't exceed the request
+            for (cs = 0; cs < sizeof(pwm_prescalers0) / sizeof(pwm_prescalers0[0]) - 1; cs++) {
+                if (F_CPU / (256UL * pgm_read_word(&pwm_prescalers0[cs])) <= freq_hz) break;
+            }
+            actual = F_CPU / (256UL * pgm_read_word(&pwm_prescalers0[cs]));
+
+            // The other PB4 channel gives up the pin
+            pwm_ramp[channel == PWM_CH_LED ? PWM_CH_MOTOR : PWM_CH_LED].ticks = 0;
+            pwm_oc0_owner = channel;
+
+            ASSR &= ~(1 << AS0);                                        // Clocked from the I/O clock
+            TCCR0 = (1 << WGM01) | (1 << WGM00) | (cs + 1);             // Fast PWM, output off until duty > 0
+            DDRB |= (1 << PB4);
+        } else {
+            // Smallest prescaler whose TOP fits in 16 bits gives the finest resolution
+            for (cs = 0; cs < sizeof(pwm_prescalers1) / sizeof(pwm_prescalers1[0]) - 1; cs++) {
+                if (F_CPU / ((uint32_t)pgm_read_word(&pwm_prescalers1[cs]) * freq_hz) <= 0x10000UL) break;
+            }
+            uint32_t top = F_CPU / ((uint32_t)pgm_read_word(&pwm_prescalers1[cs]) * freq_hz);
+            if (top > 0x10000UL) top = 0x10000UL;
+            if (top < 4) top = 4;
+            pwm_top1 = top - 1;
+            actual = F_CPU / ((uint32_t)pgm_read_word(&pwm_prescalers1[cs]) * top);
+
+            TCCR1A = (TCCR1A & ((1 << COM1A1) | (1 << COM1B1) | (1 << COM1C1))) | (1 << WGM11);
+            TCCR1B = (1 << WGM13) | (1 << WGM12) | (cs + 1);             // Fast PWM, TOP = ICR1
+            ICR1 = pwm_top1;
+            uint8_t pin = PB5 + (channel - PWM_CH_OC1A);
+            DDRB |= (1 << pin);
+            PORTB &= ~(1 << pin);
+        }
+
+        pwm_set_ramp_rate(pwm_timer(channel), actual);
+        pwm_write(channel, 0);
+        pwm_update_irq();
+    }
+    return actual;
+}
+
+/**
+ * @brief Stop a channel: cancel its ramp and switch the load off.
+ * @param channel PWM channel.
+ */
+void PwmStop(PwmChannel_t channel) {
+    PwmSetDuty10(channel, 0);
+}
+
+/**
+ * @brief Select how levels map to duty for PwmSetLevel() and PwmFade().
+ * @param channel PWM channel.
+ * @param curve PWM_CURVE_LINEAR or PWM_CURVE_GAMMA.
+ */
+void PwmSetCurve(PwmChannel_t channel, PwmCurve_t curve) {
+    if (channel >= PWM_CHANNELS) return;
+    pwm_ramp[channel].curve = curve;
+}
+
+/**
+ * @brief Set an 8-bit duty cycle (0 = off, 255 = fully on).
+ * @param channel PWM channel.
+ * @param duty Duty cycle.
+ */
+void PwmSetDuty8(PwmChannel_t channel, uint8_t duty) {
+    PwmSetDuty10(channel, ((uint16_t)duty << 2) | (duty >> 6));
+}
+
+/**
+ * @brief Set a 10-bit duty cycle (0 = off, 1023 = fully on).
+ * @param channel PWM channel.
+ * @param duty Duty cycle (values above 1023 are clamped).
+ */
+void PwmSetDuty10(PwmChannel_t channel, uint16_t duty) {
+    if (channel >= PWM_CHANNELS) return;
+    if (duty > PWM_DUTY_MAX) duty = PWM_DUTY_MAX;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pwm_ramp[channel].ticks = 0;
+        pwm_ramp[channel].target = duty >> 2;
+        pwm_ramp[channel].level = (uint32_t)pwm_ramp[channel].target << 16;
+        pwm_write(channel, duty);
+        pwm_update_irq();
+    }
+}
+
+/**
+ * @brief Set a level through the channel curve.
+ * @param channel PWM channel.
+ * @param level Level 0-255.
+ */
+void PwmSetLevel(PwmChannel_t channel, uint8_t level) {
+    PwmFade(channel, level, 0);
+}
+
+/**
+ * @brief Ramp linearly from the current level to a new one in the background.
+ * @param channel PWM channel.
+ * @param level Target level 0-255.
+ * @param duration_ms Ramp time in milliseconds (0 sets the level at once).
+ */
+void PwmFade(PwmChannel_t channel, uint8_t level, uint16_t duration_ms) {
+    if (channel >= PWM_CHANNELS) return;
+
+    PwmRamp_t *r = &pwm_ramp[channel];
+    uint32_t ticks = ((uint32_t)duration_ms * pwm_ramp_hz[pwm_timer(channel)]) / 1000;
+    if (ticks > 0xFFFF) ticks = 0xFFFF;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r->target = level;
+        if (ticks == 0) {
+            r->ticks = 0;
+            r->level = (uint32_t)level << 16;
+            pwm_write(channel, pwm_curve(channel, level));
+        } else {
+            // The only division of the ramp, done once here
+            r->step = (((int32_t)level << 16) - (int32_t)r->level) / (int32_t)ticks;
+            r->ticks = ticks;
+        }
+        pwm_update_irq();
+    }
+}
+
+/**
+ * @brief Check if a ramp is still running.
+ * @param channel PWM channel.
+ * @return true while the channel is fading.
+ */
+bool PwmIsFading(PwmChannel_t channel) {
+    bool fading;
+    if (channel >= PWM_CHANNELS) return false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        fading = pwm_ramp[channel].ticks != 0;
+    }
+    return fading;
+}
+
+/**
+ * @brief Current level of a channel (follows a running ramp).
+ * @param channel PWM channel.
+ * @return Level 0-255.
+ */
+uint8_t PwmGetLevel(PwmChannel_t channel) {
+    uint8_t level;
+    if (channel >= PWM_CHANNELS) return 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        level = pwm_ramp[channel].level >> 16;
+    }
+    return level;
+}
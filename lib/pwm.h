@@ -0,0 +1,131 @@
+/**
+ * @file pwm.h
+ * @brief Hardware PWM for the PWM LED, the J6 DC motor and the Timer1 compare outputs.
+ * @details The PWM LED (D9) and the J6 motor (ULN2003 IN7) are both on PB4 / OC0, driven
+ *          by Timer0 in fast PWM mode. D9 is wired from VCC to PB4 (on while the pin is LOW)
+ *          and the motor runs while the pin is HIGH, so they are two channels with opposite
+ *          polarity on the same output; the last one passed to PwmInit() owns the pin.
+ *          OC1A-OC1C (PB5-PB7) share Timer1 in fast PWM mode with ICR1 as TOP, so their
+ *          frequency can be set freely.
+ *
+ *          Duties are 10-bit everywhere and always mean "fraction of time the load is on".
+ *          Timer0 only has 8 bits, so the two extra bits on OC0 are dithered over four PWM
+ *          periods by the overflow interrupt. The pin is on for OCR0 + 1 counts, so OCR0 is
+ *          duty / 4 - 1; duties below 4 (one count) leave OC0 disconnected, i.e. off.
+ *
+ *          Fades and ramps are ticked by the timer overflow interrupt (about 1 kHz ramp
+ *          tick, independent of the PWM frequency), so the main loop only starts them. The
+ *          interrupt only counts the tick; the ramp arithmetic runs in the bottom half
+ *          (irq.h) with interrupts enabled, so it doesn't hold up the IRQ_HIGH sources.
+ *          The ramp works on an 8-bit level that is mapped to the duty through the channel
+ *          curve: PWM_CURVE_GAMMA (PROGMEM gamma 2.2 table, for LEDs) or PWM_CURVE_LINEAR
+ *          (motors).
+ *
+ * @note Timer3 is the shared timebase (timebase.h) and is not available for PWM.
+ *       PB5-PB7 are also the LCD control lines (J14/J16).
+ */
+
+#ifndef PWM_H
+#define PWM_H
+
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// PWM channels
+typedef enum {
+    PWM_CH_LED = 0,   ///< PB4 / OC0, Timer0, PWM LED D9 (active LOW)
+    PWM_CH_MOTOR,     ///< PB4 / OC0, Timer0, DC motor on J6 (active HIGH)
+    PWM_CH_OC1A,      ///< PB5, Timer1
+    PWM_CH_OC1B,      ///< PB6, Timer1
+    PWM_CH_OC1C,      ///< PB7, Timer1
+    PWM_CHANNELS
+} PwmChannel_t;
+
+#define PWM_LED     PWM_CH_LED      ///< PWM LED D9
+#define PWM_MOTOR   PWM_CH_MOTOR    ///< DC motor on J6 (same pin as the LED)
+
+#define PWM_DUTY_MAX    1023    ///< Full scale of a 10-bit duty
+
+// Level-to-duty mapping used by PwmSetLevel() and PwmFade()
+typedef enum {
+    PWM_CURVE_LINEAR = 0,   ///< duty = level * 1023 / 255
+    PWM_CURVE_GAMMA = 1     ///< Perceptually linear brightness (gamma 2.2)
+} PwmCurve_t;
+
+/**
+ * @brief Configure a channel's timer and enable its output.
+ * @param channel PWM channel.
+ * @param freq_hz Requested PWM frequency in Hz.
+ * @return Actual PWM frequency in Hz.
+ * @note Timer0 has a fixed 256-step period, so the PB4 channels get the closest prescaler
+ *       at or below freq_hz (31.25 kHz down to 30 Hz at 8 MHz). The OC1x channels share one
+ *       frequency; the last PwmInit() call on any of them sets it for all three.
+ *       The output starts off, with PWM_CURVE_GAMMA on the LED and PWM_CURVE_LINEAR elsewhere.
+ *       Fades need interrupts enabled (sei()).
+ */
+uint32_t PwmInit(PwmChannel_t channel, uint32_t freq_hz);
+
+/**
+ * @brief Stop a channel: cancel its ramp and switch the load off.
+ * @param channel PWM channel.
+ */
+void PwmStop(PwmChannel_t channel);
+
+/**
+ * @brief Select how levels map to duty for PwmSetLevel() and PwmFade().
+ * @param channel PWM channel.
+ * @param curve PWM_CURVE_LINEAR or PWM_CURVE_GAMMA.
+ */
+void PwmSetCurve(PwmChannel_t channel, PwmCurve_t curve);
+
+/**
+ * @brief Set an 8-bit duty cycle (0 = off, 255 = fully on).
+ * @param channel PWM channel.
+ * @param duty Duty cycle.
+ * @note Cancels a running ramp on the channel.
+ */
+void PwmSetDuty8(PwmChannel_t channel, uint8_t duty);
+
+/**
+ * @brief Set a 10-bit duty cycle (0 = off, 1023 = fully on).
+ * @param channel PWM channel.
+ * @param duty Duty cycle (values above 1023 are clamped).
+ * @note Cancels a running ramp on the channel.
+ */
+void PwmSetDuty10(PwmChannel_t channel, uint16_t duty);
+
+/**
+ * @brief Set a level through the channel curve.
+ * @param channel PWM channel.
+ * @param level Level 0-255 (brightness on gamma channels, speed on linear ones).
+ * @note Cancels a running ramp on the channel.
+ */
+void PwmSetLevel(PwmChannel_t channel, uint8_t level);
+
+/**
+ * @brief Ramp linearly from the current level to a new one in the background.
+ * @param channel PWM channel.
+ * @param level Target level 0-255.
+ * @param duration_ms Ramp time in milliseconds (0 sets the level at once).
+ * @note On a gamma channel this is a perceptually even fade; on a linear channel it is
+ *       a motor soft-start/soft-stop.
+ * @example PwmFade(PWM_MOTOR, 200, 1500); // Soft-start the J6 motor over 1.5 s
+ */
+void PwmFade(PwmChannel_t channel, uint8_t level, uint16_t duration_ms);
+
+/**
+ * @brief Check if a ramp is still running.
+ * @param channel PWM channel.
+ * @return true while the channel is fading.
+ */
+bool PwmIsFading(PwmChannel_t channel);
+
+/**
+ * @brief Current level of a channel (follows a running ramp).
+ * @param channel PWM channel.
+ * @return Level 0-255.
+ */
+uint8_t PwmGetLevel(PwmChannel_t channel);
+
+#endif // PWM_H
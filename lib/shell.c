@@ -0,0 +1,356 @@
+/**
+ * @file shell.c
+ * @brief Line-oriented command shell on USART0 (the RS232 port) for inspecting and tuning
+ *        a running program: registers, driver statistics and run-time parameters.
+ */
+
+#include "shell.h"
+#include "uart.h"
+#include <avr/io.h>
+#include <string.h>
+
+#define SHELL_PROMPT    "> "
+#define SHELL_PEEK_ROW  8       // Bytes per peek line (one step)
+#define SHELL_PEEK_MAX  256     // Bytes per peek command
+#define SHELL_REGS_END  0x1F    // r0-r31 are at data addresses 0x00-0x1F: not poked
+
+static bool shell_help(uint8_t argc, char *argv[], uint8_t step);
+static bool shell_peek(uint8_t argc, char *argv[], uint8_t step);
+static bool shell_poke(uint8_t argc, char *argv[], uint8_t step);
+static bool shell_get(uint8_t argc, char *argv[], uint8_t step);
+static bool shell_set(uint8_t argc, char *argv[], uint8_t step);
+static bool shell_stats(uint8_t argc, char *argv[], uint8_t step);
+
+static const ShellCommand_t shell_builtins[] PROGMEM = {
+    { "help",  shell_help,  "list the commands" },
+    { "peek",  shell_peek,  "<addr> [n]  read memory" },
+    { "poke",  shell_poke,  "<addr> <byte>  write memory" },
+    { "get",   shell_get,   "[name]  show parameters" },
+    { "set",   shell_set,   "<name> <value>  change one" },
+    { "stats", shell_stats, "show the statistics" },
+    { "" }
+};
+
+#define SHELL_BUILTINS  (sizeof(shell_builtins) / sizeof(shell_builtins[0]) - 1)
+
+// Global variables
+static const ShellCommand_t *shell_commands;    // Application table (flash)
+static const ShellParam_t *shell_params;        // Parameter table (flash)
+static char shell_line[SHELL_LINE];
+static uint8_t shell_length;
+static bool shell_cr;                           // Last character was a CR: skip an LF
+static char *shell_argv[SHELL_ARGS];
+static uint8_t shell_argc;
+static const ShellCommand_t *shell_current;     // Command running (flash)
+static ShellHandler_t shell_handler;            // Its handler, NULL while reading a line
+static uint8_t shell_step;
+
+static void shell_puts_P(PGM_P s) {
+    char c;
+    while ((c = pgm_read_byte(s++))) UartPutc(c);
+}
+
+static void shell_newline(void) {
+    UartPuts("\r\n");
+}
+
+// "? <word>" for an unknown command or parameter
+static void shell_unknown(const char *word) {
+    UartPuts("? ");
+    UartPuts(word);
+    shell_newline();
+}
+
+// "usage: <command> <help>" for the command running
+static void shell_usage(void) {
+    shell_puts_P(PSTR("usage: "));
+    shell_puts_P(shell_current->name);
+    UartPutc(' ');
+    shell_puts_P(shell_current->help);
+    shell_newline();
+}
+
+static const ShellCommand_t *shell_find(const ShellCommand_t *table, const char *name) {
+    for (; table && pgm_read_byte(&table->name[0]); table++) {
+        if (!strcmp_P(name, table->name)) return table;
+    }
+    return NULL;
+}
+
+static const ShellParam_t *shell_find_param(const char *name) {
+    for (const ShellParam_t *p = shell_params; p && pgm_read_byte(&p->name[0]); p++) {
+        if (!strcmp_P(name, p->name)) return p;
+    }
+    return NULL;
+}
+
+// "<name> <value>"
+static void shell_show_param(const ShellParam_t *p) {
+    uint32_t (*get)(void);
+    memcpy_P(&get, &p->get, sizeof(get));
+    shell_puts_P(p->name);
+    UartPutc(' ');
+    ShellPrintUint(get());
+    shell_newline();
+}
+
+// One parameter per step, the writable ones or the read-only ones
+static bool shell_list(uint8_t step, bool writable) {
+    if (!shell_params) return false;
+    const ShellParam_t *p = &shell_params[step];
+    if (!pgm_read_byte(&p->name[0])) return false;
+    if ((pgm_read_ptr(&p->set) != NULL) == writable) shell_show_param(p);
+    return pgm_read_byte(&p[1].name[0]) != 0;
+}
+
+// help: one command per step, the built-in ones first
+static bool shell_help(uint8_t argc, char *argv[], uint8_t step) {
+    (void)argc;
+    (void)argv;
+    const ShellCommand_t *c;
+    if (step < SHELL_BUILTINS) c = &shell_builtins[step];
+    else if (shell_commands) c = &shell_commands[step - SHELL_BUILTINS];
+    else return false;
+    if (!pgm_read_byte(&c->name[0])) return false;
+
+    uint8_t length = strlen_P(c->name);
+    shell_puts_P(c->name);
+    do UartPutc(' '); while (++length < 8);
+    shell_puts_P(c->help);
+    shell_newline();
+    if (step + 1 < SHELL_BUILTINS) return true;
+    if (step + 1 == SHELL_BUILTINS) c = shell_commands;
+    else c++;
+    return c && pgm_read_byte(&c->name[0]);
+}
+
+// An address in data space and the byte count from it; false after the usage line
+static bool shell_range(char *addr, char *count, uint32_t *start, uint32_t *n) {
+    *n = 1;
+    if (!ShellParseUint(addr, start) || (count && !ShellParseUint(count, n)) ||
+        *n == 0 || *n > SHELL_PEEK_MAX || *start + *n - 1 > RAMEND) {
+        shell_usage();
+        return false;
+    }
+    return true;
+}
+
+// peek: SHELL_PEEK_ROW bytes per step, "<addr>: xx xx ..."
+static bool shell_peek(uint8_t argc, char *argv[], uint8_t step) {
+    uint32_t start, n;
+    if (argc < 2 || argc > 3) {
+        shell_usage();
+        return false;
+    }
+    if (!shell_range(argv[1], argc == 3 ? argv[2] : NULL, &start, &n)) return false;
+
+    uint16_t offset = (uint16_t)step * SHELL_PEEK_ROW;
+    uint16_t addr = start + offset;
+    ShellPrintHex(addr, 4);
+    UartPutc(':');
+    for (uint8_t i = 0; i < SHELL_PEEK_ROW && offset + i < n; i++) {
+        UartPutc(' ');
+        ShellPrintHex(_SFR_MEM8(addr + i), 2);
+    }
+    shell_newline();
+    return offset + SHELL_PEEK_ROW < n;
+}
+
+// poke: one byte; the CPU registers are left alone
+static bool shell_poke(uint8_t argc, char *argv[], uint8_t step) {
+    uint32_t addr, value, n;
+    (void)step;
+    if (argc != 3) {
+        shell_usage();
+        return false;
+    }
+    if (!shell_range(argv[1], NULL, &addr, &n)) return false;
+    if (addr <= SHELL_REGS_END || !ShellParseUint(argv[2], &value) || value > 0xFF) {
+        shell_usage();
+        return false;
+    }
+    _SFR_MEM8(addr) = value;
+    return false;
+}
+
+// get: one parameter, or every writable one (one per step)
+static bool shell_get(uint8_t argc, char *argv[], uint8_t step) {
+    if (argc == 1) return shell_list(step, true);
+    if (argc != 2) {
+        shell_usage();
+        return false;
+    }
+    const ShellParam_t *p = shell_find_param(argv[1]);
+    if (p) shell_show_param(p);
+    else shell_unknown(argv[1]);
+    return false;
+}
+
+// set: change a parameter and show the value that took effect
+static bool shell_set(uint8_t argc, char *argv[], uint8_t step) {
+    uint32_t value;
+    (void)step;
+    if (argc != 3 || !ShellParseUint(argv[2], &value)) {
+        shell_usage();
+        return false;
+    }
+    const ShellParam_t *p = shell_find_param(argv[1]);
+    if (!p) {
+        shell_unknown(argv[1]);
+        return false;
+    }
+    uint32_t (*set)(uint32_t);
+    memcpy_P(&set, &p->set, sizeof(set));
+    if (!set) {
+        shell_puts_P(PSTR("read-only\r\n"));
+        return false;
+    }
+    value = set(value);
+    shell_puts_P(p->name);
+    UartPutc(' ');
+    ShellPrintUint(value);
+    shell_newline();
+    return false;
+}
+
+// stats: the read-only parameters, one per step
+static bool shell_stats(uint8_t argc, char *argv[], uint8_t step) {
+    (void)argc;
+    (void)argv;
+    return shell_list(step, false);
+}
+
+// Split the line into words in place and look up the command
+static void shell_start(void) {
+    char *p = shell_line;
+
+    shell_line[shell_length] = '\0';
+    shell_length = 0;
+    shell_argc = 0;
+    while (*p) {
+        if (*p == ' ') {
+            *p++ = '\0';
+            continue;
+        }
+        if (shell_argc == SHELL_ARGS) {
+            shell_puts_P(PSTR("too many words\r\n"));
+            shell_puts_P(PSTR(SHELL_PROMPT));
+            return;
+        }
+        shell_argv[shell_argc++] = p;
+        while (*p && *p != ' ') p++;
+    }
+    if (!shell_argc) {
+        shell_puts_P(PSTR(SHELL_PROMPT));
+        return;
+    }
+
+    const ShellCommand_t *c = shell_find(shell_commands, shell_argv[0]);
+    if (!c) c = shell_find(shell_builtins, shell_argv[0]);
+    if (!c) {
+        shell_unknown(shell_argv[0]);
+        shell_puts_P(PSTR(SHELL_PROMPT));
+        return;
+    }
+    shell_current = c;
+    memcpy_P(&shell_handler, &c->handler, sizeof(shell_handler));
+    shell_step = 0;
+}
+
+/**
+ * @brief Start the shell and print the prompt.
+ */
+void ShellInit(const ShellCommand_t *commands, const ShellParam_t *params) {
+    shell_commands = commands;
+    shell_params = params;
+    shell_length = 0;
+    shell_cr = false;
+    shell_handler = NULL;
+    shell_newline();
+    shell_puts_P(PSTR(SHELL_PROMPT));
+}
+
+/**
+ * @brief Take typed characters and run a step of the current command.
+ */
+bool ShellPoll(void) {
+    uint8_t c;
+
+    if (shell_handler) {
+        if (UartTxSpace() < SHELL_STEP_OUT) return false;
+        if (!shell_handler(shell_argc, shell_argv, shell_step++)) {
+            shell_handler = NULL;
+            shell_puts_P(PSTR(SHELL_PROMPT));
+        }
+        return true;
+    }
+
+    // Room for the longest echo ("\b \b")
+    while (UartTxSpace() >= 3 && UartGetc(&c)) {
+        bool after_cr = shell_cr;
+        shell_cr = (c == '\r');
+        if (c == '\r' || c == '\n') {
+            if (c == '\n' && after_cr) continue;
+            shell_newline();
+            shell_start();
+            break;                              // The command starts at the next poll
+        } else if (c == '\b' || c == 0x7F) {
+            if (shell_length) {
+                shell_length--;
+                UartPuts("\b \b");
+            }
+        } else if (c >= ' ' && c < 0x7F) {
+            if (shell_length < SHELL_LINE - 1) {
+                shell_line[shell_length++] = c;
+                UartPutc(c);
+            } else {
+                UartPutc('\a');
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Read a number argument: decimal or 0x hex.
+ */
+bool ShellParseUint(const char *s, uint32_t *value) {
+    uint8_t base = 10;
+    uint32_t v = 0;
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    }
+    if (!*s) return false;
+    for (; *s; s++) {
+        uint8_t d;
+        if (*s >= '0' && *s <= '9') d = *s - '0';
+        else if (base == 16 && (*s | 0x20) >= 'a' && (*s | 0x20) <= 'f') d = (*s | 0x20) - 'a' + 10;
+        else return false;
+        if (v > (UINT32_MAX - d) / base) return false;
+        v = v * base + d;
+    }
+    *value = v;
+    return true;
+}
+
+/**
+ * @brief Print an unsigned number in decimal.
+ */
+void ShellPrintUint(uint32_t value) {
+    char digits[10];
+    uint8_t n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n) UartPutc(digits[--n]);
+}
+
+/**
+ * @brief Print a number in hex, with leading zeros.
+ */
+void ShellPrintHex(uint32_t value, uint8_t digits) {
+    while (digits--) UartPutc("0123456789abcdef"[(value >> (4 * digits)) & 0x0F]);
+}
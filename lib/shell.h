@@ -0,0 +1,125 @@
+/**
+ * @file shell.h
+ * @brief Line-oriented command shell on USART0 (the RS232 port) for inspecting and tuning
+ *        a running program: registers, driver statistics and run-time parameters.
+ * @details Commands and parameters are tables in flash, chosen by the application:
+ *
+ *              static bool cmd_beep(uint8_t argc, char *argv[], uint8_t step) {
+ *                  BuzzerBeep(100);
+ *                  return false;                       // Done
+ *              }
+ *              static const ShellCommand_t commands[] PROGMEM = {
+ *                  { "beep", cmd_beep, "sound the buzzer" },
+ *                  { "" }
+ *              };
+ *              ...
+ *              UartInit(0);
+ *              ShellInit(commands, ShellLibraryParams);
+ *              sei();
+ *              while (1) {
+ *                  ...                                 // Display, keys, TWI first
+ *                  ShellPoll();
+ *              }
+ *
+ *          Built in: help, peek <addr> [n], poke <addr> <byte> (data-space addresses as in
+ *          the register summary of the datasheet, e.g. 0x3b for PORTA), get [name],
+ *          set <name> <value>, and stats (the read-only parameters). Numbers are decimal or
+ *          0x hex. A parameter is a getter and a setter; the setter returns the value that
+ *          took effect, so `set refresh 100` answers `refresh 98`. ShellLibraryParams
+ *          (shell_params.c) has the library's: the clock divider, the display refresh rate,
+ *          the TWI speed, the keypad scan period and debounce, and the driver statistics.
+ *          It links the drivers it names; a project without some of them lists its own.
+ *
+ *          The shell never takes the CPU for long: ShellPoll() returns at once when nothing
+ *          was typed, reads and echoes what is queued (UartGetc()), and runs a complete
+ *          line one step at a time. A step is a call of the command's handler with
+ *          step = 0, 1, 2 ... for as long as it returns true, and it only starts when the
+ *          text queue has room for SHELL_STEP_OUT characters, so its output never waits
+ *          for the line (help and get print one entry per step, peek 8 bytes). While a
+ *          command runs, typed characters stay in the receive queue. No heap: the line is
+ *          split into argv in place in its own buffer.
+ *
+ * @note Call ShellPoll() from the main loop, after the time-critical work. peek reads with
+ *       the side effects of a read (UDR0 takes a received byte, TIFR bits stay). The
+ *       application's commands are looked up before the built-in ones.
+ */
+
+#ifndef SHELL_H
+#define SHELL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/pgmspace.h>
+
+#ifndef SHELL_LINE
+#define SHELL_LINE          48      ///< Longest command line, with its terminating 0
+#endif
+#define SHELL_ARGS          6       ///< Most words per line, the command included
+#define SHELL_NAME_SIZE     14      ///< Command and parameter names, with the 0
+#define SHELL_HELP_SIZE     32      ///< Help text of a command, with the 0
+#define SHELL_STEP_OUT      48      ///< Room in the text queue a step may fill
+
+/**
+ * @brief Command handler.
+ * @param argc Words on the line, the command included.
+ * @param argv The words (argv[0] is the command); they stay valid for every step.
+ * @param step 0 on the first call, then one more on each further call.
+ * @return true to be called again once the text queue has room, false when done.
+ */
+typedef bool (*ShellHandler_t)(uint8_t argc, char *argv[], uint8_t step);
+
+// Entry of a command table in flash; the table ends with an empty name
+typedef struct {
+    char name[SHELL_NAME_SIZE];
+    ShellHandler_t handler;
+    char help[SHELL_HELP_SIZE];     ///< Arguments and what it does, shown by help
+} ShellCommand_t;
+
+// Entry of a parameter table in flash; the table ends with an empty name
+typedef struct {
+    char name[SHELL_NAME_SIZE];
+    uint32_t (*get)(void);
+    uint32_t (*set)(uint32_t value);    ///< Returns the value in effect; NULL = read-only
+} ShellParam_t;
+
+/// The library's parameters and statistics (shell_params.c)
+extern const ShellParam_t ShellLibraryParams[] PROGMEM;
+/// The same with clockdiv read-only, for programs whose timers don't follow ClockSetDivider()
+extern const ShellParam_t ShellFixedClockParams[] PROGMEM;
+
+/**
+ * @brief Start the shell and print the prompt.
+ * @param commands Application commands in flash, or NULL.
+ * @param params Parameters in flash (e.g. ShellLibraryParams), or NULL.
+ * @note Set up USART0 first (UartInit()).
+ */
+void ShellInit(const ShellCommand_t *commands, const ShellParam_t *params);
+
+/**
+ * @brief Take typed characters and run a step of the current command.
+ * @return true if a step ran.
+ */
+bool ShellPoll(void);
+
+/**
+ * @brief Read a number argument: decimal or 0x hex.
+ * @param s Word.
+ * @param value Destination.
+ * @return false if the word is not a number or is out of range.
+ */
+bool ShellParseUint(const char *s, uint32_t *value);
+
+/**
+ * @brief Print an unsigned number in decimal.
+ * @param value Number.
+ */
+void ShellPrintUint(uint32_t value);
+
+/**
+ * @brief Print a number in hex, with leading zeros.
+ * @param value Number.
+ * @param digits Digits to print (1-8).
+ */
+void ShellPrintHex(uint32_t value, uint8_t digits);
+
+#endif // SHELL_H
@@ -0,0 +1,137 @@
+/**
+ * @file shell_params.c
+ * @brief The library's run-time parameters and statistics for the shell (shell.h).
+ */
+
+#include "shell.h"
+#include "arbiter.h"
+#include "clock.h"
+#include "portd.h"
+#include "stackmon.h"
+#include "telemetry.h"
+#include "timebase.h"
+#include "twi.h"
+#include "uart.h"
+
+static uint32_t param_clockdiv(void) {
+    return ClockDivider();
+}
+
+static uint32_t param_set_clockdiv(uint32_t value) {
+    if (value <= CLOCK_MAX_DIVIDER) ClockSetDivider(value);
+    return ClockDivider();
+}
+
+static uint32_t param_refresh(void) {
+    return ArbRefresh();
+}
+
+static uint32_t param_set_refresh(uint32_t value) {
+    return ArbSetRefresh(value > 0xFF ? 0xFF : value);
+}
+
+static uint32_t param_twi_hz(void) {
+    return TwiSpeed();
+}
+
+static uint32_t param_set_twi_hz(uint32_t value) {
+    return TwiSetSpeed(value);
+}
+
+static uint32_t param_scan_us(void) {
+    return PortdScanPeriod();
+}
+
+static uint32_t param_set_scan_us(uint32_t value) {
+    return PortdSetScanPeriod(value > 0xFFFF ? 0xFFFF : value);
+}
+
+static uint32_t param_debounce(void) {
+    return PortdDebounce();
+}
+
+static uint32_t param_set_debounce(uint32_t value) {
+    return PortdSetDebounce(value > 0xFF ? 0xFF : value);
+}
+
+static uint32_t param_arb_isr_us(void) {
+    return TimebaseMicros(ArbMaxIsrTicks());
+}
+
+static uint32_t param_arb_late(void) {
+    return ArbLateEvents();
+}
+
+static uint32_t param_scans(void) {
+    PortdStats_t stats;
+    PortdGetStats(&stats);
+    return stats.scans;
+}
+
+static uint32_t param_scan_defer(void) {
+    PortdStats_t stats;
+    PortdGetStats(&stats);
+    return stats.deferred;
+}
+
+static uint32_t param_scan_late_us(void) {
+    PortdStats_t stats;
+    PortdGetStats(&stats);
+    return stats.max_late_us;
+}
+
+static uint32_t param_scan_max_us(void) {
+    PortdStats_t stats;
+    PortdGetStats(&stats);
+    return stats.max_scan_us;
+}
+
+static uint32_t param_uart_overrun(void) {
+    return UartOverruns();
+}
+
+static uint32_t param_telem_recs(void) {
+    TelemStats_t stats;
+    TelemGetStats(&stats);
+    return stats.records;
+}
+
+static uint32_t param_telem_drop(void) {
+    TelemStats_t stats;
+    TelemGetStats(&stats);
+    return stats.dropped;
+}
+
+static uint32_t param_stack_free(void) {
+    return StackFree();
+}
+
+// The rows both tables share: the other tunables and the statistics
+#define SHELL_LIBRARY_ROWS \
+    { "refresh",      param_refresh,      param_set_refresh }, \
+    { "twi_hz",       param_twi_hz,       param_set_twi_hz }, \
+    { "scan_us",      param_scan_us,      param_set_scan_us }, \
+    { "debounce",     param_debounce,     param_set_debounce }, \
+    { "arb_isr_us",   param_arb_isr_us,   NULL }, \
+    { "arb_late",     param_arb_late,     NULL }, \
+    { "scans",        param_scans,        NULL }, \
+    { "scan_defer",   param_scan_defer,   NULL }, \
+    { "scan_late_us", param_scan_late_us, NULL }, \
+    { "scan_max_us",  param_scan_max_us,  NULL }, \
+    { "uart_overrun", param_uart_overrun, NULL }, \
+    { "telem_recs",   param_telem_recs,   NULL }, \
+    { "telem_drop",   param_telem_drop,   NULL }, \
+    { "stack_free",   param_stack_free,   NULL }
+
+const ShellParam_t ShellLibraryParams[] PROGMEM = {
+    { "clockdiv",     param_clockdiv,     param_set_clockdiv },
+    SHELL_LIBRARY_ROWS,
+    { "" }
+};
+
+// clockdiv read-only, for programs whose timers don't follow a clock change
+const ShellParam_t ShellFixedClockParams[] PROGMEM = {
+    { "clockdiv",     param_clockdiv,     NULL },
+    SHELL_LIBRARY_ROWS,
+    { "" }
+};
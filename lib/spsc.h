@@ -0,0 +1,123 @@
+/**
+ * @file spsc.h
+ * @brief Lock-free single-producer/single-consumer queue for passing data between an
+ *        interrupt and the main loop.
+ * @details SPSC_QUEUE(Name, type, size) declares a queue type Name_t holding `size` items
+ *          of `type` and its functions NamePush(), NamePop(), NamePeek(), NamePushN(),
+ *          NamePopN(), NameCount() and NameSpace(), e.g.
+ *
+ *              SPSC_QUEUE(KeyQueue, uint8_t, 16)
+ *              static KeyQueue_t keys;             // Zeroed = empty
+ *              ISR(...) { KeyQueuePush(&keys, code); }
+ *              while (KeyQueuePop(&keys, &code)) { ... }
+ *
+ *          One side only pushes and the other only pops, e.g. the producer in an
+ *          interrupt and the consumer in the main loop, or the other way round. The head
+ *          index is written by the producer only and the tail by the consumer only; both are
+ *          free-running uint8_t counters, read and written in one instruction on AVR, so
+ *          neither side disables interrupts and no interrupt is delayed. An item is written
+ *          before head moves past it and read before tail releases it (compiler barriers
+ *          keep that order), so the other side never sees a half-copied item, whatever its
+ *          size. `size` is a power of two up to 128, so the index wraps with an AND and
+ *          head - tail is the fill level.
+ *
+ *          Cost at -Os with the queue in a global (constant address), counted from the
+ *          instruction sequence, 1-byte items: NamePush() and NamePop() about 20 cycles
+ *          inlined, 30 as a call from an ISR with its register saves; NamePushN() and
+ *          NamePopN() about 30 cycles plus 9 per item. Larger items add their copy
+ *          (2 cycles per byte).
+ *
+ * @note Two producers (or two consumers) need a lock, e.g. ATOMIC_BLOCK, around their
+ *       calls. The barriers only order the compiler: enough on AVR and on the host (x86)
+ *       for the tests, not on weakly ordered multi-core CPUs.
+ */
+
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Keep the compiler from moving memory accesses across this point
+#define SPSC_BARRIER()  __asm__ __volatile__("" ::: "memory")
+
+/**
+ * @brief Declare a queue type and its functions.
+ * @param Name Prefix of the type (Name_t) and of the functions (NamePush()...).
+ * @param type Item type (any type that can be assigned).
+ * @param size Number of items: 2, 4, 8, 16, 32, 64 or 128.
+ */
+#define SPSC_QUEUE(Name, type, size)                                                        \
+    _Static_assert((size) >= 2 && (size) <= 128 && ((size) & ((size) - 1)) == 0,            \
+                   #Name ": size must be a power of two from 2 to 128");                    \
+                                                                                            \
+    typedef struct {                                                                        \
+        type items[size];                                                                   \
+        volatile uint8_t head;      /* Next slot to write, producer only */                \
+        volatile uint8_t tail;      /* Next slot to read, consumer only */                 \
+    } Name##_t;                                                                             \
+                                                                                            \
+    /* Items waiting (either side) */                                                       \
+    static inline uint8_t Name##Count(const Name##_t *q) {                                  \
+        return (uint8_t)(q->head - q->tail);                                                \
+    }                                                                                       \
+                                                                                            \
+    /* Free slots (either side) */                                                          \
+    static inline uint8_t Name##Space(const Name##_t *q) {                                  \
+        return (size) - (uint8_t)(q->head - q->tail);                                       \
+    }                                                                                       \
+                                                                                            \
+    /* Add an item (producer); false when the queue is full */                             \
+    static inline bool Name##Push(Name##_t *q, type item) {                                 \
+        uint8_t head = q->head;                                                             \
+        if ((uint8_t)(head - q->tail) >= (size)) return false;                              \
+        q->items[head & ((size) - 1)] = item;                                               \
+        SPSC_BARRIER();                                                                     \
+        q->head = head + 1;                                                                 \
+        return true;                                                                        \
+    }                                                                                       \
+                                                                                            \
+    /* Take the oldest item (consumer); false when the queue is empty */                   \
+    static inline bool Name##Pop(Name##_t *q, type *item) {                                 \
+        uint8_t tail = q->tail;                                                             \
+        if (q->head == tail) return false;                                                  \
+        SPSC_BARRIER();                                                                     \
+        *item = q->items[tail & ((size) - 1)];                                              \
+        SPSC_BARRIER();                                                                     \
+        q->tail = tail + 1;                                                                 \
+        return true;                                                                        \
+    }                                                                                       \
+                                                                                            \
+    /* Copy the oldest item without taking it (consumer); false when empty */              \
+    static inline bool Name##Peek(const Name##_t *q, type *item) {                          \
+        uint8_t tail = q->tail;                                                             \
+        if (q->head == tail) return false;                                                  \
+        SPSC_BARRIER();                                                                     \
+        *item = q->items[tail & ((size) - 1)];                                              \
+        return true;                                                                        \
+    }                                                                                       \
+                                                                                            \
+    /* Add up to n items (producer); returns how many fitted, published together */       \
+    static inline uint8_t Name##PushN(Name##_t *q, const type *items, uint8_t n) {          \
+        uint8_t head = q->head;                                                             \
+        uint8_t space = (size) - (uint8_t)(head - q->tail);                                 \
+        if (n > space) n = space;                                                           \
+        for (uint8_t i = 0; i < n; i++) q->items[(uint8_t)(head + i) & ((size) - 1)] = items[i]; \
+        SPSC_BARRIER();                                                                     \
+        q->head = head + n;                                                                 \
+        return n;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    /* Take up to n items (consumer); returns how many were copied */                      \
+    static inline uint8_t Name##PopN(Name##_t *q, type *items, uint8_t n) {                 \
+        uint8_t tail = q->tail;                                                             \
+        uint8_t count = (uint8_t)(q->head - tail);                                          \
+        if (n > count) n = count;                                                           \
+        SPSC_BARRIER();                                                                     \
+        for (uint8_t i = 0; i < n; i++) items[i] = q->items[(uint8_t)(tail + i) & ((size) - 1)]; \
+        SPSC_BARRIER();                                                                     \
+        q->tail = tail + n;                                                                 \
+        return n;                                                                           \
+    }
+
+#endif // SPSC_H
@@ -0,0 +1,43 @@
+#include "stackmon.h"
+
+// Data-space byte (the same access the register macros use)
+#define STACK_RAM(addr)     _SFR_MEM8(addr)
+
+// First address above STACK_FLOOR that no longer holds the canary
+static uint16_t stack_lowest(void) {
+    uint16_t addr = STACK_FLOOR;
+    while (addr <= RAMEND && STACK_RAM(addr) == STACK_CANARY) addr++;
+    return addr;
+}
+
+/**
+ * @brief Fill the RAM between STACK_FLOOR and the stack pointer with STACK_CANARY.
+ */
+void StackMonInit(void) {
+    // SP points at the next free byte: everything up to it is unused
+    uint16_t top = SP;
+    for (uint16_t addr = STACK_FLOOR; addr <= top; addr++) STACK_RAM(addr) = STACK_CANARY;
+}
+
+/**
+ * @brief Deepest stack since StackMonInit().
+ */
+uint16_t StackHighWater(void) {
+    return RAMEND + 1 - stack_lowest();
+}
+
+/**
+ * @brief Smallest free-RAM gap since StackMonInit().
+ */
+uint16_t StackUnused(void) {
+    return stack_lowest() - STACK_FLOOR;
+}
+
+/**
+ * @brief Free-RAM gap right now.
+ */
+uint16_t StackFree(void) {
+    uint16_t sp = SP;
+    uint16_t floor = STACK_FLOOR;
+    return (sp >= floor) ? sp + 1 - floor : 0;
+}
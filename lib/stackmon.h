@@ -0,0 +1,62 @@
+/**
+ * @file stackmon.h
+ * @brief Stack monitor: measures how deep the stack has grown into the free SRAM.
+ * @details The ATmega128 has 4 KB of SRAM: .data and .bss from RAMSTART up, the stack from
+ *          RAMEND down. Nothing stops the stack when it runs into .bss, and the symptoms
+ *          (variables that change on their own, resets) show up far from the cause.
+ *          StackMonInit() fills the free RAM between the end of .bss (or of the malloc()
+ *          heap) and the stack pointer with STACK_CANARY. The stack overwrites the pattern
+ *          as it grows, so the first changed byte marks the deepest point it has reached
+ *          since, including interrupts.
+ *
+ *          `make budget` gives the static side of the same picture: flash and RAM per
+ *          module and the deepest call chain from the compiler's stack usage.
+ *
+ * @note A function that writes STACK_CANARY itself to the bottom of its frame is counted
+ *       short by those bytes; the high-water mark is a measurement, keep some margin.
+ */
+
+#ifndef STACKMON_H
+#define STACKMON_H
+
+#include <avr/io.h>
+#include <stdint.h>
+
+#define STACK_CANARY    0xC5    ///< Fill pattern of the unused RAM
+
+// Lowest address the stack may grow down to: the end of .bss/.noinit (avr-libc linker
+// script), or the top of the heap once malloc() was used
+#ifndef STACK_FLOOR
+extern uint8_t __heap_start;
+extern char *__brkval;
+#define STACK_FLOOR     ((uint16_t)(__brkval ? __brkval : (char *)&__heap_start))
+#endif
+
+/**
+ * @brief Fill the RAM between STACK_FLOOR and the stack pointer with STACK_CANARY.
+ * @note Call first thing in main(); the few bytes used before are not measured.
+ *       Takes about 1.5 ms for 3.5 KB of free RAM at 8 MHz.
+ */
+void StackMonInit(void);
+
+/**
+ * @brief Deepest stack since StackMonInit().
+ * @return Bytes from RAMEND down to the lowest byte the stack has touched.
+ * @note Scans the free RAM from the bottom up, about 0.5 us per unused byte.
+ */
+uint16_t StackHighWater(void);
+
+/**
+ * @brief Smallest free-RAM gap since StackMonInit().
+ * @return Bytes between STACK_FLOOR and the deepest point of the stack; 0 means the
+ *         stack has reached .bss (or the heap) and may have overwritten it.
+ */
+uint16_t StackUnused(void);
+
+/**
+ * @brief Free-RAM gap right now.
+ * @return Bytes between STACK_FLOOR and the stack pointer.
+ */
+uint16_t StackFree(void);
+
+#endif // STACKMON_H
@@ -0,0 +1,70 @@
+#include "startup.h"
+#include "timebase.h"
+#include "delay.h"
+
+// Elapsed ticks since StartupRun() began, extended past the 16-bit wrap by polling
+static uint32_t startup_now;
+static uint16_t startup_last;
+
+static uint32_t startup_clock(void) {
+    uint16_t tick = TimebaseNow();
+    startup_now += (uint16_t)(tick - startup_last);
+    startup_last = tick;
+    return startup_now;
+}
+
+/**
+ * @brief Run start-up tasks until all of them are finished.
+ */
+uint32_t StartupRun(StartupTask_t *tasks, uint8_t count) {
+    uint8_t running = count;
+
+    for (uint8_t i = 0; i < count; i++) {
+        tasks[i].step = 0;
+        tasks[i].due = 0;
+        tasks[i].done_us = STARTUP_DONE;
+    }
+    TimebaseInit();
+    startup_now = 0;
+    startup_last = TimebaseNow();
+
+    // Each pass runs every task whose step is due; the clock is polled well within the
+    // 65 ms wrap because a step only does a few bus transfers
+    while (running) {
+        for (uint8_t i = 0; i < count; i++) {
+            StartupTask_t *task = &tasks[i];
+            if (task->done_us != STARTUP_DONE) continue;
+            if ((int32_t)(startup_clock() - task->due) < 0) continue;
+
+            uint32_t wait = task->run(task->step);
+            if (wait == STARTUP_DONE) {
+                task->done_us = TimebaseMicros(startup_clock());
+                running--;
+                continue;
+            }
+            if (!(wait & STARTUP_REPEAT)) task->step++;
+            wait &= ~STARTUP_REPEAT;
+            task->due = startup_clock() + TimebaseTicks(wait);
+        }
+    }
+    return TimebaseMicros(startup_clock());
+}
+
+/**
+ * @brief Run one start-up task to the end with busy waits.
+ */
+void StartupRunTask(StartupStep_t run) {
+    uint32_t wait;
+    for (uint8_t step = 0; (wait = run(step)) != STARTUP_DONE; ) {
+        if (!(wait & STARTUP_REPEAT)) step++;
+        StartupDelay(wait & ~STARTUP_REPEAT);
+    }
+}
+
+/**
+ * @brief Busy-wait for a run-time number of microseconds.
+ */
+void StartupDelay(uint32_t us) {
+    for (; us > 60000; us -= 60000) DelayMs(60);
+    DelayUs(us);
+}
@@ -0,0 +1,65 @@
+/**
+ * @file startup.h
+ * @brief Start-up sequencer: runs peripheral init routines side by side instead of one
+ *        after the other.
+ * @details Peripheral start-up is mostly waiting (the LCD power-up and the pauses between
+ *          the HD44780 reset commands, an ADC first conversion...). A start-up task is a step
+ *          function that does one short piece of work and returns how long to wait before
+ *          its next step. StartupRun() interleaves the tasks on the Timer3 timebase, so the
+ *          waits overlap and the boot takes as long as the slowest task instead of the sum
+ *          of all of them. Tasks are served in array order, so put the one that gives the
+ *          first visible output (usually the LCD) first.
+ *
+ *          A step function is called with step = 0, 1, 2, ... and returns:
+ *          - the wait in microseconds before the next step (0 = as soon as possible);
+ *          - STARTUP_REPEAT | wait to run the same step again (polling a ready flag);
+ *          - STARTUP_DONE when the task is finished.
+ *
+ *          The blocking init functions (LcdStart(), I2C_LcdStart()...) run the same step
+ *          functions one at a time with StartupRunTask().
+ */
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdint.h>
+
+#define STARTUP_DONE    0xFFFFFFFFUL    ///< Step result: the task is finished
+#define STARTUP_REPEAT  0x80000000UL    ///< Step result flag: run the same step again
+
+// One step of a start-up task, see the file description for the result
+typedef uint32_t (*StartupStep_t)(uint8_t step);
+
+typedef struct {
+    StartupStep_t run;      ///< Step function
+    uint8_t step;           ///< Next step
+    uint32_t due;           ///< Timebase ticks since the start when the next step is due
+    uint32_t done_us;       ///< Microseconds from the start to the end of the task
+} StartupTask_t;
+
+// Task table entry, e.g. StartupTask_t tasks[] = { STARTUP_TASK(LcdStartStep), ... };
+#define STARTUP_TASK(fn)    { (fn), 0, 0, STARTUP_DONE }
+
+/**
+ * @brief Run start-up tasks until all of them are finished.
+ * @param tasks Task table; done_us of each task is set when it finishes.
+ * @param count Number of tasks.
+ * @return Microseconds taken by all tasks together.
+ * @note Starts the timebase (Timer3) if needed. Interrupts may stay enabled, but keep
+ *       interrupt handlers short: a step runs late by the time spent in them.
+ */
+uint32_t StartupRun(StartupTask_t *tasks, uint8_t count);
+
+/**
+ * @brief Run one start-up task to the end with busy waits.
+ * @param run Step function.
+ */
+void StartupRunTask(StartupStep_t run);
+
+/**
+ * @brief Busy-wait for a run-time number of microseconds.
+ * @param us Microseconds (DelayUs() accuracy, delay.h).
+ */
+void StartupDelay(uint32_t us);
+
+#endif // STARTUP_H
@@ -0,0 +1,311 @@
+#include "stepper.h"
+#include "timebase.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#define STEPPER_RAMP_TABLE  16      // Intervals taken from stepper_ramp[]
+#define STEPPER_MIN_LEAD    20      // Ticks needed to enter the interrupt in time
+
+// m = a / f^2 scaled by 2^56, per unit of acceleration
+#define STEPPER_M_SCALE     ((uint32_t)((1ULL << 56) / ((uint64_t)TIMEBASE_HZ * TIMEBASE_HZ)))
+
+// Profile states
+#define STATE_ACCEL   0
+#define STATE_CRUISE  1
+#define STATE_DECEL   2
+
+// Half-step coil patterns (A, AB, B, BC, C, CD, D, DA); full steps use the odd entries
+static const uint8_t stepper_phases[8] PROGMEM = {
+    0x01, 0x03, 0x02, 0x06, 0x04, 0x0C, 0x08, 0x09
+};
+
+// sqrt(n + 1) - sqrt(n) in Q0.16: interval n of a start from rest, relative to the first
+static const uint16_t stepper_ramp[STEPPER_RAMP_TABLE] PROGMEM = {
+    65535, 27146, 20830, 17560, 15471, 13987, 12862, 11972,
+    11244, 10635, 10115,  9665,  9270,  8920,  8607,  8324
+};
+
+// A queued move with its precomputed profile constants
+typedef struct {
+    uint32_t steps;     // Steps to output
+    uint16_t p0;        // First interval in ticks
+    uint16_t pmin;      // Cruise interval in ticks
+    uint32_t m;         // a / f^2 * 2^56
+    int8_t dir;         // +1 or -1
+} StepperMoveCmd_t;
+
+// Global variables
+static StepperMoveCmd_t stepper_queue[STEPPER_QUEUE_SIZE];
+static volatile uint8_t stepper_head;       // Written by StepperMove()
+static volatile uint8_t stepper_tail;       // Written by the interrupt
+static volatile bool stepper_running;       // Interrupt enabled and a move loaded
+static volatile int32_t stepper_position;
+static uint8_t stepper_increment;           // 1 (half step) or 2 (full step)
+static uint8_t stepper_phase;               // Index into stepper_phases[]
+static uint16_t stepper_isr_max;
+static uint16_t stepper_overruns;
+
+// Move being executed (interrupt context only, except StepperStop)
+static StepperMoveCmd_t cur;
+static volatile uint32_t cur_left;          // Steps still to output
+static uint32_t cur_n;                      // Intervals spent accelerating
+static uint32_t cur_p;                      // Current interval, Q16.16 ticks
+static uint8_t cur_state;
+
+// (a * b) >> 32 from three 16x16 multiplies (the low partial product is dropped)
+static uint32_t mul_hi32(uint32_t a, uint32_t b) {
+    uint16_t ah = a >> 16, al = a, bh = b >> 16, bl = b;
+    return (uint32_t)ah * bh + (((uint32_t)ah * bl) >> 16) + (((uint32_t)al * bh) >> 16);
+}
+
+// Relative interval change q = m * p^2 in Q0.32, limited to 0.5
+static uint32_t stepper_q(void) {
+    uint32_t t = mul_hi32(cur.m, mul_hi32(cur_p, cur_p));
+    return (t >= 0x800000UL) ? 0x80000000UL : (t << 8);
+}
+
+// Second-order term 1.5 * q^2 in Q0.32
+static uint32_t stepper_q2(uint32_t q) {
+    uint32_t q2 = mul_hi32(q, q);
+    return q2 + (q2 >> 1);
+}
+
+// Take the next move from the queue (interrupt context)
+static bool stepper_load(void) {
+    uint8_t tail = stepper_tail;
+
+    if (tail == stepper_head) return false;
+    cur = stepper_queue[tail];
+    stepper_tail = (tail + 1) & (STEPPER_QUEUE_SIZE - 1);
+    cur_left = cur.steps;
+    cur_n = 0;
+    cur_p = (uint32_t)cur.p0 << 16;
+    cur_state = STATE_ACCEL;
+    return true;
+}
+
+// Interval to the next step, in Q16.16 ticks
+static void stepper_next_interval(uint32_t left) {
+    if (cur_state != STATE_DECEL && left <= cur_n) {
+        cur_state = STATE_DECEL;
+        if (left == cur_n) return;  // Braking mirrors the ramp: its first interval is the last one
+    }
+
+    if (cur_state == STATE_ACCEL) {
+        if (cur_n < STEPPER_RAMP_TABLE) {
+            cur_p = (uint32_t)cur.p0 * pgm_read_word(&stepper_ramp[cur_n]);
+        } else {
+            uint32_t q = stepper_q();
+            cur_p -= mul_hi32(cur_p, q - stepper_q2(q));
+        }
+        cur_n++;
+        if (cur_p <= ((uint32_t)cur.pmin << 16)) {
+            cur_p = (uint32_t)cur.pmin << 16;
+            cur_state = STATE_CRUISE;
+        }
+    } else if (cur_state == STATE_DECEL) {
+        if (left <= STEPPER_RAMP_TABLE) {
+            uint32_t p = (uint32_t)cur.p0 * pgm_read_word(&stepper_ramp[left - 1]);
+            if (p > cur_p) cur_p = p;   // Never speed up again while braking
+        } else {
+            uint32_t q = stepper_q();
+            uint32_t delta = mul_hi32(cur_p, q + stepper_q2(q));
+            cur_p = (cur_p + delta < cur_p) ? 0xFFFF0000UL : cur_p + delta;
+        }
+    }
+}
+
+ISR(TIMER3_COMPA_vect) {
+    uint16_t start = TCNT3;
+    uint16_t interval;
+
+    // Output the step first so the pulse timing doesn't depend on the math below
+    stepper_phase = (stepper_phase + (cur.dir > 0 ? stepper_increment : -stepper_increment)) & 7;
+    STEPPER_PORT = (STEPPER_PORT & ~STEPPER_MASK) | pgm_read_byte(&stepper_phases[stepper_phase]);
+    stepper_position += cur.dir;
+
+    uint32_t left = cur_left - 1;
+    cur_left = left;
+    if (left == 0) {
+        if (!stepper_load()) {
+            ETIMSK &= ~(1 << OCIE3A);
+            stepper_running = false;
+            return;
+        }
+        interval = cur.p0;      // Next move starts from rest
+    } else {
+        stepper_next_interval(left);
+        interval = cur_p >> 16;
+    }
+
+    // Schedule relative to the previous match; if this interrupt ran past it, step ASAP
+    uint16_t due = OCR3A;
+    uint16_t now = TCNT3;
+    if (interval < (uint16_t)(now - due) + STEPPER_MIN_LEAD) {
+        OCR3A = now + STEPPER_MIN_LEAD;
+        if (stepper_overruns != 0xFFFF) stepper_overruns++;
+    } else {
+        OCR3A = due + interval;
+    }
+
+    uint16_t spent = now - start;
+    if (spent > stepper_isr_max) stepper_isr_max = spent;
+}
+
+// Integer square root of a 32-bit value
+static uint16_t isqrt32(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value) bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/**
+ * @brief Initialize the stepper outputs and the timebase.
+ * @param mode STEPPER_HALF_STEP or STEPPER_FULL_STEP.
+ */
+void StepperInit(StepperMode_t mode) {
+    STEPPER_DDR |= STEPPER_MASK;
+    STEPPER_PORT &= ~STEPPER_MASK;
+
+    ETIMSK &= ~(1 << OCIE3A);
+    stepper_increment = (uint8_t)mode;
+    stepper_phase = (mode == STEPPER_FULL_STEP) ? 7 : 0;  // First full step lands on AB
+    stepper_head = stepper_tail = 0;
+    stepper_running = false;
+    stepper_position = 0;
+    stepper_isr_max = 0;
+    stepper_overruns = 0;
+
+    TimebaseInit();
+}
+
+/**
+ * @brief Queue a relative move.
+ * @param steps Number of steps; the sign selects the direction.
+ * @param max_speed Cruise speed in steps per second.
+ * @param accel Acceleration and deceleration in steps per second squared (1-59000).
+ * @return true if queued, false if the queue is full or the arguments are invalid.
+ */
+bool StepperMove(int32_t steps, uint16_t max_speed, uint16_t accel) {
+    if (steps == 0 || max_speed == 0 || accel == 0 || accel > 59000) return false;
+
+    uint8_t head = stepper_head;
+    uint8_t next = (head + 1) & (STEPPER_QUEUE_SIZE - 1);
+    if (next == stepper_tail) return false;
+
+    StepperMoveCmd_t *cmd = &stepper_queue[head];
+    cmd->dir = (steps > 0) ? 1 : -1;
+    cmd->steps = (steps > 0) ? (uint32_t)steps : (uint32_t)-steps;
+
+    // Cruise interval f / v
+    uint32_t pmin = TIMEBASE_HZ / max_speed;
+    if (pmin < STEPPER_MIN_INTERVAL) pmin = STEPPER_MIN_INTERVAL;
+    if (pmin > 0xFFFF) pmin = 0xFFFF;
+    cmd->pmin = pmin;
+
+    // First interval from rest f * sqrt(2 / a) = f * 256 / (256 * sqrt(a / 2))
+    uint32_t p0 = ((uint32_t)TIMEBASE_HZ << 8) / isqrt32((uint32_t)accel << 15);
+    if (p0 > 0xFFFF) p0 = 0xFFFF;
+    if (p0 < pmin) p0 = pmin;
+    cmd->p0 = p0;
+
+    cmd->m = (uint32_t)accel * STEPPER_M_SCALE;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        stepper_head = next;
+        if (!stepper_running) {
+            stepper_load();
+            stepper_running = true;
+            OCR3A = TCNT3 + STEPPER_MIN_LEAD;
+            ETIFR = (1 << OCF3A);       // Drop a stale match
+            ETIMSK |= (1 << OCIE3A);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Check if the motor is moving or moves are queued.
+ * @return true while steps are still being generated.
+ */
+bool StepperIsBusy(void) {
+    return stepper_running;
+}
+
+/**
+ * @brief Number of free entries in the move queue.
+ * @return Moves that can still be queued.
+ */
+uint8_t StepperQueueFree(void) {
+    return (stepper_tail - stepper_head - 1) & (STEPPER_QUEUE_SIZE - 1);
+}
+
+/**
+ * @brief Current position in steps since StepperInit().
+ * @return Signed step count.
+ */
+int32_t StepperPosition(void) {
+    int32_t position;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        position = stepper_position;
+    }
+    return position;
+}
+
+/**
+ * @brief Decelerate to a stop as fast as the current move allows and drop queued moves.
+ */
+void StepperStop(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        stepper_tail = stepper_head;
+        // Braking takes as many steps as the ramp up did; keep only those
+        if (stepper_running && cur_state != STATE_DECEL && cur_left > cur_n + 1) {
+            cur_left = cur_n + 1;
+        }
+    }
+}
+
+/**
+ * @brief Switch all coils off (no holding torque).
+ */
+void StepperRelease(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!stepper_running) STEPPER_PORT &= ~STEPPER_MASK;
+    }
+}
+
+/**
+ * @brief Longest step interrupt measured so far.
+ * @return Duration in timebase ticks.
+ */
+uint16_t StepperMaxIsrTicks(void) {
+    uint16_t ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticks = stepper_isr_max;
+    }
+    return ticks;
+}
+
+/**
+ * @brief Number of steps that were issued late because the previous interrupt overran.
+ * @return Overrun count (saturates at 65535).
+ */
+uint16_t StepperOverruns(void) {
+    uint16_t count;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = stepper_overruns;
+    }
+    return count;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file stepper.h
+ * @brief Interrupt-driven stepper motor controller for the J5 connector on the BK-AVR128 board.
+ * @details The coils A-D are driven from PB0-PB3 through the ULN2003 (U3). Steps are
+ *          generated by the Timer3 compare A interrupt on the shared timebase (timebase.h),
+ *          so the main loop only queues moves.
+ *
+ *          Each move follows a trapezoidal (or triangular) speed profile with equal
+ *          acceleration and deceleration. The step interval is updated incrementally in
+ *          fixed point without any division in the interrupt:
+ *          - the first 16 intervals come from a table of sqrt(n + 1) - sqrt(n), which is
+ *            exact for a start from rest (AVR446 uses an approximation here);
+ *          - after that p' = p * (1 - q + 1.5 q^2) with q = a * p^2 / f^2 while
+ *            accelerating, and p * (1 + q + 1.5 q^2) while decelerating.
+ *          Divisions and the square root are done once per move in StepperMove().
+ *
+ *          Limits at 8 MHz (1 us timer ticks): the slowest interval is 65535 ticks, so
+ *          accelerations below ~470 steps/s^2 start slightly faster than requested; the
+ *          fastest interval is STEPPER_MIN_INTERVAL.
+ *
+ *          Interrupt cost, counted from the code (estimates, not measured on a board):
+ *          ~220 cycles while cruising, ~260 on the table steps and ~600 on the q-series
+ *          steps (four 32-bit fixed-point multiplies), i.e. 75 us at 8 MHz. The ramps
+ *          alone would then top out near 13000 steps/s and the cruise near 36000, so the
+ *          10000 steps/s of STEPPER_MIN_INTERVAL costs up to 75 % of the CPU while
+ *          ramping. tests/test_stepper.c prints these with the register accesses per
+ *          path. Use StepperMaxIsrTicks() and StepperOverruns() to check the sustainable
+ *          step rate of a given firmware.
+ *
+ * @note PB0-PB2 are also the SPI pins, so the stepper can't be used together with
+ *       GLCD_SERIAL_HW_SPI.
+ */
+
+#ifndef STEPPER_H
+#define STEPPER_H
+
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Stepper Pin Definitions (ULN2003 IN1-IN4)
+#define STEPPER_DDR     DDRB    ///< Data Direction Register for the coils
+#define STEPPER_PORT    PORTB   ///< Output Port for the coils
+#define STEPPER_MASK    0x0F    ///< PB0 (A), PB1 (B), PB2 (C), PB3 (D)
+
+#ifndef STEPPER_QUEUE_SIZE
+#define STEPPER_QUEUE_SIZE   8      ///< Queued moves (power of two)
+#endif
+#ifndef STEPPER_MIN_INTERVAL
+#define STEPPER_MIN_INTERVAL 100    ///< Shortest step interval in timebase ticks
+#endif
+
+// Stepping modes
+typedef enum {
+    STEPPER_HALF_STEP = 1,   ///< A, AB, B, BC, C, CD, D, DA
+    STEPPER_FULL_STEP = 2    ///< AB, BC, CD, DA (two coils on, full torque)
+} StepperMode_t;
+
+/**
+ * @brief Initialize the stepper outputs and the timebase.
+ * @param mode STEPPER_HALF_STEP or STEPPER_FULL_STEP.
+ * @note Configures PB0-PB3 as outputs with all coils off. Enable interrupts with sei().
+ */
+void StepperInit(StepperMode_t mode);
+
+/**
+ * @brief Queue a relative move.
+ * @param steps Number of steps; the sign selects the direction.
+ * @param max_speed Cruise speed in steps per second.
+ * @param accel Acceleration and deceleration in steps per second squared (1-59000).
+ * @return true if queued, false if the queue is full or the arguments are invalid.
+ * @note Computes the profile constants here, outside the interrupt.
+ */
+bool StepperMove(int32_t steps, uint16_t max_speed, uint16_t accel);
+
+/**
+ * @brief Check if the motor is moving or moves are queued.
+ * @return true while steps are still being generated.
+ */
+bool StepperIsBusy(void);
+
+/**
+ * @brief Number of free entries in the move queue.
+ * @return Moves that can still be queued.
+ */
+uint8_t StepperQueueFree(void);
+
+/**
+ * @brief Current position in steps since StepperInit().
+ * @return Signed step count.
+ */
+int32_t StepperPosition(void);
+
+/**
+ * @brief Decelerate to a stop as fast as the current move allows and drop queued moves.
+ */
+void StepperStop(void);
+
+/**
+ * @brief Switch all coils off (no holding torque).
+ * @note Only has an effect while the motor is idle.
+ */
+void StepperRelease(void);
+
+/**
+ * @brief Longest step interrupt measured so far.
+ * @return Duration in timebase ticks; the sustainable step rate is below
+ *         TIMEBASE_HZ divided by this value.
+ */
+uint16_t StepperMaxIsrTicks(void);
+
+/**
+ * @brief Number of steps that were issued late because the previous interrupt overran.
+ * @return Overrun count (saturates at 65535).
+ */
+uint16_t StepperOverruns(void);
+
+#endif // STEPPER_H
@@ -0,0 +1,105 @@
+/**
+ * @file telemetry.c
+ * @brief Binary telemetry over USART0: typed records framed with COBS and a CRC, built in
+ *        place and sent by the transmit interrupt.
+ */
+
+#include "telemetry.h"
+#include "timebase.h"
+#include "trace.h"
+#include <string.h>
+#include <util/crc16.h>
+
+// Global variables
+static uint8_t *telem_frame;            // Open record: COBS code byte, then the record
+static uint8_t telem_length;            // Its payload length
+static TelemStats_t telem_stats;
+
+/**
+ * @brief Start the timebase and USART0 for telemetry.
+ */
+UartStatus_t TelemInit(uint32_t baud) {
+    telem_frame = NULL;
+    TelemResetStats();
+    TimebaseInit();
+    return UartInit(baud);
+}
+
+/**
+ * @brief Room for the payload of a record.
+ */
+void *TelemReserve(uint8_t channel, TelemType_t type, uint8_t length) {
+    if (length > TELEM_MAX_PAYLOAD) return NULL;
+    uint16_t now = TimebaseNow();
+    uint8_t *frame = UartStreamReserve(length + TELEM_OVERHEAD);
+    telem_frame = frame;
+    if (!frame) {
+        TRACE(TRACE_TELEM_DROP, channel);
+        telem_stats.dropped++;
+        return NULL;
+    }
+    frame[1] = now & 0xFF;
+    frame[2] = now >> 8;
+    frame[3] = channel;
+    frame[4] = type;
+    telem_length = length;
+    return frame + 1 + TELEM_HEADER;
+}
+
+/**
+ * @brief Frame and send the record from TelemReserve().
+ */
+void TelemCommit(void) {
+    uint8_t *frame = telem_frame;
+    if (!frame) return;
+    telem_frame = NULL;
+
+    // Record in frame[1..n], CRC last
+    uint8_t n = TELEM_HEADER + telem_length;
+    uint16_t crc = 0;
+    for (uint8_t i = 1; i <= n; i++) crc = _crc_xmodem_update(crc, frame[i]);
+    frame[++n] = crc & 0xFF;
+    frame[++n] = crc >> 8;
+
+    // COBS in place: each 0x00 (and the code byte in front) gets the distance to the next
+    uint8_t code_at = 0;
+    for (uint8_t i = 1; i <= n; i++) {
+        if (!frame[i]) {
+            frame[code_at] = i - code_at;
+            code_at = i;
+        }
+    }
+    frame[code_at] = n + 1 - code_at;
+    frame[n + 1] = 0;
+
+    UartStreamCommit(n + 2);
+    uint8_t used = UartStreamUsed();
+    if (used > telem_stats.max_used) telem_stats.max_used = used;
+    telem_stats.records++;
+    telem_stats.bytes += n + 2;
+}
+
+/**
+ * @brief Send a record with a copy of the payload.
+ */
+bool TelemSend(uint8_t channel, TelemType_t type, const void *data, uint8_t length) {
+    void *payload = TelemReserve(channel, type, length);
+    if (!payload) return false;
+    memcpy(payload, data, length);
+    TelemCommit();
+    return true;
+}
+
+/**
+ * @brief Copy the figures.
+ */
+void TelemGetStats(TelemStats_t *stats) {
+    *stats = telem_stats;
+}
+
+/**
+ * @brief Clear the figures.
+ */
+void TelemResetStats(void) {
+    telem_stats = (TelemStats_t){ 0 };
+}
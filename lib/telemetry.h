@@ -0,0 +1,127 @@
+/**
+ * @file telemetry.h
+ * @brief Binary telemetry over USART0: typed records framed with COBS and a CRC, built in
+ *        place and sent by the transmit interrupt. tools/telemdump.c turns them into CSV.
+ * @details A record is a timestamp, a channel number chosen by the application, a type and
+ *          a payload of values of that type:
+ *
+ *              TelemInit(0);                           // 250000 baud
+ *              sei();
+ *              int16_t *v = TelemReserve(3, TELEM_I16, 2 * sizeof(int16_t));
+ *              if (v) {                                // NULL: no room, dropped
+ *                  v[0] = x;
+ *                  v[1] = y;
+ *                  TelemCommit();
+ *              }
+ *              TelemSend(9, TELEM_TEXT, "boot", 4);    // Copying variant
+ *
+ *          On the wire: COBS(ts lo, ts hi, channel, type, payload, crc lo, crc hi), 0x00.
+ *          ts is TimebaseNow() when the record was reserved (1 us ticks at the full clock,
+ *          see timebase.h); the CRC is CRC-16/XMODEM over ts to payload. Values are
+ *          little-endian, as the AVR keeps them. COBS replaces every 0x00 of the record,
+ *          so 0x00 only ends a frame: a decoder that starts in the middle, or loses
+ *          bytes, is back in step at the next frame. Text from UartPuts() may go out
+ *          between frames (uart.h); it ends with a 0x00 too and fails the CRC, so the
+ *          decoder passes it on as text.
+ *
+ *          The record is built directly in the USART's stream ring (UartStreamReserve()),
+ *          so a payload is written once and never copied. TelemCommit() adds the CRC,
+ *          encodes it in place and hands it to the interrupt. A record that finds no room
+ *          is dropped and counted: the application never waits for the link.
+ *
+ *          Cost, counted from the instruction sequence at -Os (not measured on the board):
+ *          a frame is the payload plus 8 bytes; TelemCommit() takes about 100 cycles plus
+ *          25 per frame byte (CRC and COBS), the interrupt about 45 per byte sent. A link
+ *          at 250000 baud kept full of 2-byte records (10 bytes, 2500 per second) costs
+ *          about 12 % of the CPU at 8 MHz for the records and 14 % for the interrupt; with
+ *          32-byte payloads (625 per second) about 10 % and 14 %.
+ *
+ * @note The 16-bit timestamp wraps every 65.5 ms; the decoder unwraps it as long as a
+ *       record goes out at least that often (send a heartbeat on a slow channel otherwise).
+ *       While the clock is divided the tick is longer (TimebaseMicros()).
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart.h"
+
+#ifndef TELEM_MAX_PAYLOAD
+#define TELEM_MAX_PAYLOAD   64      ///< Longest payload in bytes
+#endif
+#define TELEM_HEADER        4       ///< ts, channel, type
+#define TELEM_OVERHEAD      8       ///< Frame bytes besides the payload: COBS, header, CRC, 0x00
+
+#if TELEM_MAX_PAYLOAD + TELEM_OVERHEAD + 1 > UART_STREAM_SIZE - 1
+#error "TELEM_MAX_PAYLOAD doesn't fit the stream ring (UART_STREAM_SIZE)"
+#endif
+
+// Payload types: an array of values of that type
+typedef enum {
+    TELEM_U8 = 0,
+    TELEM_I8,
+    TELEM_U16,
+    TELEM_I16,
+    TELEM_U32,
+    TELEM_I32,
+    TELEM_F32,
+    TELEM_TEXT,             ///< Characters, no terminator
+    TELEM_BYTES,            ///< Raw bytes, shown in hex
+    TELEM_TYPES
+} TelemType_t;
+
+// Figures since TelemInit() or TelemResetStats()
+typedef struct {
+    uint32_t records;       ///< Records committed
+    uint32_t dropped;       ///< Records that found no room
+    uint32_t bytes;         ///< Frame bytes committed
+    uint8_t max_used;       ///< Highest fill of the stream ring (uart.h)
+} TelemStats_t;
+
+/**
+ * @brief Start the timebase and USART0 for telemetry.
+ * @param baud Bit rate, 0 for UART_BAUD (250000).
+ * @return UART_OK or UART_BAD_BAUD.
+ * @note Enable interrupts afterwards (sei()).
+ */
+UartStatus_t TelemInit(uint32_t baud);
+
+/**
+ * @brief Room for the payload of a record.
+ * @param channel Channel number.
+ * @param type Payload type.
+ * @param length Payload length in bytes, up to TELEM_MAX_PAYLOAD.
+ * @return Where to write the payload, or NULL if the record was dropped (no room) or is
+ *         too long. Finish with TelemCommit().
+ */
+void *TelemReserve(uint8_t channel, TelemType_t type, uint8_t length);
+
+/**
+ * @brief Frame and send the record from TelemReserve().
+ */
+void TelemCommit(void);
+
+/**
+ * @brief Send a record with a copy of the payload.
+ * @param channel Channel number.
+ * @param type Payload type.
+ * @param data Payload.
+ * @param length Payload length in bytes.
+ * @return false if the record was dropped.
+ */
+bool TelemSend(uint8_t channel, TelemType_t type, const void *data, uint8_t length);
+
+/**
+ * @brief Copy the figures.
+ * @param stats Destination.
+ */
+void TelemGetStats(TelemStats_t *stats);
+
+/**
+ * @brief Clear the figures.
+ */
+void TelemResetStats(void);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,79 @@
+/**
+ * @file timebase.h
+ * @brief Free-running 16-bit timebase on Timer3 for the BK-AVR128 board.
+ * @details Timer3 counts at F_CPU / 8 in normal mode and is never reset, so several
+ *          drivers can share it: each one schedules its own events by adding an interval
+ *          to one of the OCR3A/OCR3B/OCR3C compare registers, and anyone can take a
+ *          timestamp by reading TCNT3. At 8 MHz one tick is 1 us and the counter wraps
+ *          every 65.536 ms; compare intervals with 16-bit unsigned subtraction.
+ *
+ *          While the system clock is divided (clock.h) the tick is longer: timebase_shift
+ *          is log2 of its length in full-clock ticks, and TimebaseTicks() converts with it.
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <stdint.h>
+#include "clock_config.h"
+
+#define TIMEBASE_PRESCALER  8                               ///< Timer3 clock divider
+#define TIMEBASE_HZ         (F_CPU / TIMEBASE_PRESCALER)    ///< Ticks per second at full clock
+#define TIMEBASE_TICKS_PER_MS   (TIMEBASE_HZ / 1000)
+#define TIMEBASE_CS_MASK    ((1 << CS32) | (1 << CS31) | (1 << CS30))   ///< Timer3 clock select bits
+
+// Set by ClockSetDivider() (clock.c)
+extern uint8_t timebase_shift;      // Tick length = 2^timebase_shift full-clock ticks
+extern uint8_t timebase_cs;         // Timer3 clock select for the current system clock
+
+/**
+ * @brief Start Timer3 as a free-running counter.
+ * @note Safe to call from every driver that uses the timebase; the counter is not
+ *       reset if it is already running, so other users keep their schedules.
+ */
+static inline void TimebaseInit(void) {
+    if ((TCCR3B & TIMEBASE_CS_MASK) == timebase_cs) return;
+    TCCR3A = 0;             // Normal mode, compare outputs disconnected
+    TCCR3C = 0;
+    // F_CPU / 8, or the divided clock / 1; ICNC3/ICES3 belong to the input capture (irq.c)
+    TCCR3B = (TCCR3B & ~(TIMEBASE_CS_MASK | (1 << WGM33) | (1 << WGM32))) | timebase_cs;
+}
+
+/**
+ * @brief Read the current timebase count.
+ * @return Timer3 count in ticks (wraps at 65536).
+ * @note Atomic with respect to interrupts (16-bit register access uses the shared TEMP byte).
+ */
+static inline uint16_t TimebaseNow(void) {
+    uint16_t now;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        now = TCNT3;
+    }
+    return now;
+}
+
+/**
+ * @brief Convert a wait to timebase ticks at the current system clock.
+ * @param us Microseconds.
+ * @return Ticks; never shorter than `us`, counting the partial tick at the start when
+ *         the tick is longer than at full clock.
+ */
+static inline uint32_t TimebaseTicks(uint32_t us) {
+    uint32_t ticks = us / 1000 * TIMEBASE_TICKS_PER_MS + us % 1000 * TIMEBASE_TICKS_PER_MS / 1000;
+    if (timebase_shift) ticks = (ticks >> timebase_shift) + 2;
+    return ticks;
+}
+
+/**
+ * @brief Convert timebase ticks at the current system clock to microseconds.
+ * @param ticks Ticks.
+ * @return Microseconds.
+ */
+static inline uint32_t TimebaseMicros(uint32_t ticks) {
+    ticks <<= timebase_shift;
+    return ticks / TIMEBASE_TICKS_PER_MS * 1000 + ticks % TIMEBASE_TICKS_PER_MS * 1000 / TIMEBASE_TICKS_PER_MS;
+}
+
+#endif // TIMEBASE_H
@@ -0,0 +1,88 @@
+/**
+ * @file trace.c
+ * @brief Event trace: timestamped 4-byte records from interrupts and drivers in a RAM ring,
+ *        frozen on a trigger and dumped over USART0 for tools/tracecvt.
+ */
+
+#include "trace.h"
+#include "uart.h"
+#include <string.h>
+
+// Global variables
+TraceRecord_t trace_ring[TRACE_SIZE];
+volatile uint8_t trace_head;
+volatile uint8_t trace_left;
+volatile uint8_t trace_step;
+
+static void trace_hex(uint32_t value, uint8_t digits) {
+    while (digits--) UartPutc("0123456789abcdef"[(value >> (4 * digits)) & 0x0F]);
+}
+
+/**
+ * @brief Clear the ring and start recording.
+ */
+void TraceInit(void) {
+    TimebaseInit();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        memset(trace_ring, 0, sizeof(trace_ring));
+        trace_head = 0;
+        trace_step = 0;
+        trace_left = 1;
+    }
+}
+
+/**
+ * @brief Record a TRACE_TRIGGER event and freeze after `post` more records.
+ */
+void TraceTrigger(uint8_t post) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!trace_step && trace_left) {
+            TraceRecord(TRACE_TRIGGER, post);
+            trace_left = post;
+            trace_step = 1;
+        }
+    }
+}
+
+/**
+ * @brief Stop recording now.
+ */
+void TraceFreeze(void) {
+    trace_left = 0;
+}
+
+/**
+ * @brief Whether recording has stopped.
+ */
+bool TraceFrozen(void) {
+    return !trace_left;
+}
+
+/**
+ * @brief Print the ring over USART0, oldest record first.
+ */
+void TraceDump(void) {
+    uint8_t count = 0;
+
+    TraceFreeze();
+    for (uint8_t i = 0; i < TRACE_SIZE; i++) {
+        if (trace_ring[i].id != TRACE_NONE) count++;
+    }
+    UartPuts("#trace ");
+    trace_hex(count, 2);
+    UartPutc(' ');
+    trace_hex((1000000000UL / TIMEBASE_HZ) << timebase_shift, 8);
+    UartPutc('\n');
+
+    for (uint8_t i = 0; i < TRACE_SIZE; i++) {
+        const TraceRecord_t *r = &trace_ring[(uint8_t)(trace_head + i) & (TRACE_SIZE - 1)];
+        if (r->id == TRACE_NONE) continue;
+        trace_hex(r->ts, 4);
+        UartPutc(' ');
+        trace_hex(r->id, 2);
+        UartPutc(' ');
+        trace_hex(r->arg, 2);
+        UartPutc('\n');
+    }
+    UartPuts("#end\n");
+}
@@ -0,0 +1,147 @@
+/**
+ * @file trace.h
+ * @brief Event trace: timestamped 4-byte records from interrupts and drivers in a RAM ring,
+ *        frozen on a trigger and dumped over USART0 for tools/tracecvt.
+ * @details A record is the timebase count (TCNT3, 1 us at 8 MHz), an event id and an 8-bit
+ *          argument. TRACE_BEGIN()/TRACE_END() mark the two ends of a span (an ISR, a TWI
+ *          transfer, a wait), TRACE() a single event:
+ *
+ *              TraceInit();
+ *              ...
+ *              ISR(INT5_vect) {
+ *                  TRACE_BEGIN(TRACE_APP + 1, PINE);
+ *                  ...
+ *                  TRACE_END(TRACE_APP + 1, 0);
+ *              }
+ *              ...
+ *              if (late_us > 500) TraceTrigger(16);    // Keep 16 more records, then stop
+ *              if (TraceFrozen()) TraceDump();
+ *
+ *          The ring keeps the last TRACE_SIZE records, overwriting the oldest. After
+ *          TraceTrigger() it takes `post` more records and freezes, so the dump shows what
+ *          led up to the trigger and what followed. A record costs about 25 cycles at -Os,
+ *          counted from the instruction sequence (interrupts are held for the 4-byte store,
+ *          so the macros work in ISRs and in the main loop alike).
+ *
+ *          The macros compile to nothing unless TRACE_ENABLE is defined, for the whole
+ *          build: `make PROJECT=... TRACE=1`. The library's own events (TRACE_TWI, ...)
+ *          are in the drivers behind the same switch.
+ *
+ *          TraceDump() prints the ring as text in hex, oldest first, with UartPutc():
+ *
+ *              #trace <records> <tick ns>
+ *              <ts hex> <id hex> <arg hex>
+ *              ...
+ *              #end
+ *
+ *          tools/tracecvt turns it into a Chrome trace (chrome://tracing, Perfetto) or a
+ *          VCD file (GTKWave), one row per event id.
+ *
+ * @note The 16-bit timestamps are unwrapped by the tool, which needs one record at least
+ *       every 65.5 ms. A clock change (clock.h) changes the tick; the dump header has the
+ *       tick at the time of the dump.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timebase.h"
+
+#ifndef TRACE_SIZE
+#define TRACE_SIZE          64      ///< Records in the ring: 16, 32, 64 or 128 (4 bytes each)
+#endif
+
+#if TRACE_SIZE != 16 && TRACE_SIZE != 32 && TRACE_SIZE != 64 && TRACE_SIZE != 128
+#error "TRACE_SIZE must be 16, 32, 64 or 128"
+#endif
+
+// Event id: 0-63, with the kind in the top bits
+#define TRACE_KIND_BEGIN    0x40
+#define TRACE_KIND_END      0x80
+#define TRACE_ID_MASK       0x3F
+
+// Library events (id 1-31); TRACE_APP and up are free for the application
+enum {
+    TRACE_NONE = 0,         ///< Empty slot
+    TRACE_TRIGGER,          ///< TraceTrigger(), arg = post records
+    TRACE_TWI,              ///< Span START to STOP, arg = address
+    TRACE_LCD,              ///< Byte to the J14 LCD, arg = byte
+    TRACE_LCD_WAIT,         ///< Span waiting for the J14 LCD
+    TRACE_PORTD,            ///< Span of a keypad/button scan, arg = key
+    TRACE_KEY,              ///< Debounced key change (portd.c), arg = key
+    TRACE_ARBITER,          ///< Span of the latch refresh ISR, arg = schedule slot
+    TRACE_ARBITER_RETRY,    ///< Refresh put off for an LCD transfer
+    TRACE_CLOCK,            ///< Clock divider change, arg = divider
+    TRACE_TELEM_DROP,       ///< Telemetry record dropped, arg = channel
+    TRACE_APP = 32          ///< First application id
+};
+
+typedef struct {
+    uint16_t ts;            ///< Timebase count
+    uint8_t id;             ///< Event id and kind
+    uint8_t arg;
+} TraceRecord_t;
+
+// The ring, for the inline recorder (trace.c)
+extern TraceRecord_t trace_ring[TRACE_SIZE];
+extern volatile uint8_t trace_head;         // Next slot
+extern volatile uint8_t trace_left;         // Records until frozen, 0 = frozen
+extern volatile uint8_t trace_step;         // 0 while running, 1 after the trigger
+
+static inline void TraceRecord(uint8_t id, uint8_t arg) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (trace_left) {
+            TraceRecord_t *r = &trace_ring[trace_head & (TRACE_SIZE - 1)];
+            r->ts = TCNT3;
+            r->id = id;
+            r->arg = arg;
+            trace_head++;
+            trace_left -= trace_step;
+        }
+    }
+}
+
+#ifdef TRACE_ENABLE
+#define TRACE(id, arg)          TraceRecord((id), (arg))                        ///< Single event
+#define TRACE_BEGIN(id, arg)    TraceRecord((id) | TRACE_KIND_BEGIN, (arg))     ///< Start of a span
+#define TRACE_END(id, arg)      TraceRecord((id) | TRACE_KIND_END, (arg))       ///< End of a span
+#else
+#define TRACE(id, arg)          ((void)0)
+#define TRACE_BEGIN(id, arg)    ((void)0)
+#define TRACE_END(id, arg)      ((void)0)
+#endif
+
+/**
+ * @brief Clear the ring and start recording.
+ * @note Starts the timebase (Timer3).
+ */
+void TraceInit(void);
+
+/**
+ * @brief Record a TRACE_TRIGGER event and freeze after `post` more records.
+ * @param post Records to keep after the trigger (at most TRACE_SIZE - 1 so the trigger
+ *             stays in the ring).
+ * @note Only the first trigger counts until TraceInit().
+ */
+void TraceTrigger(uint8_t post);
+
+/**
+ * @brief Stop recording now.
+ */
+void TraceFreeze(void);
+
+/**
+ * @brief Whether recording has stopped.
+ * @return true once frozen.
+ */
+bool TraceFrozen(void);
+
+/**
+ * @brief Print the ring over USART0 (uart.h), oldest record first.
+ * @note Freezes the ring while it prints; call TraceInit() to record again.
+ */
+void TraceDump(void);
+
+#endif // TRACE_H
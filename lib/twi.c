@@ -0,0 +1,297 @@
+#include "twi.h"
+#include "clock.h"
+#include "trace.h"
+#include <util/delay.h>
+#include <stddef.h>
+
+// TWSR status codes (master modes)
+#define TW_START            0x08
+#define TW_REP_START        0x10
+#define TW_MT_SLA_ACK       0x18
+#define TW_MT_SLA_NACK      0x20
+#define TW_MT_DATA_ACK      0x28
+#define TW_MT_DATA_NACK     0x30
+#define TW_ARB_LOST         0x38
+#define TW_MR_SLA_ACK       0x40
+#define TW_MR_SLA_NACK      0x48
+#define TW_MR_DATA_ACK      0x50
+#define TW_MR_DATA_NACK     0x58
+
+#define TWI_SCL             (1 << TWI_SCL_PIN)
+#define TWI_SDA             (1 << TWI_SDA_PIN)
+#define TWI_HALF_BIT_US     5       // Bus clear runs at 100 kHz
+
+// Global variables
+static uint8_t twi_hw_status = 0xF8;
+static bool twi_active;             // Between a START and the STOP
+static TwiIdleHook_t twi_idle_hook;     // Called after each STOP (TwiOnIdle())
+static uint32_t twi_speed = TWI_SPEED;  // Requested SCL frequency (TwiSetSpeed())
+
+// Open-drain pin control: low = output 0, released = input with pull-up
+static void twi_pin_low(uint8_t pin) {
+    PORTD &= ~pin;
+    DDRD |= pin;
+}
+
+static void twi_pin_release(uint8_t pin) {
+    DDRD &= ~pin;
+    PORTD |= pin;
+}
+
+// Release SCL and wait for a slave that stretches the clock
+static bool twi_scl_high(void) {
+    twi_pin_release(TWI_SCL);
+    for (uint16_t us = TWI_TIMEOUT_US; !(PIND & TWI_SCL); us--) {
+        if (!us) return false;
+        _delay_us(1);
+    }
+    return true;
+}
+
+// Reset the unit and free the bus after a failed operation
+static TwiStatus_t twi_fail(TwiStatus_t status) {
+    twi_active = false;
+    if (TwiBusClear() != TWI_OK) return TWI_BUS_STUCK;
+    return status;
+}
+
+// Start the operation in TWCR and wait for TWINT
+static TwiStatus_t twi_run(uint8_t twcr) {
+    TWCR = twcr | (1 << TWINT) | (1 << TWEN);
+    for (uint16_t us = TWI_TIMEOUT_US; !(TWCR & (1 << TWINT)); us--) {
+        if (!us) return twi_fail(TWI_TIMEOUT);
+        _delay_us(1);
+    }
+    twi_hw_status = TWSR & 0xF8;
+    return TWI_OK;
+}
+
+// Map an unexpected status; NACKs end the transfer with a STOP
+static TwiStatus_t twi_error(void) {
+    switch (twi_hw_status) {
+    case TW_MT_SLA_NACK:
+    case TW_MR_SLA_NACK:
+        TwiStop();
+        return TWI_NACK_ADDR;
+    case TW_MT_DATA_NACK:
+        TwiStop();
+        return TWI_NACK_DATA;
+    case TW_ARB_LOST:
+        twi_active = false;     // The unit is back in slave mode, the bus belongs to the other master
+        return TWI_ARB_LOST;
+    default:
+        return twi_fail(TWI_BUS_ERROR);
+    }
+}
+
+// TWBR and TWPS for twi_speed at any system clock, as the TWI_TWBR_VALUE chain does
+static void twi_bit_rate(uint32_t cpu_hz) {
+    uint32_t twbr = cpu_hz / twi_speed;
+    uint8_t twps = 0;
+    twbr = (twbr > 16) ? (twbr - 16) / 2 : 0;
+    while (twbr > 255 && twps < 3) {
+        twbr /= 4;
+        twps++;
+    }
+    if (twbr > 255) twbr = 255;
+    if (twbr < TWI_TWBR_MIN) twbr = TWI_TWBR_MIN;
+    TWSR = twps;
+    TWBR = twbr;
+}
+
+// The system clock changed (clock.h): keep SCL at twi_speed or as close as it gets
+static void twi_clock(ClockEvent_t event, uint32_t hz) {
+    if (event == CLOCK_POST_CHANGE) twi_bit_rate(hz);
+}
+
+/**
+ * @brief Initialize the TWI unit at TWI_SPEED_ACTUAL.
+ */
+void TwiInit(void) {
+    DDRD &= ~(TWI_SCL | TWI_SDA);
+    PORTD |= TWI_SCL | TWI_SDA;         // Internal pull-ups
+    if (ClockDivider() == 1 && twi_speed == TWI_SPEED) {
+        TWSR = TWI_TWPS_VALUE;
+        TWBR = TWI_TWBR_VALUE;
+    } else {
+        twi_bit_rate(ClockHz());
+    }
+    TWCR = (1 << TWEN);
+    twi_active = false;
+    ClockNotify(twi_clock);
+}
+
+/**
+ * @brief Change the SCL frequency between transfers.
+ */
+uint32_t TwiSetSpeed(uint32_t hz) {
+    twi_speed = hz ? hz : TWI_SPEED;
+    twi_bit_rate(ClockHz());
+    return TwiSpeed();
+}
+
+/**
+ * @brief SCL frequency in use.
+ */
+uint32_t TwiSpeed(void) {
+    uint8_t twps = TWSR & 0x03;
+    return ClockHz() / (16 + 2UL * TWBR * (1UL << (2 * twps)));
+}
+
+/**
+ * @brief Send a START (or repeated START) and the address.
+ */
+TwiStatus_t TwiStart(uint8_t address, bool read) {
+    TwiStatus_t status;
+
+    // A slave left in the middle of a byte (e.g. after a reset) holds SDA low
+    if (!twi_active && !(PIND & TWI_SDA)) {
+        if (TwiBusClear() != TWI_OK) return TWI_BUS_STUCK;
+    }
+
+    if ((status = twi_run(1 << TWSTA)) != TWI_OK) return status;
+    if (twi_hw_status != TW_START && twi_hw_status != TW_REP_START) return twi_error();
+    twi_active = true;
+    TRACE_BEGIN(TRACE_TWI, address);
+
+    TWDR = (address << 1) | (read ? 1 : 0);
+    if ((status = twi_run(0)) != TWI_OK) return status;
+    if (twi_hw_status != (read ? TW_MR_SLA_ACK : TW_MT_SLA_ACK)) return twi_error();
+    return TWI_OK;
+}
+
+/**
+ * @brief Send one data byte in a write transfer.
+ */
+TwiStatus_t TwiWrite(uint8_t data) {
+    TwiStatus_t status;
+
+    TWDR = data;
+    if ((status = twi_run(0)) != TWI_OK) return status;
+    if (twi_hw_status != TW_MT_DATA_ACK) return twi_error();
+    return TWI_OK;
+}
+
+/**
+ * @brief Receive one data byte in a read transfer.
+ */
+TwiStatus_t TwiRead(uint8_t *data, bool ack) {
+    TwiStatus_t status;
+
+    if ((status = twi_run(ack ? (1 << TWEA) : 0)) != TWI_OK) return status;
+    if (twi_hw_status != (ack ? TW_MR_DATA_ACK : TW_MR_DATA_NACK)) return twi_error();
+    *data = TWDR;
+    return TWI_OK;
+}
+
+/**
+ * @brief Send a STOP and wait until it has been sent.
+ */
+TwiStatus_t TwiStop(void) {
+    twi_active = false;
+    TRACE_END(TRACE_TWI, 0);
+    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+    for (uint16_t us = TWI_TIMEOUT_US; TWCR & (1 << TWSTO); us--) {
+        if (!us) return twi_fail(TWI_TIMEOUT);
+        _delay_us(1);
+    }
+    if (twi_idle_hook) twi_idle_hook();
+    return TWI_OK;
+}
+
+/**
+ * @brief Call a function in the gap after every transfer.
+ */
+void TwiOnIdle(TwiIdleHook_t hook) {
+    twi_idle_hook = hook;
+}
+
+/**
+ * @brief Whether a transfer is open (between START and STOP).
+ */
+bool TwiActive(void) {
+    return twi_active;
+}
+
+/**
+ * @brief Write a buffer to a device in one transfer (START, address, data, STOP).
+ */
+TwiStatus_t TwiWriteTo(uint8_t address, const uint8_t *data, uint8_t length) {
+    TwiStatus_t status = TwiStart(address, false);
+    if (status != TWI_OK) return status;
+    while (length--) {
+        if ((status = TwiWrite(*data++)) != TWI_OK) return status;
+    }
+    return TwiStop();
+}
+
+/**
+ * @brief Read a buffer from a device in one transfer.
+ */
+TwiStatus_t TwiReadFrom(uint8_t address, uint8_t *data, uint8_t length) {
+    TwiStatus_t status = TwiStart(address, true);
+    if (status != TWI_OK) return status;
+    while (length) {
+        length--;
+        if ((status = TwiRead(data++, length != 0)) != TWI_OK) return status;
+    }
+    return TwiStop();
+}
+
+/**
+ * @brief Free a bus held by a slave: clock SCL up to nine times, then send a STOP.
+ */
+TwiStatus_t TwiBusClear(void) {
+    TWCR = 0;                           // Hand the pins back to PORTD
+    twi_pin_release(TWI_SDA);
+    twi_scl_high();
+
+    // Each clock lets the slave shift out one more bit; it lets go of SDA at the ACK
+    for (uint8_t i = 0; i < 9 && !(PIND & TWI_SDA); i++) {
+        twi_pin_low(TWI_SCL);
+        _delay_us(TWI_HALF_BIT_US);
+        twi_scl_high();
+        _delay_us(TWI_HALF_BIT_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    twi_pin_low(TWI_SCL);
+    _delay_us(TWI_HALF_BIT_US);
+    twi_pin_low(TWI_SDA);
+    _delay_us(TWI_HALF_BIT_US);
+    bool scl_ok = twi_scl_high();
+    _delay_us(TWI_HALF_BIT_US);
+    twi_pin_release(TWI_SDA);
+    _delay_us(TWI_HALF_BIT_US);
+
+    bool sda_ok = PIND & TWI_SDA;
+    twi_bit_rate(ClockHz());            // The rate of TwiSetSpeed() holds
+    TWCR = (1 << TWEN);
+    twi_active = false;
+    return (scl_ok && sda_ok) ? TWI_OK : TWI_BUS_STUCK;
+}
+
+/**
+ * @brief Find the devices on the bus.
+ */
+uint8_t TwiScan(uint8_t *found, uint8_t max) {
+    uint8_t count = 0;
+    for (uint8_t address = 0x08; address <= 0x77; address++) {
+        TwiStatus_t status = TwiStart(address, false);
+        if (status == TWI_OK) {
+            TwiStop();
+            if (found && count < max) found[count] = address;
+            count++;
+        } else if (status == TWI_BUS_STUCK) {
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Hardware status (TWSR & 0xF8) seen by the last operation.
+ */
+uint8_t TwiHwStatus(void) {
+    return twi_hw_status;
+}
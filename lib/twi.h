@@ -0,0 +1,188 @@
+/**
+ * @file twi.h
+ * @brief TWI (I2C) master driver with status codes, timeouts and bus recovery.
+ * @details SCL is PD0 and SDA is PD1 on the ATmega128. The bit rate is worked out at
+ *          compile time from F_CPU and TWI_SPEED (400 kHz Fast-mode by default):
+ *          SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS).
+ *
+ *          The datasheet requires TWBR >= 10 in master mode, otherwise SDA/SCL may be
+ *          wrong for the rest of a byte. TWBR is clamped to 10, so the fastest SCL is
+ *          F_CPU / 36: 222 kHz at 8 MHz, 400 kHz needs F_CPU >= 14.4 MHz.
+ *          TWI_SPEED_ACTUAL gives the rate really used; a TWI_SPEED set by the project that
+ *          had to be clamped produces a compile-time warning. While the system clock is
+ *          divided (clock.h) the bit rate is worked out again for the slower clock.
+ *
+ *          Every wait for the hardware is bounded by TWI_TIMEOUT_US. After a timeout or a
+ *          bus error the TWI unit is reset and the bus is cleared: SCL is clocked up to
+ *          nine times until the slave releases SDA, then a STOP is sent by hand. A START on
+ *          an idle bus with SDA held low clears the bus first. On any error the functions
+ *          leave the bus released (STOP sent), so the caller only reports or retries.
+ */
+
+#ifndef TWI_H
+#define TWI_H
+
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "clock_config.h"
+
+#define TWI_SCL_PIN     PD0     ///< SCL (PORTD)
+#define TWI_SDA_PIN     PD1     ///< SDA (PORTD)
+
+#ifndef TWI_SPEED
+#define TWI_SPEED       400000UL    ///< Requested SCL frequency in Hz
+#define TWI_SPEED_DEFAULT
+#endif
+#ifndef TWI_TIMEOUT_US
+#define TWI_TIMEOUT_US  1000        ///< Longest wait for one bus operation
+#endif
+
+#define TWI_TWBR_MIN    10      ///< Datasheet minimum in master mode
+
+// Bit rate settings for TWI_SPEED at F_CPU (prescaler 1, 4, 16 or 64)
+#if (F_CPU / TWI_SPEED) < (16 + 2 * TWI_TWBR_MIN)
+#define TWI_TWPS_VALUE  0
+#define TWI_TWBR_VALUE  TWI_TWBR_MIN
+#ifndef TWI_SPEED_DEFAULT
+#warning "TWI_SPEED needs TWBR < 10 at this F_CPU; using TWBR = 10 (see TWI_SPEED_ACTUAL)"
+#endif
+#elif ((F_CPU / TWI_SPEED) - 16) / 2 <= 255
+#define TWI_TWPS_VALUE  0
+#define TWI_TWBR_VALUE  (((F_CPU / TWI_SPEED) - 16) / 2)
+#elif ((F_CPU / TWI_SPEED) - 16) / 8 <= 255
+#define TWI_TWPS_VALUE  1
+#define TWI_TWBR_VALUE  (((F_CPU / TWI_SPEED) - 16) / 8)
+#elif ((F_CPU / TWI_SPEED) - 16) / 32 <= 255
+#define TWI_TWPS_VALUE  2
+#define TWI_TWBR_VALUE  (((F_CPU / TWI_SPEED) - 16) / 32)
+#else
+#define TWI_TWPS_VALUE  3
+#define TWI_TWBR_VALUE  (((F_CPU / TWI_SPEED) - 16) / 128)
+#endif
+
+/// SCL frequency produced by TWI_TWBR_VALUE and TWI_TWPS_VALUE
+#define TWI_SPEED_ACTUAL    (F_CPU / (16 + 2UL * TWI_TWBR_VALUE * (1UL << (2 * TWI_TWPS_VALUE))))
+
+// Result of a bus operation
+typedef enum {
+    TWI_OK = 0,         ///< Done, acknowledged
+    TWI_NACK_ADDR,      ///< No device acknowledged the address
+    TWI_NACK_DATA,      ///< The device did not acknowledge a data byte
+    TWI_ARB_LOST,       ///< Another master took the bus
+    TWI_BUS_ERROR,      ///< Illegal START/STOP or unexpected status; bus was cleared
+    TWI_TIMEOUT,        ///< The hardware did not finish in TWI_TIMEOUT_US; bus was cleared
+    TWI_BUS_STUCK       ///< SDA still low after nine SCL clocks
+} TwiStatus_t;
+
+/**
+ * @brief Initialize the TWI unit at TWI_SPEED_ACTUAL (or the closest rate at a divided
+ *        system clock, or the rate of TwiSetSpeed()) and follow later clock changes.
+ * @note Enables the internal pull-ups on PD0/PD1 (external pull-ups are still needed
+ *       for Fast-mode rise times).
+ */
+void TwiInit(void);
+
+/**
+ * @brief Change the SCL frequency, e.g. to try a slower bus without rebuilding.
+ * @param hz Requested frequency, 0 for TWI_SPEED; TWBR is clamped as at compile time.
+ * @return SCL frequency now in use, as TwiSpeed().
+ * @note Call between transfers. Holds through clock changes, bus clears after an error
+ *       and later TwiInit() calls (another I2C LCD starting); TwiSetSpeed(0) goes back to
+ *       TWI_SPEED.
+ */
+uint32_t TwiSetSpeed(uint32_t hz);
+
+/**
+ * @brief SCL frequency in use, from TWBR and TWPS at the current system clock.
+ * @return Frequency in Hz.
+ */
+uint32_t TwiSpeed(void);
+
+/**
+ * @brief Send a START (or repeated START) and the address.
+ * @param address 7-bit slave address.
+ * @param read true for a read transfer, false for a write.
+ * @return TWI_OK if the slave acknowledged; otherwise the bus is already released.
+ */
+TwiStatus_t TwiStart(uint8_t address, bool read);
+
+/**
+ * @brief Send one data byte in a write transfer.
+ * @param data Byte to send.
+ * @return TWI_OK if acknowledged; otherwise the bus is already released.
+ */
+TwiStatus_t TwiWrite(uint8_t data);
+
+/**
+ * @brief Receive one data byte in a read transfer.
+ * @param data Destination.
+ * @param ack true to acknowledge (more bytes follow), false for the last byte.
+ * @return TWI_OK, or an error after which the bus is already released.
+ */
+TwiStatus_t TwiRead(uint8_t *data, bool ack);
+
+/**
+ * @brief Send a STOP and wait until it has been sent.
+ * @return TWI_OK or TWI_TIMEOUT.
+ */
+TwiStatus_t TwiStop(void);
+
+// Function run in the bus gap after a STOP, see TwiOnIdle()
+typedef void (*TwiIdleHook_t)(void);
+
+/**
+ * @brief Call a function in the gap after every transfer.
+ * @param hook Function (NULL for none), called by TwiStop() once the STOP is on the bus.
+ * @note Used by the PORTD owner (portd.h) to scan the keypad and buttons on the TWI pins
+ *       between transfers. The hook may not start a transfer itself.
+ */
+void TwiOnIdle(TwiIdleHook_t hook);
+
+/**
+ * @brief Whether a transfer is open.
+ * @return true between a START and its STOP.
+ */
+bool TwiActive(void);
+
+/**
+ * @brief Write a buffer to a device in one transfer (START, address, data, STOP).
+ * @param address 7-bit slave address.
+ * @param data Bytes to send.
+ * @param length Number of bytes.
+ * @return Status of the first failing step, or TWI_OK.
+ */
+TwiStatus_t TwiWriteTo(uint8_t address, const uint8_t *data, uint8_t length);
+
+/**
+ * @brief Read a buffer from a device in one transfer.
+ * @param address 7-bit slave address.
+ * @param data Destination.
+ * @param length Number of bytes (at least 1).
+ * @return Status of the first failing step, or TWI_OK.
+ */
+TwiStatus_t TwiReadFrom(uint8_t address, uint8_t *data, uint8_t length);
+
+/**
+ * @brief Free a bus held by a slave: clock SCL up to nine times, then send a STOP.
+ * @return TWI_OK if SDA is released, TWI_BUS_STUCK otherwise.
+ * @note Disables the TWI unit while driving the pins, then initializes it again.
+ */
+TwiStatus_t TwiBusClear(void);
+
+/**
+ * @brief Find the devices on the bus.
+ * @param found Destination for the 7-bit addresses that answered (may be NULL).
+ * @param max Size of found.
+ * @return Number of devices found (can exceed max).
+ * @note Probes the addresses 0x08-0x77 with an empty write transfer.
+ */
+uint8_t TwiScan(uint8_t *found, uint8_t max);
+
+/**
+ * @brief Hardware status (TWSR & 0xF8) seen by the last operation.
+ * @return TWI status code from the datasheet tables, for diagnostics.
+ */
+uint8_t TwiHwStatus(void);
+
+#endif // TWI_H
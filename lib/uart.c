@@ -0,0 +1,261 @@
+/**
+ * @file uart.c
+ * @brief Interrupt-driven USART0 (the RS232 port): text output, input, and a zero-copy
+ *        binary stream for packets such as the telemetry frames (telemetry.h).
+ */
+
+#include "uart.h"
+#include "clock.h"
+#include "spsc.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stddef.h>
+
+#define UART_STREAM_MASK    (UART_STREAM_SIZE - 1)
+
+SPSC_QUEUE(UartTxQueue, uint8_t, UART_TX_SIZE)
+SPSC_QUEUE(UartRxQueue, uint8_t, UART_RX_SIZE)
+
+// Global variables
+static UartTxQueue_t uart_tx;
+static UartRxQueue_t uart_rx;
+static uint32_t uart_baud;
+static UartStatus_t uart_status;
+static volatile uint16_t uart_overruns;
+static bool uart_sent;                      // A byte went out since UartInit()
+static volatile bool uart_delimit;          // A 0x00 is due before the next packet
+
+// Stream ring: [length][packet]... written by the main loop, sent by the interrupt
+static uint8_t uart_stream[UART_STREAM_SIZE];
+static volatile uint8_t uart_stream_head;   // End of the published packets, producer only
+static volatile uint8_t uart_stream_tail;   // Start of the unsent packets, consumer only
+static uint8_t uart_stream_at;              // Length byte of the open reservation
+static uint8_t uart_stream_room;            // Its length
+static bool uart_stream_used;               // A packet was ever reserved: text gets a 0x00
+static uint8_t uart_send;                   // Next byte of the packet being sent
+static uint8_t uart_send_left;              // Bytes of it still to send
+
+static inline void uart_put(uint8_t c) {
+    UCSR0A = (1 << U2X0) | (1 << TXC0);     // Clear TXC0 for uart_wait_sent()
+    UDR0 = c;
+    uart_sent = true;
+}
+
+static inline void uart_packet_byte(void) {
+    uart_put(uart_stream[uart_send & UART_STREAM_MASK]);
+    uart_send++;
+    if (!--uart_send_left) uart_stream_tail = uart_send;
+}
+
+// Data register free: the rest of the packet, text, or the next packet
+static inline void uart_next(void) {
+    uint8_t c;
+
+    if (uart_send_left) {
+        uart_packet_byte();
+        return;
+    }
+    if (UartTxQueuePop(&uart_tx, &c)) {
+        uart_put(c);
+        uart_delimit = true;
+        return;
+    }
+    // Ends the text for a COBS decoder. Text with no stream in use keeps it pending, so the
+    // first packet still gets one after the boot text or a prompt.
+    if (uart_delimit && uart_stream_used) {
+        uart_delimit = false;
+        uart_put(0);
+        return;
+    }
+
+    uint8_t tail = uart_stream_tail;
+    if (tail != uart_stream_head) {
+        SPSC_BARRIER();
+        uint8_t length = uart_stream[tail & UART_STREAM_MASK];
+        if (!length) {                      // The rest of the ring is unused
+            tail |= UART_STREAM_MASK;
+            tail++;
+            length = uart_stream[tail & UART_STREAM_MASK];
+        }
+        uart_send = tail + 1;
+        uart_send_left = length;
+        uart_packet_byte();
+        return;
+    }
+    UCSR0B &= ~(1 << UDRIE0);
+}
+
+ISR(USART0_UDRE_vect) {
+    uart_next();
+}
+
+ISR(USART0_RX_vect) {
+    uint8_t c = UDR0;
+    if (!UartRxQueuePush(&uart_rx, c)) uart_overruns++;
+}
+
+// Send from the queues without the interrupt, e.g. while interrupts are disabled
+static void uart_poll(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (UCSR0A & (1 << UDRE0)) uart_next();
+    }
+}
+
+// Wait until the shift register is empty
+static void uart_wait_sent(void) {
+    while (!(UCSR0A & (1 << UDRE0)));
+    if (uart_sent) while (!(UCSR0A & (1 << TXC0)));
+}
+
+static void uart_rate(uint32_t hz) {
+    uint32_t ubrr = (hz + 4 * uart_baud) / (8 * uart_baud);
+    if (ubrr) ubrr--;
+    if (ubrr > 4095) ubrr = 4095;
+    uint32_t actual = hz / (8 * (ubrr + 1));
+    uint32_t error = (actual > uart_baud) ? actual - uart_baud : uart_baud - actual;
+
+    UBRR0H = ubrr >> 8;
+    UBRR0L = ubrr & 0xFF;
+    uart_status = (error * 1000 > uart_baud * UART_BAUD_TOLERANCE) ? UART_BAD_BAUD : UART_OK;
+}
+
+// Hold the interrupt and let the last byte out before the switch, then set the new rate
+static void uart_clock(ClockEvent_t event, uint32_t hz) {
+    if (event == CLOCK_PRE_CHANGE) {
+        UCSR0B &= ~(1 << UDRIE0);
+        uart_wait_sent();
+    } else {
+        uart_rate(hz);
+        UCSR0B |= (1 << UDRIE0);
+    }
+}
+
+/**
+ * @brief Set up USART0 for sending and receiving, 8N1.
+ */
+UartStatus_t UartInit(uint32_t baud) {
+    uart_tx = (UartTxQueue_t){ 0 };
+    uart_rx = (UartRxQueue_t){ 0 };
+    uart_stream_head = uart_stream_tail = 0;
+    uart_stream_used = false;
+    uart_send_left = 0;
+    uart_delimit = true;                    // Ends what a decoder had before a reset
+    uart_sent = false;
+    uart_overruns = 0;
+    uart_baud = baud ? baud : UART_BAUD;
+
+    UCSR0B = 0;
+    uart_rate(ClockHz());
+    UCSR0A = (1 << U2X0) | (1 << TXC0);
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    UCSR0B = (1 << RXCIE0) | (1 << RXEN0) | (1 << TXEN0);
+    ClockNotify(uart_clock);
+    return uart_status;
+}
+
+/**
+ * @brief Queue a character for sending, waiting while the queue is full.
+ */
+void UartPutc(char c) {
+    while (!UartTxQueuePush(&uart_tx, c)) uart_poll();
+    UCSR0B |= (1 << UDRIE0);
+}
+
+/**
+ * @brief Queue a string for sending.
+ */
+void UartPuts(const char *s) {
+    while (*s) UartPutc(*s++);
+}
+
+/**
+ * @brief Queue bytes for sending.
+ */
+void UartWrite(const void *data, uint8_t length) {
+    const uint8_t *p = data;
+    while (length--) UartPutc(*p++);
+}
+
+/**
+ * @brief Take a received byte.
+ */
+bool UartGetc(uint8_t *c) {
+    return UartRxQueuePop(&uart_rx, c);
+}
+
+/**
+ * @brief Free room in the text queue.
+ */
+uint8_t UartTxSpace(void) {
+    return UartTxQueueSpace(&uart_tx);
+}
+
+/**
+ * @brief Wait until the queued text is out.
+ */
+void UartFlush(void) {
+    while (UartTxQueueCount(&uart_tx) || (uart_delimit && uart_stream_used)) uart_poll();
+    uart_wait_sent();
+}
+
+/**
+ * @brief Room for a packet in the stream ring.
+ */
+uint8_t *UartStreamReserve(uint8_t length) {
+    uint8_t head = uart_stream_head;
+    uint8_t used = head - uart_stream_tail;
+    uint8_t at = head & UART_STREAM_MASK;
+    uint16_t pad = 0;
+
+    // Length byte and packet contiguous; the rest of the ring is skipped otherwise
+    if (at + length + 1 > UART_STREAM_SIZE) pad = UART_STREAM_SIZE - at;
+    if (!length || used + pad + length + 1 > UART_STREAM_SIZE - 1) return NULL;
+
+    uart_stream_used = true;
+    if (pad) {
+        uart_stream[at] = 0;
+        head += pad;
+        at = 0;
+    }
+    uart_stream_at = head;
+    uart_stream_room = length;
+    return &uart_stream[at + 1];
+}
+
+/**
+ * @brief Send the packet built in the room from UartStreamReserve().
+ */
+void UartStreamCommit(uint8_t length) {
+    if (!length || length > uart_stream_room) return;
+    uart_stream[uart_stream_at & UART_STREAM_MASK] = length;
+    uart_stream_room = 0;
+    SPSC_BARRIER();
+    uart_stream_head = uart_stream_at + 1 + length;
+    UCSR0B |= (1 << UDRIE0);
+}
+
+/**
+ * @brief Bytes of the stream ring in use.
+ */
+uint8_t UartStreamUsed(void) {
+    return uart_stream_head - uart_stream_tail;
+}
+
+/**
+ * @brief State of the rate for the current clock.
+ */
+UartStatus_t UartGetStatus(void) {
+    return uart_status;
+}
+
+/**
+ * @brief Received bytes lost because the queue was full.
+ */
+uint16_t UartOverruns(void) {
+    uint16_t count;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = uart_overruns;
+    }
+    return count;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file uart.h
+ * @brief Interrupt-driven USART0 (the RS232 port): text output, input, and a zero-copy
+ *        binary stream for packets such as the telemetry frames (telemetry.h).
+ * @details 8N1 with double speed (U2X), UBRR = (clock + 4 * baud) / (8 * baud) - 1. The
+ *          rates that are exact at 8 MHz are 125000, 250000 and 500000 (the same as the
+ *          bootloader's); 38400 and below are within 0.2 %. While the system clock is
+ *          divided (clock.h) UBRR is worked out again for the slower clock, after the byte
+ *          being sent has left the shift register.
+ *
+ *          USART0_UDRE_vect sends one byte per interrupt: first the rest of the packet
+ *          being sent, then queued text, then the next packet of the stream. A packet is
+ *          never split by text. When text went out and the stream is in use, a 0x00
+ *          follows the text, so a decoder that splits the stream at 0x00 (COBS) sees the
+ *          text as a frame of its own and drops it without losing the next packet. Text
+ *          sent before the stream is used (boot text, a shell prompt, whatever a decoder
+ *          had before a reset) gets its 0x00 in front of the first packet.
+ *
+ *          The stream is a ring of UART_STREAM_SIZE bytes: UartStreamReserve() hands out
+ *          contiguous room for a packet, the caller builds the packet in place and
+ *          UartStreamCommit() publishes it. Each packet is kept with a length byte in
+ *          front; a packet that doesn't fit before the end of the ring starts over at its
+ *          beginning. The interrupt only reads the ring and the caller only writes it (as
+ *          in spsc.h), so neither side disables interrupts. The interrupt makes no calls,
+ *          so it saves few registers: about 45 cycles per byte at -Os, counted from the
+ *          instruction sequence. At 250000 baud (25000 bytes/s) that is 14 % of the CPU at
+ *          8 MHz for a link kept busy; 7 % at 125000.
+ *
+ *          USART0_RX_vect queues received bytes for UartGetc(); bytes that find the queue
+ *          full are counted in UartOverruns().
+ *
+ * @note UartPutc() waits while the text queue is full: it then sends from the queue itself
+ *       whenever the data register is free, so it also works with interrupts disabled,
+ *       only slower. Reserve and commit stream packets from one context only (the main
+ *       loop, or one interrupt).
+ */
+
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef UART_BAUD
+#define UART_BAUD           250000UL    ///< Default rate of UartInit(0)
+#endif
+#ifndef UART_STREAM_SIZE
+#define UART_STREAM_SIZE    256         ///< Stream ring: 64, 128 or 256 bytes
+#endif
+#define UART_TX_SIZE        64          ///< Text queue
+#define UART_RX_SIZE        32          ///< Receive queue
+#define UART_BAUD_TOLERANCE 20          ///< Largest rate error accepted, in 0.1 %
+
+#if UART_STREAM_SIZE != 64 && UART_STREAM_SIZE != 128 && UART_STREAM_SIZE != 256
+#error "UART_STREAM_SIZE must be 64, 128 or 256"
+#endif
+
+typedef enum {
+    UART_OK = 0,
+    UART_BAD_BAUD           ///< Not within 2 % at the current clock; the nearest rate is used
+} UartStatus_t;
+
+/**
+ * @brief Set up USART0 for sending and receiving, 8N1.
+ * @param baud Bit rate, 0 for UART_BAUD.
+ * @return UART_OK, or UART_BAD_BAUD if the rate is off by more than UART_BAUD_TOLERANCE.
+ * @note Enable interrupts afterwards (sei()).
+ */
+UartStatus_t UartInit(uint32_t baud);
+
+/**
+ * @brief Queue a character for sending, waiting while the queue is full.
+ * @param c Character.
+ */
+void UartPutc(char c);
+
+/**
+ * @brief Queue a string for sending.
+ * @param s String.
+ */
+void UartPuts(const char *s);
+
+/**
+ * @brief Queue bytes for sending.
+ * @param data Bytes.
+ * @param length Number of bytes.
+ */
+void UartWrite(const void *data, uint8_t length);
+
+/**
+ * @brief Take a received byte.
+ * @param c Destination.
+ * @return false if nothing was received.
+ */
+bool UartGetc(uint8_t *c);
+
+/**
+ * @brief Free room in the text queue.
+ * @return Characters that UartPutc() takes now without waiting.
+ */
+uint8_t UartTxSpace(void);
+
+/**
+ * @brief Wait until the queued text is out.
+ */
+void UartFlush(void);
+
+/**
+ * @brief Room for a packet in the stream ring.
+ * @param length Packet length in bytes.
+ * @return Contiguous room for the packet, or NULL if the ring hasn't got it now.
+ * @note Only one reservation is open at a time; the next one replaces it.
+ */
+uint8_t *UartStreamReserve(uint8_t length);
+
+/**
+ * @brief Send the packet built in the room from UartStreamReserve().
+ * @param length Bytes to send, at most the reserved length (0 drops the reservation).
+ */
+void UartStreamCommit(uint8_t length);
+
+/**
+ * @brief Bytes of the stream ring in use (packets waiting, length bytes included).
+ * @return Fill level.
+ */
+uint8_t UartStreamUsed(void);
+
+/**
+ * @brief State of the rate for the current clock.
+ * @return UART_OK or UART_BAD_BAUD.
+ */
+UartStatus_t UartGetStatus(void);
+
+/**
+ * @brief Received bytes lost because the queue was full.
+ * @return Count since UartInit().
+ */
+uint16_t UartOverruns(void);
+
+#endif // UART_H
@@ -0,0 +1,463 @@
+/**
+ * @file board.c
+ * @brief Virtual BK-AVR128 for headless simavr runs: plays a script of key presses and
+ *        checks what the firmware shows on the LCDs, the 7-segment display, the LEDs and
+ *        the buzzer.
+ * @details Peripheral models attached to an ATmega128 in simavr:
+ *          - LCD1602 on J14: an HD44780 (host/hd44780.c) decoding E falling edges on PB7
+ *            with RS = PB5, RW = PB6 and the data on PORTA;
+ *          - I2C LCD: a PCF8574 backpack on the TWI bus (address 0x27, -a to change)
+ *            driving a second HD44780 (P0 = RS, P1 = RW, P2 = E, P4-P7 = D4-D7);
+ *          - the 74HC573 latches: segments U4 (PORTC, LE = PF1), digits U5 (PORTA, LE = PF2)
+ *            and LEDs U6 (PORTA, LE = PF3). A latch is transparent while its LE is high, or
+ *            while PFn is not an output. The digit shown in each position is the segment
+ *            pattern held there for at least 200 us during the last 50 ms (the eye
+ *            ignores the blanking between digits); LEDs are active low;
+ *          - the 4x4 keypad and the four buttons on PORTD (host/keymatrix.c);
+ *          - the buzzer on PE7: every edge is counted (and logged with -e).
+ *
+ *          Script, one command per line (# starts a comment, times in us, ms or s):
+ *
+ *              wait 300ms                      run the firmware
+ *              key 5 down / key 5 up           keypad key 1-16 (KeypadRead() numbering)
+ *              press 5 [100ms]                 key down, wait, key up
+ *              button 2 down / button 2 up     buttons 1-4 (PD0-PD3)
+ *              expect lcd 0 "Hello"            row of the J14 LCD contains the text
+ *              expect i2c 1 "rocks"            row of the I2C LCD contains the text
+ *              expect seg "12345678"           7-segment digits, leftmost first
+ *              expect leds "10000000"          LED1-LED8, 1 = lit more than half of the
+ *                                              last wait
+ *              expect buzzer on|off            PE7 level
+ *              expect edges 2 [4]              PE7 edges during the last wait (min, max)
+ *              show                            print the board
+ *
+ *          The board is printed at the end. The exit status is 1 when an expectation
+ *          fails or the firmware crashes.
+ *
+ * @note Optional (make sim-board): not built by make host-test or CI, and not yet compiled
+ *       or run against a simavr install.
+ *
+ * Usage: boardsim [-w columns] [-a i2c_address] [-e edges.txt] firmware.elf script.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_twi.h>
+#include "hal.h"
+#include "hd44780.h"
+#include "keymatrix.h"
+
+// ATmega128 data-space addresses
+#define ADDR_PORTA      0x3B
+#define ADDR_PORTC      0x35
+#define ADDR_DDRD       0x31
+#define ADDR_PORTD      0x32
+#define ADDR_DDRF       0x61
+#define ADDR_PORTF      0x62
+
+#define CYCLES_PER_US   (F_CPU / 1000000UL)
+#define SEG_HOLD        (200 * CYCLES_PER_US)       // Shorter patterns are not seen
+#define SEG_VISIBLE     (50000 * CYCLES_PER_US)     // Digits not refreshed since are dark
+#define DIGITS          8
+
+// 74HC573 on PORTF
+typedef enum { LATCH_SEGMENTS, LATCH_DIGITS, LATCH_LEDS, LATCH_COUNT } Latch_t;
+
+static const uint8_t latch_le[LATCH_COUNT] = { 1, 2, 3 };                   // PF1-PF3
+static const uint16_t latch_data[LATCH_COUNT] = { ADDR_PORTC, ADDR_PORTA, ADDR_PORTA };
+
+// Segment patterns (a = bit 0 ... g = bit 6, lit = 1) and what they show
+static const struct {
+    uint8_t pattern;
+    char c;
+} seg_font[] = {
+    { 0x3F, '0' }, { 0x06, '1' }, { 0x5B, '2' }, { 0x4F, '3' }, { 0x66, '4' },
+    { 0x6D, '5' }, { 0x7D, '6' }, { 0x07, '7' }, { 0x7F, '8' }, { 0x6F, '9' },
+    { 0x77, 'A' }, { 0x7C, 'b' }, { 0x39, 'C' }, { 0x5E, 'd' }, { 0x79, 'E' },
+    { 0x71, 'F' }, { 0x40, '-' }, { 0x00, ' ' }
+};
+
+// Global variables
+static avr_t *avr;
+static Hd44780_t lcd, i2c_lcd;
+static KeyMatrix_t km;
+static uint8_t columns = 16;
+static FILE *edge_log;
+
+static uint8_t portb;
+static uint8_t latch_q[LATCH_COUNT];
+static uint8_t seg_pattern[DIGITS];                 // Segment latch byte (active low)
+static avr_cycle_count_t seg_seen[DIGITS];          // When it was last shown
+static bool seg_ever[DIGITS];
+static avr_cycle_count_t seg_since;                 // Current digits/segments since
+static uint32_t led_on[8];                          // Lit cycles since the window start
+static avr_cycle_count_t led_since, window_start;
+
+static uint8_t pcf_address = 0x27;
+static bool pcf_selected;
+static uint8_t pcf_port;
+static avr_irq_t *twi_input;
+
+static avr_irq_t *portd_pins[8];
+static bool buzzer;
+static uint32_t buzzer_edges;                       // Since the window start
+static int cpu_state = cpu_Running;
+
+// Keep the HAL clock (used by the HD44780 timing checks) at the simulated cycle count
+static void sync_clock(void) {
+    if (avr->cycle > HalCycles()) HalAdvance(avr->cycle - HalCycles());
+}
+
+// J14 LCD: E falling edge on PB7
+static void portb_write(struct avr_irq_t *irq, uint32_t value, void *param) {
+    (void)irq;
+    (void)param;
+    if ((portb & 0x80) && !(value & 0x80)) {
+        sync_clock();
+        Hd44780Strobe(&lcd, value & 0x20, value & 0x40, avr->data[ADDR_PORTA]);
+    }
+    portb = value;
+}
+
+// PCF8574 at pcf_address; messages as in simavr's i2c_eeprom part
+static void twi_message(struct avr_irq_t *irq, uint32_t value, void *param) {
+    avr_twi_msg_irq_t v;
+    (void)irq;
+    (void)param;
+    v.u.v = value;
+
+    if (v.u.twi.msg & TWI_COND_STOP) pcf_selected = false;
+    if (v.u.twi.msg & TWI_COND_START) {
+        pcf_selected = (v.u.twi.addr >> 1) == pcf_address && !(v.u.twi.addr & 1);
+        if (pcf_selected) avr_raise_irq(twi_input, avr_twi_irq_msg(TWI_COND_ACK, v.u.twi.addr, 1));
+    }
+    if (pcf_selected && (v.u.twi.msg & TWI_COND_WRITE)) {
+        uint8_t port = v.u.twi.data;
+        avr_raise_irq(twi_input, avr_twi_irq_msg(TWI_COND_ACK, pcf_address << 1, 1));
+        if ((pcf_port & 0x04) && !(port & 0x04)) {
+            sync_clock();
+            Hd44780Strobe(&i2c_lcd, port & 0x01, port & 0x02, port & 0xF0);
+        }
+        pcf_port = port;
+    }
+}
+
+// Credit the time since the last change to the digits and LEDs shown meanwhile
+static void account(bool restart) {
+    avr_cycle_count_t now = avr->cycle;
+    if (now - seg_since >= SEG_HOLD) {
+        for (uint8_t d = 0; d < DIGITS; d++) {
+            if (!(latch_q[LATCH_DIGITS] & (1 << d))) continue;
+            seg_pattern[d] = latch_q[LATCH_SEGMENTS];
+            seg_seen[d] = now;
+            seg_ever[d] = true;
+        }
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        if (!(latch_q[LATCH_LEDS] & (1 << i))) led_on[i] += now - led_since;
+    }
+    led_since = now;
+    if (restart) seg_since = now;
+}
+
+// PORTA, PORTC, PORTF or DDRF changed: transparent latches follow their data port
+static void latch_update(struct avr_irq_t *irq, uint32_t value, void *param) {
+    uint8_t ddrf = avr->data[ADDR_DDRF];
+    uint8_t portf = avr->data[ADDR_PORTF];
+    uint8_t q[LATCH_COUNT];
+    (void)irq;
+    (void)value;
+    (void)param;
+
+    for (uint8_t l = 0; l < LATCH_COUNT; l++) {
+        uint8_t bit = 1 << latch_le[l];
+        bool le = (ddrf & bit) ? (portf & bit) : true;
+        q[l] = le ? avr->data[latch_data[l]] : latch_q[l];
+    }
+    if (memcmp(q, latch_q, sizeof(q))) {
+        account(true);
+        memcpy(latch_q, q, sizeof(q));
+    }
+}
+
+// PORTD, DDRD or a key changed: drive the input pins like the keypad and buttons would
+static void keypad_update(void) {
+    uint8_t ddr = avr->data[ADDR_DDRD];
+    uint8_t level = KeyMatrixLevels(&km, ddr, avr->data[ADDR_PORTD]);
+    for (uint8_t i = 0; i < 8; i++) {
+        if (!(ddr & (1 << i))) avr_raise_irq(portd_pins[i], (level >> i) & 1);
+    }
+}
+
+static void portd_write(struct avr_irq_t *irq, uint32_t value, void *param) {
+    (void)irq;
+    (void)value;
+    (void)param;
+    keypad_update();
+}
+
+static void buzzer_pin(struct avr_irq_t *irq, uint32_t value, void *param) {
+    (void)irq;
+    (void)param;
+    if (!!value == buzzer) return;
+    buzzer = value;
+    buzzer_edges++;
+    if (edge_log) fprintf(edge_log, "%llu %d\n", (unsigned long long)avr->cycle, buzzer);
+}
+
+static void attach(void) {
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), IOPORT_IRQ_REG_PORT),
+                            portb_write, NULL);
+
+    twi_input = avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT),
+                            twi_message, NULL);
+
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('A'), IOPORT_IRQ_REG_PORT),
+                            latch_update, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), IOPORT_IRQ_REG_PORT),
+                            latch_update, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('F'), IOPORT_IRQ_REG_PORT),
+                            latch_update, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('F'), IOPORT_IRQ_DIRECTION_ALL),
+                            latch_update, NULL);
+
+    for (uint8_t i = 0; i < 8; i++) portd_pins[i] = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), i);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), IOPORT_IRQ_REG_PORT),
+                            portd_write, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), IOPORT_IRQ_DIRECTION_ALL),
+                            portd_write, NULL);
+    keypad_update();
+
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('E'), 7), buzzer_pin, NULL);
+}
+
+// Run the firmware; false once it has stopped (done or crashed)
+static bool run_for(avr_cycle_count_t cycles) {
+    avr_cycle_count_t end = avr->cycle + cycles;
+    while (avr->cycle < end) {
+        if (cpu_state == cpu_Done || cpu_state == cpu_Crashed) return false;
+        cpu_state = avr_run(avr);
+    }
+    return true;
+}
+
+static void lcd_row(Hd44780_t *model, uint8_t row, char *buf) {
+    sync_clock();
+    Hd44780Row(model, row, buf, columns);
+}
+
+static void seg_text(char *buf) {
+    char *p = buf;
+    account(false);
+    for (uint8_t d = 0; d < DIGITS; d++) {
+        uint8_t lit = ~seg_pattern[d];
+        char c = '?';
+        if (!seg_ever[d] || avr->cycle - seg_seen[d] > SEG_VISIBLE) lit = 0;
+        for (uint8_t i = 0; i < sizeof(seg_font) / sizeof(seg_font[0]); i++) {
+            if (seg_font[i].pattern == (lit & 0x7F)) c = seg_font[i].c;
+        }
+        *p++ = c;
+        if (lit & 0x80) *p++ = '.';
+    }
+    *p = '\0';
+}
+
+static void led_text(char *buf) {
+    avr_cycle_count_t window = avr->cycle - window_start;
+    account(false);
+    for (uint8_t i = 0; i < 8; i++) {
+        bool lit = window ? led_on[i] * 2 > window : !(latch_q[LATCH_LEDS] & (1 << i));
+        buf[i] = lit ? '1' : '0';
+    }
+    buf[8] = '\0';
+}
+
+static void show(void) {
+    char buf[64];
+    printf("  +%.*s+   +%.*s+\n", columns, "----------------------------------------",
+           columns, "----------------------------------------");
+    for (uint8_t row = 0; row < 2; row++) {
+        char other[64];
+        lcd_row(&lcd, row, buf);
+        lcd_row(&i2c_lcd, row, other);
+        printf("  |%s|   |%s|\n", buf, other);
+    }
+    printf("  +%.*s+   +%.*s+\n", columns, "----------------------------------------",
+           columns, "----------------------------------------");
+    seg_text(buf);
+    printf("  7-seg [%s]", buf);
+    led_text(buf);
+    printf("  LEDs %s  buzzer %s (%u edges)  %.3f s\n", buf, buzzer ? "on" : "off",
+           buzzer_edges, avr->cycle / (double)F_CPU);
+}
+
+// "300ms", "2s", "150us" in cycles
+static bool parse_time(const char *text, avr_cycle_count_t *cycles) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text) return false;
+    if (!strcmp(end, "us")) value *= 1e-6;
+    else if (!strcmp(end, "ms")) value *= 1e-3;
+    else if (strcmp(end, "s")) return false;
+    *cycles = (avr_cycle_count_t)(value * F_CPU + 0.5);
+    return true;
+}
+
+// Split a line into words; a "quoted string" is one word
+static int split(char *line, char *words[], int max) {
+    int n = 0;
+    char *p = line;
+    while (n < max) {
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p || *p == '#') break;
+        if (*p == '"') {
+            words[n++] = ++p;
+            while (*p && *p != '"') p++;
+        } else {
+            words[n++] = p;
+            while (*p && !isspace((unsigned char)*p)) p++;
+        }
+        if (*p) *p++ = '\0';
+    }
+    return n;
+}
+
+static void start_window(void) {
+    account(false);
+    memset(led_on, 0, sizeof(led_on));
+    window_start = avr->cycle;
+    buzzer_edges = 0;
+}
+
+// Check one expectation; prints the reason when it fails
+static bool expect(char *words[], int n, const char *where) {
+    char buf[64];
+    const char *what = words[1];
+
+    if ((!strcmp(what, "lcd") || !strcmp(what, "i2c")) && n == 4) {
+        lcd_row(!strcmp(what, "lcd") ? &lcd : &i2c_lcd, atoi(words[2]), buf);
+        if (strstr(buf, words[3])) return true;
+        printf("%s: %s row %s: \"%s\", expected \"%s\"\n", where, what, words[2], buf, words[3]);
+    } else if (!strcmp(what, "seg") && n == 3) {
+        seg_text(buf);
+        if (!strcmp(buf, words[2])) return true;
+        printf("%s: 7-seg \"%s\", expected \"%s\"\n", where, buf, words[2]);
+    } else if (!strcmp(what, "leds") && n == 3) {
+        led_text(buf);
+        if (!strcmp(buf, words[2])) return true;
+        printf("%s: LEDs %s, expected %s\n", where, buf, words[2]);
+    } else if (!strcmp(what, "buzzer") && n == 3) {
+        if (buzzer == !strcmp(words[2], "on")) return true;
+        printf("%s: buzzer %s, expected %s\n", where, buzzer ? "on" : "off", words[2]);
+    } else if (!strcmp(what, "edges") && (n == 3 || n == 4)) {
+        uint32_t min = atoi(words[2]);
+        uint32_t max = (n == 4) ? (uint32_t)atoi(words[3]) : min;
+        if (buzzer_edges >= min && buzzer_edges <= max) return true;
+        printf("%s: %u buzzer edges, expected %u-%u\n", where, buzzer_edges, min, max);
+    } else {
+        printf("%s: bad expect\n", where);
+    }
+    return false;
+}
+
+static int run_script(const char *path) {
+    FILE *f = fopen(path, "r");
+    char line[256], where[300];
+    int failures = 0;
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    for (int number = 1; fgets(line, sizeof(line), f); number++) {
+        char *words[6];
+        avr_cycle_count_t cycles = 100000 * CYCLES_PER_US;
+        int n = split(line, words, 6);
+        snprintf(where, sizeof(where), "%s:%d", path, number);
+        if (n == 0) continue;
+
+        if (!strcmp(words[0], "wait") && n == 2 && parse_time(words[1], &cycles)) {
+            start_window();
+            run_for(cycles);
+        } else if (!strcmp(words[0], "key") && n == 3) {
+            KeyMatrixSet(&km, atoi(words[1]), !strcmp(words[2], "down"));
+            keypad_update();
+        } else if (!strcmp(words[0], "press") && (n == 2 || (n == 3 && parse_time(words[2], &cycles)))) {
+            KeyMatrixSet(&km, atoi(words[1]), 1);
+            keypad_update();
+            start_window();
+            run_for(cycles);
+            KeyMatrixSet(&km, atoi(words[1]), 0);
+            keypad_update();
+        } else if (!strcmp(words[0], "button") && n == 3) {
+            uint8_t bit = 1 << (atoi(words[1]) - 1);
+            if (!strcmp(words[2], "down")) km.buttons |= bit;
+            else km.buttons &= ~bit;
+            keypad_update();
+        } else if (!strcmp(words[0], "expect") && n >= 3) {
+            if (!expect(words, n, where)) failures++;
+        } else if (!strcmp(words[0], "show")) {
+            show();
+        } else {
+            printf("%s: unknown command\n", where);
+            failures++;
+        }
+        if (cpu_state == cpu_Crashed) {
+            printf("%s: firmware crashed at pc 0x%05x\n", where, avr->pc);
+            failures++;
+            break;
+        }
+    }
+    fclose(f);
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    elf_firmware_t firmware = { { 0 } };
+    const char *elf = NULL, *script = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-w") && i + 1 < argc) columns = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-a") && i + 1 < argc) pcf_address = strtol(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc) edge_log = fopen(argv[++i], "w");
+        else if (!elf) elf = argv[i];
+        else script = argv[i];
+    }
+    if (!elf || !script || columns < 1 || columns > 40) {
+        fprintf(stderr, "usage: %s [-w columns] [-a i2c_address] [-e edges.txt] firmware.elf script.txt\n",
+                argv[0]);
+        return 2;
+    }
+    if (elf_read_firmware(elf, &firmware) != 0) {
+        fprintf(stderr, "%s: can't read the firmware\n", elf);
+        return 2;
+    }
+
+    avr = avr_make_mcu_by_name("atmega128");
+    if (!avr) return 2;
+    avr_init(avr);
+    firmware.frequency = F_CPU;
+    avr_load_firmware(avr, &firmware);
+
+    HalReset();
+    Hd44780Init(&lcd);
+    Hd44780Init(&i2c_lcd);
+    attach();
+
+    int failures = run_script(script);
+    show();
+    if (edge_log) fclose(edge_log);
+    if (failures < 0) return 2;
+    if (lcd.busy_violations || i2c_lcd.busy_violations) {
+        printf("HD44780 busy violations: %u (J14), %u (I2C)\n", lcd.busy_violations, i2c_lcd.busy_violations);
+    }
+    return failures ? 1 : 0;
+}
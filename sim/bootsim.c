@@ -0,0 +1,63 @@
+/**
+ * @file bootsim.c
+ * @brief Runs the bootloader in simavr with USART0 on a pty, for trying `make upload`
+ *        without a board.
+ * @details Loads the bootloader ELF (linked at BOOT_START) into an ATmega128, starts it at
+ *          the boot reset vector like the programmed BOOTRST fuse does and connects USART0
+ *          to a pseudo terminal with simavr's uart_pty part (/tmp/simavr-uart0). Then, in
+ *          another terminal:
+ *
+ *              make upload PROJECT=LedBlink UPLOAD_PORT=/tmp/simavr-uart0
+ *
+ *          An optional application ELF is loaded at address 0 first, to try the page skip
+ *          and the start of the application. The simulation runs until the firmware sleeps
+ *          with interrupts off or crashes.
+ *
+ * Usage: bootsim bootloader.elf [application.elf]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include "uart_pty.h"
+#include "../bootloader/protocol.h"
+
+static uart_pty_t uart_pty;
+
+int main(int argc, char *argv[]) {
+    elf_firmware_t boot = { { 0 } };
+    elf_firmware_t app = { { 0 } };
+    avr_t *avr;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s bootloader.elf [application.elf]\n", argv[0]);
+        return 2;
+    }
+    if (elf_read_firmware(argv[1], &boot) != 0 || (argc == 3 && elf_read_firmware(argv[2], &app) != 0)) {
+        fprintf(stderr, "%s: can't read the firmware\n", argv[0]);
+        return 1;
+    }
+
+    avr = avr_make_mcu_by_name("atmega128");
+    if (!avr) return 1;
+    avr_init(avr);
+    if (argc == 3) memcpy(avr->flash, app.flash, app.flashsize);
+    boot.frequency = F_CPU;
+    avr_load_firmware(avr, &boot);      // At its flashbase, BOOT_START
+
+    // BOOTRST programmed: every reset starts in the boot section
+    avr->reset_pc = BOOT_START;
+    avr->pc = BOOT_START;
+
+    uart_pty_init(avr, &uart_pty);
+    uart_pty_connect(&uart_pty, '0');
+    printf("USART0 on /tmp/simavr-uart0, waiting for bkboot...\n");
+    fflush(stdout);
+
+    int state = cpu_Running;
+    while (state != cpu_Done && state != cpu_Crashed) state = avr_run(avr);
+
+    uart_pty_stop(&uart_pty);
+    return state == cpu_Crashed;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file trace.c
+ * @brief simavr firmware section: VCD trace of the LCD and TWI lines.
+ * @details Linked into a project by `make sim-timing`. simavr reads the .mmcu section,
+ *          runs the firmware at F_CPU and writes every change of the listed register bits
+ *          to SIM_VCD_FILE, which tools/vcdcheck then checks against the HD44780 and I2C
+ *          limits. The section is never loaded into the ATmega128, so the firmware itself
+ *          is unchanged.
+ * @note simavr models TWI at the byte level, so SCL/SDA are not traced; the TWCR/TWDR
+ *       writes give the frame and byte timing instead.
+ */
+
+#include <avr/io.h>
+#include "simavr/avr/avr_mcu_section.h"
+
+#ifndef SIM_VCD_FILE
+#define SIM_VCD_FILE "trace.vcd"
+#endif
+
+AVR_MCU(F_CPU, "atmega128");
+AVR_MCU_VCD_FILE(SIM_VCD_FILE, 1000);
+
+// Signal names as expected by tools/vcdcheck
+const struct avr_mmcu_vcd_trace_t sim_trace[] _MMCU_ = {
+    { AVR_MCU_VCD_SYMBOL("RS"), .mask = (1 << PB5), .what = (void *)&PORTB, },
+    { AVR_MCU_VCD_SYMBOL("RW"), .mask = (1 << PB6), .what = (void *)&PORTB, },
+    { AVR_MCU_VCD_SYMBOL("EN"), .mask = (1 << PB7), .what = (void *)&PORTB, },
+    { AVR_MCU_VCD_SYMBOL("DATA"), .mask = 0xFF, .what = (void *)&PORTA, },
+    { AVR_MCU_VCD_SYMBOL("TWBR"), .mask = 0xFF, .what = (void *)&TWBR, },
+    { AVR_MCU_VCD_SYMBOL("TWPS"), .mask = (1 << TWPS1) | (1 << TWPS0), .what = (void *)&TWSR, },
+    { AVR_MCU_VCD_SYMBOL("TWCR"), .mask = 0xFF, .what = (void *)&TWCR, },
+    { AVR_MCU_VCD_SYMBOL("TWDR"), .mask = 0xFF, .what = (void *)&TWDR, },
+};
@@ -0,0 +1,76 @@
+// Microbenchmarks of the formatting and decoding paths: host time per call and, for the
+// paths that touch the hardware, the AVR time their register accesses and delays add up
+// to at F_CPU (bus+delay; the formatting arithmetic itself isn't in it)
+#include <avr/io.h>
+#include "lcd.h"
+#include "i2c_lcd.h"
+#include "glcd.h"
+#include "arbiter.h"
+#include "keypad.h"
+#include "hd44780.h"
+#include "twi_bus.h"
+#include "pcf8574.h"
+#include "keymatrix.h"
+#include "timer3.h"
+#include "test.h"
+
+#define ITERATIONS  20000L
+
+static Hd44780_t lcd;
+static TwiBus_t bus;
+static Pcf8574_t pcf;
+static KeyMatrix_t km;
+static Timer3_t timer3;
+
+static void bench_lcd(void) {
+    Hd44780Init(&lcd);
+    Hd44780AttachParallel(&lcd, HAL_ADDR(PORTB), PB5, PB6, PB7, HAL_ADDR(PORTA));
+    Timer3Attach(&timer3);
+    LcdInit(LCD_MODE_4BIT);
+    LcdStart(2, 16);
+    BENCH("LcdPrintInt(-1234567)", ITERATIONS, LcdPrintInt(-1234567));
+    BENCH("LcdSetCursor(1, 4)", ITERATIONS, LcdSetCursor(1, 4));
+}
+
+static void bench_i2c_lcd(void) {
+    TwiBusAttach(&bus);
+    Pcf8574Init(&pcf, &bus, 0x27);
+    Hd44780Init(&lcd);
+    Pcf8574AttachLcd(&pcf, &lcd);
+    Timer3Attach(&timer3);
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+    BENCH("I2C_LcdPrintInt(-1234567)", ITERATIONS, I2C_LcdPrintInt(-1234567));
+}
+
+static void bench_segments(void) {
+    BENCH("ArbSegPrintInt(-1234567)", ITERATIONS, ArbSegPrintInt(-1234567));
+}
+
+static void bench_glcd(void) {
+    GlcdInit(GLCD_MODE_PARALLEL);
+    BENCH("GlcdPrint 21 chars", ITERATIONS, GlcdPrint(0, 0, "BK-AVR128 host bench!", GLCD_BLACK));
+    BENCH("GlcdFlush (one line)", ITERATIONS / 10,
+          { GlcdPrint(0, 8, "0123456789", GLCD_BLACK); GlcdPrint(0, 8, "9876543210", GLCD_BLACK); GlcdFlush(); });
+}
+
+static void bench_keypad(void) {
+    KeyMatrixAttach(&km);
+    KeypadInit();
+    BENCH("KeypadRead (idle)", ITERATIONS, KeypadRead());
+}
+
+int main(void) {
+    printf("bench_format (%ld iterations)\n", ITERATIONS);
+    HalReset();
+    bench_lcd();
+    HalReset();
+    bench_i2c_lcd();
+    HalReset();
+    bench_segments();
+    HalReset();
+    bench_glcd();
+    HalReset();
+    bench_keypad();
+    return 0;
+}
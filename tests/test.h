@@ -0,0 +1,75 @@
+/**
+ * @file test.h
+ * @brief Minimal test and benchmark helpers for the host build (make host-test).
+ * @details Each test is a function run by RUN() on a freshly reset HAL. CHECK() and
+ *          CHECK_EQ() report the failing line and keep going; TEST_REPORT() prints the
+ *          summary and returns the exit code for main(). BENCH() times a statement on the
+ *          host and reports the AVR time its register accesses and delays take at F_CPU.
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "hal.h"
+
+static int test_failures __attribute__((unused));
+static int test_checks __attribute__((unused));
+
+#define CHECK(cond) do { \
+    test_checks++; \
+    if (!(cond)) { \
+        test_failures++; \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+    long long test_a = (long long)(actual), test_e = (long long)(expected); \
+    test_checks++; \
+    if (test_a != test_e) { \
+        test_failures++; \
+        printf("  FAIL %s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__, #actual, test_a, test_e); \
+    } \
+} while (0)
+
+#define CHECK_STR(actual, expected) do { \
+    test_checks++; \
+    if (strcmp((actual), (expected)) != 0) { \
+        test_failures++; \
+        printf("  FAIL %s:%d: %s == \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, (actual), (expected)); \
+    } \
+} while (0)
+
+#define RUN(test) do { \
+    int test_before = test_failures; \
+    HalReset(); \
+    test(); \
+    printf("%s %s\n", test_failures == test_before ? "ok  " : "FAIL", #test); \
+} while (0)
+
+#define TEST_REPORT() \
+    (printf("%d checks, %d failed\n", test_checks, test_failures), test_failures ? 1 : 0)
+
+static inline double test_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Host ns/op and the AVR us/op that the register accesses and delays of a statement add
+// up to (the HAL doesn't count computation, so a statement without I/O shows none)
+#define BENCH(name, iterations, stmt) do { \
+    uint64_t bench_cycles = HalCycles(); \
+    double bench_start = test_now_ns(); \
+    for (long bench_i = 0; bench_i < (iterations); bench_i++) { stmt; } \
+    double bench_ns = (test_now_ns() - bench_start) / (iterations); \
+    uint64_t bench_io = HalCycles() - bench_cycles; \
+    printf("  %-28s %10.1f ns/op host", name, bench_ns); \
+    if (bench_io) printf(" %10.1f us/op bus+delay avr", (double)bench_io / (iterations) * 1e6 / F_CPU); \
+    printf("\n"); \
+} while (0)
+
+#endif // TEST_H
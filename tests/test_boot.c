@@ -0,0 +1,231 @@
+// Serial bootloader (bootloader/) against the upload tool (tools/bkboot.c) over a socketpair
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+// The bootloader's jump to the application comes back here
+static jmp_buf app_jump;
+static bool app_started;
+#define BOOT_JUMP_APP()     (app_started = true, longjmp(app_jump, 1))
+
+#define main boot_main
+#include "../bootloader/main.c"
+#undef main
+#define BKBOOT_NO_MAIN
+#include "../tools/bkboot.c"
+#include "usart.h"
+#include "flash.h"
+#include "test.h"
+
+#define IMAGE_SIZE      3000    // 12 pages, the last one partly used
+
+static Usart_t usart;
+static uint8_t image[BOOT_START];
+static pthread_t boot_thread;
+static int host_fd, board_fd;
+
+// Reset of the board: the bootloader's RAM is cleared, the flash keeps its contents
+static void board_reset(uint8_t mcucsr) {
+    app_started = false;
+    rx_buf = 0;
+    flash_state = FLASH_IDLE;
+    app_erased = false;
+    HalReset();
+    HalSet(HAL_ADDR(MCUCSR), mcucsr);
+    UsartAttach(&usart);
+}
+
+static void boot_run(void) {
+    if (!setjmp(app_jump)) boot_main();
+}
+
+static void *boot_thread_main(void *arg) {
+    (void)arg;
+    boot_run();
+    return NULL;
+}
+
+// Start the bootloader after the RESET button, connected to host_fd
+static void board_start(void) {
+    int sv[2];
+    board_reset(1 << EXTRF);
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    UsartBridge(&usart, sv[0]);
+    board_fd = sv[0];
+    host_fd = sv[1];
+    pthread_create(&boot_thread, NULL, boot_thread_main, NULL);
+}
+
+static void board_stop(bool ok) {
+    if (!ok) pthread_cancel(boot_thread);
+    pthread_join(boot_thread, NULL);
+    close(host_fd);
+    close(board_fd);
+}
+
+static bool upload(BkStats_t *stats) {
+    board_start();
+    bool ok = bkboot_session(host_fd, image, IMAGE_SIZE, stats);
+    board_stop(ok);
+    return ok;
+}
+
+static void make_image(uint32_t seed) {
+    memset(image, 0xFF, sizeof(image));
+    for (uint32_t i = 0; i < IMAGE_SIZE; i++) {
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+    image[0] = 0x0C;        // jmp
+    image[1] = 0x94;
+}
+
+static void test_upload(void) {
+    BkStats_t stats;
+    FlashReset();
+    make_image(1);
+
+    CHECK(upload(&stats));
+    CHECK(app_started);
+    CHECK_EQ(memcmp(hal_flash.mem, image, BOOT_START), 0);
+    CHECK_EQ(stats.pages, 12);
+    CHECK_EQ(stats.written, 12);
+    CHECK_EQ(hal_flash.writes, 12);
+    CHECK_EQ(hal_flash.spm_violations, 0);
+    CHECK_EQ(hal_flash.rww_violations, 0);
+    CHECK_EQ(HalGet(HAL_ADDR(UCSR0B)), 0);      // USART handed over in its reset state
+}
+
+static void test_skip_unchanged(void) {
+    BkStats_t stats;
+    FlashReset();
+    make_image(2);
+    CHECK(upload(&stats));
+
+    // Same image again: nothing is programmed
+    uint32_t erases = hal_flash.erases;
+    CHECK(upload(&stats));
+    CHECK_EQ(stats.written, 0);
+    CHECK_EQ(stats.skipped, 12);
+    CHECK_EQ(hal_flash.erases, erases);
+    CHECK(stats.bytes < 64);
+
+    // One changed byte: that page, and page 0 that was erased before it
+    image[5 * BOOT_PAGE_SIZE + 7] ^= 0x5A;
+    CHECK(upload(&stats));
+    CHECK_EQ(stats.written, 2);
+    CHECK_EQ(stats.skipped, 10);
+    CHECK_EQ(memcmp(hal_flash.mem, image, BOOT_START), 0);
+    CHECK_EQ(hal_flash.spm_violations, 0);
+    CHECK_EQ(hal_flash.rww_violations, 0);
+}
+
+static void test_power_on(void) {
+    FlashReset();
+    hal_flash.mem[0] = 0x0C;
+    hal_flash.mem[1] = 0x94;
+
+    // Power-on: the application starts at once, the USART is never set up
+    board_reset(1 << PORF);
+    boot_run();
+    CHECK(app_started);
+    CHECK(HalMicros() < 10);
+    CHECK_EQ(HalGet(HAL_ADDR(UCSR0B)), 0);
+    CHECK_EQ(usart.tx_count, 0);
+
+    // RESET button with no host: the application starts after BOOT_WAIT_MS
+    board_reset(1 << EXTRF);
+    boot_run();
+    CHECK(app_started);
+    CHECK(HalMicros() >= BOOT_WAIT_MS * 1000UL);
+    CHECK(HalMicros() < BOOT_WAIT_MS * 1100UL);
+    CHECK_EQ(usart.tx_count, 0);
+}
+
+// Send a raw frame, return the first reply byte
+static int raw_request(const uint8_t *frame, uint16_t length) {
+    BkStats_t stats = { 0 };
+    uint8_t c;
+    link_write(host_fd, frame, length, &stats);
+    if (!link_read(host_fd, &c, 1, BK_REPLY_MS)) return -1;
+    link_drain(host_fd, 5);
+    return c;
+}
+
+static void test_bad_frames(void) {
+    uint8_t frame[1 + 2 + BOOT_PAGE_SIZE + 2] = { BOOT_CMD_WRITE };
+    uint16_t crc;
+    FlashReset();
+    board_start();
+
+    const uint8_t sync = BOOT_SYNC;
+    CHECK_EQ(raw_request(&sync, 1), BOOT_ACK);
+
+    // Page 1 with a bad CRC
+    frame[1] = 1;
+    crc = bk_crc(0, frame, 3 + BOOT_PAGE_SIZE) ^ 1;
+    frame[3 + BOOT_PAGE_SIZE] = crc & 0xFF;
+    frame[4 + BOOT_PAGE_SIZE] = crc >> 8;
+    CHECK_EQ(raw_request(frame, sizeof(frame)), BOOT_NAK);
+
+    // First page of the bootloader itself
+    frame[1] = (BOOT_START / BOOT_PAGE_SIZE) & 0xFF;
+    frame[2] = (BOOT_START / BOOT_PAGE_SIZE) >> 8;
+    crc = bk_crc(0, frame, 3 + BOOT_PAGE_SIZE);
+    frame[3 + BOOT_PAGE_SIZE] = crc & 0xFF;
+    frame[4 + BOOT_PAGE_SIZE] = crc >> 8;
+    CHECK_EQ(raw_request(frame, sizeof(frame)), BOOT_NAK);
+
+    // Unknown command, then a good one
+    const uint8_t unknown[] = { 'X', 0, 0 };
+    CHECK_EQ(raw_request(unknown, sizeof(unknown)), BOOT_NAK);
+    uint8_t go[3] = { BOOT_CMD_GO };
+    crc = bk_crc(0, go, 1);
+    go[1] = crc & 0xFF;
+    go[2] = crc >> 8;
+    CHECK_EQ(raw_request(go, sizeof(go)), BOOT_ACK);
+
+    board_stop(true);
+    CHECK(app_started);
+    CHECK_EQ(hal_flash.erases, 0);
+}
+
+static void test_hex(void) {
+    char path[] = "/tmp/bkbootXXXXXX";
+    uint32_t length;
+    int fd = mkstemp(path);
+    FILE *f = fdopen(fd, "w");
+
+    // Extended linear address 0x0001, then 3 bytes at 0x10100
+    fputs(":020000040001F9\n:03010000AABBCCCB\n:00000001FF\n", f);
+    fclose(f);
+    uint8_t *data = hex_load(path, &length);
+    CHECK(data != NULL);
+    if (data) {
+        CHECK_EQ(length, 0x10103);
+        CHECK_EQ(data[0x10100], 0xAA);
+        CHECK_EQ(data[0x10102], 0xCC);
+        CHECK_EQ(data[0], 0xFF);
+        free(data);
+    }
+
+    // Bad checksum
+    f = fopen(path, "w");
+    fputs(":03010000AABBCCCC\n", f);
+    fclose(f);
+    CHECK(hex_load(path, &length) == NULL);
+    unlink(path);
+}
+
+int main(void) {
+    bk_wait_ms = 2000;
+    RUN(test_hex);
+    RUN(test_upload);
+    RUN(test_skip_unchanged);
+    RUN(test_power_on);
+    RUN(test_bad_frames);
+    return TEST_REPORT();
+}
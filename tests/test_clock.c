@@ -0,0 +1,189 @@
+// Run-time clock scaling (clock.c): XDIV, the timebase tick, TWI rate and notifiers
+#include <avr/io.h>
+#include "clock.h"
+#include "timebase.h"
+#include "twi.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "timer3.h"
+#include "test.h"
+
+static Hd44780_t lcd;
+static Timer3_t timer3;
+
+static void attach(void) {
+    Hd44780Init(&lcd);
+    Hd44780AttachParallel(&lcd, HAL_ADDR(PORTB), PB5, PB6, PB7, HAL_ADDR(PORTA));
+    Timer3Attach(&timer3);
+}
+
+static void test_divider(void) {
+    CHECK_EQ(ClockSetDivider(0), CLOCK_BAD_DIVIDER);
+    CHECK_EQ(ClockSetDivider(3), CLOCK_BAD_DIVIDER);
+    CHECK_EQ(ClockDivider(), 1);
+
+    CHECK_EQ(ClockSetDivider(8), CLOCK_OK);
+    CHECK_EQ(HalGet(HAL_ADDR(XDIV)), (1 << XDIVEN) | 121);
+    CHECK_EQ(ClockHz(), F_CPU / 8);
+    CHECK_EQ(timebase_cs, 1 << CS30);
+    CHECK_EQ(timebase_shift, 0);
+
+    CHECK_EQ(ClockSetDivider(4), CLOCK_OK);
+    CHECK_EQ(HalGet(HAL_ADDR(XDIV)), (1 << XDIVEN) | 125);
+    CHECK_EQ(timebase_cs, 1 << CS31);
+    CHECK_EQ(timebase_shift, 2);
+
+    CHECK_EQ(ClockSetDivider(128), CLOCK_OK);
+    CHECK_EQ(HalGet(HAL_ADDR(XDIV)), (1 << XDIVEN) | 1);
+    CHECK_EQ(timebase_shift, 4);
+
+    CHECK_EQ(ClockSetDivider(1), CLOCK_OK);
+    CHECK_EQ(HalGet(HAL_ADDR(XDIV)), 0);
+    CHECK_EQ(ClockHz(), F_CPU);
+    CHECK_EQ(timebase_shift, 0);
+}
+
+// The running counter switches prescaler; waits keep their real length
+static void test_timebase(void) {
+    attach();
+    TimebaseInit();
+    CHECK_EQ(TCCR3B, 1 << CS31);
+
+    ClockSetDivider(32);
+    CHECK_EQ(HalGet(HAL_ADDR(TCCR3B)), 1 << CS30);
+    uint64_t start_us = HalMicros();
+    uint16_t start = TimebaseNow();
+    while ((uint16_t)(TimebaseNow() - start) < TimebaseTicks(1000));
+    CHECK(HalMicros() - start_us >= 1000);
+    CHECK(HalMicros() - start_us < 1000 + 3 * 4 + 100);       // Two extra 4 us ticks and the loop
+    CHECK_EQ(TimebaseMicros(TimebaseTicks(1000)), 1000 + 2 * 4);
+
+    // Back to full speed: the switch waits out deadlines taken with the long tick
+    start_us = HalMicros();
+    ClockSetDivider(1);
+    CHECK(HalMicros() - start_us >= CLOCK_SETTLE_US);
+    CHECK_EQ(HalGet(HAL_ADDR(TCCR3B)), 1 << CS31);
+
+    // Slowing down doesn't
+    start_us = HalMicros();
+    ClockSetDivider(2);
+    CHECK(HalMicros() - start_us < 100);
+    ClockSetDivider(1);
+}
+
+// Only the clock select changes: the input capture setup on ICP3 stays
+static void test_capture_bits(void) {
+    attach();
+    TCCR3B = (1 << ICNC3) | (1 << ICES3);
+    TimebaseInit();
+    CHECK_EQ(TCCR3B, (1 << ICNC3) | (1 << ICES3) | (1 << CS31));
+
+    ClockSetDivider(16);
+    CHECK_EQ(HalGet(HAL_ADDR(TCCR3B)), (1 << ICNC3) | (1 << ICES3) | (1 << CS30));
+    ClockSetDivider(1);
+    CHECK_EQ(HalGet(HAL_ADDR(TCCR3B)), (1 << ICNC3) | (1 << ICES3) | (1 << CS31));
+}
+
+// The LCD driver meets the HD44780 times at every divider
+static void test_lcd_divided(void) {
+    static const uint8_t dividers[] = { 2, 8, 16, 128 };
+    for (uint8_t i = 0; i < sizeof(dividers); i++) {
+        HalReset();
+        attach();
+        CHECK_EQ(ClockSetDivider(dividers[i]), CLOCK_OK);
+        LcdInit(LCD_MODE_4BIT);
+        LcdStart(2, 16);
+        LcdPrint("Slow");
+        LcdClear();
+        LcdPrint("ok");
+        HalSync();
+        char row[3];
+        Hd44780Row(&lcd, 0, row, 2);
+        CHECK_STR(row, "ok");
+        CHECK_EQ(lcd.busy_violations, 0);
+        ClockSetDivider(1);
+    }
+}
+
+static void test_twi_rate(void) {
+    TwiInit();
+    CHECK_EQ(TWBR, TWI_TWBR_VALUE);
+    CHECK_EQ(TWSR & 0x03, TWI_TWPS_VALUE);
+
+    // 400 kHz is out of reach below 14.4 MHz: TWBR stays at its minimum
+    ClockSetDivider(16);
+    CHECK_EQ(TWBR, TWI_TWBR_MIN);
+    CHECK_EQ(TWSR & 0x03, 0);
+    ClockSetDivider(1);
+    CHECK_EQ(TWBR, TWI_TWBR_VALUE);
+    CHECK_EQ(TWSR & 0x03, TWI_TWPS_VALUE);
+}
+
+static uint8_t events[8];
+static uint32_t event_hz[8];
+static uint8_t event_xdiv[8];
+static uint8_t event_count;
+
+static void record(ClockEvent_t event, uint32_t hz, uint8_t who) {
+    if (event_count < sizeof(events)) {
+        event_hz[event_count] = hz;
+        event_xdiv[event_count] = HalGet(HAL_ADDR(XDIV));
+        events[event_count++] = who * 10 + event;
+    }
+}
+
+static void notifier_a(ClockEvent_t event, uint32_t hz) {
+    record(event, hz, 1);
+}
+
+static void notifier_b(ClockEvent_t event, uint32_t hz) {
+    record(event, hz, 2);
+}
+
+static void notifier_c(ClockEvent_t event, uint32_t hz) {
+    (void)event;
+    (void)hz;
+}
+
+static void notifier_d(ClockEvent_t event, uint32_t hz) {
+    (void)event;
+    (void)hz;
+}
+
+static void test_notifiers(void) {
+    CHECK_EQ(ClockNotify(notifier_a), CLOCK_OK);
+    CHECK_EQ(ClockNotify(notifier_b), CLOCK_OK);
+    CHECK_EQ(ClockNotify(notifier_a), CLOCK_OK);    // Already there
+
+    event_count = 0;
+    ClockSetDivider(4);
+    CHECK_EQ(event_count, 4);
+    CHECK_EQ(events[0], 10 + CLOCK_PRE_CHANGE);
+    CHECK_EQ(events[1], 20 + CLOCK_PRE_CHANGE);
+    CHECK_EQ(events[2], 10 + CLOCK_POST_CHANGE);
+    CHECK_EQ(events[3], 20 + CLOCK_POST_CHANGE);
+    CHECK_EQ(event_hz[0], F_CPU / 4);
+    CHECK_EQ(event_xdiv[0], 0);                     // Still at the old clock
+    CHECK_EQ(event_xdiv[2], (1 << XDIVEN) | 125);
+
+    // No change, no calls
+    event_count = 0;
+    ClockSetDivider(4);
+    CHECK_EQ(event_count, 0);
+    ClockSetDivider(1);
+    CHECK_EQ(event_count, 4);
+
+    // TWI, a, b and c fill the table
+    CHECK_EQ(ClockNotify(notifier_c), CLOCK_OK);
+    CHECK_EQ(ClockNotify(notifier_d), CLOCK_FULL);
+}
+
+int main(void) {
+    RUN(test_divider);
+    RUN(test_timebase);
+    RUN(test_capture_bits);
+    RUN(test_lcd_divided);
+    RUN(test_twi_rate);
+    RUN(test_notifiers);
+    return TEST_REPORT();
+}
@@ -0,0 +1,166 @@
+// CPU load meter (cpuload.c): baseline through the loop pass, load of busy windows,
+// divided clock, LED bar
+#include <avr/io.h>
+#include "cpuload.h"
+#include "clock.h"
+#include "led_bcm.h"
+#include "timer3.h"
+#include "test.h"
+
+#define PASS_CYCLES     40      // Rest of an idle pass on the AVR: call, count, compare
+#define POLL_CYCLES     120     // Polls of an application loop that find nothing due
+
+static Timer3_t timer3;
+
+// Each timestamp read stands for a whole idle pass
+static uint8_t pass_cost(uint16_t addr, uint8_t value, void *ctx) {
+    (void)addr;
+    (void)ctx;
+    HalAdvance(PASS_CYCLES * HalClockDivider());
+    return value;
+}
+
+static void bare_pass(void) {
+    CpuLoadIdle();
+}
+
+static void app_pass(void) {
+    HalAdvance(POLL_CYCLES);
+    CpuLoadIdle();
+}
+
+static void busy_pass(void) {
+    HalAdvance(POLL_CYCLES);
+}
+
+static void attach(void) {
+    Timer3Attach(&timer3);
+    HalOnRead(HAL_ADDR(TCNT3L), pass_cost, NULL);
+    CpuLoadInit();
+    CpuLoadCalibrate(bare_pass);
+}
+
+// Full-clock cycles of one idle pass
+static uint64_t idle_cycles(void) {
+    uint64_t start = HalCycles();
+    CpuLoadIdle();
+    return HalCycles() - start;
+}
+
+// Idle passes with `busy` cycles of work after each, until `windows` windows closed
+static CpuLoad_t run(uint64_t busy, uint8_t windows) {
+    CpuLoad_t load;
+    while (windows) {
+        if (CpuLoadIdle()) windows--;
+        HalAdvance(busy);
+    }
+    CpuLoadGet(&load);
+    return load;
+}
+
+static void test_baseline(void) {
+    attach();
+    CHECK(HalMicros() >= CPULOAD_WINDOW_MS * 1000UL);
+    uint32_t expected = 4096UL * (F_CPU / 1000000UL) / idle_cycles();
+    CHECK(CpuLoadBaseline() >= expected - expected / 50);
+    CHECK(CpuLoadBaseline() <= expected + expected / 50);
+
+    CpuLoad_t load = run(0, 3);
+    CHECK(load.now <= 5);
+    CHECK_EQ(load.windows, 3);
+}
+
+// Work as long as the idle pass itself is half the CPU, twice as long two thirds
+static void test_busy(void) {
+    attach();
+    uint64_t pass = idle_cycles();
+    CpuLoad_t load = run(pass, 4);
+    CHECK(load.now >= 490 && load.now <= 510);
+    load = run(2 * pass, 2);
+    CHECK(load.now >= 657 && load.now <= 677);
+    CHECK_EQ(load.peak, load.now);
+    load = run(0, 2);
+    CHECK(load.now <= 5);
+    CHECK(load.peak >= 657);
+    CHECK(load.average > 400 && load.average < 450);   // (4 * 500 + 2 * 667 + 2 * 0) / 8
+    CHECK_EQ(load.windows, 8);
+
+    CpuLoadReset();
+    CpuLoadGet(&load);
+    CHECK_EQ(load.peak, 0);
+    CHECK_EQ(load.windows, 0);
+}
+
+// A stall longer than the window is measured by its length
+static void test_stall(void) {
+    CpuLoad_t load;
+    attach();
+    CpuLoadIdle();
+    HalAdvance(40000UL * (F_CPU / 1000000UL));
+    CpuLoadIdle();
+    HalAdvance(20000UL * (F_CPU / 1000000UL));
+    CHECK(CpuLoadIdle());
+    CpuLoadGet(&load);
+    CHECK(load.now >= 999);
+}
+
+// Calibrated through the application's pass, its polls are no load; against a bare loop
+// they would be
+static void test_app_pass(void) {
+    CpuLoad_t load;
+    Timer3Attach(&timer3);
+    HalOnRead(HAL_ADDR(TCNT3L), pass_cost, NULL);
+    CpuLoadInit();
+    CpuLoadCalibrate(app_pass);
+    for (uint8_t windows = 3; windows; ) {
+        HalAdvance(POLL_CYCLES);
+        if (CpuLoadIdle()) windows--;
+    }
+    CpuLoadGet(&load);
+    CHECK(load.now <= 5);
+    CHECK_EQ(load.windows, 3);
+
+    CpuLoadCalibrate(bare_pass);
+    load = run(POLL_CYCLES, 3);
+    CHECK(load.now >= 700);                         // 120 of 160 cycles
+
+    // A pass that never idles still ends the window, with no baseline
+    uint64_t start_us = HalMicros();
+    CpuLoadCalibrate(busy_pass);
+    CHECK(HalMicros() - start_us >= CPULOAD_WINDOW_MS * 1000UL);
+    CHECK_EQ(CpuLoadBaseline(), 0);
+}
+
+// Fewer passes at a divided clock are no load
+static void test_divided(void) {
+    attach();
+    CHECK_EQ(ClockSetDivider(4), CLOCK_OK);
+    run(0, 1);                                      // The window of the change
+    CpuLoad_t load = run(0, 3);
+    CHECK(load.now <= 10);
+    CHECK_EQ(ClockSetDivider(1), CLOCK_OK);
+}
+
+static void test_leds(void) {
+    attach();
+    LedBcmInit();
+    CpuLoadSetView(CPULOAD_VIEW_LEDS);
+    uint64_t pass = idle_cycles();
+    run(2 * pass, 2);                               // 667: five LEDs, the peak on the sixth
+    for (uint8_t i = 0; i < 5; i++) CHECK_EQ(LedBcmGet(i), 255);
+    CHECK_EQ(LedBcmGet(5), CPULOAD_PEAK_LEVEL);
+    CHECK_EQ(LedBcmGet(6), 0);
+    run(0, 2);                                      // Idle: only the peak mark stays
+    CHECK_EQ(LedBcmGet(0), 0);
+    CHECK_EQ(LedBcmGet(5), CPULOAD_PEAK_LEVEL);
+}
+
+int main(void) {
+    RUN(test_baseline);
+    RUN(test_busy);
+    RUN(test_stall);
+    RUN(test_app_pass);
+    RUN(test_divided);
+    RUN(test_leds);
+    return TEST_REPORT();
+}
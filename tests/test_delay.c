@@ -0,0 +1,90 @@
+// Run-time busy waits (delay.c): loop counts at 8 MHz, at a divided clock, and the
+// integer conversion at other F_CPU values
+#include <avr/io.h>
+#include "delay.h"
+#include "clock.h"
+#include "test.h"
+
+// CPU cycles at 8 MHz the host sees: the loop passes (the host build takes no overhead off)
+static uint64_t cycles_of_us(uint16_t us) {
+    uint64_t start = HalCycles();
+    DelayUs(us);
+    return HalCycles() - start;
+}
+
+static void test_us(void) {
+    static const uint16_t waits[] = { 5, 10, 100, 1234, 50000, 65535 };
+    for (uint8_t i = 0; i < sizeof(waits) / sizeof(waits[0]); i++) {
+        uint64_t cycles = cycles_of_us(waits[i]);
+        uint64_t want = (uint64_t)waits[i] * (F_CPU / 1000000UL);
+        CHECK_EQ(cycles, want);
+    }
+    CHECK_EQ(cycles_of_us(0), 0);
+    CHECK_EQ(cycles_of_us(1), 8);
+}
+
+static void test_ms(void) {
+    uint64_t start = HalCycles();
+    DelayMs(25);
+    CHECK_EQ(HalCycles() - start, 25 * (F_CPU / 1000));
+    start = HalCycles();
+    DelayMs(0);
+    CHECK_EQ(HalCycles() - start, 0);
+}
+
+// At a divided clock the passes are fewer and the time stays
+static void test_divided(void) {
+    CHECK_EQ(ClockSetDivider(4), CLOCK_OK);
+    uint64_t start = HalMicros();
+    DelayUs(1000);
+    uint64_t took = HalMicros() - start;
+    CHECK_EQ(took, 1000);
+    start = HalMicros();
+    DelayMs(10);
+    took = HalMicros() - start;
+    CHECK_EQ(took, 10000);
+
+    CHECK_EQ(ClockSetDivider(128), CLOCK_OK);
+    start = HalMicros();
+    DelayMs(10);
+    took = HalMicros() - start;
+    CHECK_EQ(took, 10240);                  // 16 passes of 64 us per ms, rounded up
+    CHECK_EQ(ClockSetDivider(1), CLOCK_OK);
+}
+
+// The conversion never comes out short and stays close at common crystal frequencies: the
+// rate error of the 1/256 steps, plus at most one pass
+static void test_accuracy(void) {
+    static const uint32_t clocks[] = {
+        1000000, 2000000, 3686400, 4000000, 7372800, 8000000, 11059200, 12000000,
+        14745600, 16000000, 18432000, 20000000
+    };
+    for (uint8_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+        uint32_t f = clocks[c];
+        double rate = DELAY_LOOPS_PER_US_Q8(f) * 15625.0 / f - 1;
+        bool close = true;
+        CHECK(rate >= 0);
+        CHECK(rate < (f >= 8000000 ? 0.0005 : 0.002));
+        for (uint32_t us = 1; us <= 65535; us++) {
+            uint32_t loops = ((uint32_t)us * DELAY_LOOPS_PER_US_Q8(f) + 255) >> 8;
+            double excess = loops * (double)DELAY_LOOP_CYCLES - us * (f / 1e6);     // Cycles
+            if (excess < 0 || excess > DELAY_LOOP_CYCLES + rate * us * (f / 1e6) + 1e-6) close = false;
+        }
+        CHECK(close);
+
+        // A millisecond (the pass taken off on the AVR is the outer loop's)
+        double ms = DELAY_LOOPS_PER_MS(f) * (double)DELAY_LOOP_CYCLES * 1000 / f - 1;
+        CHECK(ms >= 0);
+        CHECK(ms < 0.001);
+        printf("  F_CPU %8lu: DelayUs rate +%.3f %% (+1 pass), DelayMs +%.3f %%\n", (unsigned long)f,
+               rate * 100, ms * 100);
+    }
+}
+
+int main(void) {
+    RUN(test_us);
+    RUN(test_ms);
+    RUN(test_divided);
+    RUN(test_accuracy);
+    return TEST_REPORT();
+}
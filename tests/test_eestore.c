@@ -0,0 +1,209 @@
+// EEPROM key/value store (eestore.c) against the EEPROM model
+#include <avr/io.h>
+#include "eestore.h"
+#include "eeprom.h"
+#include "test.h"
+
+void EE_READY_vect(void);
+
+// Reset of the board: RAM is lost, the EEPROM keeps its contents
+static void reboot(void) {
+    HalReset();
+    EepromAttach();
+    EeStoreInit();
+}
+
+// Let the background writes finish
+static void drain(void) {
+    while (EepromInterrupt()) EE_READY_vect();
+}
+
+static uint32_t max_wear(void) {
+    uint32_t wear = 0;
+    for (uint16_t a = 0; a < EEPROM_SIZE; a++) {
+        if (hal_eeprom.wear[a] > wear) wear = hal_eeprom.wear[a];
+    }
+    return wear;
+}
+
+static void test_put_get(void) {
+    uint8_t value[8], length;
+    EepromErase();
+    reboot();
+    drain();
+    CHECK_EQ(hal_eeprom.mem[0], 'K');
+
+    // Queued without waiting for the EEPROM, readable at once
+    uint64_t start = HalMicros();
+    CHECK_EQ(EeStorePut("bklt", "\x05", 1), EESTORE_OK);
+    CHECK_EQ(EeStorePut("name", "BK-128", 6), EESTORE_OK);
+    CHECK(HalMicros() - start < 500);
+    CHECK(EeStoreBusy());
+    CHECK_EQ(EeStoreGet("name", value, sizeof(value), &length), EESTORE_OK);
+    CHECK_EQ(length, 6);
+    CHECK_EQ(memcmp(value, "BK-128", 6), 0);
+
+    drain();
+    CHECK(!EeStoreBusy());
+    CHECK_EQ(hal_eeprom.violations, 0);
+    CHECK_EQ(EeStoreGet("baud", value, sizeof(value), &length), EESTORE_NOT_FOUND);
+
+    // Survives a reset; a short buffer gets the start of the value
+    reboot();
+    CHECK_EQ(EeStoreGet("bklt", value, sizeof(value), &length), EESTORE_OK);
+    CHECK_EQ(length, 1);
+    CHECK_EQ(value[0], 5);
+    memset(value, 0, sizeof(value));
+    CHECK_EQ(EeStoreGet("name", value, 2, NULL), EESTORE_OK);
+    CHECK_EQ(memcmp(value, "BK\0", 3), 0);
+
+    // Replace and delete
+    CHECK_EQ(EeStorePut("bklt", "\x09", 1), EESTORE_OK);
+    CHECK_EQ(EeStoreDelete("name"), EESTORE_OK);
+    CHECK_EQ(EeStoreDelete("name"), EESTORE_NOT_FOUND);
+    drain();
+    reboot();
+    CHECK_EQ(EeStoreGet("bklt", value, sizeof(value), NULL), EESTORE_OK);
+    CHECK_EQ(value[0], 9);
+    CHECK_EQ(EeStoreGet("name", value, sizeof(value), NULL), EESTORE_NOT_FOUND);
+    CHECK_EQ(hal_eeprom.violations, 0);
+}
+
+static void test_limits(void) {
+    uint8_t value[EESTORE_VALUE_MAX + 1] = { 0 };
+    char key[] = "k00";
+    EepromErase();
+    reboot();
+
+    CHECK_EQ(EeStorePut("big", value, EESTORE_VALUE_MAX + 1), EESTORE_TOO_LONG);
+
+    // Keys aren't cut: "bklt1" and "bklt2" would both be "bklt"
+    CHECK_EQ(EeStorePut("bklt1", value, 1), EESTORE_TOO_LONG);
+    CHECK_EQ(EeStoreGet("bklt1", value, 1, NULL), EESTORE_TOO_LONG);
+    CHECK_EQ(EeStoreDelete("bklt1"), EESTORE_TOO_LONG);
+    CHECK_EQ(EeStoreGet("bklt", value, 1, NULL), EESTORE_NOT_FOUND);
+    for (uint8_t i = 0; i < EESTORE_KEYS; i++) {
+        key[1] = '0' + i / 10;
+        key[2] = '0' + i % 10;
+        EeStoreStatus_t status;
+        while ((status = EeStorePut(key, &i, 1)) == EESTORE_BUSY) drain();
+        CHECK_EQ(status, EESTORE_OK);
+    }
+    CHECK_EQ(EeStorePut("more", value, 1), EESTORE_FULL);
+    CHECK_EQ(EeStorePut("k00", value, 2), EESTORE_OK);      // Existing keys still change
+}
+
+// Values rewritten many times: the log wraps through both banks
+static void test_wear_leveling(void) {
+    uint8_t value[16];
+    uint16_t busy = 0;
+    EepromErase();
+    reboot();
+
+    for (uint16_t i = 0; i < 2000; i++) {
+        memset(value, i, sizeof(value));
+        const char *key = (i % 3 == 0) ? "vol" : (i % 3 == 1) ? "bklt" : "mode";
+        EeStoreStatus_t status;
+        while ((status = EeStorePut(key, value, sizeof(value))) == EESTORE_BUSY) {
+            busy++;
+            EepromInterrupt();
+            EE_READY_vect();
+        }
+        CHECK_EQ(status, EESTORE_OK);
+        if (i == 1000) reboot();    // Reset in the middle, writes still pending
+    }
+    drain();
+    CHECK(busy > 0);                // Compactions happened
+
+    // 2000 records of 23 bytes over two 2 KB banks: no cell written more than about a
+    // dozen times, where a fixed layout would have written the same cells ~670 times
+    CHECK(max_wear() < 20);
+    CHECK_EQ(hal_eeprom.violations, 0);
+
+    reboot();
+    CHECK_EQ(EeStoreGet("vol", value, sizeof(value), NULL), EESTORE_OK);
+    CHECK_EQ(value[0], (uint8_t)1998);
+    CHECK_EQ(EeStoreGet("bklt", value, sizeof(value), NULL), EESTORE_OK);
+    CHECK_EQ(value[0], (uint8_t)1999);
+    CHECK_EQ(EeStoreGet("mode", value, sizeof(value), NULL), EESTORE_OK);
+    CHECK_EQ(value[0], (uint8_t)1997);
+}
+
+// Power lost in the middle of each write in turn: the store keeps either the old or the
+// new value, never garbage
+static void test_power_cut(void) {
+    uint8_t value[4];
+    for (int32_t cut = 0; cut < 12; cut++) {
+        EepromErase();
+        reboot();
+        CHECK_EQ(EeStorePut("cfg", "old", 3), EESTORE_OK);
+        drain();
+        uint32_t written = hal_eeprom.writes;
+
+        hal_eeprom.cut_after = cut;
+        CHECK_EQ(EeStorePut("cfg", "new", 3), EESTORE_OK);
+        drain();
+        hal_eeprom.cut_after = -1;
+
+        reboot();
+        CHECK_EQ(EeStoreGet("cfg", value, sizeof(value), NULL), EESTORE_OK);
+        if (hal_eeprom.writes - written >= 10) CHECK_EQ(memcmp(value, "new", 3), 0);
+        else CHECK_EQ(memcmp(value, "old", 3), 0);
+
+        // The store goes on working after the cut
+        CHECK_EQ(EeStorePut("cfg", "abc", 3), EESTORE_OK);
+        drain();
+        reboot();
+        CHECK_EQ(EeStoreGet("cfg", value, sizeof(value), NULL), EESTORE_OK);
+        CHECK_EQ(memcmp(value, "abc", 3), 0);
+    }
+}
+
+// Power lost during a compaction: the old bank stays active until the new header is written
+static void test_compaction_cut(void) {
+    uint8_t value[32] = { 0 };
+    EepromErase();
+    reboot();
+
+    // Fill the first bank with rewrites of one key
+    uint8_t n = 0;
+    while (EeStoreFree() >= 39) {
+        value[0] = n++;
+        CHECK_EQ(EeStorePut("a", value, sizeof(value)), EESTORE_OK);
+        drain();
+    }
+    CHECK_EQ(EeStorePut("b", "x", 1), EESTORE_OK);
+    drain();
+
+    hal_eeprom.cut_after = 20;
+    CHECK_EQ(EeStorePut("a", value, sizeof(value)), EESTORE_BUSY);
+    drain();
+    hal_eeprom.cut_after = -1;
+    reboot();
+    CHECK_EQ(hal_eeprom.mem[EESTORE_BANK_SIZE + 2], 0xFF);     // New header not written
+    CHECK_EQ(EeStoreGet("a", value, sizeof(value), NULL), EESTORE_OK);
+    CHECK_EQ(value[0], n - 1);
+    CHECK_EQ(EeStoreGet("b", value, sizeof(value), NULL), EESTORE_OK);
+    CHECK_EQ(value[0], 'x');
+
+    // Uncut: the second bank takes over with both keys
+    value[0] = 0xAA;
+    while (EeStorePut("a", value, sizeof(value)) == EESTORE_BUSY) drain();
+    drain();
+    reboot();
+    CHECK_EQ(hal_eeprom.mem[EESTORE_BANK_SIZE + 2], 1);
+    CHECK_EQ(EeStoreGet("a", value, sizeof(value), NULL), EESTORE_OK);
+    CHECK_EQ(value[0], 0xAA);
+    CHECK_EQ(EeStoreGet("b", value, sizeof(value), NULL), EESTORE_OK);
+    CHECK_EQ(value[0], 'x');
+    CHECK_EQ(hal_eeprom.violations, 0);
+}
+
+int main(void) {
+    RUN(test_put_get);
+    RUN(test_limits);
+    RUN(test_wear_leveling);
+    RUN(test_power_cut);
+    RUN(test_compaction_cut);
+    return TEST_REPORT();
+}
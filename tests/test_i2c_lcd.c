@@ -0,0 +1,138 @@
+// I2C LCD driver (i2c_lcd.c) through the emulated TWI and a PCF8574 backpack
+#include <avr/io.h>
+#include "i2c_lcd.h"
+#include "twi_bus.h"
+#include "pcf8574.h"
+#include "timer3.h"
+#include "test.h"
+
+static TwiBus_t bus;
+static Pcf8574_t pcf;
+static Hd44780_t lcd;
+static Timer3_t timer3;
+
+static void attach(void) {
+    TwiBusAttach(&bus);
+    Pcf8574Init(&pcf, &bus, 0x27);
+    Hd44780Init(&lcd);
+    Pcf8574AttachLcd(&pcf, &lcd);
+    Timer3Attach(&timer3);
+}
+
+static void test_start(void) {
+    char row[17];
+    attach();
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+    HalSync();
+
+    CHECK_EQ(HalGet(HAL_ADDR(TWBR)), TWI_TWBR_VALUE);
+    CHECK_EQ(I2C_LcdGetStatus(), TWI_OK);
+    CHECK(!lcd.eight_bit);
+    CHECK(lcd.two_lines);
+    CHECK(lcd.display_on);
+    CHECK_EQ(bus.nacks, 0);
+    CHECK_EQ(bus.starts, bus.stops);
+    CHECK_EQ(lcd.busy_violations, 0);
+    CHECK(pcf.port & 0x08);                     // Backlight
+
+    I2C_LcdSetCursor(1, 2);
+    CHECK_EQ(Hd44780Last(&lcd, false), 0xC2);
+    I2C_LcdPrint("twi");
+    I2C_LcdPrintInt(-42);
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, "  twi-42        ");
+}
+
+static void test_transfer_timing(void) {
+    attach();
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+
+    // One character: SLA+W and 4 port writes, 9 bits each
+    uint32_t bytes = bus.bytes;
+    uint64_t start = HalMicros();
+    I2C_LcdPrint("A");
+    HalSync();
+    CHECK_EQ(bus.bytes - bytes, 5);
+    CHECK(HalCycles() - start * (F_CPU / 1000000UL) >= 5 * 9 * TwiBusBitCycles());
+
+    // A string goes out as one transfer
+    uint32_t starts = bus.starts;
+    bytes = bus.bytes;
+    I2C_LcdPrint("0123456789");
+    I2C_LcdPrintInt(-2147483647 - 1);
+    HalSync();
+    CHECK_EQ(bus.starts - starts, 2);
+    CHECK_EQ(bus.bytes - bytes, 2 + 4 * 21);
+    CHECK_EQ(lcd.busy_violations, 0);
+    CHECK_EQ(pcf.port & 0x04, 0);               // EN ends low
+}
+
+static void test_missing_device(void) {
+    attach();
+    I2C_LcdInit(0x3F);                          // Nobody at this address
+    I2C_LcdPrint("x");
+    HalSync();
+    CHECK(bus.nacks > 0);
+    CHECK_EQ(I2C_LcdGetStatus(), TWI_NACK_ADDR);
+    CHECK_EQ(lcd.byte_count, 0);
+    CHECK_EQ(bus.starts, bus.stops);
+}
+
+static void test_two_displays(void) {
+    static Pcf8574_t pcf2;
+    static Hd44780_t lcd2;
+    I2cLcd_t small, big;
+    char row[21];
+
+    // A 16x2 at 0x27 and a 20x4 at 0x3F on the same bus
+    attach();
+    Pcf8574Init(&pcf2, &bus, 0x3F);
+    Hd44780Init(&lcd2);
+    Pcf8574AttachLcd(&pcf2, &lcd2);
+    I2C_LcdDevInit(&small, 0x27);
+    I2C_LcdDevInit(&big, 0x3F);
+    I2C_LcdDevStart(&small, 2, 16);
+    I2C_LcdDevStart(&big, 4, 20);
+    CHECK_EQ(I2C_LcdDevGetStatus(&small), TWI_OK);
+    CHECK_EQ(I2C_LcdDevGetStatus(&big), TWI_OK);
+
+    I2C_LcdDevPrint(&small, "small");
+    I2C_LcdDevSetCursor(&big, 2, 0);
+    CHECK_EQ(Hd44780Last(&lcd2, false), 0x94);
+    I2C_LcdDevPrint(&big, "third");
+    I2C_LcdDevSetCursor(&big, 3, 1);
+    CHECK_EQ(Hd44780Last(&lcd2, false), 0xD5);
+    I2C_LcdDevPrintInt(&big, 2004);
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "small           ");
+    Hd44780Row(&lcd2, 2, row, 20);
+    CHECK_STR(row, "third               ");
+    Hd44780Row(&lcd2, 3, row, 20);
+    CHECK_STR(row, " 2004               ");
+
+    // Clearing the big one doesn't delay a write to the small one
+    uint64_t start = HalMicros();
+    I2C_LcdDevClear(&big);
+    I2C_LcdDevPrint(&small, "!");
+    HalSync();
+    CHECK(HalMicros() - start < 1000);
+    I2C_LcdDevPrint(&big, "x");
+    HalSync();
+    CHECK(HalMicros() - start >= 1520);
+    CHECK_EQ(lcd.busy_violations, 0);
+    CHECK_EQ(lcd2.busy_violations, 0);
+
+    I2C_LcdDevBacklight(&big, false);
+    CHECK_EQ(pcf2.port & 0x08, 0);
+    CHECK(pcf.port & 0x08);
+}
+
+int main(void) {
+    RUN(test_start);
+    RUN(test_transfer_timing);
+    RUN(test_missing_device);
+    RUN(test_two_displays);
+    return TEST_REPORT();
+}
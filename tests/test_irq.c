@@ -0,0 +1,183 @@
+// Interrupt levels (irq.c): bottom half order and nesting, capture and probe latency,
+// the PWM ramps in the bottom half
+#include <avr/io.h>
+#include "irq.h"
+#include "pwm.h"
+#include "timer3.h"
+#include "test.h"
+
+void TIMER0_OVF_vect(void);
+
+static Timer3_t timer3;
+static char order[16];
+static uint8_t ran;
+static bool interrupts_on;
+static uint16_t seen_stamp;
+static uint8_t edges;
+
+static void log_work(char c) {
+    order[ran++] = c;
+    order[ran] = '\0';
+    interrupts_on = SREG & (1 << SREG_I);
+}
+
+static void work_c(void) {
+    log_work('c');
+}
+
+IRQ_LOW(SPI_STC_vect) {
+    IrqDefer(work_c);
+}
+
+// An interrupt cuts into the first work: its work waits for the run in progress
+static void work_a(void) {
+    log_work('a');
+    SPI_STC_vect();
+    order[ran++] = '|';
+}
+
+static void work_b(void) {
+    log_work('b');
+}
+
+IRQ_LOW(ADC_vect) {
+    IrqDefer(work_a);
+    IrqDefer(work_b);
+}
+
+IRQ_HIGH(INT3_vect, IRQ_INT3) {
+    seen_stamp = stamp;
+    edges++;
+}
+
+IRQ_HIGH(TIMER3_CAPT_vect, IRQ_CAPTURE) {
+    seen_stamp = stamp;
+    edges++;
+}
+
+static void wait_us(uint32_t us) {
+    HalAdvance(us * (F_CPU / 1000000UL));
+}
+
+static void attach(void) {
+    Timer3Attach(&timer3);
+    ran = 0;
+    edges = 0;
+    IrqResetStats();
+}
+
+static void test_bottom_half(void) {
+    attach();
+    ADC_vect();
+    CHECK_STR(order, "a|bc");
+    CHECK(interrupts_on);
+    CHECK(!(SREG & (1 << SREG_I)));                 // As the interrupt found it
+
+    // From the main loop, with interrupts on
+    ran = 0;
+    IrqDefer(work_b);
+    sei();
+    IrqBottomHalf();
+    CHECK_STR(order, "b");
+    CHECK(SREG & (1 << SREG_I));
+    cli();
+
+    // One entry stays free
+    ran = 0;
+    for (uint8_t i = 0; i < IRQ_DEFER_SIZE - 1; i++) CHECK(IrqDefer(work_b));
+    CHECK(!IrqDefer(work_b));
+    CHECK_EQ(IrqDeferDropped(), 1);
+    IrqBottomHalf();
+    CHECK_EQ(ran, IRQ_DEFER_SIZE - 1);
+}
+
+static void test_capture(void) {
+    IrqStats_t stats;
+    attach();
+
+    // Not while the buzzer drives ICP3 (PE7)
+    DDRE = (1 << PE7);
+    CHECK(!IrqHighInit(IRQ_CAPTURE, IRQ_RISING));
+    CHECK(!(ETIMSK & (1 << TICIE3)));
+    CHECK_EQ(DDRE, 1 << PE7);
+
+    DDRE = 0;
+    CHECK(IrqHighInit(IRQ_CAPTURE, IRQ_RISING));
+    CHECK(ETIMSK & (1 << TICIE3));
+    CHECK(TCCR3B & (1 << ICES3));
+
+    wait_us(100);
+    uint16_t edge = TCNT3;
+    ICR3 = edge;
+    wait_us(40);
+    TIMER3_CAPT_vect();
+    CHECK_EQ(seen_stamp, edge);
+    IrqGetStats(IRQ_CAPTURE, &stats);
+    CHECK_EQ(stats.count, 1);
+    CHECK_EQ(stats.samples, 1);
+    CHECK(stats.max_latency >= 40 && stats.max_latency <= 41);
+    CHECK(stats.max_handler <= 1);
+
+    IrqHighStop(IRQ_CAPTURE);
+    CHECK(!(ETIMSK & (1 << TICIE3)));
+}
+
+// The probe edge is measured and doesn't reach the handler body
+static void test_probe(void) {
+    IrqStats_t stats;
+    attach();
+    IrqHighInit(IRQ_INT3, IRQ_FALLING);
+    CHECK_EQ(EICRA & ((1 << ISC31) | (1 << ISC30)), (1 << ISC31));
+    CHECK(EIMSK & (1 << INT3));
+
+    PORTD = 0xFF;
+    CHECK(IrqProbe(IRQ_INT3));
+    CHECK(DDRD & (1 << PD3));
+    CHECK(!(PORTD & (1 << PD3)));
+    CHECK(!IrqProbe(IRQ_INT3));                     // Still out
+    CHECK(!IrqProbe(IRQ_CAPTURE));
+    wait_us(25);
+    INT3_vect();
+    CHECK_EQ(edges, 0);
+    CHECK(!(DDRD & (1 << PD3)));
+    CHECK(PORTD & (1 << PD3));
+    IrqGetStats(IRQ_INT3, &stats);
+    CHECK_EQ(stats.count, 0);
+    CHECK_EQ(stats.samples, 1);
+    CHECK(stats.max_latency >= 25 && stats.max_latency <= 26);
+
+    // A device edge: the body runs, no latency figure
+    INT3_vect();
+    CHECK_EQ(edges, 1);
+    IrqGetStats(IRQ_INT3, &stats);
+    CHECK_EQ(stats.count, 1);
+    CHECK_EQ(stats.samples, 1);
+
+    IrqHighInit(IRQ_INT5, IRQ_ANY);
+    CHECK_EQ(EICRB & ((1 << ISC51) | (1 << ISC50)), (1 << ISC50));
+    CHECK(EIMSK & (1 << INT5));
+}
+
+// The fade runs from the overflow interrupt's bottom half
+static void test_pwm(void) {
+    attach();
+    PwmInit(PWM_LED, 1000);
+    PwmFade(PWM_LED, 255, 20);
+    uint16_t overflows = 0;
+    while (PwmIsFading(PWM_LED) && overflows < 1000) {
+        TIMER0_OVF_vect();
+        overflows++;
+    }
+    CHECK(!PwmIsFading(PWM_LED));
+    CHECK_EQ(PwmGetLevel(PWM_LED), 255);
+    CHECK(overflows >= 18 && overflows <= 24);
+    CHECK(!(SREG & (1 << SREG_I)));
+}
+
+int main(void) {
+    RUN(test_bottom_half);
+    RUN(test_capture);
+    RUN(test_probe);
+    RUN(test_pwm);
+    return TEST_REPORT();
+}
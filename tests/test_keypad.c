@@ -0,0 +1,72 @@
+// Keypad and button scanning (keypad.h, buttons.h) against the PORTD matrix model
+#include <avr/io.h>
+#include "keypad.h"
+#include "buttons.h"
+#include "keymatrix.h"
+#include "test.h"
+
+static KeyMatrix_t km;
+
+static void test_all_keys(void) {
+    KeyMatrixAttach(&km);
+    KeypadInit();
+    CHECK_EQ(KeypadRead(), 0);
+    for (uint8_t key = 1; key <= 16; key++) {
+        KeyMatrixSet(&km, key, 1);
+        CHECK_EQ(KeypadRead(), key);
+        KeyMatrixSet(&km, key, 0);
+    }
+    CHECK_EQ(KeypadRead(), 0);
+}
+
+static void test_scan_order(void) {
+    KeyMatrixAttach(&km);
+    KeypadInit();
+
+    // Rows are driven low one at a time, top to bottom
+    KeypadRead();
+    CHECK_EQ(km.reads, 4);
+    for (uint8_t row = 0; row < 4; row++) CHECK_EQ(km.scan_log[row], 1 << row);
+
+    // The first row wins, then the leftmost column
+    KeyMatrixSet(&km, 7, 1);
+    KeyMatrixSet(&km, 4, 1);
+    CHECK_EQ(KeypadRead(), 4);
+    KeyMatrixSet(&km, 2, 1);
+    CHECK_EQ(KeypadRead(), 2);
+}
+
+static void test_debounce_time(void) {
+    KeyMatrixAttach(&km);
+    KeypadInit();
+
+    // An idle scan only waits for the row lines to settle
+    uint64_t start = HalMicros();
+    KeypadRead();
+    CHECK(HalMicros() - start < 100);
+
+    KeyMatrixSet(&km, 16, 1);
+    start = HalMicros();
+    CHECK_EQ(KeypadRead(), 16);
+    CHECK(HalMicros() - start >= 50000);
+}
+
+static void test_buttons(void) {
+    KeyMatrixAttach(&km);
+    ButtonsInit();
+    CHECK_EQ(ButtonsRead(), 0);
+    km.buttons = 0x04;
+    CHECK_EQ(ButtonsRead(), 3);
+    km.buttons = 0x0A;
+    CHECK_EQ(ButtonsRead(), 2);
+    km.buttons = 0;
+    CHECK_EQ(ButtonsRead(), 0);
+}
+
+int main(void) {
+    RUN(test_all_keys);
+    RUN(test_scan_order);
+    RUN(test_debounce_time);
+    RUN(test_buttons);
+    return TEST_REPORT();
+}
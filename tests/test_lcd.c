@@ -0,0 +1,215 @@
+// LCD1602 driver (lcd.c) against the HD44780 model on PORTA/PORTB
+#include <avr/io.h>
+#include "lcd.h"
+#include "hd44780.h"
+#include "timer3.h"
+#include "test.h"
+
+static Hd44780_t lcd;
+static Timer3_t timer3;
+
+static void attach(void) {
+    Hd44780Init(&lcd);
+    Hd44780AttachParallel(&lcd, HAL_ADDR(PORTB), PB5, PB6, PB7, HAL_ADDR(PORTA));
+    Timer3Attach(&timer3);
+}
+
+static void test_init_8bit(void) {
+    attach();
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+    HalSync();
+
+    CHECK(lcd.eight_bit);
+    CHECK(lcd.two_lines);
+    CHECK(lcd.display_on);
+    CHECK(!lcd.cursor_on);
+    CHECK(lcd.increment);
+    CHECK_EQ(lcd.ac, 0x00);
+    CHECK_EQ(lcd.busy_violations, 0);
+    CHECK_EQ(HalGet(HAL_ADDR(DDRB)) & 0xE0, 0xE0);
+
+    // 0x30 three times, function set, display on, entry mode, clear
+    static const uint8_t expected[] = { 0x30, 0x30, 0x30, 0x38, 0x0C, 0x06, 0x01 };
+    CHECK_EQ(lcd.byte_count, sizeof(expected));
+    for (uint8_t i = 0; i < sizeof(expected); i++) {
+        CHECK_EQ(lcd.bytes[i].value, expected[i]);
+        CHECK(!lcd.bytes[i].rs);
+    }
+}
+
+static void test_init_4bit_nibbles(void) {
+    attach();
+    LcdInit(LCD_MODE_4BIT);
+    LcdStart(2, 16);
+    HalSync();
+
+    CHECK(!lcd.eight_bit);
+    CHECK(lcd.two_lines);
+    CHECK(lcd.display_on);
+    CHECK_EQ(lcd.busy_violations, 0);
+
+    // Every command is two strobes, high nibble first, on DB4-DB7
+    static const uint8_t expected[] = {
+        0x00, 0x30,     // 0x03 (seen as 8-bit function set)
+        0x00, 0x30,     // 0x03
+        0x00, 0x20,     // 0x02: switch to 4 bits
+        0x20, 0x80,     // 0x28
+        0x00, 0xC0,     // 0x0C
+        0x00, 0x60,     // 0x06
+        0x00, 0x10      // 0x01
+    };
+    CHECK_EQ(lcd.strobe_count, sizeof(expected));
+    for (uint8_t i = 0; i < sizeof(expected) && i < lcd.strobe_count; i++) {
+        CHECK_EQ(lcd.strobes[i] & 0xF0, expected[i]);
+    }
+
+    LcdPrint("Hi");
+    CHECK_EQ(Hd44780Last(&lcd, true), 'i');
+    CHECK_EQ(lcd.strobes[lcd.strobe_count - 2] & 0xF0, 0x60);      // 'i' = 0x69
+    CHECK_EQ(lcd.strobes[lcd.strobe_count - 1] & 0xF0, 0x90);
+}
+
+static void test_cursor_addresses(void) {
+    char row[17];
+    attach();
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+
+    LcdSetCursor(0, 3);
+    CHECK_EQ(Hd44780Last(&lcd, false), 0x83);
+    LcdPrint("abc");
+    LcdSetCursor(1, 0);
+    CHECK_EQ(Hd44780Last(&lcd, false), 0xC0);
+    LcdPrint("second");
+    LcdSetCursor(1, 15);
+    CHECK_EQ(Hd44780Last(&lcd, false), 0xCF);
+
+    // Out of range positions are ignored
+    uint16_t count = lcd.byte_count;
+    LcdSetCursor(2, 0);
+    LcdSetCursor(0, 16);
+    HalSync();
+    CHECK_EQ(lcd.byte_count, count);
+
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "   abc          ");
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, "second          ");
+}
+
+static void test_print_int(void) {
+    char row[17];
+    attach();
+    LcdInit(LCD_MODE_4BIT);
+    LcdStart(2, 16);
+
+    LcdPrintInt(-2147483647);
+    LcdSetCursor(1, 0);
+    LcdPrintInt(0);
+    LcdPrint(" ");
+    LcdPrintInt(907);
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "-2147483647     ");
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, "0 907           ");
+}
+
+static void test_shift_and_timing(void) {
+    char row[17];
+    attach();
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+
+    LcdPrint("ABCD");
+    LcdMoveLeft();
+    Hd44780Row(&lcd, 0, row, 4);
+    CHECK_STR(row, "BCD ");
+    LcdMoveRight();
+    LcdMoveRight();
+    Hd44780Row(&lcd, 0, row, 4);
+    CHECK_STR(row, " ABC");
+
+    // Clear needs 1.52 ms before the next transfer
+    uint64_t start = HalMicros();
+    LcdClear();
+    LcdPrint("x");
+    HalSync();
+    CHECK(HalMicros() - start >= 1520);
+    CHECK_EQ(lcd.busy_violations, 0);
+}
+
+static void test_20x4_rows(void) {
+    char row[21];
+    attach();
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(4, 20);
+
+    // Rows 2 and 3 continue rows 0 and 1 after 20 cells
+    static const uint8_t expected[] = { 0x80, 0xC0, 0x94, 0xD4 };
+    for (uint8_t r = 0; r < 4; r++) {
+        LcdSetCursor(r, 0);
+        CHECK_EQ(Hd44780Last(&lcd, false), expected[r]);
+        LcdPrint("row");
+        LcdPrintInt(r);
+    }
+    LcdSetCursor(3, 19);
+    CHECK_EQ(Hd44780Last(&lcd, false), 0xE7);
+    for (uint8_t r = 0; r < 4; r++) {
+        Hd44780Row(&lcd, r, row, 20);
+        CHECK_EQ(row[0], 'r');
+        CHECK_EQ(row[3], '0' + r);
+    }
+}
+
+static void test_two_displays(void) {
+    static Hd44780_t second;
+    Lcd_t top, bottom;
+    char row[17];
+
+    // Second panel on the same data bus and RS/RW, with its own EN line on PB4
+    attach();
+    Hd44780Init(&second);
+    Hd44780AttachParallel(&second, HAL_ADDR(PORTB), PB5, PB6, PB4, HAL_ADDR(PORTA));
+    LcdDevInit(&top, LCD_MODE_4BIT, PB7);
+    LcdDevInit(&bottom, LCD_MODE_8BIT, PB4);
+    LcdDevStart(&top, 2, 16);
+    LcdDevStart(&bottom, 2, 16);
+
+    LcdDevPrint(&top, "top");
+    LcdDevSetCursor(&bottom, 1, 2);
+    LcdDevPrint(&bottom, "bottom");
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "top             ");
+    Hd44780Row(&second, 1, row, 16);
+    CHECK_STR(row, "  bottom        ");
+    Hd44780Row(&second, 0, row, 16);
+    CHECK_STR(row, "                ");
+    CHECK(!lcd.eight_bit);
+    CHECK(second.eight_bit);
+
+    // A clear on one panel doesn't hold up the other
+    uint64_t start = HalMicros();
+    LcdDevClear(&top);
+    LcdDevPrint(&bottom, "!");
+    HalSync();
+    CHECK(HalMicros() - start < 200);
+    LcdDevPrint(&top, "x");
+    HalSync();
+    CHECK(HalMicros() - start >= 1520);
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "x               ");
+    CHECK_EQ(lcd.busy_violations, 0);
+    CHECK_EQ(second.busy_violations, 0);
+}
+
+int main(void) {
+    RUN(test_init_8bit);
+    RUN(test_init_4bit_nibbles);
+    RUN(test_cursor_addresses);
+    RUN(test_print_int);
+    RUN(test_shift_and_timing);
+    RUN(test_20x4_rows);
+    RUN(test_two_displays);
+    return TEST_REPORT();
+}
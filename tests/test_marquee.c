@@ -0,0 +1,117 @@
+// Marquee viewports (marquee.c) on the parallel and the I2C LCD
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "marquee.h"
+#include "lcd.h"
+#include "i2c_lcd.h"
+#include "hd44780.h"
+#include "twi_bus.h"
+#include "pcf8574.h"
+#include "timer3.h"
+#include "test.h"
+
+static const char news[] PROGMEM = "Scrolling news on row two";     // 25 characters
+
+// Viewports stay registered across tests, like globals in a program
+static Marquee_t ticker, status;
+static Hd44780_t lcd;
+static Timer3_t timer3;
+
+static void ticks(uint8_t n) {
+    while (n--) MarqueeTick();
+}
+
+static void test_scroll_one_row(void) {
+    char row[17];
+    Hd44780Init(&lcd);
+    Hd44780AttachParallel(&lcd, HAL_ADDR(PORTB), PB5, PB6, PB7, HAL_ADDR(PORTA));
+    Timer3Attach(&timer3);
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+    LcdPrint("Temp 23C");
+
+    CHECK(MarqueeInit(&ticker, LcdSetCursor, LcdWrite, 1, 0, 16));
+    CHECK(MarqueeInit(&status, LcdSetCursor, LcdWrite, 0, 10, 6));
+    MarqueeSetText_P(&ticker, news, 5);
+    MarqueeSetText(&status, "OK", 5);      // Fits: drawn once, no scrolling
+
+    CHECK_EQ(MarqueeUpdate(), 2);
+    HalSync();
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "Temp 23C  OK    ");
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, "Scrolling news o");
+
+    // Nothing due
+    CHECK_EQ(MarqueeUpdate(), 0);
+    ticks(4);
+    CHECK_EQ(MarqueeUpdate(), 0);
+
+    // One step: one cursor command and the 16 cells of the window, nothing else
+    uint16_t bytes = lcd.byte_count;
+    ticks(1);
+    CHECK_EQ(MarqueeUpdate(), 1);
+    HalSync();
+    CHECK_EQ(lcd.byte_count - bytes, 1 + 16);
+    CHECK_EQ(lcd.bytes[bytes].value, 0xC0);
+    CHECK(!lcd.bytes[bytes].rs);
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, "crolling news on");
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "Temp 23C  OK    ");
+
+    // Steps missed by a busy main loop are caught up in one redraw
+    bytes = lcd.byte_count;
+    ticks(5 * 17);
+    CHECK_EQ(MarqueeUpdate(), 1);
+    HalSync();
+    CHECK_EQ(lcd.byte_count - bytes, 1 + 16);
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, "row two    Scrol");
+
+    // Text and gap make 29 steps for a full turn
+    ticks(5 * 11);
+    MarqueeUpdate();
+    HalSync();
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, "Scrolling news o");
+    CHECK_EQ(lcd.busy_violations, 0);
+}
+
+static void test_i2c_lcd(void) {
+    TwiBus_t bus;
+    Pcf8574_t pcf;
+    Hd44780_t i2c_lcd;
+    char row[17];
+
+    TwiBusAttach(&bus);
+    Pcf8574Init(&pcf, &bus, 0x27);
+    Hd44780Init(&i2c_lcd);
+    Pcf8574AttachLcd(&pcf, &i2c_lcd);
+    Timer3Attach(&timer3);
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+
+    CHECK(MarqueeInit(&ticker, I2C_LcdSetCursor, I2C_LcdWrite, 0, 4, 8));
+    CHECK(MarqueeInit(&status, I2C_LcdSetCursor, I2C_LcdWrite, 1, 0, 16));
+    MarqueeSetText(&ticker, "0123456789AB", 1);
+    MarqueeSetText(&status, "", 0);
+    MarqueeUpdate();
+
+    // The window is written in one transfer
+    uint32_t starts = bus.starts;
+    ticks(3);
+    CHECK_EQ(MarqueeUpdate(), 1);
+    HalSync();
+    CHECK_EQ(bus.starts - starts, 2);
+    Hd44780Row(&i2c_lcd, 0, row, 16);
+    CHECK_STR(row, "    3456789A    ");
+    CHECK_EQ(i2c_lcd.busy_violations, 0);
+    CHECK_EQ(I2C_LcdGetStatus(), TWI_OK);
+}
+
+int main(void) {
+    RUN(test_scroll_one_row);
+    RUN(test_i2c_lcd);
+    return TEST_REPORT();
+}
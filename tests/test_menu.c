@@ -0,0 +1,197 @@
+// Menus (menu.c): navigation, toggles and number edits, cells sent to the LCD, latency
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "menu.h"
+#include "lcd.h"
+#include "i2c_lcd.h"
+#include "hd44780.h"
+#include "twi_bus.h"
+#include "pcf8574.h"
+#include "timer3.h"
+#include "test.h"
+
+#define FRAME_US    8190        // One arbiter frame at 122 Hz
+
+static bool beep = true;
+static int16_t level = 100;
+static int16_t offset = -5;
+static uint8_t applied;
+
+static void apply(void) {
+    applied++;
+}
+
+static const MenuItem_t setup[] PROGMEM = {
+    { "Offset", MENU_NUMBER, .value = &offset, .action = apply, .min = -20, .max = 20, .step = 5 },
+    { "Save", MENU_ACTION, .action = apply },
+    { "Back", MENU_BACK },
+    { "" }
+};
+
+static const MenuItem_t top[] PROGMEM = {
+    { "Beep", MENU_TOGGLE, .value = &beep, .action = apply },
+    { "Level", MENU_NUMBER, .value = &level, .action = apply, .min = 0, .max = 255, .step = 16 },
+    { "Setup", MENU_SUBMENU, .page = setup },
+    { "" }
+};
+
+static Hd44780_t lcd;
+static Timer3_t timer3;
+static Menu_t menu;
+
+static void attach(void) {
+    Hd44780Init(&lcd);
+    Hd44780AttachParallel(&lcd, HAL_ADDR(PORTB), PB5, PB6, PB7, HAL_ADDR(PORTA));
+    Timer3Attach(&timer3);
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+    beep = true;
+    level = 100;
+    offset = -5;
+    applied = 0;
+    MenuInit(&menu, LcdSetCursor, LcdWrite, 2, 16, top);
+}
+
+static void check_rows(const char *row0, const char *row1) {
+    char row[17];
+    HalSync();
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, row0);
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, row1);
+}
+
+static void test_navigate(void) {
+    attach();
+    CHECK_EQ(MenuUpdate(&menu), 32);
+    check_rows(">Beep         on", " Level       100");
+    CHECK_EQ(MenuUpdate(&menu), 0);
+
+    // Moving the cursor: one cursor command and one cell per row
+    uint16_t bytes = lcd.byte_count;
+    CHECK(MenuKey(&menu, MENU_KEY_DOWN));
+    CHECK_EQ(MenuUpdate(&menu), 2);
+    HalSync();
+    CHECK_EQ(lcd.byte_count - bytes, 4);
+    check_rows(" Beep         on", ">Level       100");
+
+    // Past the last row the list scrolls
+    CHECK(MenuKey(&menu, MENU_KEY_DOWN));
+    MenuUpdate(&menu);
+    check_rows(" Level       100", ">Setup         \x7E");
+    CHECK(!MenuKey(&menu, MENU_KEY_DOWN));
+    CHECK(!MenuKey(&menu, MENU_KEY_BACK));          // Already on top
+
+    // Into the submenu and back to the same item
+    CHECK(MenuKey(&menu, MENU_KEY_OK));
+    MenuUpdate(&menu);
+    check_rows(">Offset       -5", " Save           ");
+    MenuKey(&menu, MENU_KEY_DOWN);
+    MenuKey(&menu, MENU_KEY_DOWN);
+    CHECK(MenuKey(&menu, MENU_KEY_OK));             // "Back" item
+    MenuUpdate(&menu);
+    check_rows(" Level       100", ">Setup         \x7E");
+    CHECK_EQ(lcd.busy_violations, 0);
+}
+
+static void test_edit(void) {
+    attach();
+    MenuUpdate(&menu);
+
+    // Toggle: only the value cells change
+    MenuKey(&menu, MENU_KEY_OK);
+    CHECK(!beep);
+    CHECK_EQ(applied, 1);
+    CHECK_EQ(MenuUpdate(&menu), 3);
+    check_rows(">Beep        off", " Level       100");
+
+    // Number: the copy changes, the value only on OK, clamped to the range
+    MenuKey(&menu, MENU_KEY_DOWN);
+    MenuKey(&menu, MENU_KEY_OK);
+    MenuUpdate(&menu);
+    check_rows(" Beep        off", "*Level       100");
+    MenuKey(&menu, MENU_KEY_UP);
+    CHECK_EQ(MenuUpdate(&menu), 2);                 // "100" -> "116"
+    check_rows(" Beep        off", "*Level       116");
+    CHECK_EQ(level, 100);
+    for (uint8_t i = 0; i < 20; i++) MenuKey(&menu, MENU_KEY_UP);
+    MenuKey(&menu, MENU_KEY_OK);
+    CHECK_EQ(level, 255);
+    CHECK_EQ(applied, 2);
+    MenuUpdate(&menu);
+    check_rows(" Beep        off", ">Level       255");
+
+    // Back drops the edit
+    MenuKey(&menu, MENU_KEY_OK);
+    MenuKey(&menu, MENU_KEY_DOWN);
+    MenuKey(&menu, MENU_KEY_BACK);
+    CHECK_EQ(level, 255);
+    CHECK_EQ(applied, 2);
+
+    // Negative numbers and the lower end
+    MenuKey(&menu, MENU_KEY_DOWN);
+    MenuKey(&menu, MENU_KEY_OK);
+    MenuKey(&menu, MENU_KEY_OK);
+    for (uint8_t i = 0; i < 5; i++) MenuKey(&menu, MENU_KEY_DOWN);
+    MenuKey(&menu, MENU_KEY_OK);
+    CHECK_EQ(offset, -20);
+    MenuUpdate(&menu);
+    check_rows(">Offset      -20", " Save           ");
+
+    // Changed elsewhere: nothing until MenuRefresh()
+    offset = 15;
+    CHECK_EQ(MenuUpdate(&menu), 0);
+    MenuRefresh(&menu);
+    CHECK_EQ(MenuUpdate(&menu), 3);
+    check_rows(">Offset       15", " Save           ");
+
+    // Screen overwritten: MenuInvalidate() draws it all again
+    LcdClear();
+    MenuInvalidate(&menu);
+    CHECK_EQ(MenuUpdate(&menu), 32);
+    check_rows(">Offset       15", " Save           ");
+    CHECK_EQ(lcd.busy_violations, 0);
+}
+
+// A keypress that scrolls the whole screen still lands within one frame over TWI
+static void test_i2c_latency(void) {
+    TwiBus_t bus;
+    Pcf8574_t pcf;
+    Hd44780_t i2c_lcd;
+    char row[17];
+
+    TwiBusAttach(&bus);
+    Pcf8574Init(&pcf, &bus, 0x27);
+    Hd44780Init(&i2c_lcd);
+    Pcf8574AttachLcd(&pcf, &i2c_lcd);
+    Timer3Attach(&timer3);
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+    MenuInit(&menu, I2C_LcdSetCursor, I2C_LcdWrite, 2, 16, top);
+    MenuUpdate(&menu);
+
+    uint64_t start = HalMicros();
+    MenuKey(&menu, MENU_KEY_DOWN);
+    MenuUpdate(&menu);
+    uint64_t step = HalMicros() - start;
+
+    start = HalMicros();
+    MenuKey(&menu, MENU_KEY_DOWN);
+    CHECK_EQ(MenuUpdate(&menu), 16);                // Both rows, less the cells they share
+    uint64_t scroll = HalMicros() - start;
+    HalSync();
+
+    Hd44780Row(&i2c_lcd, 1, row, 16);
+    CHECK_STR(row, ">Setup         \x7E");
+    CHECK(step < scroll / 3);
+    CHECK(scroll < FRAME_US);
+    CHECK_EQ(i2c_lcd.busy_violations, 0);
+    CHECK_EQ(I2C_LcdGetStatus(), TWI_OK);
+}
+
+int main(void) {
+    RUN(test_navigate);
+    RUN(test_edit);
+    RUN(test_i2c_latency);
+    return TEST_REPORT();
+}
@@ -0,0 +1,162 @@
+// PORTD owner (portd.c): keypad and button scans in the gaps of the TWI bus
+#include <avr/io.h>
+#include "portd.h"
+#include "i2c_lcd.h"
+#include "timebase.h"
+#include "twi_bus.h"
+#include "pcf8574.h"
+#include "keymatrix.h"
+#include "timer3.h"
+#include "test.h"
+
+static TwiBus_t bus;
+static Pcf8574_t pcf;
+static Hd44780_t lcd;
+static KeyMatrix_t km;
+static Timer3_t timer3;
+
+// The keypad answers PIND after the bus model, so a scan with TWI off sees the keys
+static void attach(void) {
+    TwiBusAttach(&bus);
+    Pcf8574Init(&pcf, &bus, 0x27);
+    Hd44780Init(&lcd);
+    Pcf8574AttachLcd(&pcf, &lcd);
+    KeyMatrixAttach(&km);
+    Timer3Attach(&timer3);
+}
+
+// Poll for a while with nothing else going on
+static void poll_for(uint32_t us) {
+    uint64_t end = HalMicros() + us;
+    while (HalMicros() < end) {
+        PortdPoll();
+        HalAdvance(100 * (F_CPU / 1000000UL));
+    }
+}
+
+// SCL/SDA pulled low by a scan: a clock pulse or a START/STOP for the slaves
+static uint16_t twi_driven;
+
+static void twi_hook(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    (void)old_value;
+    (void)ctx;
+    uint8_t ddr = (addr == HAL_ADDR(DDRD)) ? value : HalGet(HAL_ADDR(DDRD));
+    uint8_t port = (addr == HAL_ADDR(PORTD)) ? value : HalGet(HAL_ADDR(PORTD));
+    if (ddr & ~port & ((1 << PD0) | (1 << PD1))) twi_driven++;
+}
+
+static void test_scan(void) {
+    attach();
+    TwiInit();
+    PortdInit(0);
+    twi_driven = 0;
+    HalOnWrite(HAL_ADDR(DDRD), twi_hook, NULL);
+    HalOnWrite(HAL_ADDR(PORTD), twi_hook, NULL);
+    CHECK_EQ(PortdKey(), 0);
+
+    KeyMatrixSet(&km, 10, 1);
+    poll_for(PORTD_SCAN_US);
+    CHECK_EQ(PortdKey(), 0);                        // Not debounced yet
+    poll_for(PORTD_DEBOUNCE * PORTD_SCAN_US);
+    CHECK_EQ(PortdKey(), 10);
+
+    // Rows 0-1 are SCL/SDA: not driven while the bus is in use
+    KeyMatrixSet(&km, 10, 0);
+    KeyMatrixSet(&km, 6, 1);
+    poll_for((PORTD_DEBOUNCE + 1) * PORTD_SCAN_US);
+    CHECK_EQ(PortdKey(), 0);
+    CHECK_EQ(twi_driven, 0);
+
+    KeyMatrixSet(&km, 6, 0);
+    km.buttons = 0x04;
+    poll_for((PORTD_DEBOUNCE + 1) * PORTD_SCAN_US);
+    CHECK_EQ(PortdKey(), 0);
+    CHECK_EQ(PortdButtons(), 0x04);
+
+    // The pins and the TWI unit are back as they were
+    CHECK_EQ(HalGet(HAL_ADDR(DDRD)) & 0x03, 0);
+    CHECK_EQ(HalGet(HAL_ADDR(PORTD)) & 0x03, 0x03);
+    CHECK(HalGet(HAL_ADDR(TWCR)) & (1 << TWEN));
+
+    PortdStats_t stats;
+    PortdGetStats(&stats);
+    CHECK(stats.scans >= 8);
+    CHECK(stats.max_scan_us < 100);
+    CHECK(stats.max_late_us <= 100);
+}
+
+// PS/2 on PD2/PD3: those pins never change and rows 2-3 are not scanned
+static uint16_t reserved_writes;
+
+static void reserved_hook(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    (void)addr;
+    (void)ctx;
+    if ((old_value ^ value) & 0x0C) reserved_writes++;
+}
+
+static void test_reserved(void) {
+    attach();
+    DDRD = 0x00;
+    PORTD = 0x0C;                                   // PS/2 lines idle: inputs, pulled up
+    PortdInit((1 << PD2) | (1 << PD3));
+    HalOnWrite(HAL_ADDR(DDRD), reserved_hook, NULL);
+    HalOnWrite(HAL_ADDR(PORTD), reserved_hook, NULL);
+
+    KeyMatrixSet(&km, 10, 1);                       // Row 2
+    poll_for((PORTD_DEBOUNCE + 1) * PORTD_SCAN_US);
+    CHECK_EQ(PortdKey(), 0);
+    KeyMatrixSet(&km, 10, 0);
+    KeyMatrixSet(&km, 2, 1);                        // Row 0
+    poll_for((PORTD_DEBOUNCE + 1) * PORTD_SCAN_US);
+    CHECK_EQ(PortdKey(), 2);
+    CHECK_EQ(reserved_writes, 0);
+    CHECK_EQ(HalGet(HAL_ADDR(DDRD)) & 0x0C, 0x00);
+    CHECK_EQ(HalGet(HAL_ADDR(PORTD)) & 0x0C, 0x0C);
+}
+
+// The LCD streams without a pause: scans only land between transfers, no transfer is
+// disturbed and a key still comes through within a few scan periods
+static void test_streaming(void) {
+    char row[17];
+    attach();
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+    PortdInit(0);
+
+    uint64_t start = HalMicros();
+    uint64_t pressed_at = 0, seen_at = 0;
+    for (uint16_t i = 0; HalMicros() < 300000; i++) {
+        I2C_LcdSetCursor(i & 1, 0);
+        I2C_LcdPrint((i & 1) ? "streaming row 1 " : "streaming row 0 ");
+        if (!pressed_at && HalMicros() > 100000) {
+            KeyMatrixSet(&km, 16, 1);
+            pressed_at = HalMicros();
+        }
+        if (pressed_at && !seen_at && PortdKey() == 16) seen_at = HalMicros();
+    }
+
+    CHECK(seen_at > pressed_at);
+    CHECK(seen_at - pressed_at <= (PORTD_DEBOUNCE + 1) * PORTD_SCAN_US + 5000);
+    CHECK_EQ(bus.glitches, 0);
+    CHECK_EQ(bus.nacks, 0);
+    CHECK_EQ(bus.starts, bus.stops);
+    CHECK_EQ(I2C_LcdGetStatus(), TWI_OK);
+    CHECK_EQ(lcd.busy_violations, 0);
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "streaming row 0 ");
+    Hd44780Row(&lcd, 1, row, 16);
+    CHECK_STR(row, "streaming row 1 ");
+
+    PortdStats_t stats;
+    PortdGetStats(&stats);
+    CHECK(stats.scans >= (HalMicros() - start) / (PORTD_SCAN_US + 5000));
+    CHECK_EQ(stats.deferred, 0);                    // Every scan came from a gap
+    CHECK(stats.max_late_us < 5000);                // At most one 16-character transfer
+}
+
+int main(void) {
+    RUN(test_scan);
+    RUN(test_reserved);
+    RUN(test_streaming);
+    return TEST_REPORT();
+}
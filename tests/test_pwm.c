@@ -0,0 +1,68 @@
+// PWM (pwm.c): OC0 compare value and dither at low duties, where one count matters
+#include <avr/io.h>
+#include "pwm.h"
+#include "test.h"
+
+void TIMER0_OVF_vect(void);
+
+// On-time in quarter counts over four periods: OCR0 + 1 counts each while connected
+static uint16_t quarters(void) {
+    uint16_t on = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (TIMSK & (1 << TOIE0)) TIMER0_OVF_vect();
+        if (TCCR0 & ((1 << COM01) | (1 << COM00))) on += OCR0 + 1;
+    }
+    return on;
+}
+
+static void test_low_duty(void) {
+    PwmInit(PWM_LED, 1000);
+
+    // Below one count: disconnected, D9 (active LOW) off, no dither interrupt
+    PwmSetDuty10(PWM_LED, 3);
+    CHECK(!(TCCR0 & ((1 << COM01) | (1 << COM00))));
+    CHECK(PORTB & (1 << PB4));
+    CHECK(!(TIMSK & (1 << TOIE0)));
+
+    // One count exactly
+    PwmSetDuty10(PWM_LED, 4);
+    CHECK_EQ(OCR0, 0);
+    CHECK(!(TIMSK & (1 << TOIE0)));
+    CHECK_EQ(quarters(), 4);
+
+    // 1.25 and 1.75 counts: OCR0 = 0 with one and three periods of 1
+    PwmSetDuty10(PWM_LED, 5);
+    CHECK_EQ(OCR0, 0);
+    CHECK(TIMSK & (1 << TOIE0));
+    CHECK_EQ(quarters(), 5);
+    PwmSetDuty10(PWM_LED, 7);
+    CHECK_EQ(quarters(), 7);
+
+    // Every duty averages duty / 4 counts
+    for (uint16_t duty = 4; duty < PWM_DUTY_MAX; duty += 37) {
+        PwmSetDuty10(PWM_LED, duty);
+        CHECK_EQ(quarters(), duty);
+    }
+
+    // Full scale: OCR0 = TOP, no dither
+    PwmSetDuty10(PWM_LED, PWM_DUTY_MAX);
+    CHECK_EQ(OCR0, 0xFF);
+    CHECK(!(TIMSK & (1 << TOIE0)));
+}
+
+// The lowest gamma levels are off rather than one full count
+static void test_gamma_floor(void) {
+    PwmInit(PWM_LED, 1000);
+    PwmSetLevel(PWM_LED, 13);
+    CHECK(!(TCCR0 & ((1 << COM01) | (1 << COM00))));
+    PwmSetLevel(PWM_LED, 20);
+    CHECK(TCCR0 & ((1 << COM01) | (1 << COM00)));
+    CHECK_EQ(OCR0, 0);
+    CHECK_EQ(quarters(), 4);
+}
+
+int main(void) {
+    RUN(test_low_duty);
+    RUN(test_gamma_floor);
+    return TEST_REPORT();
+}
@@ -0,0 +1,187 @@
+// Serial shell (shell.c, shell_params.c) over the USART model
+#include <avr/io.h>
+#include "shell.h"
+#include "uart.h"
+#include "portd.h"
+#include "twi.h"
+#include "arbiter.h"
+#include "clock.h"
+#include "usart.h"
+#include "timer3.h"
+#include "test.h"
+
+void USART0_UDRE_vect(void);
+void USART0_RX_vect(void);
+
+static Usart_t usart;
+static Timer3_t timer3;
+static uint8_t beeps;
+
+static bool cmd_beep(uint8_t argc, char *argv[], uint8_t step) {
+    (void)argv;
+    (void)step;
+    beeps += argc;
+    return false;
+}
+
+static const ShellCommand_t commands[] PROGMEM = {
+    { "beep", cmd_beep, "[x]  count the words" },
+    { "" }
+};
+
+static void drain(void) {
+    while (UCSR0B & (1 << UDRIE0)) USART0_UDRE_vect();
+}
+
+static void attach(void) {
+    UsartAttach(&usart);
+    Timer3Attach(&timer3);
+    UartInit(0);
+    ShellInit(commands, ShellLibraryParams);
+    drain();
+}
+
+// Type a line and let the shell finish it; the output is what it sent meanwhile
+static const char *type(const char *line) {
+    static char out[USART_TX_LOG + 1];
+    usart.tx_count = 0;
+    UsartFeed(&usart, line, strlen(line));
+    for (size_t i = 0; i < strlen(line); i++) {
+        USART0_RX_vect();
+        ShellPoll();
+        drain();
+    }
+    for (int i = 0; i < 100; i++) {
+        ShellPoll();
+        drain();
+    }
+    memcpy(out, usart.tx, usart.tx_count);
+    out[usart.tx_count] = '\0';
+    return out;
+}
+
+static void test_line(void) {
+    attach();
+    CHECK_STR(type("beep a b\r\n"), "beep a b\r\n> ");
+    CHECK_EQ(beeps, 3);
+    CHECK_STR(type("  beep   a \r"), "  beep   a \r\n> ");   // CR alone ends a line too
+    CHECK_EQ(beeps, 5);
+    CHECK_STR(type("\n"), "");                     // The LF of that CR
+    CHECK_STR(type("\r\n"), "\r\n> ");
+    CHECK_STR(type("bx\bep\r\n"), "bx\b \bep\r\n? bep\r\n> ");
+    CHECK_STR(type("beep 1 2 3 4 5 6\r\n"), "beep 1 2 3 4 5 6\r\ntoo many words\r\n> ");
+
+    const char *help = type("help\r\n");
+    CHECK(!strncmp(help, "help\r\nhelp    list the commands\r\n", 33));
+    CHECK(strstr(help, "stats   show the statistics\r\nbeep    [x]  count the words\r\n> ") != NULL);
+
+    // A full line rings the bell instead of taking more
+    char longline[SHELL_LINE + 2];
+    memset(longline, 'x', SHELL_LINE + 1);
+    longline[SHELL_LINE + 1] = '\0';
+    const char *out = type(longline);
+    CHECK_EQ(strlen(out), SHELL_LINE + 1);
+    CHECK_EQ(out[SHELL_LINE - 1], '\a');
+}
+
+static void test_peek_poke(void) {
+    attach();
+    CHECK_STR(type("poke 0x3b 0x5a\r\n"), "poke 0x3b 0x5a\r\n> ");
+    CHECK_EQ(PORTA, 0x5A);
+    CHECK_STR(type("peek 59\r\n"), "peek 59\r\n003b: 5a\r\n> ");
+
+    for (uint8_t i = 0; i < 10; i++) _SFR_MEM8(0x100 + i) = i;
+    CHECK_STR(type("peek 0x100 10\r\n"), "peek 0x100 10\r\n0100: 00 01 02 03 04 05 06 07\r\n0108: 08 09\r\n> ");
+
+    CHECK_STR(type("poke 0x10 1\r\n"), "poke 0x10 1\r\nusage: poke <addr> <byte>  write memory\r\n> ");
+    CHECK_STR(type("poke 0x3b 256\r\n"), "poke 0x3b 256\r\nusage: poke <addr> <byte>  write memory\r\n> ");
+    CHECK_STR(type("peek 0x10ff 2\r\n"), "peek 0x10ff 2\r\nusage: peek <addr> [n]  read memory\r\n> ");
+    CHECK_STR(type("peek 0x1g\r\n"), "peek 0x1g\r\nusage: peek <addr> [n]  read memory\r\n> ");
+}
+
+static void test_params(void) {
+    attach();
+    TwiInit();
+    PortdInit(0);
+    CHECK_STR(type("set debounce 5\r\n"), "set debounce 5\r\ndebounce 5\r\n> ");
+    CHECK_EQ(PortdDebounce(), 5);
+    CHECK_STR(type("set refresh 100\r\n"), "set refresh 100\r\nrefresh 98\r\n> ");
+    CHECK_STR(type("set refresh 250\r\n"), "set refresh 250\r\nrefresh 163\r\n> ");
+    CHECK_STR(type("set twi_hz 100000\r\n"), "set twi_hz 100000\r\ntwi_hz 100000\r\n> ");
+    CHECK_EQ(TWBR, 32);
+    CHECK_STR(type("get scan_us\r\n"), "get scan_us\r\nscan_us 10000\r\n> ");
+    CHECK_STR(type("set scan_us 5\r\n"), "set scan_us 5\r\nscan_us 200\r\n> ");
+
+    // The TWI rate holds through a clock change
+    CHECK_STR(type("set clockdiv 2\r\n"), "set clockdiv 2\r\nclockdiv 2\r\n> ");
+    CHECK_EQ(TwiSpeed(), 100000);
+    CHECK_STR(type("set clockdiv 3\r\n"), "set clockdiv 3\r\nclockdiv 2\r\n> ");
+    type("set clockdiv 1\r\n");
+
+    CHECK_STR(type("set scans 1\r\n"), "set scans 1\r\nread-only\r\n> ");
+    CHECK_STR(type("get nope\r\n"), "get nope\r\n? nope\r\n> ");
+    CHECK_STR(type("set debounce x\r\n"), "set debounce x\r\nusage: set <name> <value>  change one\r\n> ");
+
+    const char *get = type("get\r\n");
+    CHECK(strstr(get, "\r\nclockdiv 1\r\nrefresh 163\r\ntwi_hz 100000\r\nscan_us 200\r\ndebounce 5\r\n> ") != NULL);
+    const char *stats = type("stats\r\n");
+    CHECK(strstr(stats, "\r\narb_isr_us 0\r\narb_late 0\r\nscans 0\r\n") != NULL);
+    CHECK(strstr(stats, "debounce") == NULL);
+}
+
+// Programs whose timers don't follow a clock change: clockdiv can only be read
+static void test_fixed_clock(void) {
+    attach();
+    ShellInit(commands, ShellFixedClockParams);
+    drain();
+    CHECK_STR(type("set clockdiv 2\r\n"), "set clockdiv 2\r\nread-only\r\n> ");
+    CHECK_EQ(ClockDivider(), 1);
+    CHECK_STR(type("get clockdiv\r\n"), "get clockdiv\r\nclockdiv 1\r\n> ");
+    CHECK_STR(type("set debounce 4\r\n"), "set debounce 4\r\ndebounce 4\r\n> ");
+}
+
+// One step per poll, and only with room for it in the text queue
+static void test_steps(void) {
+    attach();
+    usart.tx_count = 0;
+    UsartFeed(&usart, "peek 0x100 32\r", 14);
+    for (uint8_t i = 0; i < 14; i++) USART0_RX_vect();
+    CHECK(!ShellPoll());                            // Reads the line
+    drain();
+    CHECK(ShellPoll());                             // First row
+    CHECK(!ShellPoll());                            // No room for a second one
+    drain();
+    CHECK(ShellPoll());
+    drain();
+    CHECK(ShellPoll());
+    CHECK(!ShellPoll());
+    drain();
+    CHECK(ShellPoll());                             // Last row, and the prompt
+    drain();
+    CHECK(!ShellPoll());
+    usart.tx[usart.tx_count] = '\0';
+    CHECK(strstr((char *)usart.tx, "0118: ") != NULL);
+    CHECK(!strcmp((char *)usart.tx + usart.tx_count - 2, "> "));
+}
+
+static void test_numbers(void) {
+    uint32_t v;
+    CHECK(ShellParseUint("4294967295", &v));
+    CHECK_EQ(v, 4294967295UL);
+    CHECK(ShellParseUint("0xFFffFFff", &v));
+    CHECK_EQ(v, 0xFFFFFFFFUL);
+    CHECK(!ShellParseUint("4294967296", &v));
+    CHECK(!ShellParseUint("0x", &v));
+    CHECK(!ShellParseUint("", &v));
+    CHECK(!ShellParseUint("12a", &v));
+}
+
+int main(void) {
+    RUN(test_line);
+    RUN(test_peek_poke);
+    RUN(test_params);
+    RUN(test_fixed_clock);
+    RUN(test_steps);
+    RUN(test_numbers);
+    return TEST_REPORT();
+}
@@ -0,0 +1,154 @@
+// SPSC queue (spsc.h): edge cases, then a producer and a consumer thread hammering it
+#include <pthread.h>
+#include <sched.h>
+#include "spsc.h"
+#include "test.h"
+
+#define STRESS_ITEMS    2000000UL
+
+// Item larger than a register, so a half-copied one would show
+typedef struct {
+    uint32_t seq;
+    uint32_t check;
+} Item_t;
+
+SPSC_QUEUE(ByteQueue, uint8_t, 4)
+SPSC_QUEUE(BigQueue, uint8_t, 128)
+SPSC_QUEUE(ItemQueue, Item_t, 8)
+
+static void test_single(void) {
+    ByteQueue_t q = { 0 };
+    uint8_t value = 0;
+
+    CHECK_EQ(ByteQueueCount(&q), 0);
+    CHECK_EQ(ByteQueueSpace(&q), 4);
+    CHECK(!ByteQueuePop(&q, &value));
+    CHECK(!ByteQueuePeek(&q, &value));
+
+    for (uint8_t i = 1; i <= 4; i++) CHECK(ByteQueuePush(&q, i));
+    CHECK(!ByteQueuePush(&q, 5));
+    CHECK_EQ(ByteQueueCount(&q), 4);
+    CHECK_EQ(ByteQueueSpace(&q), 0);
+
+    CHECK(ByteQueuePeek(&q, &value));
+    CHECK_EQ(value, 1);
+    CHECK_EQ(ByteQueueCount(&q), 4);
+    for (uint8_t i = 1; i <= 4; i++) {
+        CHECK(ByteQueuePop(&q, &value));
+        CHECK_EQ(value, i);
+    }
+    CHECK(!ByteQueuePop(&q, &value));
+
+    // The indices run past 255 and wrap with the fill level intact
+    for (uint16_t i = 0; i < 600; i++) {
+        CHECK(ByteQueuePush(&q, (uint8_t)i));
+        CHECK(ByteQueuePush(&q, (uint8_t)(i + 1)));
+        CHECK(ByteQueuePop(&q, &value));
+        CHECK_EQ(value, (uint8_t)i);
+        CHECK(ByteQueuePop(&q, &value));
+        CHECK_EQ(value, (uint8_t)(i + 1));
+    }
+    CHECK_EQ(ByteQueueCount(&q), 0);
+}
+
+static void test_batch(void) {
+    BigQueue_t q = { 0 };
+    uint8_t in[200], out[200];
+    for (uint8_t i = 0; i < sizeof(in); i++) in[i] = i;
+
+    // Only what fits goes in
+    CHECK_EQ(BigQueuePushN(&q, in, 100), 100);
+    CHECK_EQ(BigQueuePushN(&q, in + 100, 100), 28);
+    CHECK_EQ(BigQueueCount(&q), 128);
+    CHECK_EQ(BigQueueSpace(&q), 0);
+    CHECK_EQ(BigQueuePushN(&q, in, 1), 0);
+
+    CHECK_EQ(BigQueuePopN(&q, out, 50), 50);
+    CHECK_EQ(out[0], 0);
+    CHECK_EQ(out[49], 49);
+
+    // A batch across the end of the array
+    CHECK_EQ(BigQueuePushN(&q, in + 128, 50), 50);
+    CHECK_EQ(BigQueuePopN(&q, out, 200), 128);
+    for (uint8_t i = 0; i < 128; i++) CHECK_EQ(out[i], 50 + i);
+    CHECK_EQ(BigQueuePopN(&q, out, 10), 0);
+}
+
+// Stress: the producer pushes a numbered sequence in batches of 1-8, the consumer takes
+// it in batches of 1-8, single pops and peeks; every item must arrive once, in order
+static ItemQueue_t stress_queue;
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1103515245UL + 12345UL;
+    return *state >> 16;
+}
+
+static Item_t make_item(uint32_t seq) {
+    Item_t item = { seq, ~seq * 2654435761UL };
+    return item;
+}
+
+static void *producer(void *arg) {
+    uint32_t state = 1;
+    uint32_t seq = 0;
+    (void)arg;
+    while (seq < STRESS_ITEMS) {
+        Item_t batch[8];
+        uint8_t n = 1 + next_random(&state) % 8;
+        for (uint8_t i = 0; i < n; i++) batch[i] = make_item(seq + i);
+        uint8_t pushed = (n == 1) ? ItemQueuePush(&stress_queue, batch[0])
+                                  : ItemQueuePushN(&stress_queue, batch, n);
+        seq += pushed;
+        if (!pushed) sched_yield();
+    }
+    return NULL;
+}
+
+static void test_stress(void) {
+    pthread_t thread;
+    uint32_t state = 7;
+    uint32_t expected = 0;
+    uint32_t torn = 0, out_of_order = 0, peek_errors = 0;
+
+    CHECK_EQ(pthread_create(&thread, NULL, producer, NULL), 0);
+    while (expected < STRESS_ITEMS) {
+        Item_t batch[8];
+        uint8_t n;
+        switch (next_random(&state) % 3) {
+        case 0:
+            n = ItemQueuePopN(&stress_queue, batch, 1 + next_random(&state) % 8);
+            break;
+        case 1:
+            n = ItemQueuePop(&stress_queue, &batch[0]);
+            break;
+        default: {
+            Item_t peeked;
+            n = 0;
+            if (ItemQueuePeek(&stress_queue, &peeked)) {
+                n = ItemQueuePop(&stress_queue, &batch[0]);
+                if (!n || peeked.seq != batch[0].seq) peek_errors++;
+            }
+        }
+        }
+        for (uint8_t i = 0; i < n; i++) {
+            if (batch[i].check != make_item(batch[i].seq).check) torn++;
+            if (batch[i].seq != expected) out_of_order++;
+            expected = batch[i].seq + 1;
+        }
+        if (!n) sched_yield();
+    }
+    pthread_join(thread, NULL);
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(out_of_order, 0);
+    CHECK_EQ(peek_errors, 0);
+    CHECK_EQ(expected, STRESS_ITEMS);
+    CHECK_EQ(ItemQueueCount(&stress_queue), 0);
+}
+
+int main(void) {
+    RUN(test_single);
+    RUN(test_batch);
+    RUN(test_stress);
+    return TEST_REPORT();
+}
@@ -0,0 +1,70 @@
+// Stack monitor (stackmon.c) on the simulated SRAM
+#include <avr/io.h>
+#include "stackmon.h"
+#include "test.h"
+
+// Push bytes the way the CPU does: store at SP, then decrement it
+static void push(uint16_t count) {
+    while (count--) {
+        HalSet(SP, 0x00);
+        SP = SP - 1;
+    }
+}
+
+static void pop(uint16_t count) {
+    SP = SP + count;
+}
+
+static void test_paint(void) {
+    hal_heap_end = 0x0300;              // 512 bytes of .data/.bss
+    SP = RAMEND - 20;                   // main() already has a frame
+    StackMonInit();
+
+    CHECK_EQ(HalGet(0x02FF), 0x00);     // .bss untouched
+    CHECK_EQ(HalGet(0x0300), STACK_CANARY);
+    CHECK_EQ(HalGet(RAMEND - 20), STACK_CANARY);
+    CHECK_EQ(HalGet(RAMEND - 19), 0x00);
+    CHECK_EQ(StackHighWater(), 20);
+    CHECK_EQ(StackUnused(), RAMEND - 20 + 1 - 0x0300);
+    CHECK_EQ(StackFree(), StackUnused());
+}
+
+static void test_high_water(void) {
+    hal_heap_end = 0x0300;
+    SP = RAMEND;
+    StackMonInit();
+    CHECK_EQ(StackHighWater(), 0);
+
+    // A deep call that returned leaves its mark
+    push(100);
+    CHECK_EQ(StackHighWater(), 100);
+    pop(100);
+    push(30);
+    CHECK_EQ(StackHighWater(), 100);
+    CHECK_EQ(StackFree(), RAMEND + 1 - 30 - 0x0300);
+    CHECK_EQ(StackUnused(), RAMEND + 1 - 100 - 0x0300);
+
+    // Heap growth counts against the gap, not the stack
+    hal_heap_end = 0x0400;
+    CHECK_EQ(StackUnused(), RAMEND + 1 - 100 - 0x0400);
+    CHECK_EQ(StackHighWater(), 100);
+}
+
+static void test_collision(void) {
+    hal_heap_end = 0x1000;
+    SP = RAMEND;
+    StackMonInit();
+
+    // The stack runs through the whole gap into .bss
+    push(RAMEND + 1 - 0x1000 + 8);
+    CHECK_EQ(StackUnused(), 0);
+    CHECK_EQ(StackFree(), 0);
+    CHECK_EQ(StackHighWater(), RAMEND + 1 - 0x1000);
+}
+
+int main(void) {
+    RUN(test_paint);
+    RUN(test_high_water);
+    RUN(test_collision);
+    return TEST_REPORT();
+}
@@ -0,0 +1,140 @@
+// Start-up sequencer (startup.c) with the LCD drivers and the LED blink as concurrent tasks
+#include <avr/io.h>
+#include "startup.h"
+#include "lcd.h"
+#include "i2c_lcd.h"
+#include "leds.h"
+#include "timer3.h"
+#include "twi_bus.h"
+#include "pcf8574.h"
+#include "test.h"
+
+static Hd44780_t lcd, i2c_lcd;
+static TwiBus_t bus;
+static Pcf8574_t pcf;
+static Timer3_t timer3;
+
+static void attach(void) {
+    Hd44780Init(&lcd);
+    Hd44780AttachParallel(&lcd, HAL_ADDR(PORTB), PB5, PB6, PB7, HAL_ADDR(PORTA));
+    TwiBusAttach(&bus);
+    Pcf8574Init(&pcf, &bus, 0x27);
+    Hd44780Init(&i2c_lcd);
+    Pcf8574AttachLcd(&pcf, &i2c_lcd);
+    Timer3Attach(&timer3);
+}
+
+// Virtual time of the first character on the parallel LCD
+static uint64_t first_output_us(void) {
+    for (uint16_t i = 0; i < lcd.byte_count; i++) {
+        if (lcd.bytes[i].rs) return lcd.bytes[i].cycles / (F_CPU / 1000000UL);
+    }
+    return UINT64_MAX;
+}
+
+// The LCD task shows something as soon as the display is ready
+static uint32_t lcd_task(uint8_t step) {
+    uint32_t wait = LcdStartStep(step);
+    if (wait == STARTUP_DONE) LcdPrint("Ready");
+    return wait;
+}
+
+static uint32_t i2c_lcd_task(uint8_t step) {
+    uint32_t wait = I2C_LcdStartStep(step);
+    if (wait == STARTUP_DONE) I2C_LcdPrint("Ready");
+    return wait;
+}
+
+// A sensor-style task that polls a ready flag a few times
+static uint8_t polls;
+
+static uint32_t poll_task(uint8_t step) {
+    if (step == 0) return 1000;
+    if (++polls < 4) return STARTUP_REPEAT | 500;
+    return STARTUP_DONE;
+}
+
+static void test_sequential(void) {
+    char row[17];
+    attach();
+    LedsInit();
+    LcdInit(LCD_MODE_8BIT);
+    LcdStart(2, 16);
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+    LcdPrint("Ready");
+    I2C_LcdPrint("Ready");
+    HalSync();
+
+    // Blink, then 65 ms for each LCD, one after the other
+    CHECK(first_output_us() > 500000);
+    CHECK(HalMicros() > 630000);
+    CHECK_EQ(lcd.busy_violations, 0);
+    CHECK_EQ(i2c_lcd.busy_violations, 0);
+    Hd44780Row(&i2c_lcd, 0, row, 16);
+    CHECK_STR(row, "Ready           ");
+}
+
+static void test_concurrent(void) {
+    char row[17];
+    StartupTask_t tasks[] = {
+        STARTUP_TASK(lcd_task),
+        STARTUP_TASK(i2c_lcd_task),
+        STARTUP_TASK(LedsFlashStep),
+        STARTUP_TASK(poll_task),
+    };
+    attach();
+    polls = 0;
+    LcdBegin(LCD_MODE_8BIT, 2, 16);
+    I2C_LcdBegin(0x27, 2, 16);
+    uint32_t total = StartupRun(tasks, sizeof(tasks) / sizeof(tasks[0]));
+    HalSync();
+
+    // The LCDs are up after their own 40 ms power-up and init, while the LEDs still blink
+    CHECK(first_output_us() >= 45000);
+    CHECK(first_output_us() < 50000);
+    CHECK(tasks[0].done_us < 50000);
+    CHECK(tasks[1].done_us < 55000);
+    CHECK(tasks[2].done_us >= 500000);
+    CHECK(tasks[3].done_us >= 2500);
+    CHECK(tasks[3].done_us < 5000);
+    CHECK_EQ(polls, 4);
+    CHECK(total >= tasks[2].done_us);
+    CHECK(total < 510000);
+    CHECK(HalMicros() >= total);
+
+    // Same sequence as the blocking init, with the waits kept
+    static const uint8_t expected[] = { 0x30, 0x30, 0x30, 0x38, 0x0C, 0x06, 0x01 };
+    CHECK_EQ(lcd.byte_count, sizeof(expected) + 5);
+    for (uint8_t i = 0; i < sizeof(expected); i++) CHECK_EQ(lcd.bytes[i].value, expected[i]);
+    CHECK(lcd.bytes[1].cycles - lcd.bytes[0].cycles >= 5000 * (F_CPU / 1000000UL));
+    CHECK_EQ(lcd.busy_violations, 0);
+    CHECK_EQ(i2c_lcd.busy_violations, 0);
+    CHECK_EQ(I2C_LcdGetStatus(), TWI_OK);
+    CHECK(i2c_lcd.display_on);
+    Hd44780Row(&lcd, 0, row, 16);
+    CHECK_STR(row, "Ready           ");
+    Hd44780Row(&i2c_lcd, 0, row, 16);
+    CHECK_STR(row, "Ready           ");
+}
+
+static void test_blocking_task(void) {
+    attach();
+    polls = 0;
+    uint64_t start = HalMicros();
+    StartupRunTask(poll_task);
+    CHECK_EQ(polls, 4);
+    CHECK(HalMicros() - start >= 2500);
+
+    start = HalMicros();
+    StartupDelay(1234);
+    CHECK(HalMicros() - start >= 1230);
+    CHECK(HalMicros() - start < 1240);
+}
+
+int main(void) {
+    RUN(test_sequential);
+    RUN(test_concurrent);
+    RUN(test_blocking_task);
+    return TEST_REPORT();
+}
@@ -0,0 +1,192 @@
+// Stepper (stepper.c): the step interrupt through queued moves, the interval profile
+// against the exact ramp, coil sequences, StepperStop() and the cost of the interrupt
+#include <avr/io.h>
+#include "stepper.h"
+#include "timebase.h"
+#include "timer3.h"
+#include "test.h"
+
+void TIMER3_COMPA_vect(void);
+
+#define MAX_STEPS   2400
+#define ACCEL       1000        // steps/s^2: 500 steps up to 1000 steps/s
+#define SPEED       1000
+#define P0          (TIMEBASE_HZ * 0.0447213595)    // f * sqrt(2 / ACCEL)
+
+static Timer3_t timer3;
+static uint16_t intervals[MAX_STEPS];   // Ticks from each step to the next (none after the last)
+static uint8_t coils[MAX_STEPS];        // PB0-PB3 after each step
+static uint16_t steps;
+
+// Advance to each compare match and run the interrupt, until it switches itself off or
+// `stop_after` steps were made
+static void run(uint16_t stop_after) {
+    steps = 0;
+    while ((ETIMSK & (1 << OCIE3A)) && steps < stop_after && steps < MAX_STEPS) {
+        uint16_t due = OCR3A;
+        HalAdvance((uint64_t)(uint16_t)(due - TCNT3) * TIMEBASE_PRESCALER);
+        TIMER3_COMPA_vect();
+        intervals[steps] = OCR3A - due;
+        coils[steps] = PORTB & STEPPER_MASK;
+        steps++;
+    }
+}
+
+static void attach(StepperMode_t mode) {
+    Timer3Attach(&timer3);
+    StepperInit(mode);
+}
+
+// Square root by Newton's method, the host tests don't link libm
+static double root(double x) {
+    double r = x > 1 ? x : 1;
+    for (uint8_t i = 0; i < 40; i++) r = (r + x / r) / 2;
+    return r;
+}
+
+// Interval k of a start from rest with the exact profile t = sqrt(2 n / a)
+static double exact(uint16_t k) {
+    return P0 * (root(k + 1.0) - root(k));
+}
+
+static bool near(double actual, double expected, double tolerance) {
+    double error = actual - expected;
+    return (error < 0 ? -error : error) <= expected * tolerance;
+}
+
+// Table start, q-series acceleration, cruise at the requested speed, mirrored braking
+static void test_trapezoid(void) {
+    attach(STEPPER_HALF_STEP);
+    CHECK(StepperMove(2000, SPEED, ACCEL));
+    run(MAX_STEPS);
+    CHECK_EQ(steps, 2000);
+    CHECK_EQ(StepperPosition(), 2000);
+    CHECK(!StepperIsBusy());
+    CHECK_EQ(StepperOverruns(), 0);
+
+    bool table = true, series = true;
+    for (uint16_t k = 0; k < 16; k++) table &= near(intervals[k], exact(k), 0.002);
+    uint16_t cruise = 16;
+    while (cruise < steps && intervals[cruise] > TIMEBASE_HZ / SPEED) {
+        series &= near(intervals[cruise], exact(cruise), 0.01);
+        cruise++;
+    }
+    CHECK(table);
+    CHECK(series);
+    CHECK(cruise >= 495 && cruise <= 505);          // v^2 / 2a = 500 steps
+
+    // Cruise: the exact interval; braking: the ramp up backwards
+    uint16_t flat = 0;
+    bool mirror = true;
+    while (intervals[cruise + flat] == TIMEBASE_HZ / SPEED) flat++;
+    CHECK(flat >= 990 && flat <= 1010);
+    // (braking starts from the clamped cruise interval, a little slow: 1.3 % at the table)
+    for (uint16_t k = 0; k < cruise; k++) mirror &= near(intervals[steps - 2 - k], intervals[k], 0.015);
+    CHECK(mirror);
+}
+
+// Too short to reach the speed: up to the middle, then down the same way
+static void test_triangle(void) {
+    attach(STEPPER_HALF_STEP);
+    CHECK(StepperMove(-200, SPEED, ACCEL));
+    run(MAX_STEPS);
+    CHECK_EQ(steps, 200);
+    CHECK_EQ(StepperPosition(), -200);
+
+    uint16_t fastest = 0;
+    for (uint16_t i = 1; i < steps - 1; i++) {
+        if (intervals[i] < intervals[fastest]) fastest = i;
+    }
+    CHECK(intervals[fastest] > TIMEBASE_HZ / SPEED);
+    CHECK(fastest >= 97 && fastest <= 101);
+    bool mirror = true;
+    for (uint16_t k = 0; k < 99; k++) mirror &= near(intervals[198 - k], intervals[k], 0.005);
+    CHECK(mirror);
+}
+
+// Moves back to back, and a stop that brakes over the ramp length and drops the queue
+static void test_queue_stop(void) {
+    attach(STEPPER_HALF_STEP);
+    CHECK(StepperMove(100, SPEED, ACCEL));
+    CHECK(StepperMove(-50, SPEED, ACCEL));
+    CHECK_EQ(StepperQueueFree(), STEPPER_QUEUE_SIZE - 2);
+    run(MAX_STEPS);
+    CHECK_EQ(steps, 150);
+    CHECK_EQ(StepperPosition(), 50);
+    CHECK(near(intervals[99], P0, 0.01));           // The second move starts from rest
+
+    CHECK(StepperMove(5000, SPEED, ACCEL));
+    CHECK(StepperMove(1000, SPEED, ACCEL));
+    run(800);                                       // In the cruise
+    StepperStop();
+    uint16_t before = steps;
+    run(MAX_STEPS);
+    CHECK(steps >= 499 && steps <= 503);            // As long as the ramp up
+    CHECK_EQ(StepperPosition(), 50 + before + steps);
+    bool slowing = true;
+    for (uint16_t i = 1; i + 1 < steps; i++) slowing &= intervals[i] >= intervals[i - 1];
+    CHECK(slowing);
+    CHECK(!StepperIsBusy());
+    CHECK_EQ(StepperQueueFree(), STEPPER_QUEUE_SIZE - 1);
+}
+
+// Half steps A, AB, B ... and back; full steps two coils at a time
+static void test_coils(void) {
+    static const uint8_t half[8] = { 0x03, 0x02, 0x06, 0x04, 0x0C, 0x08, 0x09, 0x01 };
+    static const uint8_t full[4] = { 0x03, 0x06, 0x0C, 0x09 };
+
+    attach(STEPPER_HALF_STEP);
+    CHECK_EQ(DDRB & STEPPER_MASK, STEPPER_MASK);
+    StepperMove(8, SPEED, ACCEL);
+    run(MAX_STEPS);
+    CHECK(!memcmp(coils, half, 8));
+    StepperMove(-7, SPEED, ACCEL);
+    run(MAX_STEPS);
+    for (uint8_t i = 0; i < 7; i++) CHECK_EQ(coils[i], half[6 - i]);
+    StepperRelease();
+    CHECK_EQ(PORTB & STEPPER_MASK, 0);
+
+    attach(STEPPER_FULL_STEP);
+    StepperMove(8, SPEED, ACCEL);
+    run(MAX_STEPS);
+    for (uint8_t i = 0; i < 8; i++) CHECK_EQ(coils[i], full[i & 3]);
+}
+
+// Cost of the interrupt per path. The host counts its register accesses (one HAL cycle
+// each) but not the arithmetic, so the AVR cycles are the estimates counted from the code
+// in stepper.h; with them, the step rate the interrupt alone could sustain.
+static void test_cost(void) {
+    static const char *const paths[3] = { "cruise", "ramp table", "q-series" };
+    static const uint16_t estimate[3] = { 220, 260, 600 };
+    uint32_t accesses[3] = { 0 }, count[3] = { 0 };
+
+    attach(STEPPER_HALF_STEP);
+    StepperMove(2000, SPEED, ACCEL);
+    for (uint16_t i = 0; ETIMSK & (1 << OCIE3A); i++) {
+        uint16_t due = OCR3A;
+        HalAdvance((uint64_t)(uint16_t)(due - TCNT3) * TIMEBASE_PRESCALER);
+        uint64_t cycles = HalCycles();
+        TIMER3_COMPA_vect();
+        uint8_t path = (OCR3A - due == TIMEBASE_HZ / SPEED) ? 0 : (i < 16 || i >= 1984) ? 1 : 2;
+        accesses[path] += HalCycles() - cycles;
+        count[path]++;
+    }
+    for (uint8_t p = 0; p < 3; p++) {
+        CHECK(count[p] >= 30);
+        printf("  step interrupt, %-10s %4.1f register accesses, ~%u AVR cycles (estimate),"
+               " %5lu steps/s\n", paths[p], (double)accesses[p] / count[p], estimate[p],
+               F_CPU / estimate[p]);
+    }
+    // The slowest path leaves room for the rest of the program at the fastest interval
+    CHECK((uint32_t)estimate[2] < STEPPER_MIN_INTERVAL * TIMEBASE_PRESCALER);
+    CHECK(StepperMaxIsrTicks() < STEPPER_MIN_INTERVAL);
+}
+
+int main(void) {
+    RUN(test_trapezoid);
+    RUN(test_triangle);
+    RUN(test_queue_stop);
+    RUN(test_coils);
+    RUN(test_cost);
+    return TEST_REPORT();
+}
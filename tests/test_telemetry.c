@@ -0,0 +1,242 @@
+// Telemetry (telemetry.c, uart.c) decoded by the host tool (tools/telemdump.c)
+#include <stdlib.h>
+#include <avr/io.h>
+#define TELEMDUMP_NO_MAIN
+#include "../tools/telemdump.c"
+#include "telemetry.h"
+#include "uart.h"
+#include "clock.h"
+#include "usart.h"
+#include "timer3.h"
+#include "test.h"
+
+void USART0_UDRE_vect(void);
+void USART0_RX_vect(void);
+
+static Usart_t usart;
+static Timer3_t timer3;
+static TdDecoder_t dec;
+static char *csv, *text;
+static size_t csv_size, text_size;
+static FILE *csv_file, *text_file;
+static uint32_t wire_skip;              // Bytes the decoder misses, as if started late
+
+static void wire(uint16_t addr, uint8_t old_value, uint8_t value, void *ctx) {
+    (void)addr;
+    (void)old_value;
+    (void)ctx;
+    if (wire_skip) wire_skip--;
+    else td_byte(&dec, value);
+}
+
+static void attach(void) {
+    UsartAttach(&usart);
+    HalOnWrite(HAL_ADDR(UDR0), wire, NULL);
+    wire_skip = 0;
+    csv_file = open_memstream(&csv, &csv_size);
+    text_file = open_memstream(&text, &text_size);
+    td_init(&dec, csv_file, text_file, 1);
+}
+
+static void detach(void) {
+    fclose(csv_file);
+    fclose(text_file);
+    free(csv);
+    free(text);
+}
+
+// Run the transmit interrupt until it switches itself off
+static void drain(void) {
+    while (UCSR0B & (1 << UDRIE0)) USART0_UDRE_vect();
+}
+
+static void test_records(void) {
+    attach();
+    CHECK_EQ(TelemInit(0), UART_OK);
+    CHECK_EQ(UBRR0L, 3);                            // 250000 baud at 8 MHz, exact
+    CHECK_EQ(UCSR0A & (1 << U2X0), 1 << U2X0);
+
+    uint16_t *u = TelemReserve(3, TELEM_U16, 3 * sizeof(uint16_t));
+    u[0] = 1;
+    u[1] = 0;
+    u[2] = 65535;
+    TelemCommit();
+    int8_t i8 = -5;
+    float f = 1.5f;
+    CHECK(TelemSend(4, TELEM_I8, &i8, 1));
+    CHECK(TelemSend(5, TELEM_F32, &f, sizeof(f)));
+    CHECK(TelemSend(6, TELEM_TEXT, "a\"b", 3));
+    CHECK(TelemSend(7, TELEM_BYTES, "\x00\xff", 2));
+    CHECK(TelemSend(8, TELEM_U32, &i8, 0));
+    CHECK(!TelemReserve(9, TELEM_U8, TELEM_MAX_PAYLOAD + 1));
+    drain();
+
+    fflush(csv_file);
+    CHECK_STR(csv, "0,3,u16,1,0,65535\n"
+                   "0,4,i8,-5\n"
+                   "0,5,f32,1.5\n"
+                   "0,6,text,\"a\"\"b\"\n"
+                   "0,7,bytes,00ff\n"
+                   "0,8,u32\n");
+    CHECK_EQ(dec.stats.frames, 6);
+    CHECK_EQ(dec.stats.bad, 0);
+    CHECK_EQ(dec.stats.skipped, 0);                 // A 0x00 goes ahead of the first frame
+
+    TelemStats_t stats;
+    TelemGetStats(&stats);
+    CHECK_EQ(stats.records, 6);
+    CHECK_EQ(stats.dropped, 0);
+    CHECK_EQ(stats.bytes + 1, usart.tx_count);
+    CHECK_EQ(stats.bytes, 6 * TELEM_OVERHEAD + 6 + 1 + 4 + 3 + 2);
+    CHECK_EQ(UartStreamUsed(), 0);
+    detach();
+}
+
+// Records of any length, sent while the interrupt drains a few bytes at a time, wrap
+// around the ring in order; a full ring drops records instead of waiting
+static void test_ring(void) {
+    attach();
+    TelemInit(0);
+    uint8_t payload[TELEM_MAX_PAYLOAD];
+    memset(payload, 0x5A, sizeof(payload));
+
+    uint32_t sent = 0, dropped = 0;
+    srand(7);
+    for (int i = 0; i < 2000; i++) {
+        uint8_t length = 4 + rand() % (TELEM_MAX_PAYLOAD - 3);
+        memcpy(payload, &sent, 4);
+        if (TelemSend(1, TELEM_U32, payload, length & ~3)) sent++;
+        else dropped++;
+        for (int k = rand() % 48; k && (UCSR0B & (1 << UDRIE0)); k--) USART0_UDRE_vect();
+    }
+    drain();
+    CHECK(dropped > 0);
+
+    TelemStats_t stats;
+    TelemGetStats(&stats);
+    CHECK_EQ(stats.records, sent);
+    CHECK_EQ(stats.dropped, dropped);
+    CHECK(stats.max_used > UART_STREAM_SIZE - TELEM_MAX_PAYLOAD - TELEM_OVERHEAD - 1);
+    CHECK(stats.max_used < UART_STREAM_SIZE);
+    CHECK_EQ(dec.stats.frames, sent);
+    CHECK_EQ(dec.stats.bad, 0);
+
+    // First value of every record is its sequence number
+    fflush(csv_file);
+    uint32_t expect = 0;
+    bool in_order = true;
+    for (char *line = csv; line && *line; line = strchr(line, '\n') + 1) {
+        unsigned seq;
+        if (sscanf(line, "%*[^,],1,u32,%u", &seq) != 1 || seq != expect++) in_order = false;
+    }
+    CHECK(in_order);
+    CHECK_EQ(expect, sent);
+    detach();
+}
+
+// Text between frames: never inside one, followed by a 0x00; a decoder that starts in the
+// middle of a frame skips to the next one
+static void test_text(void) {
+    attach();
+    TelemInit(0);
+    wire_skip = 3;
+    uint16_t v = 1000;
+    TelemSend(1, TELEM_U16, &v, 2);                 // Lost: the decoder joins in it
+    USART0_UDRE_vect();
+    TelemSend(2, TELEM_U16, &v, 2);
+    for (uint8_t i = 0; i < 4; i++) USART0_UDRE_vect();
+    UartPuts("hello\r\n");
+    TelemSend(3, TELEM_U16, &v, 2);
+    drain();
+
+    // Long text through a full queue: UartPutc() sends from it itself
+    for (uint8_t i = 0; i < 20; i++) UartPuts("0123456789");
+    TelemSend(4, TELEM_U16, &v, 2);
+    drain();
+
+    fflush(csv_file);
+    fflush(text_file);
+    CHECK_STR(csv, "0,2,u16,1000\n0,3,u16,1000\n0,4,u16,1000\n");
+    CHECK_EQ(dec.stats.skipped, 7);                 // The rest of the first frame
+    CHECK_EQ(dec.stats.text, 2);
+    CHECK_EQ(dec.stats.bad, 0);
+    CHECK_EQ(text_size, 7 + 200);
+    CHECK(!strncmp(text, "hello\r\n0123456789", 17));
+
+    // After a restart the prompt goes out before any packet: its 0x00 comes ahead of the
+    // first one, which isn't glued to the text
+    TelemInit(0);
+    UartPuts("\r\n> ");
+    drain();
+    TelemSend(5, TELEM_U16, &v, 2);
+    TelemSend(6, TELEM_U16, &v, 2);
+    drain();
+    fflush(csv_file);
+    CHECK_STR(csv, "0,2,u16,1000\n0,3,u16,1000\n0,4,u16,1000\n0,5,u16,1000\n0,6,u16,1000\n");
+    CHECK_EQ(dec.stats.bad, 0);
+    CHECK_EQ(dec.stats.text, 3);
+    detach();
+}
+
+// Timestamps in microseconds, unwrapped past the 65.5 ms of the counter
+static void test_timestamps(void) {
+    attach();
+    Timer3Attach(&timer3);
+    TelemInit(0);
+    for (uint8_t i = 0; i < 4; i++) {
+        TelemSend(1, TELEM_U8, &i, 1);
+        drain();
+        HalAdvance(40000ULL * (F_CPU / 1000000UL));
+    }
+
+    fflush(csv_file);
+    unsigned long long t[4];
+    char *line = csv;
+    for (uint8_t i = 0; i < 4; i++) {
+        CHECK_EQ(sscanf(line, "%llu,", &t[i]), 1);
+        line = strchr(line, '\n') + 1;
+    }
+    for (uint8_t i = 1; i < 4; i++) {
+        CHECK(t[i] - t[i - 1] >= 40000);
+        CHECK(t[i] - t[i - 1] < 40000 + 200);       // The register accesses in between
+    }
+    detach();
+}
+
+// The rate follows the system clock; input is queued
+static void test_uart(void) {
+    UsartAttach(&usart);
+    CHECK_EQ(UartInit(38400), UART_OK);
+    CHECK_EQ(UBRR0H << 8 | UBRR0L, 25);
+    CHECK_EQ(UartInit(0), UART_OK);
+
+    CHECK_EQ(ClockSetDivider(4), CLOCK_OK);         // 2 MHz: UBRR 0 gives 250000 exactly
+    CHECK_EQ(UBRR0L, 0);
+    CHECK_EQ(UartGetStatus(), UART_OK);
+    CHECK_EQ(ClockSetDivider(8), CLOCK_OK);         // 1 MHz: 125000 at best
+    CHECK_EQ(UartGetStatus(), UART_BAD_BAUD);
+    CHECK_EQ(ClockSetDivider(1), CLOCK_OK);
+    CHECK_EQ(UBRR0L, 3);
+    CHECK_EQ(UartGetStatus(), UART_OK);
+    CHECK(UCSR0B & (1 << UDRIE0));                  // Sending goes on after the switch
+
+    uint8_t c;
+    CHECK(!UartGetc(&c));
+    UsartFeed(&usart, "0123456789012345678901234567890123456789", 40);
+    for (uint8_t i = 0; i < 40; i++) USART0_RX_vect();
+    CHECK_EQ(UartOverruns(), 8);
+    CHECK(UartGetc(&c));
+    CHECK_EQ(c, '0');
+    uint8_t count = 1;
+    while (UartGetc(&c)) count++;
+    CHECK_EQ(count, 32);
+}
+
+int main(void) {
+    RUN(test_records);
+    RUN(test_ring);
+    RUN(test_text);
+    RUN(test_timestamps);
+    RUN(test_uart);
+    return TEST_REPORT();
+}
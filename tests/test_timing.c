@@ -0,0 +1,92 @@
+// Bus traces for tools/vcdcheck: make host-test checks every <test>-*.vcd written here,
+// and expects the ones ending in -bad.vcd to fail
+#include <stdio.h>
+#include <avr/io.h>
+#include "lcd.h"
+#include "i2c_lcd.h"
+#include "hd44780.h"
+#include "twi_bus.h"
+#include "pcf8574.h"
+#include "timer3.h"
+#include "vcd.h"
+#include "test.h"
+
+static const char *trace_base;
+static Hd44780_t lcd;
+static TwiBus_t bus;
+static Pcf8574_t pcf;
+static Timer3_t timer3;
+
+static bool trace_open(const char *suffix) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s-%s.vcd", trace_base, suffix);
+    return VcdOpen(path);
+}
+
+static void trace_parallel(void) {
+    VcdTrace("RS", HAL_ADDR(PORTB), 1 << PB5);
+    VcdTrace("RW", HAL_ADDR(PORTB), 1 << PB6);
+    VcdTrace("EN", HAL_ADDR(PORTB), 1 << PB7);
+    VcdTrace("DATA", HAL_ADDR(PORTA), 0xFF);
+    Hd44780Init(&lcd);
+    Hd44780AttachParallel(&lcd, HAL_ADDR(PORTB), PB5, PB6, PB7, HAL_ADDR(PORTA));
+    Timer3Attach(&timer3);
+}
+
+static void test_lcd_trace(void) {
+    CHECK(trace_open("lcd"));
+    trace_parallel();
+    LcdInit(LCD_MODE_4BIT);
+    LcdStart(2, 16);
+    LcdPrint("Hello, BK-AVR128");
+    LcdSetCursor(1, 0);
+    for (int32_t i = 0; i < 20; i++) LcdPrintInt(i);
+    LcdClear();
+    LcdPrint("done");
+    VcdClose();
+    CHECK_EQ(lcd.busy_violations, 0);
+}
+
+static void test_i2c_lcd_trace(void) {
+    CHECK(trace_open("i2c"));
+    VcdTrace("TWBR", HAL_ADDR(TWBR), 0xFF);
+    VcdTrace("TWPS", HAL_ADDR(TWSR), 0x03);
+    VcdTrace("TWCR", HAL_ADDR(TWCR), 0xFF);
+    VcdTrace("TWDR", HAL_ADDR(TWDR), 0xFF);
+    TwiBusAttach(&bus);
+    Pcf8574Init(&pcf, &bus, 0x27);
+    Hd44780Init(&lcd);
+    Pcf8574AttachLcd(&pcf, &lcd);
+    Timer3Attach(&timer3);
+    I2C_LcdInit(0x27);
+    I2C_LcdStart(2, 16);
+    I2C_LcdPrint("Hello over TWI");
+    VcdClose();
+    CHECK_EQ(lcd.busy_violations, 0);
+}
+
+// Raw port writes without the driver's delays: vcdcheck must reject this trace
+static void test_bad_trace(void) {
+    CHECK(trace_open("bad"));
+    trace_parallel();
+    DDRA = 0xFF;
+    DDRB = 0xE0;
+    for (uint8_t i = 0; i < 4; i++) {
+        PORTB = (1 << PB5);
+        PORTA = 'a' + i;
+        PORTB = (1 << PB5) | (1 << PB7);    // EN high for one cycle only
+        PORTB = (1 << PB5);
+    }
+    HalSync();
+    VcdClose();
+    CHECK(lcd.busy_violations > 0);
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    trace_base = argv[0];
+    RUN(test_lcd_trace);
+    RUN(test_i2c_lcd_trace);
+    RUN(test_bad_trace);
+    return TEST_REPORT();
+}
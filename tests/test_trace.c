@@ -0,0 +1,146 @@
+// Event trace (trace.c): ring, trigger, dump, and its conversion (tools/tracecvt.c)
+#include <stdlib.h>
+#include <avr/io.h>
+#define TRACECVT_NO_MAIN
+#include "../tools/tracecvt.c"
+#define TRACE_ENABLE
+#include "trace.h"
+#include "uart.h"
+#include "usart.h"
+#include "timer3.h"
+#include "test.h"
+
+void USART0_UDRE_vect(void);
+
+static Usart_t usart;
+static Timer3_t timer3;
+
+static void attach(void) {
+    UsartAttach(&usart);
+    Timer3Attach(&timer3);
+    UartInit(0);
+    TraceInit();
+}
+
+static void wait_us(uint32_t us) {
+    HalAdvance(us * (F_CPU / 1000000UL));
+}
+
+// Dump over the USART model and read it back with the tool
+static bool dump(TcTrace_t *t) {
+    TraceDump();
+    while (UCSR0B & (1 << UDRIE0)) USART0_UDRE_vect();
+    FILE *f = fmemopen(usart.tx, usart.tx_count < USART_TX_LOG ? usart.tx_count : USART_TX_LOG, "r");
+    tc_init(t);
+    bool ok = tc_parse(t, f);
+    fclose(f);
+    return ok;
+}
+
+static void test_records(void) {
+    static TcTrace_t t;
+    attach();
+    TRACE_BEGIN(TRACE_APP, 1);
+    wait_us(100);
+    TRACE_END(TRACE_APP, 2);
+    wait_us(40000);
+    TRACE(TRACE_APP + 1, 3);
+    wait_us(40000);                                 // Past a timestamp wrap
+    TRACE(TRACE_APP + 1, 4);
+
+    CHECK(dump(&t));
+    CHECK(TraceFrozen());
+    CHECK_EQ(t.count, 4);
+    CHECK_EQ(t.tick_ns, 1000);
+    CHECK_EQ(t.events[0].time_ns, 0);
+    CHECK_EQ(t.events[0].id, TRACE_APP);
+    CHECK_EQ(t.events[0].kind, TRACE_KIND_BEGIN);
+    CHECK_EQ(t.events[0].arg, 1);
+    CHECK(t.events[1].time_ns >= 100000 && t.events[1].time_ns < 110000);
+    CHECK_EQ(t.events[1].kind, TRACE_KIND_END);
+    CHECK_EQ(t.events[2].kind, 0);
+    CHECK(t.events[3].time_ns >= 80100000 && t.events[3].time_ns < 80120000);
+
+    // Frozen by the dump
+    TRACE(TRACE_APP, 0);
+    CHECK_EQ(trace_head, 4);
+}
+
+// The ring keeps the newest records; the trigger keeps `post` more, then freezes
+static void test_trigger(void) {
+    static TcTrace_t t;
+    attach();
+    for (uint16_t i = 0; i < 200; i++) {
+        TRACE(TRACE_APP, i);
+        if (i == 150) TraceTrigger(10);
+        wait_us(10);
+    }
+    CHECK(TraceFrozen());
+
+    CHECK(dump(&t));
+    CHECK_EQ(t.count, TRACE_SIZE);
+    CHECK_EQ(t.events[TRACE_SIZE - 1].arg, 160);    // 10 after the trigger...
+    CHECK_EQ(t.events[TRACE_SIZE - 11].id, TRACE_TRIGGER);
+    CHECK_EQ(t.events[TRACE_SIZE - 11].arg, 10);
+    CHECK_EQ(t.events[0].arg, 160 - TRACE_SIZE + 2); // ...and the ones before, oldest first
+}
+
+static void test_chrome(void) {
+    static TcTrace_t t;
+    char *json;
+    size_t size;
+    attach();
+    TRACE_END(TRACE_TWI, 0);                        // Its begin was overwritten: left out
+    TRACE_BEGIN(TRACE_TWI, 0x27);
+    wait_us(250);
+    TRACE_END(TRACE_TWI, 0);
+    TRACE(TRACE_KEY, 6);
+    CHECK(dump(&t));
+
+    FILE *f = open_memstream(&json, &size);
+    tc_chrome(&t, f);
+    fclose(f);
+    CHECK(strstr(json, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"twi\"}}") != NULL);
+    CHECK(strstr(json, "{\"name\":\"twi\",\"ph\":\"B\",\"ts\":1.000,") != NULL);
+    CHECK(strstr(json, "\"ph\":\"E\",\"ts\":25") != NULL);
+    CHECK(strstr(json, "{\"name\":\"key\",\"ph\":\"i\",\"s\":\"t\",") != NULL);
+    char *first_end = strstr(json, "\"ph\":\"E\"");
+    CHECK(first_end && !strstr(first_end + 1, "\"ph\":\"E\""));
+    free(json);
+}
+
+static void test_vcd(void) {
+    static TcTrace_t t;
+    char *vcd;
+    size_t size;
+    attach();
+    TRACE_BEGIN(TRACE_APP, 1);
+    TRACE(TRACE_KEY, 5);
+    wait_us(20);
+    TRACE_END(TRACE_APP, 0);
+    CHECK(dump(&t));
+
+    FILE *f = fmemopen("32 encoder\n", 11, "r");
+    CHECK(tc_names(&t, f));
+    fclose(f);
+    f = open_memstream(&vcd, &size);
+    tc_vcd(&t, f);
+    fclose(f);
+    CHECK(strstr(vcd, "$var wire 1 s32 encoder $end\n$var wire 8 a32 encoder_arg $end\n") != NULL);
+    CHECK(strstr(vcd, "$var wire 1 s6 key $end") != NULL);
+    CHECK(strstr(vcd, "#0\n1s32\nb00000001 a32\n") != NULL);
+    // The key pulse ends one tick later, before the span ends
+    char *pulse = strstr(vcd, "1s6\nb00000101 a6\n");
+    CHECK(pulse != NULL);
+    char *pulse_end = pulse ? strstr(pulse, "0s6\n") : NULL;
+    CHECK(pulse_end && strstr(pulse_end, "0s32\n") != NULL);
+    free(vcd);
+}
+
+int main(void) {
+    RUN(test_records);
+    RUN(test_trigger);
+    RUN(test_chrome);
+    RUN(test_vcd);
+    return TEST_REPORT();
+}
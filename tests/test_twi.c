@@ -0,0 +1,138 @@
+// TWI master driver (twi.c): status codes, timeouts, bus clear and scan
+#include <avr/io.h>
+#include "twi.h"
+#include "twi_bus.h"
+#include "pcf8574.h"
+#include "test.h"
+
+static TwiBus_t bus;
+static Pcf8574_t lcd_pcf, io_pcf;
+
+static void attach(void) {
+    TwiBusAttach(&bus);
+    Pcf8574Init(&lcd_pcf, &bus, 0x27);
+    Pcf8574Init(&io_pcf, &bus, 0x20);
+    TwiInit();
+}
+
+static void test_bit_rate(void) {
+    attach();
+    CHECK_EQ(HalGet(HAL_ADDR(TWBR)), TWI_TWBR_VALUE);
+    CHECK_EQ(HalGet(HAL_ADDR(TWSR)) & 0x03, TWI_TWPS_VALUE);
+    CHECK(TWI_TWBR_VALUE >= TWI_TWBR_MIN);
+    CHECK(TWI_SPEED_ACTUAL <= TWI_SPEED);
+    CHECK_EQ(F_CPU / TwiBusBitCycles(), TWI_SPEED_ACTUAL);
+}
+
+static void test_write_read(void) {
+    uint8_t out[] = { 0x12, 0x34, 0xA5 };
+    uint8_t in[2] = { 0, 0 };
+    attach();
+
+    CHECK_EQ(TwiWriteTo(0x20, out, sizeof(out)), TWI_OK);
+    HalSync();
+    CHECK_EQ(io_pcf.port, 0xA5);
+    CHECK_EQ(io_pcf.writes, 3);
+
+    io_pcf.inputs = 0x0F;
+    CHECK_EQ(TwiReadFrom(0x20, in, sizeof(in)), TWI_OK);
+    CHECK_EQ(in[0], 0x05);
+    CHECK_EQ(in[1], 0x05);
+    CHECK_EQ(TwiHwStatus(), 0x58);      // Last byte not acknowledged
+    CHECK_EQ(bus.starts, bus.stops);
+}
+
+static void test_nack(void) {
+    uint8_t data = 0;
+    attach();
+    CHECK_EQ(TwiWriteTo(0x50, &data, 1), TWI_NACK_ADDR);
+    CHECK_EQ(TwiHwStatus(), 0x20);
+    CHECK_EQ(TwiReadFrom(0x50, &data, 1), TWI_NACK_ADDR);
+    CHECK_EQ(TwiHwStatus(), 0x48);
+    HalSync();
+    CHECK_EQ(bus.starts, bus.stops);    // Released after every failure
+    CHECK_EQ(bus.state, TWI_BUS_IDLE);
+}
+
+static void test_scan(void) {
+    uint8_t found[4];
+    attach();
+    CHECK_EQ(TwiScan(found, 4), 2);
+    CHECK_EQ(found[0], 0x20);
+    CHECK_EQ(found[1], 0x27);
+    CHECK_EQ(TwiScan(found, 1), 2);     // Counts beyond max
+    HalSync();
+    CHECK_EQ(bus.starts, bus.stops);
+}
+
+static void test_timeout(void) {
+    uint8_t data = 0x55;
+    attach();
+    bus.hold_scl = true;
+    uint64_t start = HalMicros();
+    CHECK_EQ(TwiWriteTo(0x27, &data, 1), TWI_BUS_STUCK);
+    CHECK(HalMicros() - start < 4 * TWI_TIMEOUT_US);    // Bounded, no lock-up
+
+    // The slave lets go: the next transfer works again
+    bus.hold_scl = false;
+    CHECK_EQ(TwiWriteTo(0x27, &data, 1), TWI_OK);
+    HalSync();
+    CHECK_EQ(lcd_pcf.port, 0x55);
+}
+
+static void test_bus_clear(void) {
+    uint8_t data = 0x3C;
+    attach();
+
+    // A slave reset mid-byte holds SDA for 5 more clocks: TwiStart clears the bus first
+    bus.sda_stuck = 5;
+    CHECK_EQ(TwiWriteTo(0x20, &data, 1), TWI_OK);
+    CHECK_EQ(bus.scl_pulses, 5 + 1);                    // 5 clocks, then the STOP
+    HalSync();
+    CHECK_EQ(io_pcf.port, 0x3C);
+    CHECK(HalGet(HAL_ADDR(TWCR)) & (1 << TWEN));        // Unit enabled again
+
+    // SDA shorted low: reported, no lock-up
+    bus.sda_stuck = 0xFF;
+    bus.scl_pulses = 0;
+    CHECK_EQ(TwiBusClear(), TWI_BUS_STUCK);
+    CHECK_EQ(bus.scl_pulses, 9 + 1);
+    CHECK_EQ(TwiWriteTo(0x20, &data, 1), TWI_BUS_STUCK);
+}
+
+// A rate set at run time survives the recovery after an error and another TwiInit()
+static void test_speed_kept(void) {
+    uint8_t data = 0x5A;
+    attach();
+    uint32_t hz = TwiSetSpeed(50000);
+    uint8_t twbr = HalGet(HAL_ADDR(TWBR));
+    CHECK(hz <= 50000 && hz > 49000);
+
+    bus.sda_stuck = 0xFF;
+    CHECK_EQ(TwiWriteTo(0x20, &data, 1), TWI_BUS_STUCK);
+    CHECK_EQ(HalGet(HAL_ADDR(TWBR)), twbr);
+    CHECK_EQ(TwiSpeed(), hz);
+    bus.sda_stuck = 0;
+    CHECK_EQ(TwiBusClear(), TWI_OK);
+    CHECK_EQ(TwiSpeed(), hz);
+
+    TwiInit();
+    CHECK_EQ(TwiSpeed(), hz);
+    CHECK_EQ(TwiWriteTo(0x20, &data, 1), TWI_OK);
+    CHECK_EQ(F_CPU / TwiBusBitCycles(), hz);
+
+    CHECK_EQ(TwiSetSpeed(0), TWI_SPEED_ACTUAL);
+    TwiInit();
+    CHECK_EQ(HalGet(HAL_ADDR(TWBR)), TWI_TWBR_VALUE);
+}
+
+int main(void) {
+    RUN(test_bit_rate);
+    RUN(test_write_read);
+    RUN(test_nack);
+    RUN(test_scan);
+    RUN(test_timeout);
+    RUN(test_bus_clear);
+    RUN(test_speed_kept);
+    return TEST_REPORT();
+}
@@ -0,0 +1,462 @@
+/**
+ * @file avrbudget.c
+ * @brief Flash/RAM use per module and worst-case stack depth of a firmware build.
+ * @details Reads the files written by `make budget`:
+ *          - the linker map (-Wl,-Map): the size of every input section placed in .text,
+ *            .data, .bss and .noinit, summed per object file or archive member;
+ *          - GCC call graphs (-fcallgraph-info=su, one .ci file per source): the stack
+ *            frame of every function and the calls it makes;
+ *          - or, from compilers before GCC 10 (avr-gcc 5.4 and 7.3 as packaged), the .su
+ *            files of -fstack-usage for the frames and the disassembly of the linked ELF
+ *            (avr-objdump -d, given with -d) for the calls: call/rcall and jmp/rjmp to the
+ *            start of a function are edges, icall/eicall/ijmp/eijmp pointer calls. Static
+ *            functions of the same name in two files can't be told apart there; the first
+ *            one found is used.
+ *
+ *          The stack depth of an entry point is its own frame plus the deepest chain of
+ *          calls below it. AVR GCC counts the return address and the saved registers in
+ *          the frame, so the sums are the bytes below SP at the deepest point. The entry
+ *          points are main() and the interrupt handlers (__vector_N) of the modules that
+ *          were linked; interrupts don't nest (ISR_NOBLOCK aside), so the worst case is
+ *          main() plus the deepest handler.
+ *
+ *          Not counted, and listed in the report: calls through function pointers, frames
+ *          that grow at run time (alloca, variable-length arrays), recursion and library
+ *          functions without call-graph data (libgcc, avr-libc; usually a few bytes).
+ *          Check the measured high-water mark (stackmon.h) on the board as well.
+ *
+ * Usage: avrbudget [-r RAM_BYTES] [-f FLASH_BYTES] main.map file.ci...
+ *        avrbudget [-r RAM_BYTES] [-f FLASH_BYTES] -d main.dis main.map file.su...
+ *        (exit status 1 when the data and the stack don't fit in the RAM)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_MODULES     128
+#define MAX_FUNCS       2048
+#define MAX_CALLS       8192
+#define MAX_FILES       128
+#define NAME_SIZE       64
+
+#define DEPTH_UNKNOWN   (-1)
+#define DEPTH_ACTIVE    (-2)        // On the current search path (recursion)
+
+typedef struct {
+    char name[NAME_SIZE];
+    long flash;
+    long ram;
+} Module_t;
+
+typedef struct {
+    char name[NAME_SIZE];
+    int file;                       // .ci file that defines it
+    long frame;                     // Own stack usage in bytes
+    bool dynamic;                   // Frame size known only at run time
+    bool indirect;                  // Calls through a function pointer
+    long depth;                     // Frame plus deepest callee (DEPTH_xxx while unknown)
+    int deepest;                    // Callee on the deepest path, -1 if none
+} Func_t;
+
+typedef struct {
+    int from;                       // Func_t index
+    int file;
+    char to[NAME_SIZE];             // Callee name, resolved when the depth is computed
+} Call_t;
+
+// Global variables
+static Module_t modules[MAX_MODULES];
+static int module_count;
+static Func_t funcs[MAX_FUNCS];
+static int func_count;
+static Call_t calls[MAX_CALLS];
+static int call_count;
+static char ci_modules[MAX_FILES][NAME_SIZE];   // Object name of each .ci file
+static char missing[1024];                      // Callees without call-graph data
+static char uncounted[1024];                    // Reachable frames or calls not counted
+
+// Object name from a map file path: "dir/lcd.o" -> "lcd", "dir/libc.a(strlen.o)" -> "libc"
+static void module_name(const char *path, char *name) {
+    const char *open = strchr(path, '(');
+    const char *end = open ? open : path + strlen(path);
+    const char *base = end;
+    while (base > path && base[-1] != '/') base--;
+
+    // Members of our archive are the modules; toolchain archives are summed as a whole
+    if (open && !strncmp(base, "libbudget.a", 11)) {
+        base = open + 1;
+        end = strchr(base, ')');
+        if (!end) end = base + strlen(base);
+    }
+    int length = end - base;
+    if (length > 2 && (!strncmp(end - 2, ".o", 2) || !strncmp(end - 2, ".a", 2))) length -= 2;
+    if (length >= NAME_SIZE) length = NAME_SIZE - 1;
+    memcpy(name, base, length);
+    name[length] = '\0';
+}
+
+static Module_t *module_get(const char *path) {
+    char name[NAME_SIZE];
+    module_name(path, name);
+    for (int i = 0; i < module_count; i++) {
+        if (!strcmp(modules[i].name, name)) return &modules[i];
+    }
+    if (module_count == MAX_MODULES) return NULL;
+    Module_t *m = &modules[module_count++];
+    strcpy(m->name, name);
+    return m;
+}
+
+static bool module_linked(const char *name) {
+    for (int i = 0; i < module_count; i++) {
+        if (!strcmp(modules[i].name, name)) return true;
+    }
+    return false;
+}
+
+// Output sections that take flash and/or RAM
+typedef enum { OUT_OTHER, OUT_TEXT, OUT_DATA, OUT_BSS } Output_t;
+
+static Output_t output_kind(const char *name) {
+    if (!strcmp(name, ".text")) return OUT_TEXT;
+    if (!strcmp(name, ".data")) return OUT_DATA;
+    if (!strcmp(name, ".bss") || !strcmp(name, ".noinit")) return OUT_BSS;
+    return OUT_OTHER;
+}
+
+static void add_section(Output_t out, long size, const char *path) {
+    if (out == OUT_OTHER || size == 0) return;
+    Module_t *m = module_get(path);
+    if (!m) return;
+    if (out != OUT_BSS) m->flash += size;       // .data is copied from flash at start-up
+    if (out != OUT_TEXT) m->ram += size;
+}
+
+static bool read_map(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    char line[512];
+    bool in_map = false;
+    bool pending = false;           // Input section name alone, numbers on the next line
+    Output_t out = OUT_OTHER;
+    while (fgets(line, sizeof(line), f)) {
+        if (!in_map) {
+            in_map = !strncmp(line, "Linker script and memory map", 28);
+            continue;
+        }
+        char name[256], file[256];
+        unsigned long long addr, size;
+
+        if (line[0] == '.') {
+            // Output section: ".text  0x00000000  0x2f4"
+            if (sscanf(line, "%255s", name) == 1) out = output_kind(name);
+            pending = false;
+        } else if (line[0] == ' ' && line[1] != ' ' && line[1] != '*') {
+            // Input section: " .text.LcdPrint  0x000000f8  0x1c  dir/lib.a(lcd.o)"
+            int n = sscanf(line, " %255s %llx %llx %255s", name, &addr, &size, file);
+            if (n == 4) add_section(out, size, file);
+            pending = (n == 1);
+        } else if (pending) {
+            if (sscanf(line, " %llx %llx %255s", &addr, &size, file) == 3) add_section(out, size, file);
+            pending = false;
+        }
+    }
+    fclose(f);
+    return in_map;
+}
+
+static int func_find(const char *name, int file) {
+    int found = -1;
+    for (int i = 0; i < func_count; i++) {
+        if (strcmp(funcs[i].name, name)) continue;
+        if (funcs[i].file == file) return i;    // A static function of the caller's file
+        if (found < 0) found = i;
+    }
+    return found;
+}
+
+// Copy the text between the quotes after `key` (e.g. title: "main")
+static bool quoted(const char *line, const char *key, char *value, size_t size) {
+    const char *p = strstr(line, key);
+    if (!p) return false;
+    p += strlen(key);
+    const char *end = strchr(p, '"');
+    if (!end) return false;
+    size_t length = end - p;
+    if (length >= size) length = size - 1;
+    memcpy(value, p, length);
+    value[length] = '\0';
+    return true;
+}
+
+static bool read_ci(const char *path, int file) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    char line[1024], from[NAME_SIZE];
+    while (fgets(line, sizeof(line), f)) {
+        if (!strncmp(line, "node:", 5)) {
+            // node: { title: "lcd_send" label: "lcd_send\nlib/lcd.c:48:13\n6 bytes (static)" }
+            char label[512];
+            if (!quoted(line, "title: \"", from, sizeof(from))) continue;
+            if (!quoted(line, "label: \"", label, sizeof(label))) continue;
+            const char *bytes = strstr(label, " bytes (");
+            if (!bytes || func_count == MAX_FUNCS) continue;    // Not defined in this file
+            while (bytes > label && bytes[-1] >= '0' && bytes[-1] <= '9') bytes--;
+
+            Func_t *fn = &funcs[func_count++];
+            strcpy(fn->name, from);
+            fn->file = file;
+            fn->frame = atol(bytes);
+            fn->dynamic = strstr(bytes, "(static)") == NULL;
+            fn->depth = DEPTH_UNKNOWN;
+            fn->deepest = -1;
+        } else if (!strncmp(line, "edge:", 5)) {
+            // edge: { sourcename: "LcdPrint" targetname: "lcd_send" label: "lib/lcd.c:210:5" }
+            char to[NAME_SIZE];
+            if (!quoted(line, "sourcename: \"", from, sizeof(from))) continue;
+            if (!quoted(line, "targetname: \"", to, sizeof(to))) continue;
+            int caller = func_find(from, file);
+            if (caller < 0) continue;
+            if (!strcmp(to, "__indirect_call")) {
+                funcs[caller].indirect = true;
+            } else if (call_count < MAX_CALLS) {
+                calls[call_count].from = caller;
+                calls[call_count].file = file;
+                strcpy(calls[call_count].to, to);
+                call_count++;
+            }
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool read_su(const char *path, int file) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        // lib/lcd.c:48:13:lcd_send	6	static
+        char *tab = strchr(line, '\t');
+        if (!tab || func_count == MAX_FUNCS) continue;
+        *tab = '\0';
+        char *name = strrchr(line, ':');
+        name = name ? name + 1 : line;
+        if (strlen(name) >= NAME_SIZE) continue;
+
+        Func_t *fn = &funcs[func_count++];
+        strcpy(fn->name, name);
+        fn->file = file;
+        fn->frame = atol(tab + 1);
+        fn->dynamic = strstr(tab + 1, "dynamic") != NULL;
+        fn->depth = DEPTH_UNKNOWN;
+        fn->deepest = -1;
+    }
+    fclose(f);
+    return true;
+}
+
+// Whole-word mnemonic in a disassembly line
+static bool mnemonic(const char *line, const char *op) {
+    size_t length = strlen(op);
+    for (const char *p = strstr(line, op); p; p = strstr(p + 1, op)) {
+        bool start = p == line || p[-1] == '\t' || p[-1] == ' ';
+        bool end = p[length] == '\t' || p[length] == ' ' || p[length] == '\n' || !p[length];
+        if (start && end) return true;
+    }
+    return false;
+}
+
+static bool read_dis(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    char line[512];
+    int caller = -1;
+    while (fgets(line, sizeof(line), f)) {
+        // 000000b4 <LcdInit>:
+        char *open = strchr(line, '<'), *close = strstr(line, ">:");
+        if (line[0] != ' ' && open && close > open) {
+            *close = '\0';
+            caller = func_find(open + 1, -1);
+            continue;
+        }
+        if (caller < 0) continue;
+
+        //   9a:	0e 94 5a 00 	call	0xb4	; 0xb4 <LcdInit>
+        if (mnemonic(line, "icall") || mnemonic(line, "eicall") ||
+            mnemonic(line, "ijmp") || mnemonic(line, "eijmp")) {
+            funcs[caller].indirect = true;
+            continue;
+        }
+        if (!mnemonic(line, "call") && !mnemonic(line, "rcall") &&
+            !mnemonic(line, "jmp") && !mnemonic(line, "rjmp")) continue;
+        char *target = strrchr(line, '<');
+        if (!target) continue;
+        char to[NAME_SIZE];
+        size_t length = strcspn(target + 1, ">");
+        if (length >= sizeof(to)) continue;
+        memcpy(to, target + 1, length);
+        to[length] = '\0';
+        // <main+0x1c>: a jump inside a function, or rcall .+0 making room on the stack
+        if (strchr(to, '+') || !strcmp(to, funcs[caller].name)) continue;
+        if (call_count < MAX_CALLS) {
+            calls[call_count].from = caller;
+            calls[call_count].file = funcs[caller].file;
+            strcpy(calls[call_count].to, to);
+            call_count++;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// Function name without the "lib/lcd.c:" prefix GCC gives static functions
+static const char *short_name(const char *name) {
+    const char *colon = strrchr(name, ':');
+    return colon ? colon + 1 : name;
+}
+
+// Add " item," to a list once
+static void note(char *list, size_t size, const char *what, const char *name) {
+    char item[NAME_SIZE + 32];
+    snprintf(item, sizeof(item), " %s%s,", what, name);
+    if (strstr(list, item) || strlen(list) + strlen(item) >= size) return;
+    strcat(list, item);
+}
+
+static void print_list(const char *title, char *list) {
+    if (!list[0]) return;
+    list[strlen(list) - 1] = '\0';     // Trailing comma
+    printf("%s:%s\n", title, list);
+}
+
+// Deepest stack below a function; a recursive call is skipped (and listed)
+static long depth(int i) {
+    Func_t *fn = &funcs[i];
+    if (fn->depth >= 0) return fn->depth;
+
+    fn->depth = DEPTH_ACTIVE;
+    if (fn->dynamic) note(uncounted, sizeof(uncounted), "dynamic frame of ", short_name(fn->name));
+    if (fn->indirect) note(uncounted, sizeof(uncounted), "pointer calls in ", short_name(fn->name));
+    long deepest = 0;
+    for (int c = 0; c < call_count; c++) {
+        if (calls[c].from != i) continue;
+        int callee = func_find(calls[c].to, calls[c].file);
+        if (callee < 0) {
+            note(missing, sizeof(missing), "", short_name(calls[c].to));
+            continue;
+        }
+        if (funcs[callee].depth == DEPTH_ACTIVE) {
+            note(uncounted, sizeof(uncounted), "recursion through ", short_name(funcs[callee].name));
+            continue;
+        }
+        long d = depth(callee);
+        if (d > deepest || fn->deepest < 0) {
+            deepest = d;
+            fn->deepest = callee;
+        }
+    }
+    fn->depth = fn->frame + deepest;
+    return fn->depth;
+}
+
+// Call chain of the deepest path
+static void print_path(int i) {
+    for (int n = 0; i >= 0 && n < 16; n++, i = funcs[i].deepest) {
+        printf("%s%s", n ? " > " : "", short_name(funcs[i].name));
+    }
+    printf("\n");
+}
+
+static int by_flash(const void *a, const void *b) {
+    const Module_t *ma = a, *mb = b;
+    return (mb->flash > ma->flash) - (mb->flash < ma->flash);
+}
+
+int main(int argc, char *argv[]) {
+    long ram_size = 4096, flash_size = 131072;
+    const char *map = NULL, *dis = NULL;
+    int ci_first = argc;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) ram_size = strtol(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc) flash_size = strtol(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) dis = argv[++i];
+        else {
+            map = argv[i];
+            ci_first = i + 1;
+            break;
+        }
+    }
+    if (!map) {
+        fprintf(stderr, "usage: %s [-r RAM_BYTES] [-f FLASH_BYTES] [-d main.dis] main.map "
+                "file.ci|file.su...\n", argv[0]);
+        return 2;
+    }
+    if (!read_map(map)) {
+        fprintf(stderr, "%s: no memory map\n", map);
+        return 2;
+    }
+    for (int i = ci_first; i < argc && i - ci_first < MAX_FILES; i++) {
+        module_name(argv[i], ci_modules[i - ci_first]);
+        char *dot = strrchr(ci_modules[i - ci_first], '.');
+        bool su = dot && !strcmp(dot, ".su");
+        if (dot && (su || !strcmp(dot, ".ci"))) *dot = '\0';
+        if (!(su ? read_su(argv[i], i - ci_first) : read_ci(argv[i], i - ci_first))) return 2;
+    }
+    if (dis && !read_dis(dis)) return 2;
+
+    // Memory per module, largest first
+    long flash = 0, ram = 0;
+    qsort(modules, module_count, sizeof(modules[0]), by_flash);
+    printf("%-20s %8s %8s\n", "module", "flash", "ram");
+    for (int i = 0; i < module_count; i++) {
+        if (!modules[i].flash && !modules[i].ram) continue;
+        printf("%-20s %8ld %8ld\n", modules[i].name, modules[i].flash, modules[i].ram);
+        flash += modules[i].flash;
+        ram += modules[i].ram;
+    }
+    printf("%-20s %8ld %8ld   of %ld / %ld bytes\n\n", "total", flash, ram, flash_size, ram_size);
+
+    // Stack per entry point: main() and the handlers of the linked modules
+    long main_depth = 0, isr_depth = 0;
+    printf("stack (bytes, deepest call chain)\n");
+    for (int i = 0; i < func_count; i++) {
+        bool is_main = !strcmp(funcs[i].name, "main");
+        bool is_isr = !strncmp(funcs[i].name, "__vector_", 9);
+        if (!is_main && !is_isr) continue;
+        if (!module_linked(ci_modules[funcs[i].file])) continue;
+
+        long d = depth(i);
+        printf("%-20s %8ld   ", funcs[i].name, d);
+        print_path(i);
+        if (is_main && d > main_depth) main_depth = d;
+        if (is_isr && d > isr_depth) isr_depth = d;
+    }
+    long stack = main_depth + isr_depth;
+    long gap = ram_size - ram - stack;
+    printf("%-20s %8ld   main + deepest interrupt%s\n", "worst case", stack,
+           uncounted[0] ? ", at least" : "");
+    print_list("not counted", uncounted);
+    print_list("no call graph for", missing);
+    printf("\nRAM: %ld data/bss + %ld stack, %ld bytes %s\n", ram, stack,
+           gap < 0 ? -gap : gap, gap < 0 ? "OVER" : "to spare");
+    return gap < 0 ? 1 : 0;
+}
@@ -0,0 +1,347 @@
+/**
+ * @file bkboot.c
+ * @brief Uploads an Intel HEX image through the serial bootloader (bootloader/).
+ * @details Syncs with the bootloader after the board's RESET button, asks for the CRC of
+ *          every page the image covers and sends only the pages that differ, the
+ *          application's first page last. The CRC of the whole image is checked before the
+ *          application is started.
+ *
+ *          Any baud rate is set with termios2/BOTHER, so the rates that are exact at 8 MHz
+ *          (125000, 250000, 500000) work with USB serial adapters that support them. Low
+ *          latency mode is requested so the adapter doesn't hold back the short replies.
+ *
+ * Usage: bkboot [-b baud] [-w seconds] port image.hex
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include <linux/serial.h>
+#include "../bootloader/protocol.h"
+
+#define BK_SYNC_MS      50      // Sync interval while waiting for the board
+#define BK_REPLY_MS     1000    // Longest wait for a reply
+#define BK_RETRIES      3       // Attempts per request (bad CRC on the line)
+
+typedef struct {
+    uint16_t pages;             ///< Pages covered by the image
+    uint16_t written;
+    uint16_t skipped;           ///< Already programmed
+    uint32_t bytes;             ///< Bytes sent
+    double seconds;             ///< From sync to start of the application
+} BkStats_t;
+
+// Global variables
+static unsigned bk_wait_ms = 10000;     // Time for pressing RESET
+
+static double bk_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint16_t bk_crc(uint16_t crc, const uint8_t *data, uint32_t length) {
+    while (length--) crc = boot_crc_update(crc, *data++);
+    return crc;
+}
+
+static int hex_digits(const char *s, int count) {
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        int c = s[i], d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else return -1;
+        value = value << 4 | d;
+    }
+    return value;
+}
+
+// Read an Intel HEX file into a BOOT_START byte image filled with 0xFF
+static uint8_t *hex_load(const char *path, uint32_t *length) {
+    FILE *f = fopen(path, "r");
+    char line[600];
+    uint32_t base = 0;
+    unsigned number = 0;
+
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    uint8_t *image = malloc(BOOT_START);
+    memset(image, 0xFF, BOOT_START);
+    *length = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        uint8_t rec[256 + 5];
+        int count;
+        number++;
+        if (line[0] != ':') continue;
+        count = hex_digits(line + 1, 2);
+        if (count < 0 || (int)strlen(line) < 11 + 2 * count) goto bad;
+
+        uint8_t sum = 0;
+        for (int i = 0; i < count + 5; i++) {
+            int b = hex_digits(line + 1 + 2 * i, 2);
+            if (b < 0) goto bad;
+            rec[i] = b;
+            sum += b;
+        }
+        if (sum != 0) goto bad;
+
+        uint32_t addr = base + (rec[1] << 8 | rec[2]);
+        switch (rec[3]) {
+        case 0x00:
+            if (addr + count > BOOT_START) {
+                fprintf(stderr, "%s:%u: data at 0x%05X is inside the bootloader\n", path, number, addr);
+                goto fail;
+            }
+            memcpy(image + addr, rec + 4, count);
+            if (addr + count > *length) *length = addr + count;
+            break;
+        case 0x01:
+            fclose(f);
+            return image;
+        case 0x02:
+            base = (uint32_t)(rec[4] << 8 | rec[5]) << 4;
+            break;
+        case 0x04:
+            base = (uint32_t)(rec[4] << 8 | rec[5]) << 16;
+            break;
+        default:
+            break;              // Start addresses
+        }
+    }
+    fclose(f);
+    return image;
+
+bad:
+    fprintf(stderr, "%s:%u: bad record\n", path, number);
+fail:
+    fclose(f);
+    free(image);
+    return NULL;
+}
+
+// Read exactly length bytes; false after timeout_ms without data
+static bool link_read(int fd, uint8_t *data, uint32_t length, int timeout_ms) {
+    struct pollfd p = { .fd = fd, .events = POLLIN };
+    while (length) {
+        if (poll(&p, 1, timeout_ms) <= 0) return false;
+        ssize_t n = read(fd, data, length);
+        if (n < 0 && errno == EAGAIN) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+static bool link_write(int fd, const uint8_t *data, uint32_t length, BkStats_t *stats) {
+    struct pollfd p = { .fd = fd, .events = POLLOUT };
+    stats->bytes += length;
+    while (length) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EAGAIN && poll(&p, 1, BK_REPLY_MS) > 0) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+// Throw away whatever arrives until the line is quiet
+static void link_drain(int fd, int quiet_ms) {
+    uint8_t c;
+    while (link_read(fd, &c, 1, quiet_ms));
+}
+
+// Send a request and read its reply payload; retried on NAK or a bad reply
+static bool link_request(int fd, uint8_t cmd, const uint8_t *payload, uint16_t length,
+                         uint8_t *reply, uint16_t reply_length, int timeout_ms, BkStats_t *stats) {
+    uint8_t frame[1 + 4 + BOOT_PAGE_SIZE + 2];
+    uint16_t crc;
+
+    frame[0] = cmd;
+    if (length) memcpy(frame + 1, payload, length);
+    crc = bk_crc(0, frame, length + 1);
+    frame[length + 1] = crc & 0xFF;
+    frame[length + 2] = crc >> 8;
+
+    for (int attempt = 0; attempt < BK_RETRIES; attempt++) {
+        uint8_t c, end[2];
+        if (!link_write(fd, frame, length + 3, stats)) return false;
+        if (!link_read(fd, &c, 1, timeout_ms)) {
+            fprintf(stderr, "bkboot: no reply to '%c'\n", cmd);
+            return false;
+        }
+        if (c != BOOT_ACK) {
+            link_drain(fd, 20);
+            continue;
+        }
+        if (!reply_length) return true;
+        if (link_read(fd, reply, reply_length, timeout_ms) && link_read(fd, end, 2, timeout_ms) &&
+            bk_crc(0, reply, reply_length) == (end[0] | end[1] << 8)) return true;
+        link_drain(fd, 20);
+    }
+    fprintf(stderr, "bkboot: request '%c' failed\n", cmd);
+    return false;
+}
+
+// Wait for the bootloader: it listens for BOOT_WAIT_MS after the RESET button
+static bool bk_sync(int fd, BkStats_t *stats) {
+    const uint8_t sync = BOOT_SYNC;
+    for (unsigned ms = 0; ms < bk_wait_ms; ms += BK_SYNC_MS) {
+        uint8_t c;
+        if (!link_write(fd, &sync, 1, stats)) return false;
+        if (link_read(fd, &c, 1, BK_SYNC_MS) && c == BOOT_ACK) {
+            link_drain(fd, 2 * BK_SYNC_MS);        // ACKs for the syncs still on the way
+            return true;
+        }
+    }
+    fprintf(stderr, "bkboot: no answer from the bootloader (press RESET on the board)\n");
+    return false;
+}
+
+// Upload an image (BOOT_START bytes, length used) and start it
+static bool bkboot_session(int fd, const uint8_t *image, uint32_t length, BkStats_t *stats) {
+    static uint8_t reply[2 * BOOT_START / BOOT_PAGE_SIZE];
+    uint8_t payload[4 + BOOT_PAGE_SIZE];
+    BootInfo_t info;
+
+    *stats = (BkStats_t){ 0 };
+    stats->pages = (length + BOOT_PAGE_SIZE - 1) / BOOT_PAGE_SIZE;
+    if (!stats->pages || length > BOOT_START) return false;
+    if (!bk_sync(fd, stats)) return false;
+    double start = bk_now();
+
+    if (!link_request(fd, BOOT_CMD_INFO, NULL, 0, (uint8_t *)&info, sizeof(info), BK_REPLY_MS, stats)) return false;
+    if (info.magic[0] != 'B' || info.magic[1] != 'K' || info.version != BOOT_VERSION ||
+        (info.page_size[0] | info.page_size[1] << 8) != BOOT_PAGE_SIZE) {
+        fprintf(stderr, "bkboot: unknown bootloader (version %u)\n", info.version);
+        return false;
+    }
+
+    // CRC of every page, to skip the ones that are already programmed
+    payload[0] = 0;
+    payload[1] = 0;
+    payload[2] = stats->pages & 0xFF;
+    payload[3] = stats->pages >> 8;
+    if (!link_request(fd, BOOT_CMD_CRC, payload, 4, reply, 2 * stats->pages,
+                      BK_REPLY_MS + stats->pages, stats)) return false;
+
+    // Page 0 goes last: the bootloader erases it at the first write, so an interrupted
+    // upload doesn't leave a broken application that would be started
+    for (uint16_t i = 1; i <= stats->pages; i++) {
+        uint16_t page = i % stats->pages;
+        const uint8_t *data = image + (uint32_t)page * BOOT_PAGE_SIZE;
+        bool same = bk_crc(0, data, BOOT_PAGE_SIZE) == (reply[2 * page] | reply[2 * page + 1] << 8);
+
+        if (same && !(page == 0 && stats->written)) {
+            stats->skipped++;
+            continue;
+        }
+        payload[0] = page & 0xFF;
+        payload[1] = page >> 8;
+        memcpy(payload + 2, data, BOOT_PAGE_SIZE);
+        if (!link_request(fd, BOOT_CMD_WRITE, payload, 2 + BOOT_PAGE_SIZE, NULL, 0, BK_REPLY_MS, stats)) return false;
+        stats->written++;
+    }
+
+    // Check the whole image, then start it
+    uint32_t span = (uint32_t)stats->pages * BOOT_PAGE_SIZE;
+    uint8_t crc[2];
+    payload[0] = span & 0xFF;
+    payload[1] = (span >> 8) & 0xFF;
+    payload[2] = (span >> 16) & 0xFF;
+    payload[3] = span >> 24;
+    if (!link_request(fd, BOOT_CMD_VERIFY, payload, 4, crc, 2, BK_REPLY_MS + stats->pages, stats)) return false;
+    if ((crc[0] | crc[1] << 8) != bk_crc(0, image, span)) {
+        fprintf(stderr, "bkboot: verify failed, the application was not started\n");
+        return false;
+    }
+    if (!link_request(fd, BOOT_CMD_GO, NULL, 0, NULL, 0, BK_REPLY_MS, stats)) return false;
+
+    stats->seconds = bk_now() - start;
+    return true;
+}
+
+#ifndef BKBOOT_NO_MAIN
+// Open the serial port in raw mode at any baud rate
+static int port_open(const char *path, unsigned baud) {
+    struct termios2 tio;
+    struct serial_struct serial;
+    int fd = open(path, O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || ioctl(fd, TCGETS2, &tio) < 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_lflag = 0;
+    tio.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+    tio.c_ispeed = tio.c_ospeed = baud;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (ioctl(fd, TCSETS2, &tio) < 0) {
+        perror("baud rate");
+        close(fd);
+        return -1;
+    }
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &serial);
+    }
+    ioctl(fd, TCFLSH, TCIOFLUSH);
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned baud = 125000;
+    uint32_t length;
+    BkStats_t stats;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:w:")) != -1) {
+        if (opt == 'b') baud = strtoul(optarg, NULL, 0);
+        else if (opt == 'w') bk_wait_ms = strtoul(optarg, NULL, 0) * 1000;
+        else optind = argc + 1;
+    }
+    if (optind + 2 != argc) {
+        fprintf(stderr, "usage: %s [-b baud] [-w seconds] port image.hex\n", argv[0]);
+        return 2;
+    }
+
+    uint8_t *image = hex_load(argv[optind + 1], &length);
+    if (!image) return 1;
+    if (!length) {
+        fprintf(stderr, "%s: no data\n", argv[optind + 1]);
+        return 1;
+    }
+    int fd = port_open(argv[optind], baud);
+    if (fd < 0) return 1;
+
+    printf("Press RESET on the board...\n");
+    fflush(stdout);
+    if (!bkboot_session(fd, image, length, &stats)) return 1;
+
+    printf("%u pages: %u written, %u unchanged, %.2f s, %.0f bytes/s\n", stats.pages, stats.written,
+           stats.skipped, stats.seconds, stats.seconds > 0 ? length / stats.seconds : 0.0);
+    close(fd);
+    free(image);
+    return 0;
+}
+#endif
@@ -0,0 +1,250 @@
+/**
+ * @file telemdump.c
+ * @brief Decodes the telemetry stream of lib/telemetry.c into CSV.
+ * @details Reads a serial port, a pty (simavr's uart_pty) or a capture file and prints one
+ *          line per record:
+ *
+ *              time_us,channel,type,values...
+ *
+ *          The stream is split at 0x00 and each frame COBS-decoded and checked with its
+ *          CRC-16/XMODEM. The 16-bit timestamps are unwrapped into a running time from the
+ *          first record. Frames that fail but are printable are text the board sent with
+ *          UartPuts(); they are copied to stderr. Everything before the first 0x00 is
+ *          skipped, as the reader may have started in the middle of a frame. The counts of
+ *          frames, bad frames, text and skipped bytes are printed at the end (EOF or
+ *          Ctrl-C).
+ *
+ *          A serial port is set to the rate with termios2/BOTHER, as in bkboot.
+ *
+ * Usage: telemdump [-b baud] [-t us_per_tick] [port|file|-]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include "../lib/telemetry.h"
+
+#define TD_FRAME_MAX    256     // Longer frames are text or noise
+
+typedef struct {
+    uint32_t frames;            ///< Good records
+    uint32_t bad;               ///< Frames with a bad CRC, COBS code or length
+    uint32_t text;              ///< Text frames
+    uint32_t skipped;           ///< Bytes before the first 0x00
+} TdStats_t;
+
+typedef struct {
+    FILE *out;                  ///< CSV
+    FILE *text;                 ///< Text frames, NULL to drop them
+    unsigned tick_us;           ///< Microseconds per timestamp tick
+    uint8_t buf[TD_FRAME_MAX];
+    unsigned length;
+    bool synced;
+    bool overflow;
+    bool started;               ///< A record was seen: last_ts is valid
+    uint16_t last_ts;
+    uint64_t ticks;             ///< Running time since the first record
+    TdStats_t stats;
+} TdDecoder_t;
+
+static const char *const td_type_names[TELEM_TYPES] = {
+    "u8", "i8", "u16", "i16", "u32", "i32", "f32", "text", "bytes"
+};
+static const uint8_t td_type_sizes[TELEM_TYPES] = { 1, 1, 2, 2, 4, 4, 4, 1, 1 };
+
+static void td_init(TdDecoder_t *d, FILE *out, FILE *text, unsigned tick_us) {
+    memset(d, 0, sizeof(*d));
+    d->out = out;
+    d->text = text;
+    d->tick_us = tick_us;
+}
+
+// CRC-16/XMODEM, as _crc_xmodem_update() on the board
+static uint16_t td_crc(const uint8_t *data, unsigned length) {
+    uint16_t crc = 0;
+    while (length--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+// COBS frame without its 0x00 into out; returns the decoded length or -1
+static int td_cobs(const uint8_t *in, unsigned length, uint8_t *out) {
+    unsigned i = 0, n = 0;
+    while (i < length) {
+        unsigned code = in[i++];
+        if (!code || i + code - 1 > length) return -1;
+        for (unsigned k = 1; k < code; k++) out[n++] = in[i++];
+        if (code < 0xFF && i < length) out[n++] = 0;
+    }
+    return n;
+}
+
+static uint32_t td_le(const uint8_t *p, unsigned size) {
+    uint32_t value = 0;
+    for (unsigned i = size; i--;) value = value << 8 | p[i];
+    return value;
+}
+
+static void td_value(FILE *out, TelemType_t type, const uint8_t *p) {
+    uint32_t raw = td_le(p, td_type_sizes[type]);
+    float f;
+    switch (type) {
+    case TELEM_U8:
+    case TELEM_U16:
+    case TELEM_U32:     fprintf(out, ",%u", raw); break;
+    case TELEM_I8:      fprintf(out, ",%d", (int8_t)raw); break;
+    case TELEM_I16:     fprintf(out, ",%d", (int16_t)raw); break;
+    case TELEM_I32:     fprintf(out, ",%d", (int32_t)raw); break;
+    case TELEM_F32:
+        memcpy(&f, &raw, sizeof(f));
+        fprintf(out, ",%g", f);
+        break;
+    default:            break;
+    }
+}
+
+static void td_record(TdDecoder_t *d, const uint8_t *rec, unsigned length) {
+    uint16_t ts = rec[0] | rec[1] << 8;
+    TelemType_t type = rec[3];
+    const uint8_t *payload = rec + TELEM_HEADER;
+    unsigned n = length - TELEM_HEADER;
+
+    if (d->started) d->ticks += (uint16_t)(ts - d->last_ts);
+    d->started = true;
+    d->last_ts = ts;
+    d->stats.frames++;
+
+    fprintf(d->out, "%llu,%u,%s", (unsigned long long)(d->ticks * d->tick_us), rec[2], td_type_names[type]);
+    if (type == TELEM_TEXT) {
+        fputs(",\"", d->out);
+        for (unsigned i = 0; i < n; i++) {
+            if (payload[i] == '"') fputc('"', d->out);
+            fputc(payload[i], d->out);
+        }
+        fputc('"', d->out);
+    } else if (type == TELEM_BYTES) {
+        fputc(',', d->out);
+        for (unsigned i = 0; i < n; i++) fprintf(d->out, "%02x", payload[i]);
+    } else {
+        for (unsigned i = 0; i < n; i += td_type_sizes[type]) td_value(d->out, type, payload + i);
+    }
+    fputc('\n', d->out);
+}
+
+static bool td_printable(const uint8_t *data, unsigned length) {
+    for (unsigned i = 0; i < length; i++) {
+        if ((data[i] < 0x20 || data[i] > 0x7E) && data[i] != '\r' && data[i] != '\n' && data[i] != '\t') return false;
+    }
+    return true;
+}
+
+// A 0x00 ended the frame in buf
+static void td_frame(TdDecoder_t *d) {
+    uint8_t rec[TD_FRAME_MAX];
+    int n = d->overflow ? -1 : td_cobs(d->buf, d->length, rec);
+
+    if (n >= TELEM_HEADER + 2 && rec[3] < TELEM_TYPES && td_crc(rec, n - 2) == td_le(rec + n - 2, 2) &&
+        (n - TELEM_HEADER - 2) % td_type_sizes[rec[3]] == 0) {
+        td_record(d, rec, n - 2);
+    } else if (!d->overflow && td_printable(d->buf, d->length)) {
+        d->stats.text++;
+        if (d->text) fwrite(d->buf, 1, d->length, d->text);
+    } else {
+        d->stats.bad++;
+    }
+}
+
+// Feed one byte of the stream
+static void td_byte(TdDecoder_t *d, uint8_t c) {
+    if (!d->synced) {
+        if (c) d->stats.skipped++;
+        else d->synced = true;
+        return;
+    }
+    if (c) {
+        if (d->length < TD_FRAME_MAX) d->buf[d->length++] = c;
+        else d->overflow = true;
+        return;
+    }
+    if (d->length) td_frame(d);
+    d->length = 0;
+    d->overflow = false;
+}
+
+#ifndef TELEMDUMP_NO_MAIN
+static volatile sig_atomic_t td_stop;
+
+static void td_interrupt(int sig) {
+    (void)sig;
+    td_stop = 1;
+}
+
+// Serial port in raw mode at any baud rate; other files are read as they are
+static int td_open(const char *path, unsigned baud) {
+    struct termios2 tio;
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY | O_NOCTTY) : STDIN_FILENO;
+
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    if (!isatty(fd)) return fd;
+    if (ioctl(fd, TCGETS2, &tio) == 0) {
+        tio.c_iflag = 0;
+        tio.c_oflag = 0;
+        tio.c_lflag = 0;
+        tio.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+        tio.c_ispeed = tio.c_ospeed = baud;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        if (ioctl(fd, TCSETS2, &tio) < 0) perror("baud rate");
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned baud = 250000, tick_us = 1;
+    struct sigaction sa = { .sa_handler = td_interrupt };
+    TdDecoder_t d;
+    uint8_t buf[4096];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:t:")) != -1) {
+        if (opt == 'b') baud = strtoul(optarg, NULL, 0);
+        else if (opt == 't') tick_us = strtoul(optarg, NULL, 0);
+        else optind = argc + 1;
+    }
+    if (optind + 1 < argc || optind > argc) {
+        fprintf(stderr, "usage: %s [-b baud] [-t us_per_tick] [port|file|-]\n", argv[0]);
+        return 2;
+    }
+    int fd = td_open(optind < argc ? argv[optind] : "-", baud);
+    if (fd < 0) return 1;
+
+    sigaction(SIGINT, &sa, NULL);       // No SA_RESTART: read() returns on Ctrl-C
+    td_init(&d, stdout, stderr, tick_us);
+    printf("time_us,channel,type,values\n");
+    while (!td_stop) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n; i++) td_byte(&d, buf[i]);
+        fflush(stdout);
+    }
+
+    fprintf(stderr, "%u records, %u bad frames, %u text, %u bytes skipped\n", d.stats.frames,
+            d.stats.bad, d.stats.text, d.stats.skipped);
+    return 0;
+}
+#endif
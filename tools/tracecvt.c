@@ -0,0 +1,251 @@
+/**
+ * @file tracecvt.c
+ * @brief Converts a trace dump of lib/trace.c into a Chrome trace or a VCD file.
+ * @details Reads the text TraceDump() prints (from a serial port, a pty or a saved file)
+ *          and writes one row per event id: spans (TRACE_BEGIN/TRACE_END) as bars, single
+ *          events as marks, each with its argument. The 16-bit timestamps are unwrapped
+ *          and scaled with the tick length from the dump header; time 0 is the oldest
+ *          record.
+ *
+ *          -f chrome (default) writes JSON for chrome://tracing or ui.perfetto.dev.
+ *          -f vcd writes a VCD file for GTKWave: a 1-bit signal per id (high during a span,
+ *          a one-tick pulse for a single event) and an 8-bit <name>_arg signal.
+ *
+ *          The library's ids have names; -n file adds or renames ids with lines
+ *          `<id> <name>` (id in decimal, e.g. `32 encoder_isr`).
+ *
+ * Usage: tracecvt [-f chrome|vcd] [-n names] [-b baud] [port|file|-]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#define TC_IDS          64
+#define TC_MAX_RECORDS  256
+#define TC_BEGIN        0x40    // Kind bits of the id, as in lib/trace.h
+#define TC_END          0x80
+
+typedef struct {
+    uint64_t time_ns;           ///< Since the oldest record
+    uint8_t id;                 ///< Id without the kind bits
+    uint8_t kind;               ///< 0, TC_BEGIN or TC_END
+    uint8_t arg;
+} TcEvent_t;
+
+typedef struct {
+    TcEvent_t events[TC_MAX_RECORDS];
+    unsigned count;
+    uint32_t tick_ns;
+    char names[TC_IDS][32];
+} TcTrace_t;
+
+// The library's events (lib/trace.h)
+static const char *const tc_library_names[] = {
+    "none", "trigger", "twi", "lcd", "lcd_wait", "portd", "key", "arbiter", "arbiter_retry",
+    "clock", "telem_drop"
+};
+
+static void tc_init(TcTrace_t *t) {
+    memset(t, 0, sizeof(*t));
+    for (unsigned id = 0; id < TC_IDS; id++) {
+        if (id < sizeof(tc_library_names) / sizeof(tc_library_names[0])) strcpy(t->names[id], tc_library_names[id]);
+        else snprintf(t->names[id], sizeof(t->names[id]), "id%u", id);
+    }
+}
+
+// `<id> <name>` lines
+static bool tc_names(TcTrace_t *t, FILE *f) {
+    char line[80], name[32];
+    unsigned id;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%u %31s", &id, name) != 2 || id >= TC_IDS) return false;
+        strcpy(t->names[id], name);
+    }
+    return true;
+}
+
+// Skip to the #trace header and read the records up to #end
+static bool tc_parse(TcTrace_t *t, FILE *in) {
+    char line[80];
+    unsigned count, tick, ts, id, arg;
+    bool started = false;
+    uint16_t last = 0;
+    uint64_t ticks = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        if (sscanf(line, "#trace %x %x", &count, &tick) == 2) break;
+    }
+    if (feof(in) || ferror(in)) return false;
+    t->tick_ns = tick;
+    t->count = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        if (!strncmp(line, "#end", 4)) return t->count == count;
+        if (sscanf(line, "%x %x %x", &ts, &id, &arg) != 3 || t->count >= TC_MAX_RECORDS) return false;
+        if (started) ticks += (uint16_t)(ts - last);
+        started = true;
+        last = ts;
+        TcEvent_t *e = &t->events[t->count++];
+        e->time_ns = ticks * t->tick_ns;
+        e->id = id & (TC_IDS - 1);
+        e->kind = id & (TC_BEGIN | TC_END);
+        e->arg = arg;
+    }
+    return false;
+}
+
+static void tc_chrome(const TcTrace_t *t, FILE *out) {
+    bool used[TC_IDS] = { false };
+    unsigned open[TC_IDS] = { 0 };
+    const char *sep = "";
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (unsigned i = 0; i < t->count; i++) used[t->events[i].id] = true;
+    for (unsigned id = 0; id < TC_IDS; id++) {
+        if (!used[id]) continue;
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                sep, id, t->names[id]);
+        sep = ",\n";
+    }
+    for (unsigned i = 0; i < t->count; i++) {
+        const TcEvent_t *e = &t->events[i];
+        const char *ph = "i";
+        if (e->kind == TC_BEGIN) {
+            ph = "B";
+            open[e->id]++;
+        } else if (e->kind == TC_END) {
+            if (!open[e->id]) continue;         // Its begin was overwritten
+            ph = "E";
+            open[e->id]--;
+        }
+        fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"%s\",%s\"ts\":%llu.%03u,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%u}}",
+                sep, t->names[e->id], ph, e->kind ? "" : "\"s\":\"t\",",
+                (unsigned long long)(e->time_ns / 1000), (unsigned)(e->time_ns % 1000), e->id, e->arg);
+        sep = ",\n";
+    }
+    fprintf(out, "\n]}\n");
+}
+
+static void tc_vcd_bits(FILE *out, uint8_t value) {
+    fputc('b', out);
+    for (int bit = 7; bit >= 0; bit--) fputc('0' + ((value >> bit) & 1), out);
+}
+
+static void tc_vcd(const TcTrace_t *t, FILE *out) {
+    bool used[TC_IDS] = { false };
+    uint64_t reset_at[TC_IDS] = { 0 };          // End of a single-event pulse, 0 = none
+    uint64_t now = 0;
+
+    for (unsigned i = 0; i < t->count; i++) used[t->events[i].id] = true;
+    fprintf(out, "$timescale 1ns $end\n$scope module trace $end\n");
+    for (unsigned id = 0; id < TC_IDS; id++) {
+        if (!used[id]) continue;
+        fprintf(out, "$var wire 1 s%u %s $end\n", id, t->names[id]);
+        fprintf(out, "$var wire 8 a%u %s_arg $end\n", id, t->names[id]);
+    }
+    fprintf(out, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+    for (unsigned id = 0; id < TC_IDS; id++) {
+        if (!used[id]) continue;
+        fprintf(out, "0s%u\n", id);
+        tc_vcd_bits(out, 0);
+        fprintf(out, " a%u\n", id);
+    }
+    fprintf(out, "$end\n");
+
+    for (unsigned i = 0; i <= t->count; i++) {
+        uint64_t time = (i < t->count) ? t->events[i].time_ns : UINT64_MAX;
+
+        // Pulses that end before this event, in time order
+        for (;;) {
+            unsigned next = TC_IDS;
+            for (unsigned id = 0; id < TC_IDS; id++) {
+                if (reset_at[id] && reset_at[id] <= time && (next == TC_IDS || reset_at[id] < reset_at[next])) next = id;
+            }
+            if (next == TC_IDS) break;
+            if (reset_at[next] != now) fprintf(out, "#%llu\n", (unsigned long long)(now = reset_at[next]));
+            fprintf(out, "0s%u\n", next);
+            reset_at[next] = 0;
+        }
+        if (i == t->count) break;
+
+        const TcEvent_t *e = &t->events[i];
+        if (time != now || i == 0) fprintf(out, "#%llu\n", (unsigned long long)(now = time));
+        fprintf(out, "%cs%u\n", e->kind == TC_END ? '0' : '1', e->id);
+        tc_vcd_bits(out, e->arg);
+        fprintf(out, " a%u\n", e->id);
+        if (!e->kind) reset_at[e->id] = time + t->tick_ns;
+    }
+}
+
+#ifndef TRACECVT_NO_MAIN
+// Serial port in raw mode at any baud rate; other files are read as they are
+static FILE *tc_open(const char *path, unsigned baud) {
+    struct termios2 tio;
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY | O_NOCTTY) : STDIN_FILENO;
+
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    if (isatty(fd) && ioctl(fd, TCGETS2, &tio) == 0) {
+        tio.c_iflag = 0;
+        tio.c_oflag = 0;
+        tio.c_lflag = 0;
+        tio.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+        tio.c_ispeed = tio.c_ospeed = baud;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        if (ioctl(fd, TCSETS2, &tio) < 0) perror("baud rate");
+    }
+    return fdopen(fd, "r");
+}
+
+int main(int argc, char *argv[]) {
+    static TcTrace_t trace;
+    const char *format = "chrome", *names = NULL;
+    unsigned baud = 250000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:b:")) != -1) {
+        if (opt == 'f') format = optarg;
+        else if (opt == 'n') names = optarg;
+        else if (opt == 'b') baud = strtoul(optarg, NULL, 0);
+        else optind = argc + 1;
+    }
+    if (optind + 1 < argc || optind > argc || (strcmp(format, "chrome") && strcmp(format, "vcd"))) {
+        fprintf(stderr, "usage: %s [-f chrome|vcd] [-n names] [-b baud] [port|file|-]\n", argv[0]);
+        return 2;
+    }
+
+    tc_init(&trace);
+    if (names) {
+        FILE *f = fopen(names, "r");
+        if (!f || !tc_names(&trace, f)) {
+            fprintf(stderr, "%s: bad names file\n", names);
+            return 1;
+        }
+        fclose(f);
+    }
+    FILE *in = tc_open(optind < argc ? argv[optind] : "-", baud);
+    if (!in) return 1;
+    if (!tc_parse(&trace, in)) {
+        fprintf(stderr, "tracecvt: no complete trace dump in the input\n");
+        return 1;
+    }
+
+    if (!strcmp(format, "vcd")) tc_vcd(&trace, stdout);
+    else tc_chrome(&trace, stdout);
+    fprintf(stderr, "%u records, %.3f ms\n", trace.count,
+            trace.count ? trace.events[trace.count - 1].time_ns / 1e6 : 0.0);
+    return 0;
+}
+#endif
@@ -0,0 +1,387 @@
+/**
+ * @file vcdcheck.c
+ * @brief Checks LCD and I2C bus timing in a VCD trace and reports the throughput.
+ * @details Reads the signals written by sim/trace.c (simavr) or host/vcd.c (host tests):
+ *          - RS, RW, EN, DATA: HD44780 parallel bus (lcd.c, glcd.c);
+ *          - TWBR, TWPS, TWCR, TWDR: TWI master registers (i2c_lcd.c). TWDR bytes after
+ *            the address are decoded as a PCF8574 LCD backpack (P0 = RS, P1 = RW, P2 = EN,
+ *            P4-P7 = D4-D7).
+ *
+ *          HD44780 limits (write cycle, VCC 4.5-5.5 V): tcycE >= 500 ns, PWEH >= 230 ns,
+ *          tAS >= 40 ns, tAH >= 10 ns, tDSW >= 80 ns, tH >= 10 ns, 37 us between
+ *          instructions and 1.52 ms after clear/home. I2C limits: SCL <= 400 kHz and bus free
+ *          time between STOP and START >= 4.7 us (standard mode) or 1.3 us (fast mode),
+ *          measured between the TWCR writes that request them.
+ *
+ *          The report shows the minimum seen for each parameter, so the margin left for
+ *          tightening a delay is visible, and the characters per second on each bus
+ *          (mean spacing of data writes closer than 10 ms to each other).
+ *
+ * Usage: vcdcheck [-f F_CPU] trace.vcd  (exit status 1 on a violation)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+
+#define NONE            (-1LL)
+#define BURST_GAP_NS    10000000LL      // Data writes further apart start a new burst
+
+// TWCR bits
+#define TWINT   7
+#define TWSTA   5
+#define TWSTO   4
+
+typedef enum {
+    SIG_RS, SIG_RW, SIG_EN, SIG_DATA, SIG_TWBR, SIG_TWPS, SIG_TWCR, SIG_TWDR, SIG_COUNT
+} Signal_t;
+
+static const char *signal_names[SIG_COUNT] = {
+    "RS", "RW", "EN", "DATA", "TWBR", "TWPS", "TWCR", "TWDR"
+};
+
+// Minimum of a timing parameter against its limit
+typedef struct {
+    const char *name;
+    long long limit_ns;
+    long long min_ns;
+    unsigned long count;
+    unsigned long violations;
+    long long first_violation;
+} Limit_t;
+
+// HD44780 instruction decoder, one per bus
+typedef struct {
+    const char *bus;
+    bool eight_bit;
+    bool nibble_pending;
+    uint8_t nibble;
+    long long transfer_start;       // First strobe of the transfer being assembled
+    long long last_end;             // Last strobe of the previous transfer
+    bool last_slow;                 // Previous instruction was clear/home
+    bool last_none;                 // Previous "instruction" was 0x00
+    long long last_data;            // Last data byte
+    long long burst_ns;
+    unsigned long burst_bytes;
+    unsigned long commands;
+    unsigned long data;
+    Limit_t exec;                   // Spacing after ordinary instructions
+    Limit_t exec_slow;              // Spacing after clear/home
+} Decoder_t;
+
+// Global variables
+static long long timescale_ns = 1;      // Multiplier to ns (sub-ns units are divided)
+static long long timescale_div = 1;
+static char id_of_signal[SIG_COUNT][16];
+static long long f_cpu = 8000000LL;
+
+static Limit_t lim_tcyce = { "tcycE", 500, NONE, 0, 0, NONE };
+static Limit_t lim_pweh = { "PWEH", 230, NONE, 0, 0, NONE };
+static Limit_t lim_tas = { "tAS", 40, NONE, 0, 0, NONE };
+static Limit_t lim_tah = { "tAH", 10, NONE, 0, 0, NONE };
+static Limit_t lim_tdsw = { "tDSW", 80, NONE, 0, 0, NONE };
+static Limit_t lim_th = { "tH", 10, NONE, 0, 0, NONE };
+static Limit_t lim_tbuf = { "tBUF", 4700, NONE, 0, 0, NONE };
+
+static Decoder_t dec_parallel = {
+    .bus = "parallel", .eight_bit = true, .transfer_start = NONE, .last_end = NONE, .last_data = NONE,
+    .exec = { "exec", 37000, NONE, 0, 0, NONE },
+    .exec_slow = { "exec clear/home", 1520000, NONE, 0, 0, NONE }
+};
+static Decoder_t dec_twi = {
+    .bus = "twi", .eight_bit = true, .transfer_start = NONE, .last_end = NONE, .last_data = NONE,
+    .exec = { "exec", 37000, NONE, 0, 0, NONE },
+    .exec_slow = { "exec clear/home", 1520000, NONE, 0, 0, NONE }
+};
+
+// Parallel bus state
+static int val[SIG_COUNT];
+static bool known[SIG_COUNT];
+static long long changed[SIG_COUNT];    // Time of the last change
+static long long en_rise = NONE;
+static long long en_fall = NONE;
+static bool check_tah, check_th;
+
+// TWI state
+static long long twi_stop = NONE;
+static bool twi_expect_sla;
+static int twi_port = 0xFF;
+static unsigned long twi_frames;
+static double twi_scl_max;
+
+static void limit_add(Limit_t *l, long long ns, long long now) {
+    l->count++;
+    if (l->min_ns == NONE || ns < l->min_ns) l->min_ns = ns;
+    if (ns < l->limit_ns) {
+        if (!l->violations) l->first_violation = now;
+        l->violations++;
+    }
+}
+
+static unsigned long limit_print(const char *bus, const Limit_t *l) {
+    if (!l->count) return 0;
+    printf("  %-9s %-16s min %10.3f us  limit %9.3f us  margin %9.3f us  %s",
+           bus, l->name, l->min_ns / 1000.0, l->limit_ns / 1000.0,
+           (l->min_ns - l->limit_ns) / 1000.0, l->violations ? "FAIL" : "ok");
+    if (l->violations) printf(" (%lu of %lu, first at %.3f ms)", l->violations, l->count, l->first_violation / 1e6);
+    printf("\n");
+    return l->violations;
+}
+
+// One complete 8-bit transfer
+static void decoder_byte(Decoder_t *d, bool rs, uint8_t value, long long start, long long end) {
+    if (d->last_end != NONE && !d->last_none) {
+        limit_add(d->last_slow ? &d->exec_slow : &d->exec, start - d->last_end, start);
+    }
+    d->last_end = end;
+    d->last_slow = false;
+    d->last_none = false;
+
+    if (rs) {
+        d->data++;
+        if (d->last_data != NONE && end - d->last_data < BURST_GAP_NS) {
+            d->burst_ns += end - d->last_data;
+            d->burst_bytes++;
+        }
+        d->last_data = end;
+        return;
+    }
+
+    d->commands++;
+    if (value == 0x00) {
+        d->last_none = true;        // Not an instruction (high nibble of 0x03 during init)
+    } else if ((value & 0xE0) == 0x20) {
+        d->eight_bit = value & 0x10;
+        d->nibble_pending = false;
+    } else if (value == 0x01 || (value & 0xFE) == 0x02) {
+        d->last_slow = true;
+    }
+}
+
+// Falling EN edge
+static void decoder_strobe(Decoder_t *d, bool rs, bool rw, uint8_t data, long long now) {
+    if (rw) return;                 // Busy flag reads are not instructions
+    if (d->eight_bit) {
+        decoder_byte(d, rs, data, now, now);
+    } else if (!d->nibble_pending) {
+        d->nibble = data & 0xF0;
+        d->nibble_pending = true;
+        d->transfer_start = now;
+    } else {
+        d->nibble_pending = false;
+        decoder_byte(d, rs, d->nibble | (data >> 4), d->transfer_start, now);
+    }
+}
+
+static void decoder_print(const Decoder_t *d, unsigned long *violations) {
+    if (!d->commands && !d->data) return;
+    printf("  %-9s %lu instructions, %lu data bytes", d->bus, d->commands, d->data);
+    if (d->burst_bytes) printf(", %.0f chars/s", d->burst_bytes * 1e9 / d->burst_ns);
+    printf("\n");
+    *violations += limit_print(d->bus, &d->exec);
+    *violations += limit_print(d->bus, &d->exec_slow);
+}
+
+static void on_change(Signal_t sig, int value, bool valid, long long now) {
+    int old_value = val[sig];
+    bool was_known = known[sig];
+    val[sig] = value;
+    known[sig] = valid;
+    if (!valid) return;
+
+    switch (sig) {
+    case SIG_RS:
+    case SIG_RW:
+        // The first traced write only shows a level held since before: not an edge
+        if (was_known) changed[sig] = now;
+        if (check_tah) {
+            limit_add(&lim_tah, now - en_fall, now);
+            check_tah = false;
+        }
+        break;
+    case SIG_DATA:
+        changed[sig] = now;
+        if (check_th) {
+            limit_add(&lim_th, now - en_fall, now);
+            check_th = false;
+        }
+        break;
+    case SIG_EN:
+        if (was_known && old_value == value) break;
+        if (value) {
+            if (en_rise != NONE) limit_add(&lim_tcyce, now - en_rise, now);
+            long long setup = changed[SIG_RS] > changed[SIG_RW] ? changed[SIG_RS] : changed[SIG_RW];
+            if (setup != NONE) limit_add(&lim_tas, now - setup, now);
+            en_rise = now;
+        } else if (was_known && en_rise != NONE) {
+            limit_add(&lim_pweh, now - en_rise, now);
+            if (changed[SIG_DATA] != NONE) limit_add(&lim_tdsw, now - changed[SIG_DATA], now);
+            en_fall = now;
+            check_tah = check_th = true;
+            decoder_strobe(&dec_parallel, val[SIG_RS], val[SIG_RW], val[SIG_DATA], now);
+        }
+        break;
+    case SIG_TWCR:
+        if (!(value & (1 << TWINT))) break;
+        if (value & (1 << TWSTO)) {
+            twi_stop = now;
+            twi_frames++;
+        } else if (value & (1 << TWSTA)) {
+            double scl = (double)f_cpu / (16 + 2.0 * val[SIG_TWBR] * (1 << (2 * (val[SIG_TWPS] & 3))));
+            if (scl > twi_scl_max) twi_scl_max = scl;
+            if (scl > 100000.0) lim_tbuf.limit_ns = 1300;     // Fast mode
+            if (twi_stop != NONE) limit_add(&lim_tbuf, now - twi_stop, now);
+            twi_stop = NONE;
+            twi_expect_sla = true;
+        }
+        break;
+    case SIG_TWDR:
+        if (twi_expect_sla) {
+            twi_expect_sla = false;
+            twi_port = 0xFF;
+            break;
+        }
+        if ((twi_port & 0x04) && !(value & 0x04)) {
+            decoder_strobe(&dec_twi, value & 0x01, value & 0x02, (value & 0xF0) | 0x0F, now);
+        }
+        twi_port = value;
+        break;
+    default:
+        break;
+    }
+}
+
+static int id_index(const char *id) {
+    for (int s = 0; s < SIG_COUNT; s++) {
+        if (id_of_signal[s][0] && strcmp(id_of_signal[s], id) == 0) return s;
+    }
+    return -1;
+}
+
+static bool parse_timescale(const char *text) {
+    char unit[8] = "";
+    long long n = 1;
+    if (sscanf(text, "%lld%7s", &n, unit) < 1) return false;
+    if (!strcmp(unit, "s")) timescale_ns = n * 1000000000LL;
+    else if (!strcmp(unit, "ms")) timescale_ns = n * 1000000LL;
+    else if (!strcmp(unit, "us")) timescale_ns = n * 1000LL;
+    else if (!strcmp(unit, "ns")) timescale_ns = n;
+    else if (!strcmp(unit, "ps")) { timescale_ns = n; timescale_div = 1000; }
+    else if (!strcmp(unit, "fs")) { timescale_ns = n; timescale_div = 1000000; }
+    else return false;
+    return true;
+}
+
+static int parse_value(const char *bits, bool *valid) {
+    int value = 0;
+    *valid = true;
+    for (; *bits; bits++) {
+        if (*bits == '0' || *bits == '1') value = (value << 1) | (*bits - '0');
+        else *valid = false;
+    }
+    return value;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-f") && i + 1 < argc) f_cpu = strtoll(argv[++i], NULL, 0);
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [-f F_CPU] trace.vcd\n", argv[0]);
+        return 2;
+    }
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 2;
+    }
+
+    for (int s = 0; s < SIG_COUNT; s++) changed[s] = NONE;
+
+    // Header: $timescale and $var, up to $enddefinitions
+    char token[256];
+    char timescale[32] = "";
+    bool in_timescale = false;
+    while (fscanf(f, "%255s", token) == 1) {
+        if (!strcmp(token, "$enddefinitions")) break;
+        if (!strcmp(token, "$timescale")) {
+            in_timescale = true;
+        } else if (in_timescale) {
+            if (!strcmp(token, "$end")) {
+                in_timescale = false;
+                if (!parse_timescale(timescale)) {
+                    fprintf(stderr, "%s: unsupported timescale '%s'\n", path, timescale);
+                    return 2;
+                }
+            } else {
+                strncat(timescale, token, sizeof(timescale) - strlen(timescale) - 1);
+            }
+        } else if (!strcmp(token, "$var")) {
+            char type[32], id[16], name[64];
+            int width;
+            if (fscanf(f, "%31s %d %15s %63s", type, &width, id, name) != 4) break;
+            for (int s = 0; s < SIG_COUNT; s++) {
+                if (!strcasecmp(name, signal_names[s])) strcpy(id_of_signal[s], id);
+            }
+        }
+    }
+
+    // Value changes
+    long long now = 0;
+    while (fscanf(f, "%255s", token) == 1) {
+        bool valid = false;
+        int s;
+        if (token[0] == '#') {
+            now = strtoll(token + 1, NULL, 10) * timescale_ns / timescale_div;
+        } else if (token[0] == '$') {
+            continue;               // $dumpvars, $end, $comment ...
+        } else if (token[0] == 'b' || token[0] == 'B') {
+            char id[16];
+            if (fscanf(f, "%15s", id) != 1) break;
+            int value = parse_value(token + 1, &valid);
+            if ((s = id_index(id)) >= 0) on_change(s, value, valid, now);
+        } else if (token[0] == 'r' || token[0] == 'R') {
+            char id[16];
+            if (fscanf(f, "%15s", id) != 1) break;
+        } else if (strchr("01xXzZ", token[0])) {
+            if ((s = id_index(token + 1)) >= 0) {
+                char bit[2] = { token[0], 0 };
+                int value = parse_value(bit, &valid);
+                on_change(s, value, valid, now);
+            }
+        }
+    }
+    fclose(f);
+
+    // Report
+    unsigned long violations = 0;
+    printf("%s: %.3f ms traced\n", path, now / 1e6);
+    if (lim_pweh.count) {
+        violations += limit_print("parallel", &lim_pweh);
+        violations += limit_print("parallel", &lim_tcyce);
+        violations += limit_print("parallel", &lim_tas);
+        violations += limit_print("parallel", &lim_tah);
+        violations += limit_print("parallel", &lim_tdsw);
+        violations += limit_print("parallel", &lim_th);
+    }
+    decoder_print(&dec_parallel, &violations);
+
+    if (twi_scl_max > 0) {
+        bool fast = twi_scl_max > 100000.0;
+        bool scl_ok = twi_scl_max <= 400000.0;
+        printf("  %-9s SCL %.1f kHz (%s mode), %lu frames  %s\n", "twi", twi_scl_max / 1000.0,
+               fast ? "fast" : "standard", twi_frames, scl_ok ? "ok" : "FAIL");
+        if (!scl_ok) violations++;
+        violations += limit_print("twi", &lim_tbuf);
+    }
+    decoder_print(&dec_twi, &violations);
+
+    if (!lim_pweh.count && twi_scl_max == 0) printf("  no LCD or TWI activity found\n");
+    printf("%s (%lu violations)\n", violations ? "FAIL" : "PASS", violations);
+    return violations ? 1 : 0;
+}